@@ -0,0 +1,185 @@
+#include "tick/bars.h"
+
+#include "tick/output.h"
+#include "tick/symbol.h"
+#include "tick/error.h"
+#include "tick/dsv.h"
+#include "tick/taq.h"
+#include "tick/ob.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char header[] = "Date\tSymbol\tTime\tOpen\tHigh\tLow\tClose\tVolume\tVWAP\tTrades\n";
+
+void bars_init(struct bars *bars, struct output *out, uint64_t interval)
+{
+	*bars = (struct bars) {
+		.out		= out,
+		.interval	= interval,
+	};
+}
+
+void bars_release(struct bars *bars)
+{
+	free(bars->active);
+	free(bars->bars);
+}
+
+void bars_write_header(struct bars *bars)
+{
+	output_write_header(bars->out, header, strlen(header));
+}
+
+/*
+ * A new date starts a new session, so the bars of the previous one are
+ * written out first.  Feeds announce the date once per exchange, which
+ * does not start a new session.
+ */
+void bars_date(struct bars *bars, const char *date, size_t len)
+{
+	if (len >= BARS_DATE_LEN)
+		len = BARS_DATE_LEN - 1;
+
+	if (len == bars->date_len && !memcmp(bars->date, date, len))
+		return;
+
+	bars_flush(bars);
+
+	memcpy(bars->date, date, len);
+
+	bars->date_len = len;
+}
+
+/*
+ * Longest row after the Date and Symbol columns:
+ */
+#define BARS_ROW_LEN		(3 * DSV_UINT_MAX_LEN + 5 * DSV_PRICE_MAX_LEN)
+
+static void bars_write(struct bars *bars, uint32_t symbol, struct bar *bar)
+{
+	size_t idx = 0;
+	uint64_t vwap;
+	char *buf;
+
+	vwap = (bar->notional + bar->volume / 2) / bar->volume;
+
+	output_begin_row(bars->out, bars->start);
+
+	buf = output_reserve(bars->out, bars->date_len + 1 + SYMBOL_MAX_LEN + 1 + BARS_ROW_LEN);
+
+	idx += dsv_fmt_value(buf + idx, bars->date, bars->date_len, '\t');
+	idx += dsv_fmt_value(buf + idx, symbol_name(symbol), symbol_len(symbol), '\t');
+	idx += dsv_fmt_uint(buf + idx, bars->start, '\t');
+	idx += dsv_fmt_price(buf + idx, bar->open, '\t');
+	idx += dsv_fmt_price(buf + idx, bar->high, '\t');
+	idx += dsv_fmt_price(buf + idx, bar->low, '\t');
+	idx += dsv_fmt_price(buf + idx, bar->close, '\t');
+	idx += dsv_fmt_uint(buf + idx, bar->volume, '\t');
+	idx += dsv_fmt_price(buf + idx, vwap, '\t');
+	idx += dsv_fmt_uint(buf + idx, bar->nr_trades, '\n');
+
+	output_commit(bars->out, idx);
+}
+
+/*
+ * Write out the bars of the current interval.
+ */
+void bars_flush(struct bars *bars)
+{
+	unsigned int i;
+
+	for (i = 0; i < bars->nr_active; i++) {
+		uint32_t symbol = bars->active[i];
+		struct bar *bar = &bars->bars[symbol];
+
+		bars_write(bars, symbol, bar);
+
+		bar->nr_trades = 0;
+	}
+
+	bars->nr_active = 0;
+}
+
+static void bars_grow(struct bars *bars, uint32_t symbol)
+{
+	unsigned int nr = bars->nr_bars ? bars->nr_bars : 1024;
+
+	while (nr <= symbol)
+		nr *= 2;
+
+	bars->bars = realloc(bars->bars, nr * sizeof(*bars->bars));
+	bars->active = realloc(bars->active, nr * sizeof(*bars->active));
+	if (!bars->bars || !bars->active)
+		error("out of memory");
+
+	memset(bars->bars + bars->nr_bars, 0, (nr - bars->nr_bars) * sizeof(*bars->bars));
+
+	bars->nr_bars = nr;
+}
+
+void bars_trade(struct bars *bars, uint32_t symbol, uint64_t time, uint64_t price, uint64_t quantity)
+{
+	uint64_t start = time - time % bars->interval;
+	struct bar *bar;
+
+	if (!quantity)
+		return;
+
+	if (start != bars->start) {
+		bars_flush(bars);
+
+		bars->start = start;
+	}
+
+	if (symbol >= bars->nr_bars)
+		bars_grow(bars, symbol);
+
+	bar = &bars->bars[symbol];
+
+	if (!bar->nr_trades) {
+		*bar = (struct bar) {
+			.open		= price,
+			.high		= price,
+			.low		= price,
+		};
+
+		bars->active[bars->nr_active++] = symbol;
+	}
+
+	if (price > bar->high)
+		bar->high = price;
+
+	if (price < bar->low)
+		bar->low = price;
+
+	bar->close	= price;
+	bar->volume	+= quantity;
+	bar->notional	+= (unsigned __int128) price * quantity;
+	bar->nr_trades++;
+}
+
+/*
+ * Executions and trades of the OB feed are the trades, except for
+ * executions that the feed marks as not to be counted in volume.
+ */
+void bars_ob_event(void *data, struct ob_event *event)
+{
+	struct bars *bars = data;
+
+	if (event->type == OB_EVENT_DATE)
+		bars_date(bars, event->date, event->date_len);
+	else if ((event->type == OB_EVENT_EXECUTE_ORDER || event->type == OB_EVENT_TRADE) &&
+		 (event->fields & OB_FIELD_PRICE) && !event->non_printable)
+		bars_trade(bars, event->symbol, event->time, event->price, event->quantity);
+}
+
+void bars_taq_event(void *data, struct taq_event *event)
+{
+	struct bars *bars = data;
+
+	if (event->type == TAQ_EVENT_DATE)
+		bars_date(bars, event->date, event->date_len);
+	else if (event->type == TAQ_EVENT_TRADE)
+		bars_trade(bars, event->symbol, event->time, event->trade_price, event->trade_quantity);
+}
@@ -38,3 +38,20 @@ unsigned char base36_table[64] = {
 	[BASE36_DIGIT('Y')] = 34,
 	[BASE36_DIGIT('Z')] = 35,
 };
+
+/*
+ * Decode 'nr' IDs of BASE36_ID_LEN characters that are 'stride' bytes
+ * apart.  Decoding stops at the first ID that is not valid base 36.
+ * Returns the number of IDs decoded.
+ */
+size_t base36_decode_ids(const char *s, size_t stride, size_t nr, uint64_t *values)
+{
+	size_t i;
+
+	for (i = 0; i < nr; i++, s += stride) {
+		if (!base36_decode_id_checked(s, &values[i]))
+			break;
+	}
+
+	return i;
+}
@@ -0,0 +1,260 @@
+#include "tick/bats/gen.h"
+
+#include "libtrading/proto/bats_pitch_message.h"
+
+#include "tick/base36.h"
+#include "tick/gen.h"
+
+#include <string.h>
+
+#define NSEC_PER_MSEC		1000000ULL
+
+#define ADD_ORDER_LONG_PROB	0.05
+#define TRADE_LONG_PROB		0.05
+#define TRADE_BREAK_PROB	0.002
+
+/*
+ * Order and execution IDs are the sequence numbers of the model multiplied
+ * modulo 36^12, so that they use all twelve base 36 characters like the
+ * IDs of a real feed.  The multiplier is coprime to 36, which keeps the IDs
+ * unique.  Execution IDs start far from the order IDs.
+ */
+#define ID_MODULUS		4738381338321616896ULL	/* 36^12 */
+#define ID_MULTIPLIER		1923952142679964693ULL
+#define EXEC_ID_BASE		(1ULL << 40)
+
+struct bats_pitch_gen {
+	struct gen_output	*out;
+	uint64_t		nr_messages;
+	uint64_t		break_exec_id;	/* trade to break, or zero */
+};
+
+/*
+ * Messages are framed as 'S', the message and a line feed.
+ */
+static void bats_pitch_write(struct bats_pitch_gen *pitch, const void *msg, size_t len)
+{
+	gen_output_write(pitch->out, "S", 1);
+	gen_output_write(pitch->out, msg, len);
+	gen_output_write(pitch->out, "\n", 1);
+
+	pitch->nr_messages++;
+}
+
+static void bats_pitch_header(struct pitch_message *msg, uint64_t time, u8 msg_type)
+{
+	gen_digits(msg->Timestamp, sizeof(msg->Timestamp), time / NSEC_PER_MSEC);
+
+	msg->MessageType = msg_type;
+}
+
+static void bats_pitch_base36(char *buf, size_t len, uint64_t value)
+{
+	char tmp[13];
+	size_t n;
+
+	n = base36_encode(tmp, value);
+
+	memset(buf, '0', len - n);
+	memcpy(buf + len - n, tmp, n);
+}
+
+static void bats_pitch_id(char *buf, uint64_t seq)
+{
+	bats_pitch_base36(buf, BASE36_ID_LEN, (unsigned __int128) seq * ID_MULTIPLIER % ID_MODULUS);
+}
+
+static void bats_pitch_symbol(char *buf, size_t len, struct gen_symbol *sym)
+{
+	memset(buf, ' ', len);
+	memcpy(buf, sym->name, GEN_SYMBOL_LEN);
+}
+
+static void bats_pitch_add_order(struct bats_pitch_gen *pitch, struct gen *gen,
+	uint64_t time, uint32_t symbol, uint64_t order_id, char side,
+	uint32_t quantity, uint64_t price)
+{
+	struct gen_symbol *sym = &gen->symbols[symbol];
+
+	if (gen_uniform(gen) < ADD_ORDER_LONG_PROB) {
+		struct pitch_msg_add_order_long m;
+
+		bats_pitch_header((void *) &m, time, PITCH_MSG_ADD_ORDER_LONG);
+		bats_pitch_id(m.OrderID, order_id);
+		m.SideIndicator = side;
+		gen_digits(m.Shares, sizeof(m.Shares), quantity);
+		bats_pitch_symbol(m.StockSymbol, sizeof(m.StockSymbol), sym);
+		gen_digits(m.Price, sizeof(m.Price), price);
+		m.Display = 'Y';
+		memcpy(m.ParticipantID, "GENX", sizeof(m.ParticipantID));
+
+		bats_pitch_write(pitch, &m, sizeof(m));
+	} else {
+		struct pitch_msg_add_order_short m;
+
+		bats_pitch_header((void *) &m, time, PITCH_MSG_ADD_ORDER_SHORT);
+		bats_pitch_id(m.OrderID, order_id);
+		m.SideIndicator = side;
+		gen_digits(m.Shares, sizeof(m.Shares), quantity);
+		bats_pitch_symbol(m.StockSymbol, sizeof(m.StockSymbol), sym);
+		gen_digits(m.Price, sizeof(m.Price), price);
+		m.Display = 'Y';
+
+		bats_pitch_write(pitch, &m, sizeof(m));
+	}
+}
+
+static void bats_pitch_order_executed(struct bats_pitch_gen *pitch, struct gen_event *event)
+{
+	struct pitch_msg_order_executed m;
+
+	bats_pitch_header((void *) &m, event->time, PITCH_MSG_ORDER_EXECUTED);
+	bats_pitch_id(m.OrderID, event->order_id);
+	gen_digits(m.ExecutedShares, sizeof(m.ExecutedShares), event->quantity);
+	bats_pitch_id(m.ExecutionID, EXEC_ID_BASE + event->exec_id);
+
+	bats_pitch_write(pitch, &m, sizeof(m));
+}
+
+static void bats_pitch_order_cancel(struct bats_pitch_gen *pitch, struct gen_event *event)
+{
+	struct pitch_msg_order_cancel m;
+
+	bats_pitch_header((void *) &m, event->time, PITCH_MSG_ORDER_CANCEL);
+	bats_pitch_id(m.OrderID, event->order_id);
+	gen_digits(m.CanceledShares, sizeof(m.CanceledShares), event->quantity);
+
+	bats_pitch_write(pitch, &m, sizeof(m));
+}
+
+static void bats_pitch_trade(struct bats_pitch_gen *pitch, struct gen *gen, struct gen_event *event)
+{
+	struct gen_symbol *sym = &gen->symbols[event->symbol];
+
+	if (gen_uniform(gen) < TRADE_LONG_PROB) {
+		struct pitch_msg_trade_long m;
+
+		bats_pitch_header((void *) &m, event->time, PITCH_MSG_TRADE_LONG);
+		bats_pitch_base36(m.OrderID, sizeof(m.OrderID), 0);
+		m.SideIndicator = event->side;
+		gen_digits(m.Shares, sizeof(m.Shares), event->quantity);
+		bats_pitch_symbol(m.StockSymbol, sizeof(m.StockSymbol), sym);
+		gen_digits(m.Price, sizeof(m.Price), event->price);
+		bats_pitch_id(m.ExecutionID, EXEC_ID_BASE + event->exec_id);
+
+		bats_pitch_write(pitch, &m, sizeof(m));
+	} else {
+		struct pitch_msg_trade_short m;
+
+		bats_pitch_header((void *) &m, event->time, PITCH_MSG_TRADE_SHORT);
+		bats_pitch_base36(m.OrderID, sizeof(m.OrderID), 0);
+		m.SideIndicator = event->side;
+		gen_digits(m.Shares, sizeof(m.Shares), event->quantity);
+		bats_pitch_symbol(m.StockSymbol, sizeof(m.StockSymbol), sym);
+		gen_digits(m.Price, sizeof(m.Price), event->price);
+		bats_pitch_id(m.ExecutionID, EXEC_ID_BASE + event->exec_id);
+
+		bats_pitch_write(pitch, &m, sizeof(m));
+	}
+}
+
+static void bats_pitch_trade_break(struct bats_pitch_gen *pitch, uint64_t time, uint64_t exec_id)
+{
+	struct pitch_msg_trade_break m;
+
+	bats_pitch_header((void *) &m, time, PITCH_MSG_TRADE_BREAK);
+	bats_pitch_id(m.ExecutionID, EXEC_ID_BASE + exec_id);
+
+	bats_pitch_write(pitch, &m, sizeof(m));
+}
+
+/*
+ * Every symbol starts the day with a symbol clear and a trading status
+ * that opens it for trading.
+ */
+static void bats_pitch_symbol_open(struct bats_pitch_gen *pitch, uint64_t time, struct gen_symbol *sym)
+{
+	struct pitch_msg_symbol_clear clear;
+	struct pitch_msg_trading_status status;
+
+	bats_pitch_header((void *) &clear, time, PITCH_MSG_SYMBOL_CLEAR);
+	bats_pitch_symbol(clear.StockSymbol, sizeof(clear.StockSymbol), sym);
+
+	bats_pitch_write(pitch, &clear, sizeof(clear));
+
+	bats_pitch_header((void *) &status, time, PITCH_MSG_TRADING_STATUS);
+	bats_pitch_symbol(status.StockSymbol, sizeof(status.StockSymbol), sym);
+	status.HaltStatus	= 'T';
+	status.RegSHOAction	= '0';
+	status.Reserved1	= ' ';
+	status.Reserved2	= ' ';
+
+	bats_pitch_write(pitch, &status, sizeof(status));
+}
+
+/*
+ * PITCH has no delete or replace messages: a delete cancels all remaining
+ * shares and a replace is a cancel followed by an add.  A few trades and
+ * executions are broken with the next message.
+ */
+void bats_pitch_gen(struct gen *gen, struct gen_output *out, uint64_t nr_messages)
+{
+	uint64_t next_progress = GEN_PROGRESS_STEP;
+	struct bats_pitch_gen pitch;
+	unsigned int i;
+
+	pitch = (struct bats_pitch_gen) {
+		.out		= out,
+	};
+
+	for (i = 0; i < gen->nr_symbols && pitch.nr_messages < nr_messages; i++)
+		bats_pitch_symbol_open(&pitch, gen->time, &gen->symbols[i]);
+
+	while (pitch.nr_messages < nr_messages) {
+		struct gen_event event;
+
+		gen_next(gen, &event);
+
+		if (pitch.break_exec_id) {
+			bats_pitch_trade_break(&pitch, event.time, pitch.break_exec_id);
+
+			pitch.break_exec_id = 0;
+		}
+
+		switch (event.type) {
+		case GEN_EVENT_ADD:
+			bats_pitch_add_order(&pitch, gen, event.time, event.symbol,
+				event.order_id, event.side, event.quantity, event.price);
+			break;
+		case GEN_EVENT_EXECUTE:
+			bats_pitch_order_executed(&pitch, &event);
+
+			if (gen_uniform(gen) < TRADE_BREAK_PROB)
+				pitch.break_exec_id = event.exec_id;
+			break;
+		case GEN_EVENT_CANCEL:
+		case GEN_EVENT_DELETE:
+			bats_pitch_order_cancel(&pitch, &event);
+			break;
+		case GEN_EVENT_REPLACE:
+			bats_pitch_order_cancel(&pitch, &event);
+			bats_pitch_add_order(&pitch, gen, event.time, event.symbol,
+				event.new_order_id, event.side, event.new_quantity, event.new_price);
+			break;
+		case GEN_EVENT_TRADE:
+			bats_pitch_trade(&pitch, gen, &event);
+
+			if (gen_uniform(gen) < TRADE_BREAK_PROB)
+				pitch.break_exec_id = event.exec_id;
+			break;
+		default:
+			break;
+		}
+
+		if (pitch.nr_messages >= next_progress) {
+			gen_progress(pitch.nr_messages, nr_messages);
+
+			next_progress += GEN_PROGRESS_STEP;
+		}
+	}
+}
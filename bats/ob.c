@@ -4,11 +4,13 @@
 #include "libtrading/buffer.h"
 
 #include "tick/progress.h"
-#include "tick/decimal.h"
+#include "tick/profile.h"
+#include "tick/memory.h"
 #include "tick/base10.h"
 #include "tick/base36.h"
 #include "tick/format.h"
 #include "tick/stream.h"
+#include "tick/symbol.h"
 #include "tick/error.h"
 #include "tick/types.h"
 #include "tick/ob.h"
@@ -28,119 +30,163 @@ static gboolean free_entry(gpointer __maybe_unused key, gpointer __maybe_unused
 	return TRUE;
 }
 
+static gboolean order_of_symbol(gpointer __maybe_unused key, gpointer val, gpointer data)
+{
+	struct pitch_order_info *info = val;
+
+	return info->symbol == *(uint32_t *) data;
+}
+
+static inline void pitch_order_event(struct ob_event *event, struct pitch_order_info *info)
+{
+	event->fields		|= OB_FIELD_ORDER;
+	event->order_time	= info->time;
+	event->order_price	= info->price;
+	event->order_remaining	= info->remaining;
+	event->order_side	= info->side;
+}
+
+/*
+ * An order ID that is still on the book replaces the order.  The old order
+ * is canceled first so that books built from the events stay consistent.
+ */
+static void bats_pitch_add_order(struct pitch_session *session, struct pitch_order_info *info)
+{
+	struct pitch_order_info *old;
+	struct ob_event event;
+
+	old = g_hash_table_lookup(session->order_hash, &info->order_id);
+	if (old) {
+		event = (struct ob_event) {
+			.type		= OB_EVENT_CANCEL_ORDER,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_QUANTITY,
+			.time		= info->time,
+			.exchange	= session->exchange,
+			.exchange_len	= session->exchange_len,
+			.symbol		= old->symbol,
+			.order_id	= old->order_id,
+			.quantity	= old->remaining,
+		};
+
+		old->remaining = 0;
+
+		pitch_order_event(&event, old);
+
+		ob_write_event(session->ob_writer, &event);
+	}
+
+	g_hash_table_replace(session->order_hash, &info->order_id, info);
+}
+
 static void bats_pitch_write(struct pitch_session *session, struct pitch_message *msg)
 {
 	struct pitch_order_info *info = NULL;
 	struct ob_event event;
+	bool selected;
+
+	profile_enter(PROFILE_STAGE_LOOKUP);
 
 	info = pitch_session_lookup_order(session, msg);
+
+	profile_leave();
+
 	if (info)
 		goto found;
 
-	if (!pitch_session_filter_msg(session, msg))
+	profile_enter(PROFILE_STAGE_FILTER);
+
+	selected = pitch_session_filter_msg(session, msg);
+
+	profile_leave();
+
+	if (!selected)
 		return;
 
 found:
 	switch (msg->MessageType) {
 	case PITCH_MSG_SYMBOL_CLEAR: {
 		struct pitch_msg_symbol_clear *m = (void *) msg;
+		uint32_t symbol = pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol));
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_CLEAR,
-			.time		= m->Timestamp,
-			.time_len	= sizeof(m->Timestamp),
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL,
+			.time		= pitch_timestamp(m->Timestamp),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
+			.symbol		= symbol,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
-		g_hash_table_foreach_remove(session->order_hash, free_entry, NULL);
+		g_hash_table_foreach_remove(session->order_hash, order_of_symbol, &symbol);
 
 		break;
 	}
 	case PITCH_MSG_ADD_ORDER_SHORT: {
 		struct pitch_msg_add_order_short *m = (void *) msg;
-		unsigned long order_id;
 
 		assert(info == NULL);
 
 		info = malloc(sizeof(*info));
-
-		order_id = base36_decode(m->OrderID, sizeof(m->OrderID));
-
-		info->order_id	= order_id;
+		info->order_id	= base36_decode_id(m->OrderID);
+		info->time	= pitch_timestamp(m->Timestamp);
 		info->remaining	= base10_decode(m->Shares, sizeof(m->Shares));
-		memcpy(info->price, m->Price, sizeof(m->Price));
+		info->price	= base10_decode(m->Price, sizeof(m->Price));
+		info->symbol	= pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol));
+		info->side	= m->SideIndicator;
 
-		g_hash_table_insert(session->order_hash, &info->order_id, info);
+		bats_pitch_add_order(session, info);
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_ADD_ORDER,
-			.time		= m->Timestamp,
-			.time_len	= sizeof(m->Timestamp),
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_QUANTITY | OB_FIELD_PRICE,
+			.time		= info->time,
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= m->OrderID,
-			.order_id_len	= sizeof(m->OrderID),
-			.side		= &m->SideIndicator,
-			.side_len	= sizeof(m->SideIndicator),
-			.quantity	= m->Shares,
-			.quantity_len	= sizeof(m->Shares),
-			.price		= (struct decimal) {
-				.integer	= m->Price,
-				.integer_len	= PITCH_PRICE_INT_LEN,
-				.fraction	= m->Price + PITCH_PRICE_INT_LEN,
-				.fraction_len	= PITCH_PRICE_FRACTION_LEN,
-			},
+			.symbol		= info->symbol,
+			.order_id	= info->order_id,
+			.side		= info->side,
+			.quantity	= info->remaining,
+			.price		= info->price,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
 	case PITCH_MSG_ADD_ORDER_LONG: {
 		struct pitch_msg_add_order_long *m = (void *) msg;
-		unsigned long order_id;
 
 		assert(info == NULL);
 
-		order_id = base36_decode(m->OrderID, sizeof(m->OrderID));
-
 		info = malloc(sizeof(*info));
-		info->order_id	= order_id;
+		info->order_id	= base36_decode_id(m->OrderID);
+		info->time	= pitch_timestamp(m->Timestamp);
 		info->remaining	= base10_decode(m->Shares, sizeof(m->Shares));
-		memcpy(info->price, m->Price, sizeof(m->Price));
+		info->price	= base10_decode(m->Price, sizeof(m->Price));
+		info->symbol	= pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol));
+		info->side	= m->SideIndicator;
 
-		g_hash_table_insert(session->order_hash, &info->order_id, info);
+		bats_pitch_add_order(session, info);
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_ADD_ORDER,
-			.time		= m->Timestamp,
-			.time_len	= sizeof(m->Timestamp),
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_QUANTITY | OB_FIELD_PRICE,
+			.time		= info->time,
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= m->OrderID,
-			.order_id_len	= sizeof(m->OrderID),
-			.side		= &m->SideIndicator,
-			.side_len	= sizeof(m->SideIndicator),
-			.quantity	= m->Shares,
-			.quantity_len	= sizeof(m->Shares),
-			.price		= (struct decimal) {
-				.integer	= m->Price,
-				.integer_len	= PITCH_PRICE_INT_LEN,
-				.fraction	= m->Price + PITCH_PRICE_INT_LEN,
-				.fraction_len	= PITCH_PRICE_FRACTION_LEN,
-			},
+			.symbol		= info->symbol,
+			.order_id	= info->order_id,
+			.side		= info->side,
+			.quantity	= info->remaining,
+			.price		= info->price,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
@@ -158,43 +204,35 @@ found:
 
 		info->remaining	-= nr_executed;
 
-		exec_id = base36_decode(m->ExecutionID, sizeof(m->ExecutionID));
+		exec_id = base36_decode_id(m->ExecutionID);
 
 		e_info = malloc(sizeof(*e_info));
 		e_info->exec_id	= exec_id;
-		e_info->symbol	= session->filter.symbol;
+		e_info->symbol	= info->symbol;
 
 		g_hash_table_insert(session->exec_hash, &e_info->exec_id, e_info);
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_EXECUTE_ORDER,
-			.time		= m->Timestamp,
-			.time_len	= sizeof(m->Timestamp),
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_EXEC_ID | OB_FIELD_QUANTITY | OB_FIELD_PRICE,
+			.time		= pitch_timestamp(m->Timestamp),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= m->OrderID,
-			.order_id_len	= sizeof(m->OrderID),
-			.exec_id	= m->ExecutionID,
-			.exec_id_len	= sizeof(m->ExecutionID),
-			.quantity	= m->ExecutedShares,
-			.quantity_len	= sizeof(m->ExecutedShares),
-			.price          = (struct decimal) {
-				.integer        = info->price,
-				.integer_len    = PITCH_PRICE_INT_LEN,
-				.fraction       = info->price + PITCH_PRICE_INT_LEN,
-				.fraction_len   = PITCH_PRICE_FRACTION_LEN,
-			},
+			.symbol		= info->symbol,
+			.order_id	= info->order_id,
+			.exec_id	= exec_id,
+			.quantity	= nr_executed,
+			.price		= info->price,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		pitch_order_event(&event, info);
+
+		ob_write_event(session->ob_writer, &event);
 
 		if (!info->remaining) {
 			if (!g_hash_table_remove(session->order_hash, &info->order_id))
 				assert(0);
-
-			free(info);
 		}
 
 		break;
@@ -213,25 +251,23 @@ found:
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_CANCEL_ORDER,
-			.time		= m->Timestamp,
-			.time_len	= sizeof(m->Timestamp),
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_QUANTITY,
+			.time		= pitch_timestamp(m->Timestamp),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= m->OrderID,
-			.order_id_len	= sizeof(m->OrderID),
-			.quantity	= m->CanceledShares,
-			.quantity_len	= sizeof(m->CanceledShares),
+			.symbol		= info->symbol,
+			.order_id	= info->order_id,
+			.quantity	= nr_canceled,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		pitch_order_event(&event, info);
+
+		ob_write_event(session->ob_writer, &event);
 
 		if (!info->remaining) {
 			if (!g_hash_table_remove(session->order_hash, &info->order_id))
 				assert(0);
-
-			free(info);
 		}
 
 		break;
@@ -240,36 +276,32 @@ found:
 		struct pitch_msg_trade_short *m = (void *) msg;
 		struct pitch_exec_info *e_info;
 		unsigned long exec_id;
+		uint32_t symbol;
+
+		exec_id = base36_decode_id(m->ExecutionID);
 
-		exec_id = base36_decode(m->ExecutionID, sizeof(m->ExecutionID));
+		symbol = pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol));
 
 		e_info = malloc(sizeof(*e_info));
 		e_info->exec_id	= exec_id;
-		e_info->symbol	= session->filter.symbol;
+		e_info->symbol	= symbol;
 
 		g_hash_table_insert(session->exec_hash, &e_info->exec_id, e_info);
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_TRADE,
-			.time		= m->Timestamp,
-			.time_len	= sizeof(m->Timestamp),
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_EXEC_ID |
+					  OB_FIELD_QUANTITY | OB_FIELD_PRICE,
+			.time		= pitch_timestamp(m->Timestamp),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.exec_id	= m->ExecutionID,
-			.exec_id_len	= sizeof(m->ExecutionID),
-			.quantity	= m->Shares,
-			.quantity_len	= sizeof(m->Shares),
-			.price		= (struct decimal) {
-				.integer	= m->Price,
-				.integer_len	= PITCH_PRICE_INT_LEN,
-				.fraction	= m->Price + PITCH_PRICE_INT_LEN,
-				.fraction_len	= PITCH_PRICE_FRACTION_LEN,
-			},
+			.symbol		= symbol,
+			.exec_id	= exec_id,
+			.quantity	= base10_decode(m->Shares, sizeof(m->Shares)),
+			.price		= base10_decode(m->Price, sizeof(m->Price)),
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
@@ -277,55 +309,55 @@ found:
 		struct pitch_msg_trade_long *m = (void *) msg;
 		struct pitch_exec_info *e_info;
 		unsigned long exec_id;
+		uint32_t symbol;
 
-		exec_id = base36_decode(m->ExecutionID, sizeof(m->ExecutionID));
+		exec_id = base36_decode_id(m->ExecutionID);
+
+		symbol = pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol));
 
 		e_info = malloc(sizeof(*e_info));
 		e_info->exec_id	= exec_id;
-		e_info->symbol	= session->filter.symbol;
+		e_info->symbol	= symbol;
 
 		g_hash_table_insert(session->exec_hash, &e_info->exec_id, e_info);
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_TRADE,
-			.time		= m->Timestamp,
-			.time_len	= sizeof(m->Timestamp),
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_EXEC_ID |
+					  OB_FIELD_QUANTITY | OB_FIELD_PRICE,
+			.time		= pitch_timestamp(m->Timestamp),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.exec_id	= m->ExecutionID,
-			.exec_id_len	= sizeof(m->ExecutionID),
-			.quantity	= m->Shares,
-			.quantity_len	= sizeof(m->Shares),
-			.price		= (struct decimal) {
-				.integer	= m->Price,
-				.integer_len	= PITCH_PRICE_INT_LEN,
-				.fraction	= m->Price + PITCH_PRICE_INT_LEN,
-				.fraction_len	= PITCH_PRICE_FRACTION_LEN,
-			},
+			.symbol		= symbol,
+			.exec_id	= exec_id,
+			.quantity	= base10_decode(m->Shares, sizeof(m->Shares)),
+			.price		= base10_decode(m->Price, sizeof(m->Price)),
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
 	case PITCH_MSG_TRADE_BREAK: {
 		struct pitch_msg_trade_break *m = (void *) msg;
+		struct pitch_exec_info *e_info;
+		unsigned long exec_id;
+
+		exec_id = base36_decode_id(m->ExecutionID);
+
+		e_info = g_hash_table_lookup(session->exec_hash, &exec_id);
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_TRADE_BREAK,
-			.time		= m->Timestamp,
-			.time_len	= sizeof(m->Timestamp),
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_EXEC_ID,
+			.time		= pitch_timestamp(m->Timestamp),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.exec_id	= m->ExecutionID,
-			.exec_id_len	= sizeof(m->ExecutionID),
+			.symbol		= e_info->symbol,
+			.exec_id	= exec_id,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
@@ -334,17 +366,15 @@ found:
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_STATUS,
-			.time		= m->Timestamp,
-			.time_len	= sizeof(m->Timestamp),
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL,
+			.time		= pitch_timestamp(m->Timestamp),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.status		= &m->HaltStatus,
-			.status_len	= sizeof(m->HaltStatus),
+			.symbol		= pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol)),
+			.status		= m->HaltStatus,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
@@ -380,17 +410,25 @@ void bats_pitch_ob(struct pitch_session *session)
 		.zstream	= session->zstream,
 		.uncomp_buf	= uncomp_buf,
 		.comp_buf	= comp_buf,
-		.progress	= print_progress,
 	};
 
-	session->exec_hash = g_hash_table_new(g_int_hash, g_int_equal);
+	session->exec_hash = g_hash_table_new(g_int64_hash, g_int64_equal);
 	if (!session->exec_hash)
 		error("out of memory");
 
-	session->order_hash = g_hash_table_new(g_int_hash, g_int_equal);
+	memory_track_table(MEMORY_TABLE_EXECS, session->exec_hash, sizeof(struct pitch_exec_info));
+
+	session->order_hash = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, free);
 	if (!session->order_hash)
 		error("out of memory");
 
+	progress_track_orders(session->order_hash);
+
+	memory_track_table(MEMORY_TABLE_ORDERS, session->order_hash, sizeof(struct pitch_order_info));
+
+	if (session->symbol)
+		session->symbol_id = symbol_intern(session->symbol, session->symbol_len);
+
 	event = (struct ob_event) {
 		.type		= OB_EVENT_DATE,
 		.date		= session->date,
@@ -401,24 +439,41 @@ void bats_pitch_ob(struct pitch_session *session)
 		.exchange_len	= session->exchange_len,
 	};
 
-	ob_write_event(session->out_fd, &event);
+	ob_write_event(session->ob_writer, &event);
 
 	for (;;) {
 		struct pitch_message *msg;
 		int err;
 
+		profile_enter(PROFILE_STAGE_DECODE);
+
 		err = bats_pitch_read(&stream, &msg);
+
+		profile_leave();
+
 		if (err)
 			error("%s: %s", session->input_filename, strerror(err));
 
 		if (!msg)
 			break;
 
+		progress_message();
+
+		profile_message_begin();
+
 		bats_pitch_write(session, msg);
+
+		profile_message_end(msg->MessageType);
 	}
 
+	progress_track_orders(NULL);
+
+	memory_untrack_table(MEMORY_TABLE_ORDERS);
+
 	g_hash_table_destroy(session->order_hash);
 
+	memory_untrack_table(MEMORY_TABLE_EXECS);
+
 	g_hash_table_foreach_remove(session->exec_hash, free_entry, NULL);
 
 	g_hash_table_destroy(session->exec_hash);
@@ -23,16 +23,13 @@ retry_size:
 
 		buffer_compact(stream->uncomp_buf);
 
-		nr = buffer_inflate(stream->comp_buf, stream->uncomp_buf, stream->zstream);
+		nr = stream_inflate(stream);
 		if (nr < 0)
 			return nr;
 
 		if (!nr)
 			return 0;
 
-		if (stream->progress)
-			stream->progress(stream->comp_buf);
-
 		goto retry_size;
 	}
 
@@ -49,16 +46,13 @@ retry_message:
 
 		buffer_compact(stream->uncomp_buf);
 
-		nr = buffer_inflate(stream->comp_buf, stream->uncomp_buf, stream->zstream);
+		nr = stream_inflate(stream);
 		if (nr < 0)
 			return nr;
 
 		if (!nr)
 			return 0;
 
-		if (stream->progress)
-			stream->progress(stream->comp_buf);
-
 		goto retry_message;
 	}
 
@@ -101,7 +95,33 @@ int pitch_file_parse_date(const char *filename, char *buf, size_t buf_len)
 void pitch_filter_init(struct pitch_filter *filter, const char *symbol)
 {
 	memset(filter->symbol, ' ', sizeof(filter->symbol));
-	memcpy(filter->symbol, symbol, strlen(symbol));
+
+	filter->all = !symbol;
+
+	if (symbol)
+		memcpy(filter->symbol, symbol, strlen(symbol));
+}
+
+/*
+ * Long messages have room for eight characters, the last two of which
+ * are spaces for symbols that fit the filter.
+ */
+static inline bool pitch_filter_match(struct pitch_filter *filter, const char *symbol, size_t len)
+{
+	size_t i;
+
+	if (filter->all)
+		return true;
+
+	if (memcmp(symbol, filter->symbol, sizeof(filter->symbol)))
+		return false;
+
+	for (i = sizeof(filter->symbol); i < len; i++) {
+		if (symbol[i] != ' ')
+			return false;
+	}
+
+	return true;
 }
 
 struct pitch_order_info *
@@ -112,7 +132,7 @@ pitch_session_lookup_order(struct pitch_session *session, struct pitch_message *
 		struct pitch_msg_order_executed *m = (void *) msg;
 		unsigned long order_id;
 
-		order_id = base36_decode(m->OrderID, sizeof(m->OrderID));
+		order_id = base36_decode_id(m->OrderID);
 
 		return g_hash_table_lookup(session->order_hash, &order_id);
 	}
@@ -120,7 +140,7 @@ pitch_session_lookup_order(struct pitch_session *session, struct pitch_message *
 		struct pitch_msg_order_cancel *m = (void *) msg;
 		unsigned long order_id;
 
-		order_id = base36_decode(m->OrderID, sizeof(m->OrderID));
+		order_id = base36_decode_id(m->OrderID);
 
 		return g_hash_table_lookup(session->order_hash, &order_id);
 	}
@@ -139,45 +159,45 @@ bool pitch_session_filter_msg(struct pitch_session *session, struct pitch_messag
 	case PITCH_MSG_SYMBOL_CLEAR: {
 		struct pitch_msg_symbol_clear *m = (void *) msg;
 
-		return !memcmp(m->StockSymbol, filter->symbol, sizeof(m->StockSymbol));
+		return pitch_filter_match(filter, m->StockSymbol, sizeof(m->StockSymbol));
 	}
 	case PITCH_MSG_ADD_ORDER_SHORT: {
 		struct pitch_msg_add_order_short *m = (void *) msg;
 
-		return !memcmp(m->StockSymbol, filter->symbol, sizeof(m->StockSymbol));
+		return pitch_filter_match(filter, m->StockSymbol, sizeof(m->StockSymbol));
 	}
 	case PITCH_MSG_ADD_ORDER_LONG: {
 		struct pitch_msg_add_order_long *m = (void *) msg;
 
-		return !memcmp(m->StockSymbol, filter->symbol, sizeof(m->StockSymbol));
+		return pitch_filter_match(filter, m->StockSymbol, sizeof(m->StockSymbol));
 	}
 	case PITCH_MSG_TRADE_SHORT: {
 		struct pitch_msg_trade_short *m = (void *) msg;
 
-		return !memcmp(m->StockSymbol, filter->symbol, sizeof(m->StockSymbol));
+		return pitch_filter_match(filter, m->StockSymbol, sizeof(m->StockSymbol));
 	}
 	case PITCH_MSG_TRADE_LONG: {
 		struct pitch_msg_trade_long *m = (void *) msg;
 
-		return !memcmp(m->StockSymbol, filter->symbol, sizeof(m->StockSymbol));
+		return pitch_filter_match(filter, m->StockSymbol, sizeof(m->StockSymbol));
 	}
 	case PITCH_MSG_TRADE_BREAK: {
 		struct pitch_msg_trade_break *m = (void *) msg;
 		struct pitch_exec_info *e_info;
 		unsigned long exec_id;
 
-		exec_id = base36_decode(m->ExecutionID, sizeof(m->ExecutionID));
+		exec_id = base36_decode_id(m->ExecutionID);
 
 		e_info = g_hash_table_lookup(session->exec_hash, &exec_id);
 		if (!e_info)
 			return false;
 
-		return !memcmp(e_info->symbol, filter->symbol, 6);
+		return filter->all || e_info->symbol == session->symbol_id;
 	}
 	case PITCH_MSG_TRADING_STATUS: {
 		struct pitch_msg_trading_status *m = (void *) msg;
 
-		return !memcmp(m->StockSymbol, filter->symbol, sizeof(m->StockSymbol));
+		return pitch_filter_match(filter, m->StockSymbol, sizeof(m->StockSymbol));
 	}
 	default:
 		break;
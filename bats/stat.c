@@ -5,9 +5,13 @@
 
 #include "tick/bats/pitch-proto.h"
 #include "tick/progress.h"
-#include "tick/format.h"
+#include "tick/profile.h"
 #include "tick/stream.h"
+#include "tick/base36.h"
+#include "tick/base10.h"
+#include "tick/format.h"
 #include "tick/error.h"
+#include "tick/rates.h"
 #include "tick/stats.h"
 #include "tick/types.h"
 
@@ -35,8 +39,167 @@ void bats_pitch_print_stats(struct stats *stats)
 	print_stats(stats, bats_stat_names, ARRAY_SIZE(bats_stat_names));
 }
 
+void bats_pitch_print_symbol_stats(struct stats *stats, unsigned int top)
+{
+	print_symbol_stats(stats, bats_stat_names, ARRAY_SIZE(bats_stat_names), top);
+}
+
 #define BUFFER_SIZE	(1ULL << 20) /* 1 MB */
 
+/*
+ * Offset of the message type in a message: the 'S' start byte is followed
+ * by the eight-digit timestamp.
+ */
+#define PITCH_TYPE_OFFSET	9
+
+static void symbol_message(struct stats *stats, const char *symbol, size_t len, u8 msg_type)
+{
+	stats_symbol_message(stats, stats_symbol(stats, symbol, len), msg_type);
+}
+
+/*
+ * Attribute a message to its symbol.  Executions and cancels do not carry
+ * the symbol, so it is looked up from the order they refer to.
+ */
+static void bats_pitch_symbol_stat(struct stats *stats, const void *msg, size_t len)
+{
+	u8 msg_type = ((const struct pitch_message *) msg)->MessageType;
+
+	switch (msg_type) {
+	case PITCH_MSG_SYMBOL_CLEAR: {
+		const struct pitch_msg_symbol_clear *m = msg;
+
+		if (len >= sizeof(*m))
+			symbol_message(stats, m->StockSymbol, sizeof(m->StockSymbol), msg_type);
+
+		break;
+	}
+	case PITCH_MSG_ADD_ORDER_SHORT: {
+		const struct pitch_msg_add_order_short *m = msg;
+
+		if (len >= sizeof(*m))
+			stats_add_order(stats, stats_symbol(stats, m->StockSymbol, sizeof(m->StockSymbol)),
+					base36_decode_id(m->OrderID),
+					base10_decode(m->Shares, sizeof(m->Shares)), msg_type);
+
+		break;
+	}
+	case PITCH_MSG_ADD_ORDER_LONG: {
+		const struct pitch_msg_add_order_long *m = msg;
+
+		if (len >= sizeof(*m))
+			stats_add_order(stats, stats_symbol(stats, m->StockSymbol, sizeof(m->StockSymbol)),
+					base36_decode_id(m->OrderID),
+					base10_decode(m->Shares, sizeof(m->Shares)), msg_type);
+
+		break;
+	}
+	case PITCH_MSG_ORDER_EXECUTED: {
+		const struct pitch_msg_order_executed *m = msg;
+
+		if (len >= sizeof(*m))
+			stats_reduce_order(stats, base36_decode_id(m->OrderID),
+					   base10_decode(m->ExecutedShares, sizeof(m->ExecutedShares)), msg_type);
+
+		break;
+	}
+	case PITCH_MSG_ORDER_CANCEL: {
+		const struct pitch_msg_order_cancel *m = msg;
+
+		if (len >= sizeof(*m))
+			stats_reduce_order(stats, base36_decode_id(m->OrderID),
+					   base10_decode(m->CanceledShares, sizeof(m->CanceledShares)), msg_type);
+
+		break;
+	}
+	case PITCH_MSG_TRADE_SHORT: {
+		const struct pitch_msg_trade_short *m = msg;
+
+		if (len >= sizeof(*m))
+			symbol_message(stats, m->StockSymbol, sizeof(m->StockSymbol), msg_type);
+
+		break;
+	}
+	case PITCH_MSG_TRADE_LONG: {
+		const struct pitch_msg_trade_long *m = msg;
+
+		if (len >= sizeof(*m))
+			symbol_message(stats, m->StockSymbol, sizeof(m->StockSymbol), msg_type);
+
+		break;
+	}
+	case PITCH_MSG_TRADING_STATUS: {
+		const struct pitch_msg_trading_status *m = msg;
+
+		if (len >= sizeof(*m))
+			symbol_message(stats, m->StockSymbol, sizeof(m->StockSymbol), msg_type);
+
+		break;
+	}
+	case PITCH_MSG_AUCTION_UPDATE: {
+		const struct pitch_msg_auction_update *m = msg;
+
+		if (len >= sizeof(*m))
+			symbol_message(stats, m->StockSymbol, sizeof(m->StockSymbol), msg_type);
+
+		break;
+	}
+	case PITCH_MSG_AUCTION_SUMMARY: {
+		const struct pitch_msg_auction_summary *m = msg;
+
+		if (len >= sizeof(*m))
+			symbol_message(stats, m->StockSymbol, sizeof(m->StockSymbol), msg_type);
+
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+/*
+ * Count the complete messages in the buffer by their framing only: every
+ * message is a line that carries its type byte at a fixed offset, so there
+ * is no need to decode the message bodies.  A partial line at the end of
+ * the buffer is left in place.
+ */
+static int bats_pitch_count(struct stats *stats, struct buffer *buf)
+{
+	const char *start = buffer_start(buf);
+	const char *end = start + buffer_size(buf);
+	const char *p = start;
+
+	for (;;) {
+		const char *eol = memchr(p, '\n', end - p);
+
+		if (!eol)
+			break;
+
+		if (eol - p <= PITCH_TYPE_OFFSET || p[0] != 'S')
+			return -EINVAL;
+
+		progress_message();
+
+		profile_message_begin();
+
+		stats->stats[(u8) p[PITCH_TYPE_OFFSET]]++;
+
+		if (stats->rates)
+			rates_message(stats->rates, pitch_timestamp(p + 1));
+
+		if (stats->by_symbol)
+			bats_pitch_symbol_stat(stats, p + 1, eol - p - 1);
+
+		profile_message_end(p[PITCH_TYPE_OFFSET]);
+
+		p = eol + 1;
+	}
+
+	buffer_advance(buf, p - start);
+
+	return 0;
+}
+
 void bats_pitch_stat(struct stats *stats, int fd, z_stream *zstream)
 {
 	struct buffer *comp_buf, *uncomp_buf;
@@ -60,21 +223,31 @@ void bats_pitch_stat(struct stats *stats, int fd, z_stream *zstream)
 		.zstream	= zstream,
 		.uncomp_buf	= uncomp_buf,
 		.comp_buf	= comp_buf,
-		.progress	= print_progress,
 	};
 
+	progress_track_orders(stats->orders);
+
 	for (;;) {
-		struct pitch_message *msg;
+		ssize_t nr;
 		int err;
 
-		err = bats_pitch_read(&stream, &msg);
-		if (err)
-			error("%s: %s", stats->filename, strerror(err));
+		buffer_compact(uncomp_buf);
 
-		if (!msg)
+		nr = stream_inflate(&stream);
+		if (nr < 0)
+			error("%s: %s", stats->filename, strerror(EINVAL));
+
+		if (!nr)
 			break;
 
-		stats->stats[msg->MessageType]++;
+		profile_enter(PROFILE_STAGE_DECODE);
+
+		err = bats_pitch_count(stats, uncomp_buf);
+
+		profile_leave();
+
+		if (err < 0)
+			error("%s: %s", stats->filename, strerror(EINVAL));
 	}
 
 	buffer_munmap(comp_buf);
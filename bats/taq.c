@@ -4,11 +4,13 @@
 #include "libtrading/buffer.h"
 
 #include "tick/progress.h"
-#include "tick/decimal.h"
+#include "tick/profile.h"
+#include "tick/memory.h"
 #include "tick/base10.h"
 #include "tick/base36.h"
 #include "tick/format.h"
 #include "tick/stream.h"
+#include "tick/symbol.h"
 #include "tick/error.h"
 #include "tick/types.h"
 #include "tick/taq.h"
@@ -30,22 +32,49 @@ static gboolean free_entry(gpointer __maybe_unused key, gpointer __maybe_unused
 	return TRUE;
 }
 
+static gboolean free_order_of_symbol(gpointer __maybe_unused key, gpointer val, gpointer data)
+{
+	struct pitch_order_info *info = val;
+
+	if (info->symbol != *(uint32_t *) data)
+		return FALSE;
+
+	free(info);
+
+	return TRUE;
+}
+
 static void bats_pitch_write(struct pitch_session *session, struct pitch_message *msg)
 {
 	struct pitch_order_info *info = NULL;
 	struct taq_event event;
+	bool selected;
+
+	profile_enter(PROFILE_STAGE_LOOKUP);
 
 	info = pitch_session_lookup_order(session, msg);
+
+	profile_leave();
+
 	if (info)
 		goto found;
 
-	if (!pitch_session_filter_msg(session, msg))
+	profile_enter(PROFILE_STAGE_FILTER);
+
+	selected = pitch_session_filter_msg(session, msg);
+
+	profile_leave();
+
+	if (!selected)
 		return;
 
 found:
 	switch (msg->MessageType) {
 	case PITCH_MSG_SYMBOL_CLEAR: {
-		g_hash_table_foreach_remove(session->order_hash, free_entry, NULL);
+		struct pitch_msg_symbol_clear *m = (void *) msg;
+		uint32_t symbol = pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol));
+
+		g_hash_table_foreach_remove(session->order_hash, free_order_of_symbol, &symbol);
 
 		break;
 	}
@@ -57,11 +86,12 @@ found:
 
 		info = malloc(sizeof(*info));
 
-		order_id = base36_decode(m->OrderID, sizeof(m->OrderID));
+		order_id = base36_decode_id(m->OrderID);
 
 		info->order_id	= order_id;
 		info->remaining	= base10_decode(m->Shares, sizeof(m->Shares));
-		memcpy(info->price, m->Price, sizeof(m->Price));
+		info->price	= base10_decode(m->Price, sizeof(m->Price));
+		info->symbol	= pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol));
 
 		g_hash_table_insert(session->order_hash, &info->order_id, info);
 
@@ -73,12 +103,13 @@ found:
 
 		assert(info == NULL);
 
-		order_id = base36_decode(m->OrderID, sizeof(m->OrderID));
+		order_id = base36_decode_id(m->OrderID);
 
 		info = malloc(sizeof(*info));
 		info->order_id	= order_id;
 		info->remaining	= base10_decode(m->Shares, sizeof(m->Shares));
-		memcpy(info->price, m->Price, sizeof(m->Price));
+		info->price	= base10_decode(m->Price, sizeof(m->Price));
+		info->symbol	= pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol));
 
 		g_hash_table_insert(session->order_hash, &info->order_id, info);
 
@@ -98,40 +129,29 @@ found:
 
 		info->remaining	-= nr_executed;
 
-		exec_id = base36_decode(m->ExecutionID, sizeof(m->ExecutionID));
+		exec_id = base36_decode_id(m->ExecutionID);
 
 		e_info = malloc(sizeof(*e_info));
 		e_info->exec_id	= exec_id;
-		e_info->symbol	= session->filter.symbol;
+		e_info->symbol	= info->symbol;
 
 		g_hash_table_insert(session->exec_hash, &e_info->exec_id, e_info);
 
 		event = (struct taq_event) {
 			.type			= TAQ_EVENT_TRADE,
-			.time			= (struct time) {
-				.value			= m->Timestamp,
-				.value_len		= sizeof(m->Timestamp),
-				.unit			= TIME_UNIT_MILLISECONDS,
-			},
+			.fields			= TAQ_FIELD_TIME | TAQ_FIELD_SYMBOL | TAQ_FIELD_EXEC_ID |
+						  TAQ_FIELD_TRADE,
+			.time			= pitch_timestamp(m->Timestamp),
 			.exchange		= session->exchange,
 			.exchange_len		= session->exchange_len,
-			.symbol			= session->symbol,
-			.symbol_len		= session->symbol_len,
-			.exec_id		= m->ExecutionID,
-			.exec_id_len		= sizeof(m->ExecutionID),
-			.trade_quantity		= m->ExecutedShares,
-			.trade_quantity_len	= sizeof(m->ExecutedShares),
-			.trade_price		= (struct decimal) {
-				.integer		= info->price,
-				.integer_len		= PITCH_PRICE_INT_LEN,
-				.fraction		= info->price + PITCH_PRICE_INT_LEN,
-				.fraction_len		= PITCH_PRICE_FRACTION_LEN,
-			},
+			.symbol			= info->symbol,
+			.exec_id		= exec_id,
+			.trade_quantity		= nr_executed,
+			.trade_price		= info->price,
 			.trade_type		= TAQ_TRADE_TYPE_REGULAR,
-			.trade_type_len		= TAQ_TRADE_TYPE_LEN,
 		};
 
-		taq_write_event(session->out_fd, &event);
+		taq_write_event(session->taq_writer, &event);
 
 		if (!info->remaining) {
 			if (!g_hash_table_remove(session->order_hash, &info->order_id))
@@ -167,40 +187,33 @@ found:
 		struct pitch_msg_trade_short *m = (void *) msg;
 		struct pitch_exec_info *e_info;
 		unsigned long exec_id;
+		uint32_t symbol;
 
-		exec_id = base36_decode(m->ExecutionID, sizeof(m->ExecutionID));
+		exec_id = base36_decode_id(m->ExecutionID);
+
+		symbol = pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol));
 
 		e_info = malloc(sizeof(*e_info));
 		e_info->exec_id	= exec_id;
-		e_info->symbol	= session->filter.symbol;
+		e_info->symbol	= symbol;
 
 		g_hash_table_insert(session->exec_hash, &e_info->exec_id, e_info);
 
 		event = (struct taq_event) {
 			.type			= TAQ_EVENT_TRADE,
-			.time			= (struct time) {
-				.value			= m->Timestamp,
-				.value_len		= sizeof(m->Timestamp),
-				.unit			= TIME_UNIT_MILLISECONDS,
-			},
+			.fields			= TAQ_FIELD_TIME | TAQ_FIELD_SYMBOL | TAQ_FIELD_EXEC_ID |
+						  TAQ_FIELD_TRADE,
+			.time			= pitch_timestamp(m->Timestamp),
 			.exchange		= session->exchange,
 			.exchange_len		= session->exchange_len,
-			.symbol			= session->symbol,
-			.symbol_len		= session->symbol_len,
-			.exec_id		= m->ExecutionID,
-			.exec_id_len		= sizeof(m->ExecutionID),
-			.trade_quantity		= m->Shares,
-			.trade_quantity_len	= sizeof(m->Shares),
-			.trade_price		= (struct decimal) {
-				.integer		= m->Price,
-				.integer_len		= PITCH_PRICE_INT_LEN,
-				.fraction		= m->Price + PITCH_PRICE_INT_LEN,
-				.fraction_len		= PITCH_PRICE_FRACTION_LEN,
-			},
+			.symbol			= symbol,
+			.exec_id		= exec_id,
+			.trade_quantity		= base10_decode(m->Shares, sizeof(m->Shares)),
+			.trade_price		= base10_decode(m->Price, sizeof(m->Price)),
 			.trade_type		= TAQ_TRADE_TYPE_NON_DISPLAYED,
-			.trade_type_len		= TAQ_TRADE_TYPE_LEN,
 		};
-		taq_write_event(session->out_fd, &event);
+
+		taq_write_event(session->taq_writer, &event);
 
 		break;
 	}
@@ -208,62 +221,56 @@ found:
 		struct pitch_msg_trade_long *m = (void *) msg;
 		struct pitch_exec_info *e_info;
 		unsigned long exec_id;
+		uint32_t symbol;
 
-		exec_id = base36_decode(m->ExecutionID, sizeof(m->ExecutionID));
+		exec_id = base36_decode_id(m->ExecutionID);
+
+		symbol = pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol));
 
 		e_info = malloc(sizeof(*e_info));
 		e_info->exec_id	= exec_id;
-		e_info->symbol	= session->filter.symbol;
+		e_info->symbol	= symbol;
 
 		g_hash_table_insert(session->exec_hash, &e_info->exec_id, e_info);
 
 		event = (struct taq_event) {
 			.type			= TAQ_EVENT_TRADE,
-			.time			= (struct time) {
-				.value			= m->Timestamp,
-				.value_len		= sizeof(m->Timestamp),
-				.unit			= TIME_UNIT_MILLISECONDS,
-			},
+			.fields			= TAQ_FIELD_TIME | TAQ_FIELD_SYMBOL | TAQ_FIELD_EXEC_ID |
+						  TAQ_FIELD_TRADE,
+			.time			= pitch_timestamp(m->Timestamp),
 			.exchange		= session->exchange,
 			.exchange_len		= session->exchange_len,
-			.symbol			= session->symbol,
-			.symbol_len		= session->symbol_len,
-			.exec_id		= m->ExecutionID,
-			.exec_id_len		= sizeof(m->ExecutionID),
-			.trade_quantity		= m->Shares,
-			.trade_quantity_len	= sizeof(m->Shares),
-			.trade_price		= (struct decimal) {
-				.integer		= m->Price,
-				.integer_len		= PITCH_PRICE_INT_LEN,
-				.fraction		= m->Price + PITCH_PRICE_INT_LEN,
-				.fraction_len		= PITCH_PRICE_FRACTION_LEN,
-			},
+			.symbol			= symbol,
+			.exec_id		= exec_id,
+			.trade_quantity		= base10_decode(m->Shares, sizeof(m->Shares)),
+			.trade_price		= base10_decode(m->Price, sizeof(m->Price)),
 			.trade_type		= TAQ_TRADE_TYPE_NON_DISPLAYED,
-			.trade_type_len		= TAQ_TRADE_TYPE_LEN,
 		};
-		taq_write_event(session->out_fd, &event);
+
+		taq_write_event(session->taq_writer, &event);
 
 		break;
 	}
 	case PITCH_MSG_TRADE_BREAK: {
 		struct pitch_msg_trade_break *m = (void *) msg;
+		struct pitch_exec_info *e_info;
+		unsigned long exec_id;
+
+		exec_id = base36_decode_id(m->ExecutionID);
+
+		e_info = g_hash_table_lookup(session->exec_hash, &exec_id);
 
 		event = (struct taq_event) {
 			.type		= TAQ_EVENT_TRADE_BREAK,
-			.time		= (struct time) {
-				.value		= m->Timestamp,
-				.value_len	= sizeof(m->Timestamp),
-				.unit		= TIME_UNIT_MILLISECONDS,
-			},
+			.fields		= TAQ_FIELD_TIME | TAQ_FIELD_SYMBOL | TAQ_FIELD_EXEC_ID,
+			.time		= pitch_timestamp(m->Timestamp),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.exec_id	= m->ExecutionID,
-			.exec_id_len	= sizeof(m->ExecutionID),
+			.symbol		= e_info->symbol,
+			.exec_id	= exec_id,
 		};
 
-		taq_write_event(session->out_fd, &event);
+		taq_write_event(session->taq_writer, &event);
 
 		break;
 	}
@@ -272,20 +279,15 @@ found:
 
 		event = (struct taq_event) {
 			.type		= TAQ_EVENT_STATUS,
-			.time		= (struct time) {
-				.value		= m->Timestamp,
-				.value_len	= sizeof(m->Timestamp),
-				.unit		= TIME_UNIT_MILLISECONDS,
-			},
+			.fields		= TAQ_FIELD_TIME | TAQ_FIELD_SYMBOL,
+			.time		= pitch_timestamp(m->Timestamp),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.status		= &m->HaltStatus,
-			.status_len	= sizeof(m->HaltStatus),
+			.symbol		= pitch_session_symbol(session, m->StockSymbol, sizeof(m->StockSymbol)),
+			.status		= m->HaltStatus,
 		};
 
-		taq_write_event(session->out_fd, &event);
+		taq_write_event(session->taq_writer, &event);
 
 		break;
 	}
@@ -321,17 +323,25 @@ void bats_pitch_taq(struct pitch_session *session)
 		.zstream	= session->zstream,
 		.uncomp_buf	= uncomp_buf,
 		.comp_buf	= comp_buf,
-		.progress	= print_progress,
 	};
 
-	session->exec_hash = g_hash_table_new(g_int_hash, g_int_equal);
+	session->exec_hash = g_hash_table_new(g_int64_hash, g_int64_equal);
 	if (!session->exec_hash)
 		error("out of memory");
 
-	session->order_hash = g_hash_table_new(g_int_hash, g_int_equal);
+	memory_track_table(MEMORY_TABLE_EXECS, session->exec_hash, sizeof(struct pitch_exec_info));
+
+	session->order_hash = g_hash_table_new(g_int64_hash, g_int64_equal);
 	if (!session->order_hash)
 		error("out of memory");
 
+	progress_track_orders(session->order_hash);
+
+	memory_track_table(MEMORY_TABLE_ORDERS, session->order_hash, sizeof(struct pitch_order_info));
+
+	if (session->symbol)
+		session->symbol_id = symbol_intern(session->symbol, session->symbol_len);
+
 	event = (struct taq_event) {
 		.type		= TAQ_EVENT_DATE,
 		.date		= session->date,
@@ -342,24 +352,41 @@ void bats_pitch_taq(struct pitch_session *session)
 		.exchange_len	= session->exchange_len,
 	};
 
-	taq_write_event(session->out_fd, &event);
+	taq_write_event(session->taq_writer, &event);
 
 	for (;;) {
 		struct pitch_message *msg;
 		int err;
 
+		profile_enter(PROFILE_STAGE_DECODE);
+
 		err = bats_pitch_read(&stream, &msg);
+
+		profile_leave();
+
 		if (err)
 			error("%s: %s", session->input_filename, strerror(err));
 
 		if (!msg)
 			break;
 
+		progress_message();
+
+		profile_message_begin();
+
 		bats_pitch_write(session, msg);
+
+		profile_message_end(msg->MessageType);
 	}
 
+	progress_track_orders(NULL);
+
+	memory_untrack_table(MEMORY_TABLE_ORDERS);
+
 	g_hash_table_destroy(session->order_hash);
 
+	memory_untrack_table(MEMORY_TABLE_EXECS);
+
 	g_hash_table_foreach_remove(session->exec_hash, free_entry, NULL);
 
 	g_hash_table_destroy(session->exec_hash);
@@ -0,0 +1,678 @@
+#include "tick/symbol.h"
+#include "tick/error.h"
+#include "tick/types.h"
+#include "tick/dsv.h"
+#include "tick/gen.h"
+
+#include <inttypes.h>
+#include <getopt.h>
+#include <locale.h>
+#include <libgen.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <glib.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+const char *program;
+
+/*
+ * Microbenchmarks for the decode, format and lookup kernels on the hot
+ * path of the converters.
+ *
+ * Every kernel runs over a fixed set of inputs that fits in the cache and
+ * that is generated with realistic field widths and value distributions.
+ * Kernels that do the same job on the same inputs are listed next to each
+ * other so that alternatives can be compared directly.  The numbers are
+ * throughput: consecutive operations are independent and may overlap in
+ * the pipeline.
+ */
+
+#define DEFAULT_REPEAT		5
+#define DEFAULT_TIME_MS		20
+#define DEFAULT_SEED		1
+
+#define NR_INPUTS		4096
+
+/*
+ * Fields are padded because dsv_parse_uint() reads eight bytes at a time.
+ */
+#define FIELD_SIZE		24
+
+#define NR_ORDERS		(1U << 20)
+#define NR_SYMBOLS		8000
+
+#define ORDER_ID_LEN		12	/* BATS PITCH */
+#define STOCK_LEN		8	/* NASDAQ ITCH */
+
+static void usage(void)
+{
+#define FMT								\
+"\n usage: %s [<options>] [<kernel>...]\n"				\
+"\n"									\
+"    -r, --repeat <n>            timed runs per kernel (default: %d)\n"	\
+"    -t, --time <ms>             minimum duration of a run (default: %d)\n" \
+"    -s, --seed <n>              random seed of the inputs (default: %d)\n" \
+"\n Runs the kernels whose name contains one of the arguments, or all\n" \
+" kernels if there are none.  Cycles are time stamp counter ticks.\n"	\
+"\n"
+	fprintf(stderr, FMT, program, DEFAULT_REPEAT, DEFAULT_TIME_MS, DEFAULT_SEED);
+
+#undef FMT
+
+	exit(EXIT_FAILURE);
+}
+
+static const struct option options[] = {
+	{ "repeat",	required_argument,	NULL, 'r' },
+	{ "time",	required_argument,	NULL, 't' },
+	{ "seed",	required_argument,	NULL, 's' },
+	{ NULL,		0,			NULL,  0  },
+};
+
+static unsigned int	repeat = DEFAULT_REPEAT;
+static unsigned int	time_ms = DEFAULT_TIME_MS;
+static uint64_t		seed = DEFAULT_SEED;
+static char		**patterns;
+static int		nr_patterns;
+
+struct input {
+	char			fields[NR_INPUTS][FIELD_SIZE];
+	uint8_t			lens[NR_INPUTS];
+	uint64_t		values[NR_INPUTS];
+};
+
+/*
+ * Output of the format kernels.  Rows are formatted back to back as they
+ * are into an output block.
+ */
+static char			out_buf[NR_INPUTS * FIELD_SIZE];
+
+static volatile uint64_t	sink;
+
+static uint64_t			rng_state;
+
+static uint64_t rng_next(void)
+{
+	uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+	return z ^ (z >> 31);
+}
+
+static uint64_t rng_range(uint64_t n)
+{
+	return rng_next() % n;
+}
+
+/*
+ * Order sizes are mostly round lots, with some odd lots and a few large
+ * orders.
+ */
+static uint64_t random_quantity(void)
+{
+	uint64_t r = rng_range(100);
+
+	if (r < 70)
+		return (1 + rng_range(10)) * 100;
+
+	if (r < 90)
+		return 1 + rng_range(99);
+
+	return 1 + rng_range(99999);
+}
+
+/*
+ * Prices between $1 and $500 in whole cents, in units of 1/10000 dollar.
+ */
+static uint64_t random_price(void)
+{
+	return (1 + rng_range(500)) * DSV_PRICE_SCALE + rng_range(100) * 100;
+}
+
+/*
+ * Nanoseconds since midnight during regular trading hours, in order.
+ */
+static uint64_t session_time(unsigned int i)
+{
+	const uint64_t open = 34200ULL * 1000000000ULL, length = 23400ULL * 1000000000ULL;
+
+	return open + i * (length / NR_INPUTS) + rng_range(length / NR_INPUTS);
+}
+
+static void base36_digits(char *buf, size_t len, uint64_t value)
+{
+	static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+	while (len--) {
+		buf[len] = digits[value % 36];
+
+		value /= 36;
+	}
+}
+
+static void setup_order_ids(struct input *in)
+{
+	unsigned int i;
+
+	for (i = 0; i < NR_INPUTS; i++) {
+		in->values[i] = rng_range(4738381338321616896ULL);	/* 36^12 */
+		in->lens[i]   = ORDER_ID_LEN;
+
+		base36_digits(in->fields[i], ORDER_ID_LEN, in->values[i]);
+	}
+}
+
+static void setup_digits(struct input *in, size_t len, uint64_t (*value)(unsigned int))
+{
+	unsigned int i;
+
+	for (i = 0; i < NR_INPUTS; i++) {
+		in->values[i] = value(i);
+		in->lens[i]   = len;
+
+		gen_digits(in->fields[i], len, in->values[i]);
+	}
+}
+
+static uint64_t quantity_value(unsigned int i __maybe_unused)
+{
+	return random_quantity();
+}
+
+static uint64_t price_value(unsigned int i __maybe_unused)
+{
+	return random_price();
+}
+
+static uint64_t millis_value(unsigned int i)
+{
+	return session_time(i) / 1000000;
+}
+
+static void setup_shares(struct input *in)
+{
+	setup_digits(in, 6, quantity_value);
+}
+
+static void setup_long_prices(struct input *in)
+{
+	setup_digits(in, 10, price_value);
+}
+
+static void setup_millis(struct input *in)
+{
+	setup_digits(in, 8, millis_value);
+}
+
+static void setup_quantities(struct input *in)
+{
+	unsigned int i;
+
+	for (i = 0; i < NR_INPUTS; i++) {
+		in->values[i] = random_quantity();
+		in->lens[i]   = dsv_fmt_uint(in->fields[i], in->values[i], '\t') - 1;
+	}
+}
+
+static void setup_tsv_prices(struct input *in)
+{
+	unsigned int i;
+
+	for (i = 0; i < NR_INPUTS; i++) {
+		in->values[i] = random_price();
+		in->lens[i]   = dsv_fmt_price(in->fields[i], in->values[i], '\t') - 1;
+	}
+}
+
+static void setup_times(struct input *in)
+{
+	unsigned int i;
+
+	for (i = 0; i < NR_INPUTS; i++)
+		in->values[i] = session_time(i);
+}
+
+static void setup_price_values(struct input *in)
+{
+	unsigned int i;
+
+	for (i = 0; i < NR_INPUTS; i++)
+		in->values[i] = random_price();
+}
+
+static void setup_quantity_values(struct input *in)
+{
+	unsigned int i;
+
+	for (i = 0; i < NR_INPUTS; i++)
+		in->values[i] = random_quantity();
+}
+
+static char		symbol_names[NR_SYMBOLS][STOCK_LEN + 1];
+
+/*
+ * Symbols are one to five letters, mostly three or four.
+ */
+static void init_symbol_names(void)
+{
+	static const unsigned int lens[] = { 1, 2, 3, 3, 3, 4, 4, 4, 4, 5 };
+	unsigned int i, j;
+
+	memset(symbol_names, 0, sizeof(symbol_names));
+
+	for (i = 0; i < NR_SYMBOLS; i++) {
+		unsigned int len = lens[rng_range(ARRAY_SIZE(lens))];
+
+		for (j = 0; j < len; j++)
+			symbol_names[i][j] = 'A' + rng_range(26);
+	}
+}
+
+static void setup_symbols(struct input *in)
+{
+	unsigned int i;
+
+	init_symbol_names();
+
+	for (i = 0; i < NR_INPUTS; i++) {
+		const char *name = symbol_names[rng_range(NR_SYMBOLS)];
+
+		in->lens[i] = strlen(name);
+
+		memcpy(in->fields[i], name, in->lens[i]);
+	}
+}
+
+/*
+ * Stock fields of NASDAQ ITCH messages are padded with spaces.
+ */
+static void setup_stocks(struct input *in)
+{
+	unsigned int i;
+
+	init_symbol_names();
+
+	for (i = 0; i < NR_SYMBOLS; i++) {
+		memset(in->fields[0], ' ', STOCK_LEN);
+		memcpy(in->fields[0], symbol_names[i], strlen(symbol_names[i]));
+
+		symbol_intern(in->fields[0], STOCK_LEN);
+	}
+
+	for (i = 0; i < NR_INPUTS; i++) {
+		const char *name = symbol_names[rng_range(NR_SYMBOLS)];
+
+		memset(in->fields[i], ' ', STOCK_LEN);
+		memcpy(in->fields[i], name, strlen(name));
+
+		in->lens[i] = STOCK_LEN;
+	}
+}
+
+static uint64_t		*order_keys;
+
+/*
+ * The order tables hold about as many live orders as a busy ITCH day.
+ * Lookups are for orders that exist.
+ */
+static GHashTable *setup_order_table(struct input *in, GHashFunc hash, GEqualFunc equal)
+{
+	GHashTable *table;
+	unsigned int i;
+
+	table = g_hash_table_new(hash, equal);
+	if (!table)
+		error("out of memory");
+
+	if (!order_keys) {
+		order_keys = malloc(NR_ORDERS * sizeof(*order_keys));
+		if (!order_keys)
+			error("out of memory");
+	}
+
+	for (i = 0; i < NR_ORDERS; i++) {
+		order_keys[i] = 1 + rng_range(UINT64_C(1) << 40);
+
+		g_hash_table_insert(table, &order_keys[i], &order_keys[i]);
+	}
+
+	for (i = 0; i < NR_INPUTS; i++)
+		in->values[i] = order_keys[rng_range(NR_ORDERS)];
+
+	return table;
+}
+
+static GHashTable	*order_table;
+
+static void setup_int_orders(struct input *in)
+{
+	if (order_table)
+		g_hash_table_destroy(order_table);
+
+	order_table = setup_order_table(in, g_int_hash, g_int_equal);
+}
+
+static void setup_int64_orders(struct input *in)
+{
+	if (order_table)
+		g_hash_table_destroy(order_table);
+
+	order_table = setup_order_table(in, g_int64_hash, g_int64_equal);
+}
+
+/*
+ * The kernels return the number of bytes they decode or format.
+ */
+
+#define DECODE_KERNEL(fn)						\
+static size_t run_##fn(struct input *in)				\
+{									\
+	uint64_t sum = 0;						\
+	size_t bytes = 0;						\
+	unsigned int i;							\
+									\
+	for (i = 0; i < NR_INPUTS; i++) {				\
+		sum   += fn(in->fields[i], in->lens[i]);		\
+		bytes += in->lens[i];					\
+	}								\
+									\
+	sink = sum;							\
+									\
+	return bytes;							\
+}
+
+DECODE_KERNEL(base36_decode)
+DECODE_KERNEL(base10_decode)
+DECODE_KERNEL(dsv_parse_uint)
+DECODE_KERNEL(dsv_parse_price)
+
+static size_t run_base36_decode_id(struct input *in)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < NR_INPUTS; i++)
+		sum += base36_decode_id(in->fields[i]);
+
+	sink = sum;
+
+	return NR_INPUTS * BASE36_ID_LEN;
+}
+
+static size_t run_base36_decode_ids(struct input *in)
+{
+	static uint64_t values[NR_INPUTS];
+
+	if (base36_decode_ids(in->fields[0], FIELD_SIZE, NR_INPUTS, values) != NR_INPUTS)
+		error("invalid order ID in input");
+
+	sink = values[NR_INPUTS - 1];
+
+	return NR_INPUTS * BASE36_ID_LEN;
+}
+
+#define FORMAT_KERNEL(fn)						\
+static size_t run_##fn(struct input *in)				\
+{									\
+	size_t pos = 0;							\
+	unsigned int i;							\
+									\
+	for (i = 0; i < NR_INPUTS; i++)					\
+		pos += fn(out_buf + pos, in->values[i], '\t');		\
+									\
+	sink = out_buf[pos / 2];					\
+									\
+	return pos;							\
+}
+
+FORMAT_KERNEL(dsv_fmt_uint)
+FORMAT_KERNEL(dsv_fmt_price)
+FORMAT_KERNEL(dsv_fmt_base36)
+
+static size_t run_dsv_fmt_value(struct input *in)
+{
+	size_t pos = 0;
+	unsigned int i;
+
+	for (i = 0; i < NR_INPUTS; i++)
+		pos += dsv_fmt_value(out_buf + pos, in->fields[i], in->lens[i], '\t');
+
+	sink = out_buf[pos / 2];
+
+	return pos;
+}
+
+static size_t run_g_hash_table_lookup(struct input *in)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < NR_INPUTS; i++) {
+		uint64_t *order = g_hash_table_lookup(order_table, &in->values[i]);
+
+		sum += *order;
+	}
+
+	sink = sum;
+
+	return 0;
+}
+
+static size_t run_symbol_intern(struct input *in)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < NR_INPUTS; i++)
+		sum += symbol_intern(in->fields[i], in->lens[i]);
+
+	sink = sum;
+
+	return 0;
+}
+
+struct kernel {
+	const char		*group;
+	const char		*name;
+	const char		*input;
+	void			(*setup)(struct input *in);
+	size_t			(*run)(struct input *in);
+};
+
+static const struct kernel kernels[] = {
+	{ "Decode", "base36_decode",	"PITCH order ID, 12 chars",	setup_order_ids,	run_base36_decode },
+	{ "Decode", "base36_decode_id",	"PITCH order ID, 12 chars",	setup_order_ids,	run_base36_decode_id },
+	{ "Decode", "base36_decode_ids", "PITCH order ID, 12 chars",	setup_order_ids,	run_base36_decode_ids },
+	{ "Decode", "base10_decode",	"PITCH shares, 6 digits",	setup_shares,		run_base10_decode },
+	{ "Decode", "dsv_parse_uint",	"PITCH shares, 6 digits",	setup_shares,		run_dsv_parse_uint },
+	{ "Decode", "base10_decode",	"PITCH timestamp, 8 digits",	setup_millis,		run_base10_decode },
+	{ "Decode", "dsv_parse_uint",	"PITCH timestamp, 8 digits",	setup_millis,		run_dsv_parse_uint },
+	{ "Decode", "base10_decode",	"PITCH long price, 10 digits",	setup_long_prices,	run_base10_decode },
+	{ "Decode", "dsv_parse_uint",	"PITCH long price, 10 digits",	setup_long_prices,	run_dsv_parse_uint },
+	{ "Decode", "base10_decode",	"TSV quantity, 1-5 digits",	setup_quantities,	run_base10_decode },
+	{ "Decode", "dsv_parse_uint",	"TSV quantity, 1-5 digits",	setup_quantities,	run_dsv_parse_uint },
+	{ "Decode", "dsv_parse_price",	"TSV price, 'x.xxxx'",		setup_tsv_prices,	run_dsv_parse_price },
+
+	{ "Format", "dsv_fmt_uint",	"time, ns since midnight",	setup_times,		run_dsv_fmt_uint },
+	{ "Format", "dsv_fmt_uint",	"quantity",			setup_quantity_values,	run_dsv_fmt_uint },
+	{ "Format", "dsv_fmt_price",	"price",			setup_price_values,	run_dsv_fmt_price },
+	{ "Format", "dsv_fmt_base36",	"order ID",			setup_order_ids,	run_dsv_fmt_base36 },
+	{ "Format", "dsv_fmt_value",	"symbol, 1-5 chars",		setup_symbols,		run_dsv_fmt_value },
+
+	{ "Lookup", "g_hash_table_lookup", "g_int_hash, 1M orders",	setup_int_orders,	run_g_hash_table_lookup },
+	{ "Lookup", "g_hash_table_lookup", "g_int64_hash, 1M orders",	setup_int64_orders,	run_g_hash_table_lookup },
+	{ "Lookup", "symbol_intern",	"ITCH stock, 8k symbols",	setup_stocks,		run_symbol_intern },
+};
+
+static uint64_t clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t clock_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static bool kernel_selected(const struct kernel *kernel)
+{
+	int i;
+
+	if (!nr_patterns)
+		return true;
+
+	for (i = 0; i < nr_patterns; i++) {
+		if (strstr(kernel->name, patterns[i]))
+			return true;
+	}
+
+	return false;
+}
+
+static void bench_kernel(const struct kernel *kernel, struct input *in)
+{
+	double best_ns = 0.0, best_cycles = 0.0;
+	unsigned long passes, i;
+	size_t bytes = 0;
+	unsigned int run;
+
+	rng_state = seed;
+
+	memset(in, 0, sizeof(*in));
+
+	kernel->setup(in);
+
+	/* Double the number of passes until a run takes long enough: */
+	for (passes = 1; ; passes *= 2) {
+		uint64_t start = clock_ns();
+
+		for (i = 0; i < passes; i++)
+			kernel->run(in);
+
+		if (clock_ns() - start >= time_ms * 1000000ULL)
+			break;
+	}
+
+	for (run = 0; run < repeat; run++) {
+		uint64_t start_ns, end_ns, start_cycles, end_cycles;
+		double ops = (double) passes * NR_INPUTS;
+
+		start_ns     = clock_ns();
+		start_cycles = clock_cycles();
+
+		for (i = 0; i < passes; i++)
+			bytes = kernel->run(in);
+
+		end_cycles = clock_cycles();
+		end_ns	   = clock_ns();
+
+		if (!run || (end_ns - start_ns) / ops < best_ns) {
+			best_ns	    = (end_ns - start_ns) / ops;
+			best_cycles = (end_cycles - start_cycles) / ops;
+		}
+	}
+
+	printf("  %-20s %-28s %8.2f", kernel->name, kernel->input, best_ns);
+
+	if (best_cycles > 0)
+		printf(" %10.2f", best_cycles);
+	else
+		printf(" %10s", "-");
+
+	if (bytes && best_cycles > 0)
+		printf(" %12.2f\n", bytes / (best_cycles * NR_INPUTS));
+	else
+		printf(" %12s\n", "-");
+}
+
+static void parse_args(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "r:t:s:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'r':
+			repeat		= strtoul(optarg, NULL, 10);
+			if (!repeat)
+				error("%s: invalid number of runs", optarg);
+			break;
+		case 't':
+			time_ms		= strtoul(optarg, NULL, 10);
+			if (!time_ms)
+				error("%s: invalid time", optarg);
+			break;
+		case 's':
+			seed		= strtoull(optarg, NULL, 10);
+			break;
+		default:
+			usage();
+			break;
+		}
+	}
+
+	patterns	= argv + optind;
+	nr_patterns	= argc - optind;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *group = NULL;
+	struct input *in;
+	unsigned int i;
+
+	program = basename(argv[0]);
+
+	setlocale(LC_ALL, "");
+
+	parse_args(argc, argv);
+
+	in = malloc(sizeof(*in));
+	if (!in)
+		error("out of memory");
+
+	printf(" Microbenchmarks (%'u inputs per pass, best of %u runs):\n", NR_INPUTS, repeat);
+
+	for (i = 0; i < ARRAY_SIZE(kernels); i++) {
+		const struct kernel *kernel = &kernels[i];
+
+		if (!kernel_selected(kernel))
+			continue;
+
+		if (!group || strcmp(group, kernel->group)) {
+			group = kernel->group;
+
+			printf("\n  %-20s %-28s %8s %10s %12s\n",
+				group, "Input", "ns/op", "cycles/op", "bytes/cycle");
+		}
+
+		bench_kernel(kernel, in);
+
+		fflush(stdout);
+	}
+
+	printf("\n");
+
+	if (order_table)
+		g_hash_table_destroy(order_table);
+
+	free(order_keys);
+
+	free(in);
+
+	return 0;
+}
@@ -0,0 +1,289 @@
+#include "tick/builtins.h"
+
+#include "tick/nasdaq/itch-proto.h"
+#include "tick/bats/pitch-proto.h"
+#include "tick/nyse/taq-proto.h"
+#include "tick/format.h"
+#include "tick/output.h"
+#include "tick/error.h"
+#include "tick/bars.h"
+#include "tick/taq.h"
+#include "tick/ob.h"
+
+#include <getopt.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+extern const char *program;
+
+#define DEFAULT_INTERVAL	(60ULL * 1000000000ULL) /* 1m */
+
+static void usage(void)
+{
+#define FMT								\
+"\n usage: %s bars [<options>] <input> <output>\n"			\
+"\n"									\
+"    -s, --symbol <symbol>       only this symbol (default: all symbols)\n" \
+"    -f, --format <format>       input file format\n"			\
+"    -d, --date <date>           date\n"				\
+"    -i, --interval <time>       bar interval (e.g. 1s, 5m; default: 1m)\n" \
+"    -z, --compress <type>       compress output (%s, %s)\n"		\
+"    -j, --threads <n>           number of compression threads\n"	\
+"\n Use '-' as <output> to write to standard output.\n"			\
+"\n Supported file formats are:\n"					\
+"\n"									\
+"   %s\n"								\
+"   %s\n"								\
+"   %s\n"								\
+"\n"
+	fprintf(stderr, FMT,
+			program,
+			output_compression_names[OUTPUT_COMPRESSION_GZIP],
+			output_compression_names[OUTPUT_COMPRESSION_ZSTD],
+			format_names[FORMAT_BATS_PITCH_112],
+			format_names[FORMAT_NASDAQ_ITCH_41],
+			format_names[FORMAT_NYSE_TAQ_17]);
+
+#undef FMT
+
+	exit(EXIT_FAILURE);
+}
+
+static const struct option options[] = {
+	{ "date",	required_argument,	NULL, 'd' },
+	{ "format",	required_argument, 	NULL, 'f' },
+	{ "interval",	required_argument,	NULL, 'i' },
+	{ "compress",	required_argument,	NULL, 'z' },
+	{ "threads",	required_argument,	NULL, 'j' },
+	{ "symbol",	required_argument, 	NULL, 's' },
+	{ NULL,		0,			NULL,  0  },
+};
+
+static const char	*output_filename;
+static struct output_options output_options;
+static const char	*input_filename;
+static const char	*date;
+static const char	*format;
+static const char	*symbol;
+static uint64_t		interval = DEFAULT_INTERVAL;
+
+static void parse_args(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "f:s:d:i:z:j:", options, NULL)) != -1) {
+		switch (opt) {
+		case 's':
+			symbol		= optarg;
+			break;
+		case 'f':
+			format		= optarg;
+			break;
+		case 'd':
+			date		= optarg;
+			break;
+		case 'i':
+			interval	= parse_output_interval(optarg);
+			if (!interval)
+				error("%s: invalid interval", optarg);
+			break;
+		default:
+			if (!output_parse_option(&output_options, opt, optarg))
+				usage();
+			break;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc < 2)
+		usage();
+
+	input_filename	= argv[0];
+	output_filename = argv[1];
+}
+
+static void init_stream(z_stream *stream)
+{
+	memset(stream, 0, sizeof(*stream));
+
+	if (inflateInit2(stream, 15 + 32) != Z_OK)
+		error("unable to initialize zlib");
+}
+
+static void release_stream(z_stream *stream)
+{
+	inflateEnd(stream);
+}
+
+/*
+ * The trade paths of the OB and TAQ converters feed the bars directly
+ * through the writers' event hooks, so no text is formatted for them.
+ */
+static void bars_nasdaq_itch(struct bars *bars, z_stream *stream, int in_fd)
+{
+	struct nasdaq_itch_session session;
+	struct ob_writer writer;
+	char date_buf[11];
+
+	if (!date) {
+		if (nasdaq_itch_file_parse_date(input_filename, date_buf, sizeof(date_buf)) < 0)
+			error("%s: unable to parse date from filename", input_filename);
+
+		date = date_buf;
+	}
+
+	ob_writer_init(&writer, NULL, "D,E,T");
+
+	writer.event_fn		= bars_ob_event;
+	writer.event_data	= bars;
+
+	session = (struct nasdaq_itch_session) {
+		.zstream	= stream,
+		.in_fd		= in_fd,
+		.ob_writer	= &writer,
+		.input_filename	= input_filename,
+		.time_zone	= "America/New_York",
+		.time_zone_len	= strlen("America/New_York"),
+		.date		= date,
+		.date_len	= strlen(date),
+		.exchange	= "XNAS",
+		.exchange_len	= strlen("XNAS"),
+		.symbol		= symbol,
+		.symbol_len	= symbol ? strlen(symbol) : 0,
+	};
+
+	nasdaq_itch_filter_init(&session.filter, symbol);
+
+	nasdaq_itch_ob(&session);
+}
+
+static void bars_bats_pitch(struct bars *bars, z_stream *stream, int in_fd)
+{
+	struct pitch_session session;
+	struct taq_writer writer;
+	char date_buf[11];
+
+	if (!date) {
+		if (pitch_file_parse_date(input_filename, date_buf, sizeof(date_buf)) < 0)
+			error("%s: unable to parse date from filename", input_filename);
+
+		date = date_buf;
+	}
+
+	taq_writer_init(&writer, NULL, "D,T");
+
+	writer.event_fn		= bars_taq_event;
+	writer.event_data	= bars;
+
+	session = (struct pitch_session) {
+		.zstream	= stream,
+		.in_fd		= in_fd,
+		.taq_writer	= &writer,
+		.input_filename	= input_filename,
+		.time_zone	= "America/New_York",
+		.time_zone_len	= strlen("America/New_York"),
+		.date		= date,
+		.date_len	= strlen(date),
+		.exchange	= "BATS",
+		.exchange_len	= strlen("BATS"),
+		.symbol		= symbol,
+		.symbol_len	= symbol ? strlen(symbol) : 0,
+	};
+
+	pitch_filter_init(&session.filter, symbol);
+
+	bats_pitch_taq(&session);
+}
+
+static void bars_nyse_taq(struct bars *bars, z_stream *stream, int in_fd)
+{
+	struct nyse_taq_session	session;
+	struct taq_writer writer;
+
+	taq_writer_init(&writer, NULL, "D,T");
+
+	writer.event_fn		= bars_taq_event;
+	writer.event_data	= bars;
+
+	session = (struct nyse_taq_session) {
+		.zstream	= stream,
+		.in_fd		= in_fd,
+		.taq_writer	= &writer,
+		.input_filename	= input_filename,
+		.date           = date,
+		.time_zone	= "America/New_York",
+		.time_zone_len	= strlen("America/New_York"),
+		.symbol		= symbol,
+		.symbol_len	= symbol ? strlen(symbol) : 0,
+	};
+
+	nyse_taq_filter_init(&session.filter, symbol);
+
+	nyse_taq_taq(&session);
+}
+
+int cmd_bars(int argc, char *argv[])
+{
+	struct output *out;
+	struct bars bars;
+	enum format fmt;
+	z_stream stream;
+	int in_fd;
+
+	setlocale(LC_ALL, "");
+
+	parse_args(argc - 1, argv + 1);
+
+	if (!format)
+		error("%s: file format not detected. Please specify it with the '-f' option.",
+			input_filename);
+
+	fmt = parse_format(format);
+	if ((int) fmt < 0)
+		error("%s is not a supported file format", format);
+
+	init_stream(&stream);
+
+	in_fd = open(input_filename, O_RDONLY);
+	if (in_fd < 0)
+		error("%s: %s", input_filename, strerror(errno));
+
+	out = output_open(output_filename, &output_options);
+
+	bars_init(&bars, out, interval);
+
+	bars_write_header(&bars);
+
+	switch (fmt) {
+	case FORMAT_NASDAQ_ITCH_41:
+		bars_nasdaq_itch(&bars, &stream, in_fd);
+		break;
+	case FORMAT_BATS_PITCH_112:
+		bars_bats_pitch(&bars, &stream, in_fd);
+		break;
+	case FORMAT_NYSE_TAQ_17:
+	default:
+		bars_nyse_taq(&bars, &stream, in_fd);
+		break;
+	}
+
+	bars_flush(&bars);
+
+	output_close(out);
+
+	bars_release(&bars);
+
+	if (close(in_fd) < 0)
+		error("%s: %s", input_filename, strerror(errno));
+
+	release_stream(&stream);
+
+	return 0;
+}
@@ -0,0 +1,548 @@
+#include "tick/builtins.h"
+
+#include "tick/output.h"
+#include "tick/error.h"
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <getopt.h>
+#include <locale.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <glob.h>
+#include <time.h>
+
+extern const char *program;
+
+static void usage(void)
+{
+#define FMT								\
+"\n usage: %s batch [<options>] -o <template> <command> [<args>] -- <input>...\n" \
+"\n"									\
+"    -o, --output <template>     output file name, '{}' is the input name\n" \
+"    -l, --list <file>           read input file names from <file>\n"	\
+"    -j, --jobs <n>              number of concurrent jobs\n"		\
+"    -M, --memory <size>         memory budget for all jobs (e.g. 16G)\n" \
+"\n Runs '%s <command> [<args>] <input> <output>' for every input, largest\n" \
+" input first.  Inputs may be glob patterns.  In the output template, '{}'\n" \
+" is replaced with the input file name up to its first '.'.\n"		\
+"\n"
+	fprintf(stderr, FMT, program, program);
+
+#undef FMT
+
+	exit(EXIT_FAILURE);
+}
+
+static const struct option options[] = {
+	{ "output",	required_argument,	NULL, 'o' },
+	{ "list",	required_argument,	NULL, 'l' },
+	{ "jobs",	required_argument,	NULL, 'j' },
+	{ "memory",	required_argument,	NULL, 'M' },
+	{ NULL,		0,			NULL,  0  },
+};
+
+#define BATCH_MESSAGE_LEN	256
+
+struct batch_job {
+	const char		*input;
+	char			*output;
+	uint64_t		size;
+	uint64_t		estimate;	/* bytes of memory */
+	pid_t			pid;
+	int			err_fd;
+	struct timespec		start;
+	double			seconds;
+	uint64_t		max_rss;	/* bytes */
+	int			status;
+	bool			started;
+	bool			done;
+
+	/* Last line the job wrote to standard error: */
+	char			line[BATCH_MESSAGE_LEN];
+	size_t			line_len;
+	char			message[BATCH_MESSAGE_LEN];
+};
+
+static const char	*output_template;
+static const char	*list_filename;
+static unsigned int	nr_jobs;
+static uint64_t		memory_budget;
+static char		**command_argv;
+static int		command_argc;
+
+static struct batch_job	*jobs;
+static unsigned int	nr_inputs;
+static unsigned int	inputs_capacity;
+
+static void add_input(const char *input)
+{
+	if (nr_inputs == inputs_capacity) {
+		inputs_capacity = inputs_capacity ? 2 * inputs_capacity : 64;
+
+		jobs = realloc(jobs, inputs_capacity * sizeof(*jobs));
+		if (!jobs)
+			error("out of memory");
+	}
+
+	jobs[nr_inputs++] = (struct batch_job) {
+		.input		= input,
+		.err_fd		= -1,
+	};
+}
+
+static void add_pattern(const char *pattern)
+{
+	glob_t g;
+	size_t i;
+
+	if (!strpbrk(pattern, "*?[")) {
+		add_input(pattern);
+		return;
+	}
+
+	if (glob(pattern, 0, NULL, &g))
+		error("%s: no matching files", pattern);
+
+	/* The strings stay around until the process exits: */
+	for (i = 0; i < g.gl_pathc; i++)
+		add_input(strdup(g.gl_pathv[i]));
+
+	globfree(&g);
+}
+
+static void read_list(const char *filename)
+{
+	char *line = NULL;
+	size_t capacity = 0;
+	ssize_t len;
+	FILE *file;
+
+	file = strcmp(filename, "-") ? fopen(filename, "r") : stdin;
+	if (!file)
+		error("%s: %s", filename, strerror(errno));
+
+	while ((len = getline(&line, &capacity, file)) != -1) {
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = '\0';
+
+		if (len > 0)
+			add_pattern(strdup(line));
+	}
+
+	free(line);
+
+	if (file != stdin)
+		fclose(file);
+}
+
+static void parse_args(int argc, char *argv[])
+{
+	int opt, i;
+
+	/* Stop at the command so that its options are passed through: */
+	while ((opt = getopt_long(argc, argv, "+o:l:j:M:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'o':
+			output_template	= optarg;
+			break;
+		case 'l':
+			list_filename	= optarg;
+			break;
+		case 'j':
+			nr_jobs		= strtoul(optarg, NULL, 10);
+			break;
+		case 'M':
+			memory_budget	= parse_output_size(optarg);
+			if (!memory_budget)
+				error("%s: invalid size", optarg);
+			break;
+		default:
+			usage();
+			break;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc < 1 || !output_template)
+		usage();
+
+	command_argv = argv;
+
+	for (i = 0; i < argc; i++) {
+		if (!strcmp(argv[i], "--"))
+			break;
+	}
+
+	command_argc = i;
+
+	for (i++; i < argc; i++)
+		add_pattern(argv[i]);
+
+	if (list_filename)
+		read_list(list_filename);
+
+	if (!nr_inputs)
+		usage();
+}
+
+/*
+ * Substitute the input name for "{}" in the output template.
+ */
+static char *expand_template(const char *input)
+{
+	const char *base, *p;
+	size_t stem_len, len;
+	char *ret, *q;
+
+	base = strrchr(input, '/');
+	base = base ? base + 1 : input;
+
+	stem_len = strcspn(base, ".");
+
+	len = strlen(output_template) + 1;
+
+	for (p = strstr(output_template, "{}"); p; p = strstr(p + 2, "{}"))
+		len += stem_len;
+
+	ret = malloc(len);
+	if (!ret)
+		error("out of memory");
+
+	for (p = output_template, q = ret; *p; ) {
+		if (p[0] == '{' && p[1] == '}') {
+			memcpy(q, base, stem_len);
+			q += stem_len;
+			p += 2;
+		} else {
+			*q++ = *p++;
+		}
+	}
+
+	*q = '\0';
+
+	return ret;
+}
+
+static int compare_size(const void *a, const void *b)
+{
+	const struct batch_job *x = a, *y = b;
+
+	if (x->size != y->size)
+		return x->size < y->size ? 1 : -1;
+
+	return strcmp(x->input, y->input);
+}
+
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void start_job(struct batch_job *job, const char *exe)
+{
+	char **argv;
+	int fds[2];
+	int i;
+
+	argv = calloc(command_argc + 4, sizeof(*argv));
+	if (!argv)
+		error("out of memory");
+
+	argv[0] = (char *) program;
+
+	for (i = 0; i < command_argc; i++)
+		argv[i + 1] = command_argv[i];
+
+	argv[i + 1] = (char *) job->input;
+	argv[i + 2] = job->output;
+
+	if (pipe(fds) < 0)
+		error("pipe: %s", strerror(errno));
+
+	clock_gettime(CLOCK_MONOTONIC, &job->start);
+
+	job->pid = fork();
+	if (job->pid < 0)
+		error("fork: %s", strerror(errno));
+
+	if (!job->pid) {
+		close(fds[0]);
+
+		if (dup2(fds[1], STDERR_FILENO) < 0)
+			_exit(127);
+
+		close(fds[1]);
+
+		execv(exe, argv);
+
+		fprintf(stderr, "%s: %s\n", exe, strerror(errno));
+
+		_exit(127);
+	}
+
+	close(fds[1]);
+
+	job->err_fd	= fds[0];
+	job->started	= true;
+
+	free(argv);
+}
+
+/*
+ * Keep the last line a job writes to standard error; it is the error
+ * message when the job fails.  Progress updates end in a carriage return.
+ */
+static bool read_job_output(struct batch_job *job)
+{
+	char buf[4096];
+	ssize_t nr, i;
+
+	nr = read(job->err_fd, buf, sizeof(buf));
+	if (nr < 0)
+		return errno == EINTR || errno == EAGAIN;
+
+	if (!nr) {
+		if (job->line_len) {
+			memcpy(job->message, job->line, job->line_len);
+			job->message[job->line_len] = '\0';
+		}
+		return false;
+	}
+
+	for (i = 0; i < nr; i++) {
+		if (buf[i] == '\n' || buf[i] == '\r') {
+			if (job->line_len) {
+				memcpy(job->message, job->line, job->line_len);
+				job->message[job->line_len] = '\0';
+			}
+			job->line_len = 0;
+		} else if (job->line_len < BATCH_MESSAGE_LEN - 1) {
+			job->line[job->line_len++] = buf[i];
+		}
+	}
+
+	return true;
+}
+
+static void finish_job(struct batch_job *job)
+{
+	struct rusage usage;
+	int status;
+
+	close(job->err_fd);
+
+	job->err_fd = -1;
+
+	while (wait4(job->pid, &status, 0, &usage) < 0) {
+		if (errno != EINTR)
+			error("wait: %s", strerror(errno));
+	}
+
+	job->seconds	= elapsed(&job->start);
+	job->max_rss	= (uint64_t) usage.ru_maxrss * 1024;
+	job->done	= true;
+
+	if (WIFEXITED(status))
+		job->status = WEXITSTATUS(status);
+	else
+		job->status = 128 + WTERMSIG(status);
+}
+
+/*
+ * Memory of a job is estimated from the largest ratio of peak RSS to input
+ * size seen so far.  Until the first job finishes, every job is assumed to
+ * need an equal share of the budget.
+ */
+static double rss_ratio;
+
+static uint64_t estimate_memory(struct batch_job *job)
+{
+	if (rss_ratio > 0)
+		return job->size * rss_ratio;
+
+	return memory_budget / nr_jobs;
+}
+
+static void learn_memory(struct batch_job *job)
+{
+	double ratio;
+
+	if (job->status || !job->size)
+		return;
+
+	ratio = (double) job->max_rss / job->size;
+	if (ratio > rss_ratio)
+		rss_ratio = ratio;
+}
+
+static void run_jobs(const char *exe)
+{
+	unsigned int nr_running = 0, nr_pending = nr_inputs;
+	struct pollfd *pfds;
+	struct batch_job **running;
+	uint64_t used = 0;
+	unsigned int i;
+
+	pfds = calloc(nr_jobs, sizeof(*pfds));
+	running = calloc(nr_jobs, sizeof(*running));
+	if (!pfds || !running)
+		error("out of memory");
+
+	while (nr_pending || nr_running) {
+		/* Start the largest pending jobs that fit in the budget: */
+		for (i = 0; i < nr_inputs && nr_pending && nr_running < nr_jobs; i++) {
+			struct batch_job *job = &jobs[i];
+
+			if (job->started)
+				continue;
+
+			if (memory_budget) {
+				job->estimate = estimate_memory(job);
+
+				if (nr_running && used + job->estimate > memory_budget)
+					continue;
+			}
+
+			start_job(job, exe);
+
+			used += job->estimate;
+
+			running[nr_running++] = job;
+			nr_pending--;
+		}
+
+		for (i = 0; i < nr_running; i++) {
+			pfds[i] = (struct pollfd) {
+				.fd		= running[i]->err_fd,
+				.events		= POLLIN,
+			};
+		}
+
+		if (poll(pfds, nr_running, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+
+			error("poll: %s", strerror(errno));
+		}
+
+		for (i = 0; i < nr_running; ) {
+			struct batch_job *job = running[i];
+
+			if (!pfds[i].revents || read_job_output(job)) {
+				i++;
+				continue;
+			}
+
+			finish_job(job);
+
+			learn_memory(job);
+
+			used -= job->estimate;
+
+			/* Keep 'pfds' in step with 'running': */
+			running[i] = running[nr_running - 1];
+			pfds[i] = pfds[nr_running - 1];
+
+			nr_running--;
+		}
+	}
+
+	free(running);
+	free(pfds);
+}
+
+static unsigned int print_report(void)
+{
+	unsigned int i, nr_failed = 0;
+	uint64_t total_size = 0;
+	double total = 0;
+
+	printf(" Batch results:\n\n");
+
+	for (i = 0; i < nr_inputs; i++) {
+		struct batch_job *job = &jobs[i];
+
+		printf("%'16.0f bytes %8.2f s %10.2f MB/s %'10.0f KB  %s",
+			(double) job->size,
+			job->seconds,
+			job->seconds > 0 ? job->size / job->seconds / 1e6 : 0,
+			(double) job->max_rss / 1024,
+			job->input);
+
+		if (job->status) {
+			printf("  FAILED (%d): %s", job->status, job->message);
+			nr_failed++;
+		}
+
+		printf("\n");
+
+		total_size	+= job->size;
+		total		+= job->seconds;
+	}
+
+	printf("\n %u files, %u failed, %.2f MB/s per job on average\n",
+		nr_inputs, nr_failed, total > 0 ? total_size / total / 1e6 : 0);
+
+	return nr_failed;
+}
+
+int cmd_batch(int argc, char *argv[])
+{
+	char exe[PATH_MAX];
+	unsigned int i;
+	ssize_t len;
+
+	setlocale(LC_ALL, "");
+
+	parse_args(argc - 1, argv + 1);
+
+	if (!command_argc)
+		error("command not specified");
+
+	if (nr_inputs > 1 && !strstr(output_template, "{}"))
+		error("%s: output template must contain '{}'", output_template);
+
+	if (!nr_jobs)
+		nr_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+	/* Jobs run in a fresh 'tick' process each: */
+	len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+	if (len < 0)
+		error("/proc/self/exe: %s", strerror(errno));
+
+	exe[len] = '\0';
+
+	for (i = 0; i < nr_inputs; i++) {
+		struct batch_job *job = &jobs[i];
+		struct stat st;
+
+		if (stat(job->input, &st) < 0)
+			error("%s: %s", job->input, strerror(errno));
+
+		job->size	= st.st_size;
+		job->output	= expand_template(job->input);
+	}
+
+	qsort(jobs, nr_inputs, sizeof(*jobs), compare_size);
+
+	run_jobs(exe);
+
+	if (print_report())
+		return EXIT_FAILURE;
+
+	return 0;
+}
@@ -0,0 +1,1014 @@
+#include "tick/builtins.h"
+
+#include "libtrading/proto/nasdaq_itch41_message.h"
+#include "libtrading/proto/bats_pitch_message.h"
+#include "libtrading/buffer.h"
+
+#include "tick/nasdaq/itch-proto.h"
+#include "tick/bats/pitch-proto.h"
+#include "tick/nyse/taq-proto.h"
+#include "tick/progress.h"
+#include "tick/format.h"
+#include "tick/output.h"
+#include "tick/stream.h"
+#include "tick/error.h"
+#include "tick/types.h"
+#include "tick/json.h"
+#include "tick/taq.h"
+#include "tick/ob.h"
+
+#include <sys/utsname.h>
+#include <sys/stat.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+extern const char *program;
+
+#define DEFAULT_WARMUP		1
+#define DEFAULT_REPEAT		5
+#define DEFAULT_THRESHOLD	5
+
+#define BUFFER_SIZE	(1ULL << 20) /* 1 MB */
+
+static void usage(void)
+{
+#define FMT								\
+"\n usage: %s bench [<options>] <input>\n"				\
+"\n"									\
+"    -f, --format <format>       input file format\n"			\
+"    -s, --symbol <symbol>       symbol of the filter and conversion stages\n" \
+"    -S, --stages <stages>       comma-separated stages to run (default: all)\n" \
+"    -w, --warmup <n>            untimed runs per stage (default: %d)\n"	\
+"    -r, --repeat <n>            timed runs per stage (default: %d)\n"	\
+"    -j, --json <file>           write the results to <file> as JSON\n"	\
+"    -b, --baseline <file>       compare with the JSON results in <file>\n" \
+"    -t, --threshold <pct>       slowdown that is a regression (default: %d%%)\n" \
+"\n The stages are:\n"							\
+"\n"									\
+"   inflate   decompress only\n"					\
+"   decode    decompress and decode messages\n"			\
+"   filter    decode and filter messages by symbol\n"			\
+"   track     decode, filter and track orders without formatting\n"	\
+"   ob        full conversion to OB format\n"				\
+"   taq       full conversion to TAQ format\n"				\
+"\n Conversion output goes to a temporary file in $TMPDIR.  When comparing\n" \
+" with a baseline, the exit status is 1 if any stage regressed.\n"	\
+"\n Supported file formats are:\n"					\
+"\n"									\
+"   %s\n"								\
+"   %s\n"								\
+"   %s\n"								\
+"\n"
+	fprintf(stderr, FMT,
+			program,
+			DEFAULT_WARMUP,
+			DEFAULT_REPEAT,
+			DEFAULT_THRESHOLD,
+			format_names[FORMAT_BATS_PITCH_112],
+			format_names[FORMAT_NASDAQ_ITCH_41],
+			format_names[FORMAT_NYSE_TAQ_17]);
+
+#undef FMT
+
+	exit(EXIT_FAILURE);
+}
+
+static const struct option options[] = {
+	{ "format",	required_argument, 	NULL, 'f' },
+	{ "symbol",	required_argument, 	NULL, 's' },
+	{ "stages",	required_argument,	NULL, 'S' },
+	{ "warmup",	required_argument,	NULL, 'w' },
+	{ "repeat",	required_argument,	NULL, 'r' },
+	{ "json",	required_argument,	NULL, 'j' },
+	{ "baseline",	required_argument,	NULL, 'b' },
+	{ "threshold",	required_argument,	NULL, 't' },
+	{ NULL,		0,			NULL,  0  },
+};
+
+static const char	*input_filename;
+static const char	*format;
+static const char	*symbol;
+static const char	*stages;
+static unsigned int	nr_warmup = DEFAULT_WARMUP;
+static unsigned int	nr_repeat = DEFAULT_REPEAT;
+static const char	*json_filename;
+static const char	*baseline_filename;
+static double		threshold = DEFAULT_THRESHOLD;
+
+static void parse_args(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "f:s:S:w:r:j:b:t:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'f':
+			format		= optarg;
+			break;
+		case 's':
+			symbol		= optarg;
+			break;
+		case 'S':
+			stages		= optarg;
+			break;
+		case 'w':
+			nr_warmup	= strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			nr_repeat	= strtoul(optarg, NULL, 10);
+			break;
+		case 'j':
+			json_filename	= optarg;
+			break;
+		case 'b':
+			baseline_filename = optarg;
+			break;
+		case 't':
+			threshold	= strtod(optarg, NULL);
+			if (threshold <= 0)
+				error("%s: invalid threshold", optarg);
+			break;
+		default:
+			usage();
+			break;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc != 1)
+		usage();
+
+	input_filename = argv[0];
+}
+
+struct bench {
+	enum format		fmt;
+	int			in_fd;
+	uint64_t		file_size;
+	char			*output_filename;
+	z_stream		zstream;
+
+	/* Measured by the calibration runs: */
+	uint64_t		nr_bytes;	/* uncompressed */
+	uint64_t		nr_messages;
+
+	/* Results that must not be optimized away: */
+	uint64_t		nr_selected;
+	uint64_t		nr_events;
+};
+
+#define FORMAT_MASK(fmt)	(1U << (fmt))
+
+#define ALL_FORMATS		(FORMAT_MASK(FORMAT_BATS_PITCH_112) |	\
+				 FORMAT_MASK(FORMAT_NASDAQ_ITCH_41) |	\
+				 FORMAT_MASK(FORMAT_NYSE_TAQ_17))
+
+#define OB_FORMATS		(FORMAT_MASK(FORMAT_BATS_PITCH_112) |	\
+				 FORMAT_MASK(FORMAT_NASDAQ_ITCH_41))
+
+#define TAQ_FORMATS		(FORMAT_MASK(FORMAT_BATS_PITCH_112) |	\
+				 FORMAT_MASK(FORMAT_NYSE_TAQ_17))
+
+struct bench_stage {
+	const char		*name;
+	void			(*run)(struct bench *bench);
+	unsigned int		formats;
+	bool			needs_symbol;
+};
+
+static void init_stream(z_stream *stream)
+{
+	memset(stream, 0, sizeof(*stream));
+
+	if (inflateInit2(stream, 15 + 32) != Z_OK)
+		error("unable to initialize zlib");
+}
+
+static void release_stream(z_stream *stream)
+{
+	inflateEnd(stream);
+}
+
+static void bench_stream_open(struct bench *bench, struct stream *stream)
+{
+	struct buffer *comp_buf, *uncomp_buf;
+
+	comp_buf = buffer_mmap(bench->in_fd, bench->file_size);
+	if (!comp_buf)
+		error("%s: %s", input_filename, strerror(errno));
+
+	uncomp_buf = buffer_new(BUFFER_SIZE);
+	if (!uncomp_buf)
+		error("%s", strerror(errno));
+
+	init_stream(&bench->zstream);
+
+	bench->zstream.next_in = (void *) buffer_start(comp_buf);
+
+	*stream = (struct stream) {
+		.zstream	= &bench->zstream,
+		.uncomp_buf	= uncomp_buf,
+		.comp_buf	= comp_buf,
+	};
+}
+
+static void bench_stream_close(struct stream *stream)
+{
+	release_stream(stream->zstream);
+
+	buffer_munmap(stream->comp_buf);
+
+	buffer_delete(stream->uncomp_buf);
+}
+
+static void bench_inflate(struct bench *bench)
+{
+	struct stream stream;
+	uint64_t nr_bytes = 0;
+
+	bench_stream_open(bench, &stream);
+
+	for (;;) {
+		ssize_t nr;
+
+		buffer_advance(stream.uncomp_buf, buffer_size(stream.uncomp_buf));
+
+		buffer_compact(stream.uncomp_buf);
+
+		nr = buffer_inflate(stream.comp_buf, stream.uncomp_buf, stream.zstream);
+		if (nr < 0)
+			error("%s: %s", input_filename, strerror(EINVAL));
+
+		if (!nr)
+			break;
+
+		nr_bytes += nr;
+	}
+
+	bench_stream_close(&stream);
+
+	bench->nr_bytes = nr_bytes;
+}
+
+static void bench_decode(struct bench *bench)
+{
+	uint64_t nr_messages = 0;
+	struct stream stream;
+
+	bench_stream_open(bench, &stream);
+
+	for (;;) {
+		int err;
+
+		if (bench->fmt == FORMAT_NASDAQ_ITCH_41) {
+			struct itch41_message *msg;
+
+			err = nasdaq_itch_read(&stream, &msg);
+			if (!err && !msg)
+				break;
+		} else {
+			struct pitch_message *msg;
+
+			err = bats_pitch_read(&stream, &msg);
+			if (!err && !msg)
+				break;
+		}
+
+		if (err)
+			error("%s: %s", input_filename, strerror(err));
+
+		nr_messages++;
+	}
+
+	bench_stream_close(&stream);
+
+	bench->nr_messages = nr_messages;
+}
+
+static void bench_filter_nasdaq_itch(struct bench *bench, struct stream *stream)
+{
+	struct nasdaq_itch_session session;
+
+	session = (struct nasdaq_itch_session) {
+		.symbol		= symbol,
+		.symbol_len	= strlen(symbol),
+	};
+
+	nasdaq_itch_filter_init(&session.filter, symbol);
+
+	session.exec_hash = g_hash_table_new(g_int64_hash, g_int64_equal);
+	if (!session.exec_hash)
+		error("out of memory");
+
+	for (;;) {
+		struct itch41_message *msg;
+		int err;
+
+		err = nasdaq_itch_read(stream, &msg);
+		if (err)
+			error("%s: %s", input_filename, strerror(err));
+
+		if (!msg)
+			break;
+
+		bench->nr_selected += nasdaq_itch_session_filter_msg(&session, msg);
+	}
+
+	g_hash_table_destroy(session.exec_hash);
+}
+
+static void bench_filter_bats_pitch(struct bench *bench, struct stream *stream)
+{
+	struct pitch_session session;
+
+	session = (struct pitch_session) {
+		.symbol		= symbol,
+		.symbol_len	= strlen(symbol),
+	};
+
+	pitch_filter_init(&session.filter, symbol);
+
+	session.exec_hash = g_hash_table_new(g_int64_hash, g_int64_equal);
+	if (!session.exec_hash)
+		error("out of memory");
+
+	for (;;) {
+		struct pitch_message *msg;
+		int err;
+
+		err = bats_pitch_read(stream, &msg);
+		if (err)
+			error("%s: %s", input_filename, strerror(err));
+
+		if (!msg)
+			break;
+
+		bench->nr_selected += pitch_session_filter_msg(&session, msg);
+	}
+
+	g_hash_table_destroy(session.exec_hash);
+}
+
+static void bench_filter(struct bench *bench)
+{
+	struct stream stream;
+
+	bench_stream_open(bench, &stream);
+
+	if (bench->fmt == FORMAT_NASDAQ_ITCH_41)
+		bench_filter_nasdaq_itch(bench, &stream);
+	else
+		bench_filter_bats_pitch(bench, &stream);
+
+	bench_stream_close(&stream);
+}
+
+static struct output *bench_output_open(struct bench *bench)
+{
+	struct output_options opts;
+
+	opts = (struct output_options) {
+		.compression	= OUTPUT_COMPRESSION_NONE,
+		.nr_threads	= 1,
+	};
+
+	return output_open(bench->output_filename, &opts);
+}
+
+static void bench_output_close(struct bench *bench, struct output *out)
+{
+	output_close(out);
+
+	if (unlink(bench->output_filename) < 0)
+		error("%s: %s", bench->output_filename, strerror(errno));
+}
+
+static void bench_ob_event(void *data, struct ob_event *event __maybe_unused)
+{
+	struct bench *bench = data;
+
+	bench->nr_events++;
+}
+
+/*
+ * Run the OB conversion.  Without an output, the events are dropped instead
+ * of formatted, which leaves decoding, filtering and order tracking.
+ */
+static void bench_run_ob(struct bench *bench, struct output *out)
+{
+	struct ob_writer writer;
+
+	ob_writer_init(&writer, NULL, NULL);
+
+	if (out) {
+		writer.out = out;
+
+		ob_write_header(&writer);
+	} else {
+		writer.event_fn		= bench_ob_event;
+		writer.event_data	= bench;
+	}
+
+	init_stream(&bench->zstream);
+
+	if (bench->fmt == FORMAT_NASDAQ_ITCH_41) {
+		struct nasdaq_itch_session session;
+
+		session = (struct nasdaq_itch_session) {
+			.zstream	= &bench->zstream,
+			.in_fd		= bench->in_fd,
+			.ob_writer	= &writer,
+			.input_filename	= input_filename,
+			.time_zone	= "America/New_York",
+			.time_zone_len	= strlen("America/New_York"),
+			.date		= "",
+			.exchange	= "XNAS",
+			.exchange_len	= strlen("XNAS"),
+			.symbol		= symbol,
+			.symbol_len	= strlen(symbol),
+		};
+
+		nasdaq_itch_filter_init(&session.filter, symbol);
+
+		nasdaq_itch_ob(&session);
+	} else {
+		struct pitch_session session;
+
+		session = (struct pitch_session) {
+			.zstream	= &bench->zstream,
+			.in_fd		= bench->in_fd,
+			.ob_writer	= &writer,
+			.input_filename	= input_filename,
+			.time_zone	= "America/New_York",
+			.time_zone_len	= strlen("America/New_York"),
+			.date		= "",
+			.exchange	= "BATS",
+			.exchange_len	= strlen("BATS"),
+			.symbol		= symbol,
+			.symbol_len	= strlen(symbol),
+		};
+
+		pitch_filter_init(&session.filter, symbol);
+
+		bats_pitch_ob(&session);
+	}
+
+	release_stream(&bench->zstream);
+}
+
+static void bench_track(struct bench *bench)
+{
+	bench_run_ob(bench, NULL);
+}
+
+static void bench_ob(struct bench *bench)
+{
+	struct output *out = bench_output_open(bench);
+
+	bench_run_ob(bench, out);
+
+	bench_output_close(bench, out);
+}
+
+static void bench_taq(struct bench *bench)
+{
+	struct output *out = bench_output_open(bench);
+	struct taq_writer writer;
+
+	taq_writer_init(&writer, NULL, NULL);
+
+	writer.out = out;
+
+	taq_write_header(&writer);
+
+	init_stream(&bench->zstream);
+
+	if (bench->fmt == FORMAT_BATS_PITCH_112) {
+		struct pitch_session session;
+
+		session = (struct pitch_session) {
+			.zstream	= &bench->zstream,
+			.in_fd		= bench->in_fd,
+			.taq_writer	= &writer,
+			.input_filename	= input_filename,
+			.time_zone	= "America/New_York",
+			.time_zone_len	= strlen("America/New_York"),
+			.date		= "",
+			.exchange	= "BATS",
+			.exchange_len	= strlen("BATS"),
+			.symbol		= symbol,
+			.symbol_len	= strlen(symbol),
+		};
+
+		pitch_filter_init(&session.filter, symbol);
+
+		bats_pitch_taq(&session);
+	} else {
+		struct nyse_taq_session session;
+
+		session = (struct nyse_taq_session) {
+			.zstream	= &bench->zstream,
+			.in_fd		= bench->in_fd,
+			.taq_writer	= &writer,
+			.input_filename	= input_filename,
+			.time_zone	= "America/New_York",
+			.time_zone_len	= strlen("America/New_York"),
+			.symbol		= symbol,
+			.symbol_len	= strlen(symbol),
+		};
+
+		nyse_taq_filter_init(&session.filter, symbol);
+
+		nyse_taq_taq(&session);
+	}
+
+	release_stream(&bench->zstream);
+
+	bench_output_close(bench, out);
+}
+
+/*
+ * The stages build on each other, so the difference between two adjacent
+ * stages is the cost of what the later one adds.
+ */
+static const struct bench_stage bench_stages[] = {
+	{ "inflate",	bench_inflate,	ALL_FORMATS,	false },
+	{ "decode",	bench_decode,	OB_FORMATS,	false },
+	{ "filter",	bench_filter,	OB_FORMATS,	true  },
+	{ "track",	bench_track,	OB_FORMATS,	true  },
+	{ "ob",		bench_ob,	OB_FORMATS,	true  },
+	{ "taq",	bench_taq,	TAQ_FORMATS,	true  },
+};
+
+static bool stage_selected(const struct bench_stage *stage)
+{
+	const char *s = stages;
+	size_t len = strlen(stage->name);
+
+	if (!s)
+		return true;
+
+	while (*s) {
+		size_t n = strcspn(s, ",");
+
+		if (n == len && !memcmp(s, stage->name, len))
+			return true;
+
+		s += n;
+
+		if (*s == ',')
+			s++;
+	}
+
+	return false;
+}
+
+static void parse_stages(void)
+{
+	const char *s = stages;
+
+	if (!s)
+		return;
+
+	while (*s) {
+		size_t n = strcspn(s, ",");
+		unsigned int i;
+
+		for (i = 0; i < ARRAY_SIZE(bench_stages); i++) {
+			if (strlen(bench_stages[i].name) == n && !memcmp(s, bench_stages[i].name, n))
+				break;
+		}
+
+		if (i == ARRAY_SIZE(bench_stages))
+			error("%.*s: unknown stage", (int) n, s);
+
+		s += n;
+
+		if (*s == ',')
+			s++;
+	}
+}
+
+static uint64_t now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+struct bench_result {
+	const struct bench_stage *stage;
+	uint64_t		*runs;
+	uint64_t		best;
+	uint64_t		worst;
+	double			mean;
+	double			stddev;
+};
+
+static struct bench_result	results[ARRAY_SIZE(bench_stages)];
+static unsigned int		nr_results;
+
+static void print_result(struct bench *bench, struct bench_result *result)
+{
+	printf("  %-8s %10.1f %10.1f %7.1f%% %10.1f",
+		result->stage->name,
+		result->best / 1e6,
+		result->mean / 1e6,
+		100.0 * result->stddev / result->mean,
+		bench->nr_bytes / 1e6 / (result->best / 1e9));
+
+	if (bench->nr_messages) {
+		printf(" %'14.0f %10.1f\n",
+			bench->nr_messages / (result->best / 1e9),
+			(double) result->best / bench->nr_messages);
+	} else {
+		printf(" %14s %10s\n", "-", "-");
+	}
+}
+
+static void bench_stage(struct bench *bench, const struct bench_stage *stage)
+{
+	struct bench_result *result = &results[nr_results++];
+	uint64_t total = 0;
+	double sq = 0.0;
+	unsigned int i;
+
+	*result = (struct bench_result) {
+		.stage		= stage,
+		.best		= UINT64_MAX,
+	};
+
+	result->runs = calloc(nr_repeat, sizeof(*result->runs));
+	if (!result->runs)
+		error("out of memory");
+
+	for (i = 0; i < nr_warmup; i++)
+		stage->run(bench);
+
+	for (i = 0; i < nr_repeat; i++) {
+		uint64_t start, elapsed;
+
+		start = now();
+
+		stage->run(bench);
+
+		elapsed = now() - start;
+
+		if (elapsed < result->best)
+			result->best = elapsed;
+
+		if (elapsed > result->worst)
+			result->worst = elapsed;
+
+		result->runs[i] = elapsed;
+
+		total += elapsed;
+	}
+
+	result->mean = (double) total / nr_repeat;
+
+	for (i = 0; i < nr_repeat; i++)
+		sq += (result->runs[i] - result->mean) * (result->runs[i] - result->mean);
+
+	if (nr_repeat > 1)
+		result->stddev = sqrt(sq / (nr_repeat - 1));
+
+	print_result(bench, result);
+}
+
+static void cpu_model(char *buf, size_t len)
+{
+	char *line = NULL;
+	size_t capacity = 0;
+	FILE *file;
+
+	snprintf(buf, len, "unknown");
+
+	file = fopen("/proc/cpuinfo", "r");
+	if (!file)
+		return;
+
+	while (getline(&line, &capacity, file) != -1) {
+		char *value;
+
+		if (strncmp(line, "model name", strlen("model name")))
+			continue;
+
+		value = strchr(line, ':');
+		if (!value)
+			continue;
+
+		value += strspn(value, ": \t");
+
+		value[strcspn(value, "\n")] = '\0';
+
+		snprintf(buf, len, "%s", value);
+
+		break;
+	}
+
+	free(line);
+
+	fclose(file);
+}
+
+static void json_print_rate(FILE *file, const char *key, double value, bool valid)
+{
+	if (valid)
+		fprintf(file, ", \"%s\": %.1f", key, value);
+	else
+		fprintf(file, ", \"%s\": null", key);
+}
+
+/*
+ * Write the results with enough about the machine and the input to tell
+ * whether two result files can be compared.
+ */
+static void write_json(struct bench *bench, const char *filename)
+{
+	char date[32], cpu[256];
+	struct utsname uts;
+	unsigned int i, j;
+	time_t t;
+	FILE *file;
+
+	file = fopen(filename, "w");
+	if (!file)
+		error("%s: %s", filename, strerror(errno));
+
+	if (uname(&uts) < 0)
+		memset(&uts, 0, sizeof(uts));
+
+	t = time(NULL);
+
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+
+	cpu_model(cpu, sizeof(cpu));
+
+	fprintf(file, "{\n  \"version\": ");
+	json_print_string(file, TICK_VERSION);
+	fprintf(file, ",\n  \"date\": \"%s\",\n", date);
+
+	fprintf(file, "  \"environment\": {\"hostname\": ");
+	json_print_string(file, uts.nodename);
+	fprintf(file, ", \"os\": ");
+	json_print_string(file, uts.sysname);
+	fprintf(file, ", \"kernel\": ");
+	json_print_string(file, uts.release);
+	fprintf(file, ", \"machine\": ");
+	json_print_string(file, uts.machine);
+	fprintf(file, ", \"compiler\": ");
+	json_print_string(file, __VERSION__);
+	fprintf(file, "},\n");
+
+	fprintf(file, "  \"cpu\": {\"model\": ");
+	json_print_string(file, cpu);
+	fprintf(file, ", \"cpus\": %ld},\n", sysconf(_SC_NPROCESSORS_ONLN));
+
+	fprintf(file, "  \"input\": {\"filename\": ");
+	json_print_string(file, input_filename);
+	fprintf(file, ", \"format\": ");
+	json_print_string(file, format_names[bench->fmt]);
+	fprintf(file, ", \"symbol\": ");
+	if (symbol)
+		json_print_string(file, symbol);
+	else
+		fprintf(file, "null");
+	fprintf(file, ", \"bytes_compressed\": %" PRIu64 ", \"bytes_uncompressed\": %" PRIu64
+		", \"messages\": %" PRIu64 "},\n",
+		bench->file_size, bench->nr_bytes, bench->nr_messages);
+
+	fprintf(file, "  \"config\": {\"warmup\": %u, \"repeat\": %u},\n", nr_warmup, nr_repeat);
+
+	fprintf(file, "  \"stages\": [");
+
+	for (i = 0; i < nr_results; i++) {
+		struct bench_result *result = &results[i];
+		double secs = result->best / 1e9;
+
+		fprintf(file, "%s\n    {\"name\": \"%s\", \"best_ns\": %" PRIu64 ", \"worst_ns\": %" PRIu64
+			", \"mean_ns\": %.0f, \"stddev_ns\": %.0f",
+			i ? "," : "", result->stage->name, result->best, result->worst,
+			result->mean, result->stddev);
+
+		json_print_rate(file, "mb_per_sec", bench->nr_bytes / 1e6 / secs, true);
+		json_print_rate(file, "messages_per_sec", bench->nr_messages / secs, bench->nr_messages);
+		json_print_rate(file, "ns_per_message", (double) result->best / bench->nr_messages, bench->nr_messages);
+
+		fprintf(file, ", \"runs_ns\": [");
+
+		for (j = 0; j < nr_repeat; j++)
+			fprintf(file, "%s%" PRIu64, j ? ", " : "", result->runs[j]);
+
+		fprintf(file, "]}");
+	}
+
+	fprintf(file, "\n  ]\n}\n");
+
+	if (fclose(file))
+		error("%s: %s", filename, strerror(errno));
+}
+
+static const struct json_value *baseline_stage(const struct json_value *base_stages, const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < base_stages->nr_elements; i++) {
+		const char *s = json_string(&base_stages->elements[i], "name");
+
+		if (s && !strcmp(s, name))
+			return &base_stages->elements[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Compare the best times with a baseline.  Stages whose own run-to-run
+ * variation exceeds the threshold are marked, as their verdict is not
+ * reliable.  Returns the number of base_stages that regressed.
+ */
+static unsigned int compare_baseline(struct bench *bench, const char *filename)
+{
+	const struct json_value *base_stages, *input;
+	unsigned int i, nr_regressed = 0;
+	struct json_value *baseline;
+
+	baseline = json_read(filename);
+
+	base_stages = json_get(baseline, "stages");
+	if (!base_stages || base_stages->type != JSON_ARRAY)
+		error("%s: not a benchmark results file", filename);
+
+	input = json_get(baseline, "input");
+
+	if (json_number(input, "bytes_uncompressed", 0) != bench->nr_bytes)
+		warning("%s: the baseline was measured on a different input", filename);
+
+	printf(" Comparison with '%s' (threshold: %.1f%%):\n\n", filename, threshold);
+
+	printf("  %-8s %14s %14s %9s  %s\n",
+		"Stage", "Baseline (ms)", "Current (ms)", "Change", "Status");
+
+	for (i = 0; i < nr_results; i++) {
+		struct bench_result *result = &results[i];
+		const struct json_value *stage;
+		const char *status;
+		double base, change;
+
+		stage = baseline_stage(base_stages, result->stage->name);
+
+		base = json_number(stage, "best_ns", 0);
+		if (base <= 0) {
+			printf("  %-8s %14s %14.1f %9s  %s\n",
+				result->stage->name, "-", result->best / 1e6, "-", "new");
+			continue;
+		}
+
+		change = 100.0 * (result->best - base) / base;
+
+		if (change > threshold) {
+			status = "REGRESSION";
+			nr_regressed++;
+		} else if (change < -threshold) {
+			status = "improved";
+		} else {
+			status = "ok";
+		}
+
+		printf("  %-8s %14.1f %14.1f %+8.1f%%  %s%s\n",
+			result->stage->name, base / 1e6, result->best / 1e6, change, status,
+			100.0 * result->stddev / result->mean > threshold ? " (noisy)" : "");
+	}
+
+	printf("\n");
+
+	if (nr_regressed)
+		printf(" %u stage(s) regressed by more than %.1f%%.\n\n", nr_regressed, threshold);
+
+	json_free(baseline);
+
+	return nr_regressed;
+}
+
+static char *temp_filename(void)
+{
+	const char *tmpdir = getenv("TMPDIR");
+	char *filename;
+
+	if (!tmpdir || !*tmpdir)
+		tmpdir = "/tmp";
+
+	if (asprintf(&filename, "%s/tick-bench-%d.tsv", tmpdir, getpid()) < 0)
+		error("out of memory");
+
+	return filename;
+}
+
+int cmd_bench(int argc, char *argv[])
+{
+	unsigned int i, nr_regressed = 0;
+	struct bench bench;
+	struct stat st;
+
+	setlocale(LC_ALL, "");
+
+	parse_args(argc - 1, argv + 1);
+
+	if (!format)
+		error("%s: file format not detected. Please specify it with the '-f' option.",
+			input_filename);
+
+	if (!nr_repeat)
+		error("number of repetitions must be positive");
+
+	parse_stages();
+
+	bench = (struct bench) {
+		.fmt		= parse_format(format),
+	};
+
+	if ((int) bench.fmt < 0)
+		error("%s is not a supported file format", format);
+
+	bench.in_fd = open(input_filename, O_RDONLY);
+	if (bench.in_fd < 0)
+		error("%s: %s", input_filename, strerror(errno));
+
+	if (fstat(bench.in_fd, &st) < 0)
+		error("%s: %s", input_filename, strerror(errno));
+
+	bench.file_size		= st.st_size;
+	bench.output_filename	= temp_filename();
+
+	progress_disable();
+
+	/*
+	 * Measure the uncompressed size and the number of messages once, which
+	 * also brings the input into the page cache.
+	 */
+	bench_inflate(&bench);
+
+	if (FORMAT_MASK(bench.fmt) & OB_FORMATS)
+		bench_decode(&bench);
+
+	printf(" Benchmark of '%s':\n\n", input_filename);
+
+	printf("%'14.0f  bytes compressed\n", (double) bench.file_size);
+	printf("%'14.0f  bytes uncompressed\n", (double) bench.nr_bytes);
+
+	if (bench.nr_messages)
+		printf("%'14.0f  messages\n", (double) bench.nr_messages);
+
+	printf("\n");
+
+	printf("  %-8s %10s %10s %8s %10s %14s %10s\n",
+		"Stage", "Best (ms)", "Mean (ms)", "Stddev", "MB/s", "Messages/s", "ns/msg");
+
+	for (i = 0; i < ARRAY_SIZE(bench_stages); i++) {
+		const struct bench_stage *stage = &bench_stages[i];
+
+		if (!(stage->formats & FORMAT_MASK(bench.fmt)))
+			continue;
+
+		if (!stage_selected(stage))
+			continue;
+
+		if (stage->needs_symbol && !symbol) {
+			printf("  %-8s (skipped: no symbol specified)\n", stage->name);
+			continue;
+		}
+
+		bench_stage(&bench, stage);
+	}
+
+	printf("\n");
+
+	if (json_filename)
+		write_json(&bench, json_filename);
+
+	if (baseline_filename)
+		nr_regressed = compare_baseline(&bench, baseline_filename);
+
+	for (i = 0; i < nr_results; i++)
+		free(results[i].runs);
+
+	free(bench.output_filename);
+
+	if (close(bench.in_fd) < 0)
+		error("%s: %s", input_filename, strerror(errno));
+
+	return nr_regressed ? 1 : 0;
+}
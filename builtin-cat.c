@@ -0,0 +1,209 @@
+#include "tick/builtins.h"
+
+#include "tick/output.h"
+#include "tick/error.h"
+#include "tick/tsv.h"
+#include "tick/taq.h"
+#include "tick/ob.h"
+
+#include <getopt.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+extern const char *program;
+
+static void usage(void)
+{
+#define FMT								\
+"\n usage: %s cat [<options>] <input>... <output>\n"			\
+"\n"									\
+"    -c, --columns <list>        comma-separated columns to output\n"	\
+"    -e, --events <list>         comma-separated event types to output\n" \
+"    -z, --compress <type>       compress output (%s, %s)\n"		\
+"    -j, --threads <n>           number of compression threads\n"	\
+"    -R, --roll-size <size>      roll output over at size (e.g. 512M)\n" \
+"    -T, --roll-interval <time>  roll output over at feed time (e.g. 5m)\n" \
+"\n Inputs are OB or TAQ files written by tick, optionally compressed.\n" \
+" Use '-' as <input> to read from standard input and as <output> to\n"	\
+" write to standard output.\n"						\
+"\n"
+	fprintf(stderr, FMT,
+			program,
+			output_compression_names[OUTPUT_COMPRESSION_GZIP],
+			output_compression_names[OUTPUT_COMPRESSION_ZSTD]);
+
+#undef FMT
+
+	exit(EXIT_FAILURE);
+}
+
+static const struct option options[] = {
+	{ "columns",	required_argument,	NULL, 'c' },
+	{ "events",	required_argument,	NULL, 'e' },
+	{ "compress",	required_argument,	NULL, 'z' },
+	{ "threads",	required_argument,	NULL, 'j' },
+	{ "roll-size",	required_argument,	NULL, 'R' },
+	{ "roll-interval", required_argument,	NULL, 'T' },
+	{ NULL,		0,			NULL,  0  },
+};
+
+static const char	*output_filename;
+static struct output_options output_options;
+static char		**input_filenames;
+static int		nr_inputs;
+static const char	*columns;
+static const char	*events;
+
+enum file_kind {
+	FILE_KIND_OB,
+	FILE_KIND_TAQ,
+};
+
+static void parse_args(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "c:e:z:j:R:T:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'c':
+			columns		= optarg;
+			break;
+		case 'e':
+			events		= optarg;
+			break;
+		default:
+			if (!output_parse_option(&output_options, opt, optarg))
+				usage();
+			break;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc < 2)
+		usage();
+
+	input_filenames	= argv;
+	nr_inputs	= argc - 1;
+	output_filename	= argv[argc - 1];
+}
+
+/*
+ * Open an input file and read its header row.
+ */
+static enum file_kind open_input(struct tsv_reader *tsv, const char *filename)
+{
+	tsv_reader_open(tsv, filename);
+
+	if (!tsv_read_row(tsv))
+		error("%s: file is empty", filename);
+
+	if (ob_header_match(tsv))
+		return FILE_KIND_OB;
+
+	if (taq_header_match(tsv))
+		return FILE_KIND_TAQ;
+
+	error("%s: not an OB or TAQ file", filename);
+
+	return -1;
+}
+
+static void cat_ob(struct tsv_reader *tsv)
+{
+	struct ob_writer writer;
+	struct output *out;
+	int i;
+
+	ob_writer_init(&writer, columns, events);
+
+	out = output_open(output_filename, &output_options);
+
+	writer.out = out;
+
+	ob_write_header(&writer);
+
+	for (i = 0; i < nr_inputs; i++) {
+		struct ob_reader reader;
+		struct ob_event event;
+
+		if (i > 0 && open_input(tsv, input_filenames[i]) != FILE_KIND_OB)
+			error("%s: not an OB file", input_filenames[i]);
+
+		ob_reader_init(&reader, tsv);
+
+		while (ob_read_event(&reader, &event))
+			ob_write_event(&writer, &event);
+
+		tsv_reader_close(tsv);
+	}
+
+	output_close(out);
+}
+
+static void cat_taq(struct tsv_reader *tsv)
+{
+	struct taq_writer writer;
+	struct output *out;
+	int i;
+
+	taq_writer_init(&writer, columns, events);
+
+	out = output_open(output_filename, &output_options);
+
+	writer.out = out;
+
+	taq_write_header(&writer);
+
+	for (i = 0; i < nr_inputs; i++) {
+		struct taq_reader reader;
+		struct taq_event event;
+
+		if (i > 0 && open_input(tsv, input_filenames[i]) != FILE_KIND_TAQ)
+			error("%s: not a TAQ file", input_filenames[i]);
+
+		taq_reader_init(&reader, tsv);
+
+		while (taq_read_event(&reader, &event))
+			taq_write_event(&writer, &event);
+
+		tsv_reader_close(tsv);
+	}
+
+	output_close(out);
+}
+
+int cmd_cat(int argc, char *argv[])
+{
+	struct tsv_reader tsv;
+	char *header = NULL;
+	enum file_kind kind;
+
+	setlocale(LC_ALL, "");
+
+	parse_args(argc - 1, argv + 1);
+
+	kind = open_input(&tsv, input_filenames[0]);
+
+	/* Output has the same columns as the first input unless specified: */
+	if (!columns)
+		columns = header = tsv_join_fields(&tsv, ',');
+
+	switch (kind) {
+	case FILE_KIND_OB:
+		cat_ob(&tsv);
+		break;
+	case FILE_KIND_TAQ:
+	default:
+		cat_taq(&tsv);
+		break;
+	}
+
+	free(header);
+
+	return 0;
+}
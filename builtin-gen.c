@@ -0,0 +1,224 @@
+#include "tick/builtins.h"
+
+#include "tick/nasdaq/gen.h"
+#include "tick/bats/gen.h"
+#include "tick/nyse/gen.h"
+#include "tick/format.h"
+#include "tick/error.h"
+#include "tick/gen.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <getopt.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <zlib.h>
+
+extern const char *program;
+
+#define DEFAULT_MESSAGES	1000000ULL
+#define DEFAULT_SYMBOLS		500
+#define DEFAULT_SEED		1
+#define DEFAULT_DATE		"2013-01-03"
+#define DEFAULT_LEVEL		1
+
+/*
+ * Roughly one in twelve order flow events is a trade, so a trade file
+ * needs that many more events to cover the session.
+ */
+#define EVENTS_PER_TRADE	12
+
+static void usage(void)
+{
+#define FMT								\
+"\n usage: %s gen [<options>] <output>\n"				\
+"\n"									\
+"    -f, --format <format>       output file format\n"			\
+"    -n, --messages <n>          number of messages (e.g. 10M; default: 1M)\n" \
+"    -y, --symbols <n>           number of symbols (default: %d)\n"	\
+"    -s, --seed <n>              random seed (default: %d)\n"		\
+"    -d, --date <date>           date of NYSE TAQ files (default: %s)\n"	\
+"    -t, --trades                write a NYSE TAQ trade file instead of quotes\n" \
+"    -l, --level <n>             gzip compression level (default: %d)\n"	\
+"\n The same options always generate the same file.\n"		\
+"\n Supported file formats are:\n"					\
+"\n"									\
+"   %s\n"								\
+"   %s\n"								\
+"   %s\n"								\
+"\n"
+	fprintf(stderr, FMT,
+			program,
+			DEFAULT_SYMBOLS,
+			DEFAULT_SEED,
+			DEFAULT_DATE,
+			DEFAULT_LEVEL,
+			format_names[FORMAT_BATS_PITCH_112],
+			format_names[FORMAT_NASDAQ_ITCH_41],
+			format_names[FORMAT_NYSE_TAQ_17]);
+
+#undef FMT
+
+	exit(EXIT_FAILURE);
+}
+
+static const struct option options[] = {
+	{ "format",	required_argument, 	NULL, 'f' },
+	{ "messages",	required_argument,	NULL, 'n' },
+	{ "symbols",	required_argument,	NULL, 'y' },
+	{ "seed",	required_argument,	NULL, 's' },
+	{ "date",	required_argument,	NULL, 'd' },
+	{ "trades",	no_argument,		NULL, 't' },
+	{ "level",	required_argument,	NULL, 'l' },
+	{ NULL,		0,			NULL,  0  },
+};
+
+static const char	*output_filename;
+static const char	*format;
+static const char	*date = DEFAULT_DATE;
+static uint64_t		nr_messages = DEFAULT_MESSAGES;
+static unsigned int	nr_symbols = DEFAULT_SYMBOLS;
+static uint64_t		seed = DEFAULT_SEED;
+static bool		trades;
+static int		level = DEFAULT_LEVEL;
+
+/*
+ * Parse a count with an optional K, M or G suffix.  The suffixes are
+ * decimal.  Returns zero if the count is invalid.
+ */
+static uint64_t parse_count(const char *s)
+{
+	uint64_t ret;
+	char *end;
+
+	ret = strtoull(s, &end, 10);
+
+	switch (*end) {
+	case 'G': case 'g':
+		ret *= 1000;
+		/* fallthrough */
+	case 'M': case 'm':
+		ret *= 1000;
+		/* fallthrough */
+	case 'K': case 'k':
+		ret *= 1000;
+		end++;
+		break;
+	default:
+		break;
+	}
+
+	if (*end)
+		return 0;
+
+	return ret;
+}
+
+static void parse_args(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "f:n:y:s:d:tl:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'f':
+			format		= optarg;
+			break;
+		case 'n':
+			nr_messages	= parse_count(optarg);
+			if (!nr_messages)
+				error("%s: invalid number of messages", optarg);
+			break;
+		case 'y':
+			nr_symbols	= strtoul(optarg, NULL, 10);
+			if (!nr_symbols || nr_symbols > GEN_MAX_SYMBOLS)
+				error("%s: invalid number of symbols", optarg);
+			break;
+		case 's':
+			seed		= strtoull(optarg, NULL, 10);
+			break;
+		case 'd':
+			date		= optarg;
+			break;
+		case 't':
+			trades		= true;
+			break;
+		case 'l':
+			level		= atoi(optarg);
+			if (level < 0 || level > 9)
+				error("%s: invalid compression level", optarg);
+			break;
+		default:
+			usage();
+			break;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc != 1)
+		usage();
+
+	output_filename = argv[0];
+}
+
+int cmd_gen(int argc, char *argv[])
+{
+	struct gen_options opts;
+	struct gen_output out;
+	struct gen gen;
+	enum format fmt;
+
+	setlocale(LC_ALL, "");
+
+	parse_args(argc - 1, argv + 1);
+
+	if (!format)
+		error("%s: file format not specified. Please specify it with the '-f' option.",
+			output_filename);
+
+	fmt = parse_format(format);
+
+	opts = (struct gen_options) {
+		.seed		= seed,
+		.nr_symbols	= nr_symbols,
+		.nr_events	= nr_messages,
+	};
+
+	if (fmt == FORMAT_NYSE_TAQ_17 && trades)
+		opts.nr_events *= EVENTS_PER_TRADE;
+
+	gen_init(&gen, &opts);
+
+	gen_output_open(&out, output_filename, level);
+
+	switch (fmt) {
+	case FORMAT_NASDAQ_ITCH_41:
+		nasdaq_itch_gen(&gen, &out, nr_messages);
+		break;
+	case FORMAT_BATS_PITCH_112:
+		bats_pitch_gen(&gen, &out, nr_messages);
+		break;
+	case FORMAT_NYSE_TAQ_17:
+		nyse_taq_gen(&gen, &out, nr_messages, date, trades);
+		break;
+	default:
+		error("%s is not a supported file format", format);
+		break;
+	}
+
+	gen_progress(nr_messages, nr_messages);
+
+	fprintf(stderr, "\n");
+
+	gen_output_close(&out);
+
+	fprintf(stderr, "%s: %'" PRIu64 " bytes (%'" PRIu64 " uncompressed)\n",
+		output_filename, out.bytes_out, out.bytes_in);
+
+	gen_release(&gen);
+
+	return 0;
+}
@@ -0,0 +1,201 @@
+#include "tick/builtins.h"
+
+#include "tick/error.h"
+#include "tick/index.h"
+#include "tick/tsv.h"
+#include "tick/taq.h"
+#include "tick/ob.h"
+
+#include <sys/stat.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+extern const char *program;
+
+static void usage(void)
+{
+#define FMT								\
+"\n usage: %s index [<options>] <input>...\n"				\
+"\n"									\
+"    -n, --stride <rows>         rows between index entries (default: %d)\n" \
+"\n Inputs are uncompressed OB or TAQ files written by tick.  The index of\n" \
+" <input> is written to <input>.idx and is used by '%s slice'.\n"	\
+"\n"
+	fprintf(stderr, FMT, program, INDEX_DEFAULT_STRIDE, program);
+
+#undef FMT
+
+	exit(EXIT_FAILURE);
+}
+
+static const struct option options[] = {
+	{ "stride",	required_argument,	NULL, 'n' },
+	{ NULL,		0,			NULL,  0  },
+};
+
+static char		**input_filenames;
+static int		nr_inputs;
+static uint32_t		stride = INDEX_DEFAULT_STRIDE;
+
+static void parse_args(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "n:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			stride		= strtoul(optarg, NULL, 10);
+			if (!stride)
+				error("%s: invalid stride", optarg);
+			break;
+		default:
+			usage();
+			break;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc < 1)
+		usage();
+
+	input_filenames	= argv;
+	nr_inputs	= argc;
+}
+
+struct indexer {
+	struct index		index;
+	struct tsv_reader	*tsv;
+	uint64_t		nr_rows;
+	uint64_t		last_time;
+};
+
+/*
+ * Sample every Nth timed row.  Rows must be in time order for the samples
+ * to bound the rows between them.
+ */
+static void index_row(struct indexer *indexer, uint64_t time)
+{
+	struct tsv_reader *tsv = indexer->tsv;
+
+	if (!indexer->nr_rows)
+		indexer->index.data_offset = tsv->offset;
+	else if (time < indexer->last_time)
+		error("%s:%" PRIu64 ": rows are not in time order", tsv->filename, tsv->line);
+
+	if (indexer->nr_rows % indexer->index.stride == 0)
+		index_add(&indexer->index, tsv->offset, time);
+
+	indexer->last_time = time;
+	indexer->nr_rows++;
+}
+
+/*
+ * Every row after the first timed one adds its symbol to the set of the
+ * block it is in, including the rows without a time.
+ */
+static void index_symbol(struct indexer *indexer, uint32_t symbol)
+{
+	if (indexer->nr_rows)
+		index_add_symbol(&indexer->index, symbol);
+}
+
+static void index_ob(struct indexer *indexer)
+{
+	struct ob_reader reader;
+	struct ob_event event;
+
+	ob_reader_init(&reader, indexer->tsv);
+
+	while (ob_read_event(&reader, &event)) {
+		if (event.fields & OB_FIELD_TIME)
+			index_row(indexer, event.time);
+
+		index_symbol(indexer, event.fields & OB_FIELD_SYMBOL ? event.symbol : INDEX_SYMBOL_NONE);
+	}
+}
+
+static void index_taq(struct indexer *indexer)
+{
+	struct taq_reader reader;
+	struct taq_event event;
+
+	taq_reader_init(&reader, indexer->tsv);
+
+	while (taq_read_event(&reader, &event)) {
+		if (event.fields & TAQ_FIELD_TIME)
+			index_row(indexer, event.time);
+
+		index_symbol(indexer, event.fields & TAQ_FIELD_SYMBOL ? event.symbol : INDEX_SYMBOL_NONE);
+	}
+}
+
+static void index_file(const char *filename)
+{
+	struct indexer indexer;
+	struct tsv_reader tsv;
+	char *idx_filename;
+	struct stat st;
+
+	if (!strcmp(filename, "-"))
+		error("cannot index standard input");
+
+	tsv_reader_open(&tsv, filename);
+
+	/* Slicing reads byte ranges of the file, which needs plain text: */
+	if (tsv.compression != TSV_COMPRESSION_NONE)
+		error("%s: cannot index a compressed file", filename);
+
+	if (fstat(tsv.fd, &st) < 0)
+		error("%s: %s", filename, strerror(errno));
+
+	indexer = (struct indexer) {
+		.tsv		= &tsv,
+	};
+
+	index_init(&indexer.index, stride);
+
+	/* A file without timed rows is all header: */
+	indexer.index.file_size		= st.st_size;
+	indexer.index.data_offset	= st.st_size;
+
+	if (!tsv_read_row(&tsv))
+		error("%s: file is empty", filename);
+
+	if (ob_header_match(&tsv))
+		index_ob(&indexer);
+	else if (taq_header_match(&tsv))
+		index_taq(&indexer);
+	else
+		error("%s: not an OB or TAQ file", filename);
+
+	tsv_reader_close(&tsv);
+
+	idx_filename = index_filename(filename);
+
+	index_write(&indexer.index, idx_filename);
+
+	free(idx_filename);
+
+	index_release(&indexer.index);
+}
+
+int cmd_index(int argc, char *argv[])
+{
+	int i;
+
+	setlocale(LC_ALL, "");
+
+	parse_args(argc - 1, argv + 1);
+
+	for (i = 0; i < nr_inputs; i++)
+		index_file(input_filenames[i]);
+
+	return 0;
+}
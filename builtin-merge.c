@@ -0,0 +1,418 @@
+#include "tick/builtins.h"
+
+#include "tick/output.h"
+#include "tick/error.h"
+#include "tick/tsv.h"
+#include "tick/taq.h"
+#include "tick/ob.h"
+
+#include <inttypes.h>
+#include <getopt.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+extern const char *program;
+
+static void usage(void)
+{
+#define FMT								\
+"\n usage: %s merge [<options>] <input>... <output>\n"			\
+"\n"									\
+"    -c, --columns <list>        comma-separated columns to output\n"	\
+"    -e, --events <list>         comma-separated event types to output\n" \
+"    -z, --compress <type>       compress output (%s, %s)\n"		\
+"    -j, --threads <n>           number of compression threads\n"	\
+"    -R, --roll-size <size>      roll output over at size (e.g. 512M)\n" \
+"    -T, --roll-interval <time>  roll output over at feed time (e.g. 5m)\n" \
+"\n Inputs are OB or TAQ files written by tick, each ordered by time.  Rows\n" \
+" are merged by date and time; rows with equal timestamps keep the order of\n" \
+" the inputs on the command line.\n"					\
+"\n"
+	fprintf(stderr, FMT,
+			program,
+			output_compression_names[OUTPUT_COMPRESSION_GZIP],
+			output_compression_names[OUTPUT_COMPRESSION_ZSTD]);
+
+#undef FMT
+
+	exit(EXIT_FAILURE);
+}
+
+static const struct option options[] = {
+	{ "columns",	required_argument,	NULL, 'c' },
+	{ "events",	required_argument,	NULL, 'e' },
+	{ "compress",	required_argument,	NULL, 'z' },
+	{ "threads",	required_argument,	NULL, 'j' },
+	{ "roll-size",	required_argument,	NULL, 'R' },
+	{ "roll-interval", required_argument,	NULL, 'T' },
+	{ NULL,		0,			NULL,  0  },
+};
+
+static const char	*output_filename;
+static struct output_options output_options;
+static char		**input_filenames;
+static int		nr_inputs;
+static const char	*columns;
+static const char	*events;
+
+enum file_kind {
+	FILE_KIND_OB,
+	FILE_KIND_TAQ,
+};
+
+#define MERGE_DATE_LEN		16
+
+/*
+ * An input holds its current event until the event is written out: string
+ * fields of the event point into the input's own TSV buffer, which does not
+ * move until the input is advanced.  Rows other than date rows have no date
+ * of their own, so each input tracks the date of its last date row.
+ */
+struct merge_input {
+	struct tsv_reader	tsv;
+	union {
+		struct ob_reader	ob;
+		struct taq_reader	taq;
+	} reader;
+	union {
+		struct ob_event		ob;
+		struct taq_event	taq;
+	} event;
+	char			date[MERGE_DATE_LEN];
+	size_t			date_len;
+	uint64_t		time;
+	bool			done;
+};
+
+/*
+ * A loser tree over the inputs: internal node 'i' holds the loser of the
+ * match between its children 2i and 2i + 1, and node 0 holds the overall
+ * winner.  Leaves are the inputs at 'nr_inputs + index'.  Replacing the
+ * winner replays only the matches on its path to the root, which takes
+ * log2(k) comparisons against k - 1 for a linear scan.
+ */
+struct merge {
+	struct merge_input	*inputs;
+	unsigned int		*tree;
+	unsigned int		nr_inputs;
+};
+
+static void parse_args(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "c:e:z:j:R:T:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'c':
+			columns		= optarg;
+			break;
+		case 'e':
+			events		= optarg;
+			break;
+		default:
+			if (!output_parse_option(&output_options, opt, optarg))
+				usage();
+			break;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc < 2)
+		usage();
+
+	input_filenames	= argv;
+	nr_inputs	= argc - 1;
+	output_filename	= argv[argc - 1];
+}
+
+/*
+ * Open an input file and read its header row.
+ */
+static enum file_kind open_input(struct tsv_reader *tsv, const char *filename)
+{
+	tsv_reader_open(tsv, filename);
+
+	if (!tsv_read_row(tsv))
+		error("%s: file is empty", filename);
+
+	if (ob_header_match(tsv))
+		return FILE_KIND_OB;
+
+	if (taq_header_match(tsv))
+		return FILE_KIND_TAQ;
+
+	error("%s: not an OB or TAQ file", filename);
+
+	return -1;
+}
+
+static void merge_input_date(struct merge_input *input, const char *date, size_t len)
+{
+	if (len >= MERGE_DATE_LEN)
+		error("%s:%" PRIu64 ": invalid date", input->tsv.filename, input->tsv.line);
+
+	memcpy(input->date, date, len);
+
+	input->date_len = len;
+}
+
+static void merge_input_next_ob(struct merge_input *input)
+{
+	struct ob_event *event = &input->event.ob;
+
+	if (!ob_read_event(&input->reader.ob, event)) {
+		input->done = true;
+		return;
+	}
+
+	if (event->date)
+		merge_input_date(input, event->date, event->date_len);
+
+	/* Rows without a time, such as date rows, go first: */
+	input->time = event->fields & OB_FIELD_TIME ? event->time : 0;
+}
+
+static void merge_input_next_taq(struct merge_input *input)
+{
+	struct taq_event *event = &input->event.taq;
+
+	if (!taq_read_event(&input->reader.taq, event)) {
+		input->done = true;
+		return;
+	}
+
+	if (event->date)
+		merge_input_date(input, event->date, event->date_len);
+
+	input->time = event->fields & TAQ_FIELD_TIME ? event->time : 0;
+}
+
+/*
+ * Returns true if input 'a' goes before input 'b'.  Exhausted inputs go
+ * last and ties go to the input that comes first on the command line.
+ */
+static bool merge_before(struct merge *merge, unsigned int a, unsigned int b)
+{
+	struct merge_input *x = &merge->inputs[a];
+	struct merge_input *y = &merge->inputs[b];
+	int cmp;
+
+	if (x->done || y->done)
+		return !x->done || (y->done && a < b);
+
+	cmp = memcmp(x->date, y->date, x->date_len < y->date_len ? x->date_len : y->date_len);
+	if (!cmp)
+		cmp = (int) x->date_len - (int) y->date_len;
+	if (cmp)
+		return cmp < 0;
+
+	if (x->time != y->time)
+		return x->time < y->time;
+
+	return a < b;
+}
+
+static unsigned int merge_build(struct merge *merge, unsigned int node)
+{
+	unsigned int left, right;
+
+	if (node >= merge->nr_inputs)
+		return node - merge->nr_inputs;
+
+	left	= merge_build(merge, 2 * node);
+	right	= merge_build(merge, 2 * node + 1);
+
+	if (merge_before(merge, left, right)) {
+		merge->tree[node] = right;
+		return left;
+	}
+
+	merge->tree[node] = left;
+	return right;
+}
+
+static void merge_init(struct merge *merge, struct merge_input *inputs, unsigned int nr)
+{
+	merge->inputs		= inputs;
+	merge->nr_inputs	= nr;
+
+	merge->tree = calloc(nr, sizeof(*merge->tree));
+	if (!merge->tree)
+		error("out of memory");
+
+	merge->tree[0] = merge_build(merge, 1);
+}
+
+static void merge_release(struct merge *merge)
+{
+	free(merge->tree);
+}
+
+static inline struct merge_input *merge_winner(struct merge *merge)
+{
+	struct merge_input *input = &merge->inputs[merge->tree[0]];
+
+	return input->done ? NULL : input;
+}
+
+/*
+ * Replay the matches on the path from the winner's leaf to the root after
+ * the winner has been advanced.
+ */
+static void merge_replay(struct merge *merge)
+{
+	unsigned int winner = merge->tree[0];
+	unsigned int node;
+
+	for (node = (winner + merge->nr_inputs) / 2; node > 0; node /= 2) {
+		unsigned int loser = merge->tree[node];
+
+		if (merge_before(merge, loser, winner)) {
+			merge->tree[node] = winner;
+			winner = loser;
+		}
+	}
+
+	merge->tree[0] = winner;
+}
+
+static enum file_kind open_inputs(struct merge_input *inputs, char **header)
+{
+	enum file_kind kind = FILE_KIND_OB;
+	int i;
+
+	for (i = 0; i < nr_inputs; i++) {
+		struct merge_input *input = &inputs[i];
+		enum file_kind input_kind;
+
+		input_kind = open_input(&input->tsv, input_filenames[i]);
+
+		/* Output has the same columns as the first input unless specified: */
+		if (!i) {
+			kind = input_kind;
+
+			if (!columns)
+				columns = *header = tsv_join_fields(&input->tsv, ',');
+		} else if (input_kind != kind) {
+			error("%s: not an %s file", input_filenames[i], kind == FILE_KIND_OB ? "OB" : "TAQ");
+		}
+
+		if (input_kind == FILE_KIND_OB) {
+			ob_reader_init(&input->reader.ob, &input->tsv);
+			merge_input_next_ob(input);
+		} else {
+			taq_reader_init(&input->reader.taq, &input->tsv);
+			merge_input_next_taq(input);
+		}
+	}
+
+	return kind;
+}
+
+static void close_inputs(struct merge_input *inputs)
+{
+	int i;
+
+	for (i = 0; i < nr_inputs; i++)
+		tsv_reader_close(&inputs[i].tsv);
+
+	free(inputs);
+}
+
+static void merge_ob(struct merge_input *inputs)
+{
+	struct merge_input *input;
+	struct ob_writer writer;
+	struct merge merge;
+	struct output *out;
+
+	ob_writer_init(&writer, columns, events);
+
+	out = output_open(output_filename, &output_options);
+
+	writer.out = out;
+
+	ob_write_header(&writer);
+
+	merge_init(&merge, inputs, nr_inputs);
+
+	while ((input = merge_winner(&merge)) != NULL) {
+		ob_write_event(&writer, &input->event.ob);
+
+		merge_input_next_ob(input);
+
+		merge_replay(&merge);
+	}
+
+	merge_release(&merge);
+
+	output_close(out);
+}
+
+static void merge_taq(struct merge_input *inputs)
+{
+	struct merge_input *input;
+	struct taq_writer writer;
+	struct merge merge;
+	struct output *out;
+
+	taq_writer_init(&writer, columns, events);
+
+	out = output_open(output_filename, &output_options);
+
+	writer.out = out;
+
+	taq_write_header(&writer);
+
+	merge_init(&merge, inputs, nr_inputs);
+
+	while ((input = merge_winner(&merge)) != NULL) {
+		taq_write_event(&writer, &input->event.taq);
+
+		merge_input_next_taq(input);
+
+		merge_replay(&merge);
+	}
+
+	merge_release(&merge);
+
+	output_close(out);
+}
+
+int cmd_merge(int argc, char *argv[])
+{
+	struct merge_input *inputs;
+	char *header = NULL;
+	enum file_kind kind;
+
+	setlocale(LC_ALL, "");
+
+	parse_args(argc - 1, argv + 1);
+
+	inputs = calloc(nr_inputs, sizeof(*inputs));
+	if (!inputs)
+		error("out of memory");
+
+	kind = open_inputs(inputs, &header);
+
+	switch (kind) {
+	case FILE_KIND_OB:
+		merge_ob(inputs);
+		break;
+	case FILE_KIND_TAQ:
+	default:
+		merge_taq(inputs);
+		break;
+	}
+
+	close_inputs(inputs);
+
+	free(header);
+
+	return 0;
+}
@@ -2,7 +2,11 @@
 
 #include "tick/nasdaq/itch-proto.h"
 #include "tick/bats/pitch-proto.h"
+#include "tick/progress.h"
+#include "tick/profile.h"
+#include "tick/memory.h"
 #include "tick/format.h"
+#include "tick/output.h"
 #include "tick/error.h"
 #include "tick/ob.h"
 
@@ -15,6 +19,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <unistd.h>
 
 extern const char *program;
 
@@ -23,9 +28,22 @@ static void usage(void)
 #define FMT								\
 "\n usage: %s ob [<options>] <input> <output>\n"			\
 "\n"									\
-"    -s, --symbol <symbol> symbol\n"					\
-"    -f, --format <format> input file format\n"				\
-"    -d, --date <date>     date\n"					\
+"    -s, --symbol <symbol>       symbol\n"				\
+"    -f, --format <format>       input file format\n"			\
+"    -d, --date <date>           date\n"				\
+"    -z, --compress <type>       compress output (%s, %s)\n"		\
+"    -j, --threads <n>           number of compression threads\n"	\
+"    -c, --columns <list>        comma-separated columns to output\n"	\
+"    -e, --events <list>         comma-separated event types to output\n" \
+"    -R, --roll-size <size>      roll output over at size (e.g. 512M)\n" \
+"    -T, --roll-interval <time>  roll output over at feed time (e.g. 5m)\n" \
+"    -P, --profile               print a per-stage time breakdown\n"	\
+"    -C, --counters              add hardware performance counters to the profile\n" \
+"    -l, --latency               add per-message latency percentiles to the profile\n" \
+"    -p, --progress <mode>       progress output: auto, tty, log or none\n" \
+"    -M, --memory                print memory usage\n"			\
+"    -L, --memory-limit <size>   abort when memory usage exceeds <size> (e.g. 8G)\n" \
+"\n Use '-' as <output> to write to standard output.\n"			\
 "\n Supported file formats are:\n"					\
 "\n"									\
 "   %s\n"								\
@@ -33,6 +51,8 @@ static void usage(void)
 "\n"
 	fprintf(stderr, FMT,
 			program,
+			output_compression_names[OUTPUT_COMPRESSION_GZIP],
+			output_compression_names[OUTPUT_COMPRESSION_ZSTD],
 			format_names[FORMAT_BATS_PITCH_112],
 			format_names[FORMAT_NASDAQ_ITCH_41]);
 
@@ -44,21 +64,42 @@ static void usage(void)
 static const struct option options[] = {
 	{ "date",	required_argument,	NULL, 'd' },
 	{ "format",	required_argument, 	NULL, 'f' },
+	{ "compress",	required_argument,	NULL, 'z' },
+	{ "threads",	required_argument,	NULL, 'j' },
+	{ "columns",	required_argument,	NULL, 'c' },
+	{ "events",	required_argument,	NULL, 'e' },
+	{ "roll-size",	required_argument,	NULL, 'R' },
+	{ "roll-interval", required_argument,	NULL, 'T' },
+	{ "profile",	no_argument,		NULL, 'P' },
+	{ "counters",	no_argument,		NULL, 'C' },
+	{ "latency",	no_argument,		NULL, 'l' },
+	{ "progress",	required_argument,	NULL, 'p' },
+	{ "memory",	no_argument,		NULL, 'M' },
+	{ "memory-limit", required_argument,	NULL, 'L' },
 	{ "symbol",	required_argument, 	NULL, 's' },
 	{ NULL,		0,			NULL,  0  },
 };
 
 static const char	*output_filename;
+static struct output_options output_options;
 static const char	*input_filename;
 static const char	*date;
 static const char	*format;
 static const char	*symbol;
+static const char	*columns;
+static const char	*events;
+static bool		with_profile;
+static bool		with_counters;
+static bool		with_latency;
+static enum progress_mode progress_mode;
+static bool		with_memory;
+static uint64_t		memory_limit;
 
 static void parse_args(int argc, char *argv[])
 {
 	int opt;
 
-	while ((opt = getopt_long(argc, argv, "s:f:d:", options, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "s:f:d:z:j:c:e:R:T:PClp:ML:", options, NULL)) != -1) {
 		switch (opt) {
 		case 's':
 			symbol		= optarg;
@@ -69,8 +110,39 @@ static void parse_args(int argc, char *argv[])
 		case 'd':
 			date		= optarg;
 			break;
+		case 'c':
+			columns		= optarg;
+			break;
+		case 'e':
+			events		= optarg;
+			break;
+		case 'P':
+			with_profile	= true;
+			break;
+		case 'C':
+			with_profile	= true;
+			with_counters	= true;
+			break;
+		case 'l':
+			with_profile	= true;
+			with_latency	= true;
+			break;
+		case 'p':
+			progress_mode	= parse_progress_mode(optarg);
+			if ((int) progress_mode < 0)
+				error("%s: invalid progress mode", optarg);
+			break;
+		case 'M':
+			with_memory	= true;
+			break;
+		case 'L':
+			memory_limit	= parse_output_size(optarg);
+			if (!memory_limit)
+				error("%s: invalid memory limit", optarg);
+			break;
 		default:
-			usage();
+			if (!output_parse_option(&output_options, opt, optarg))
+				usage();
 			break;
 		}
 	}
@@ -101,7 +173,9 @@ static void release_stream(z_stream *stream)
 
 int cmd_ob(int argc, char *argv[])
 {
-	int in_fd, out_fd;
+	int in_fd;
+	struct ob_writer writer;
+	struct output *out;
 	enum format fmt;
 	z_stream stream;
 
@@ -109,6 +183,14 @@ int cmd_ob(int argc, char *argv[])
 
 	parse_args(argc - 1, argv + 1);
 
+	if (with_profile)
+		profile_start(with_counters, with_latency);
+
+	progress_start(progress_mode, input_filename);
+
+	if (with_memory || memory_limit)
+		memory_start(input_filename, memory_limit);
+
 	if (!format)
 		error("%s: file format not detected. Please specify it with the '-f' option.",
 			input_filename);
@@ -116,17 +198,22 @@ int cmd_ob(int argc, char *argv[])
 	if (!symbol)
 		error("symbol not specified");
 
+	ob_writer_init(&writer, columns, events);
+
 	init_stream(&stream);
 
 	in_fd = open(input_filename, O_RDONLY);
 	if (in_fd < 0)
 		error("%s: %s", input_filename, strerror(errno));
 
-	out_fd = open(output_filename, O_RDWR|O_CREAT|O_EXCL, 0644);
-	if (out_fd < 0)
-		error("%s: %s", output_filename, strerror(errno));
+	out = output_open(output_filename, &output_options);
+
+	writer.out = out;
 
-	ob_write_header(out_fd);
+	progress_track_output(out);
+	memory_track_output(out);
+
+	ob_write_header(&writer);
 
 	fmt = parse_format(format);
 
@@ -145,7 +232,7 @@ int cmd_ob(int argc, char *argv[])
 		session = (struct pitch_session) {
 			.zstream	= &stream,
 			.in_fd		= in_fd,
-			.out_fd		= out_fd,
+			.ob_writer	= &writer,
 			.input_filename	= input_filename,
 			.time_zone	= "America/New_York",
 			.time_zone_len	= strlen("America/New_York"),
@@ -177,7 +264,7 @@ int cmd_ob(int argc, char *argv[])
 		session = (struct nasdaq_itch_session) {
 			.zstream	= &stream,
 			.in_fd		= in_fd,
-			.out_fd		= out_fd,
+			.ob_writer	= &writer,
 			.input_filename	= input_filename,
 			.time_zone	= "America/New_York",
 			.time_zone_len	= strlen("America/New_York"),
@@ -202,13 +289,19 @@ int cmd_ob(int argc, char *argv[])
 		break;
 	}
 
-	printf("\n");
+	progress_stop();
+
+	memory_untrack_output();
+
+	output_close(out);
 
 	if (close(in_fd) < 0)
 		error("%s: %s", input_filename, strerror(errno));
 
-	if (close(out_fd) < 0)
-		error("%s: %s", output_filename, strerror(errno));
+	print_profile(input_filename);
+
+	if (with_memory)
+		print_memory();
 
 	release_stream(&stream);
 
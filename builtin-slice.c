@@ -0,0 +1,411 @@
+#include "tick/builtins.h"
+
+#include "tick/output.h"
+#include "tick/symbol.h"
+#include "tick/error.h"
+#include "tick/index.h"
+
+#include <sys/stat.h>
+#include <stdbool.h>
+#include <getopt.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+
+extern const char *program;
+
+static void usage(void)
+{
+#define FMT								\
+"\n usage: %s slice [<options>] <input> <output>\n"			\
+"\n"									\
+"    -f, --from <time>           first time of day to output (HH:MM[:SS[.f]])\n" \
+"    -t, --to <time>             time of day to stop output at (HH:MM[:SS[.f]])\n" \
+"    -s, --symbol <symbol>       only rows of this symbol (default: all symbols)\n" \
+"    -z, --compress <type>       compress output (%s, %s)\n"		\
+"    -j, --threads <n>           number of compression threads\n"	\
+"\n <input> is an uncompressed OB or TAQ file of a single day that has been\n" \
+" indexed with '%s index'.  Rows from <from> up to but not including <to>\n" \
+" are written after the header and date rows of <input>.  Rows without a\n" \
+" time are written if and only if the timed row before them is.  With -s,\n" \
+" rows without a symbol are written as well.\n"			\
+"\n"
+	fprintf(stderr, FMT,
+			program,
+			output_compression_names[OUTPUT_COMPRESSION_GZIP],
+			output_compression_names[OUTPUT_COMPRESSION_ZSTD],
+			program);
+
+#undef FMT
+
+	exit(EXIT_FAILURE);
+}
+
+static const struct option options[] = {
+	{ "from",	required_argument,	NULL, 'f' },
+	{ "to",		required_argument,	NULL, 't' },
+	{ "symbol",	required_argument,	NULL, 's' },
+	{ "compress",	required_argument,	NULL, 'z' },
+	{ "threads",	required_argument,	NULL, 'j' },
+	{ NULL,		0,			NULL,  0  },
+};
+
+static const char	*input_filename;
+static const char	*output_filename;
+static struct output_options output_options;
+static uint64_t		time_from;
+static uint64_t		time_to = UINT64_MAX;
+static const char	*symbol;
+static uint32_t		symbol_id;
+static unsigned int	time_column;
+static unsigned int	symbol_column;
+static struct symbol_cache symbol_cache;
+
+/*
+ * Parse a time of day in "HH:MM[:SS[.fraction]]" format to nanoseconds
+ * since midnight.
+ */
+static uint64_t parse_time(const char *s)
+{
+	unsigned int hours, minutes, seconds = 0;
+	uint64_t nsec = 0, scale = 100000000;
+	const char *p;
+	int n = 0;
+
+	if (sscanf(s, "%2u:%2u%n", &hours, &minutes, &n) != 2)
+		error("%s: invalid time", s);
+
+	p = s + n;
+
+	if (*p == ':') {
+		if (sscanf(p, ":%2u%n", &seconds, &n) != 1)
+			error("%s: invalid time", s);
+
+		p += n;
+
+		if (*p == '.') {
+			for (p++; *p >= '0' && *p <= '9' && scale; p++) {
+				nsec += (*p - '0') * scale;
+				scale /= 10;
+			}
+		}
+	}
+
+	if (*p != '\0' || hours > 24 || minutes > 59 || seconds > 59)
+		error("%s: invalid time", s);
+
+	return ((uint64_t) hours * 3600 + minutes * 60 + seconds) * 1000000000ULL + nsec;
+}
+
+static void parse_args(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "f:t:s:z:j:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'f':
+			time_from	= parse_time(optarg);
+			break;
+		case 't':
+			time_to		= parse_time(optarg);
+			break;
+		case 's':
+			symbol		= optarg;
+			break;
+		default:
+			if (!output_parse_option(&output_options, opt, optarg))
+				usage();
+			break;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc != 2)
+		usage();
+
+	input_filename	= argv[0];
+	output_filename	= argv[1];
+}
+
+static char *read_range(int fd, uint64_t offset, uint64_t len)
+{
+	uint64_t pos = 0;
+	char *buf;
+
+	buf = malloc(len + 1);
+	if (!buf)
+		error("out of memory");
+
+	while (pos < len) {
+		ssize_t nr;
+
+		nr = pread(fd, buf + pos, len - pos, offset + pos);
+		if (nr < 0) {
+			if (errno == EINTR)
+				continue;
+
+			error("%s: %s", input_filename, strerror(errno));
+		}
+
+		if (!nr)
+			error("%s: unexpected end of file", input_filename);
+
+		pos += nr;
+	}
+
+	buf[len] = '\0';
+
+	return buf;
+}
+
+/*
+ * Returns the index of a column in the header row, or -1 if there is no
+ * such column.
+ */
+static int find_column(const char *header, const char *name)
+{
+	size_t name_len = strlen(name);
+	const char *p = header;
+	int column = 0;
+
+	for (;;) {
+		size_t len = strcspn(p, "\t\n");
+
+		if (len == name_len && !memcmp(p, name, len))
+			return column;
+
+		if (p[len] != '\t')
+			break;
+
+		p += len + 1;
+		column++;
+	}
+
+	return -1;
+}
+
+/*
+ * Returns the start of field 'column' of the row from 'p' to 'eol'.  The
+ * field ends at the next tab or newline.
+ */
+static char *row_field(char *p, char *eol, unsigned int column)
+{
+	unsigned int i;
+
+	for (i = 0; i < column && p < eol; i++) {
+		p = memchr(p, '\t', eol - p);
+		p = p ? p + 1 : eol;
+	}
+
+	return p;
+}
+
+static bool symbol_matches(char *p, char *eol)
+{
+	char *field = row_field(p, eol, symbol_column);
+	size_t len = strcspn(field, "\t\n");
+
+	/* Rows without a symbol always match: */
+	if (field >= eol || !len)
+		return true;
+
+	return symbol_cache_intern(&symbol_cache, field, len) == symbol_id;
+}
+
+/*
+ * Write out the rows of a block that are in the time window and of the
+ * symbol.  A block starts with a timed row and rows without a time go with
+ * the timed row before them, which is also what copying a whole block does.
+ */
+static void slice_block(struct output *out, int fd, uint64_t offset, uint64_t len)
+{
+	bool in_window = false;
+	char *buf, *p, *end;
+
+	buf = read_range(fd, offset, len);
+	end = buf + len;
+
+	for (p = buf; p < end; ) {
+		char *eol, *field;
+
+		eol = memchr(p, '\n', end - p);
+		eol = eol ? eol + 1 : end;
+
+		field = row_field(p, eol, time_column);
+
+		if (field < eol && *field >= '0' && *field <= '9') {
+			uint64_t time = 0;
+
+			for (; *field >= '0' && *field <= '9'; field++)
+				time = time * 10 + (*field - '0');
+
+			in_window = time >= time_from && time < time_to;
+		}
+
+		if (in_window && (!symbol || symbol_matches(p, eol)))
+			output_write(out, p, eol - p);
+
+		p = eol;
+	}
+
+	free(buf);
+}
+
+/*
+ * A block has rows to write for the symbol if the symbol or rows without a
+ * symbol are in its set.
+ */
+static bool block_has_symbol(struct index *index, uint64_t entry)
+{
+	if (!symbol)
+		return true;
+
+	return index_block_has_symbol(index, entry, symbol_id) ||
+	       index_block_has_symbol(index, entry, INDEX_SYMBOL_NONE);
+}
+
+/*
+ * Rows from entry 'i' up to the next entry have times between the times of
+ * the two entries.  Blocks that are entirely in the window are copied as is
+ * and only the blocks at the edges of the window are scanned row by row.
+ * When slicing by symbol, blocks without rows of the symbol are skipped and
+ * the others are scanned.
+ */
+static void slice(struct output *out, int fd, struct index *index)
+{
+	uint64_t copy_start = 0, copy_len = 0;
+	uint64_t lo = 0, hi, first, last;
+
+	/* Last entry before the window and first entry at its end: */
+	first = 0;
+	last = index->nr_entries;
+
+	while (first < last) {
+		uint64_t mid = first + (last - first) / 2;
+
+		if (index->entries[mid].time < time_from)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+
+	lo = first ? first - 1 : 0;
+
+	first = lo;
+	last = index->nr_entries;
+
+	while (first < last) {
+		uint64_t mid = first + (last - first) / 2;
+
+		if (index->entries[mid].time < time_to)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+
+	hi = first;
+
+	for (; lo < hi; lo++) {
+		struct index_entry *entry = &index->entries[lo];
+		uint64_t next_offset, next_time;
+
+		if (lo + 1 < index->nr_entries) {
+			next_offset	= index->entries[lo + 1].offset;
+			next_time	= index->entries[lo + 1].time;
+		} else {
+			next_offset	= index->file_size;
+			next_time	= UINT64_MAX;
+		}
+
+		if (!block_has_symbol(index, lo))
+			continue;
+
+		if (!symbol && entry->time >= time_from && next_time < time_to) {
+			if (!copy_len)
+				copy_start = entry->offset;
+
+			copy_len += next_offset - entry->offset;
+			continue;
+		}
+
+		if (copy_len) {
+			output_copy_range(out, fd, input_filename, copy_start, copy_len);
+			copy_len = 0;
+		}
+
+		slice_block(out, fd, entry->offset, next_offset - entry->offset);
+	}
+
+	if (copy_len)
+		output_copy_range(out, fd, input_filename, copy_start, copy_len);
+}
+
+int cmd_slice(int argc, char *argv[])
+{
+	char *idx_filename, *header;
+	struct index index;
+	struct output *out;
+	struct stat st;
+	int column;
+	int fd;
+
+	setlocale(LC_ALL, "");
+
+	parse_args(argc - 1, argv + 1);
+
+	fd = open(input_filename, O_RDONLY);
+	if (fd < 0)
+		error("%s: %s", input_filename, strerror(errno));
+
+	if (fstat(fd, &st) < 0)
+		error("%s: %s", input_filename, strerror(errno));
+
+	idx_filename = index_filename(input_filename);
+
+	index_read(&index, idx_filename);
+
+	if (index.file_size != (uint64_t) st.st_size)
+		error("%s: index is out of date, run '%s index %s'", idx_filename, program, input_filename);
+
+	/* The header and date rows come before the first timed row: */
+	header = read_range(fd, 0, index.data_offset);
+
+	column = find_column(header, "Time");
+	if (column < 0)
+		error("%s: no Time column", input_filename);
+
+	time_column = column;
+
+	if (symbol) {
+		column = find_column(header, "Symbol");
+		if (column < 0)
+			error("%s: no Symbol column", input_filename);
+
+		symbol_column	= column;
+		symbol_id	= symbol_intern(symbol, strlen(symbol));
+	}
+
+	out = output_open(output_filename, &output_options);
+
+	output_write(out, header, index.data_offset);
+
+	slice(out, fd, &index);
+
+	output_close(out);
+
+	free(header);
+
+	index_release(&index);
+
+	free(idx_filename);
+
+	close(fd);
+
+	return 0;
+}
@@ -2,10 +2,16 @@
 
 #include "tick/nasdaq/stat.h"
 #include "tick/bats/stat.h"
+#include "tick/progress.h"
+#include "tick/profile.h"
+#include "tick/memory.h"
 #include "tick/format.h"
+#include "tick/output.h"
 #include "tick/error.h"
+#include "tick/rates.h"
 #include "tick/stats.h"
 
+#include <stdbool.h>
 #include <getopt.h>
 #include <libgen.h>
 #include <locale.h>
@@ -19,12 +25,26 @@
 
 extern const char *program;
 
+#define DEFAULT_TOP		10
+#define DEFAULT_INTERVAL	1000000000ULL /* 1s */
+
 static void usage(void)
 {
 #define FMT								\
 "\n usage: %s stat [<options>] <filename>\n"				\
 "\n"									\
-"    -f, --format <format> input file format\n"				\
+"    -f, --format <format>       input file format\n"			\
+"    -S, --symbols               print per-symbol stats\n"		\
+"    -n, --top <n>               number of symbols in top lists (default: 10)\n" \
+"    -r, --rates                 print message rate stats\n"		\
+"    -t, --timeline <file>       write message counts per interval to <file>\n" \
+"    -i, --interval <time>       timeline interval (e.g. 1ms, 1s; default: 1s)\n" \
+"    -P, --profile               print a per-stage time breakdown\n"	\
+"    -C, --counters              add hardware performance counters to the profile\n" \
+"    -l, --latency               add per-message latency percentiles to the profile\n" \
+"    -p, --progress <mode>       progress output: auto, tty, log or none\n" \
+"    -M, --memory                print memory usage\n"			\
+"    -L, --memory-limit <size>   abort when memory usage exceeds <size> (e.g. 8G)\n" \
 "\n Supported file formats are:\n"					\
 "\n"									\
 "   %s\n"								\
@@ -42,21 +62,85 @@ static void usage(void)
 
 static const struct option options[] = {
 	{ "format",	required_argument, 	NULL, 'f' },
+	{ "symbols",	no_argument,		NULL, 'S' },
+	{ "top",	required_argument,	NULL, 'n' },
+	{ "rates",	no_argument,		NULL, 'r' },
+	{ "timeline",	required_argument,	NULL, 't' },
+	{ "interval",	required_argument,	NULL, 'i' },
+	{ "profile",	no_argument,		NULL, 'P' },
+	{ "counters",	no_argument,		NULL, 'C' },
+	{ "latency",	no_argument,		NULL, 'l' },
+	{ "progress",	required_argument,	NULL, 'p' },
+	{ "memory",	no_argument,		NULL, 'M' },
+	{ "memory-limit", required_argument,	NULL, 'L' },
 	{ NULL,		0,			NULL,  0  },
 };
 
 static const char	*filename;
 static const char	*format;
+static const char	*timeline_filename;
+static bool		by_symbol;
+static bool		with_rates;
+static bool		with_profile;
+static bool		with_counters;
+static bool		with_latency;
+static enum progress_mode progress_mode;
+static bool		with_memory;
+static uint64_t		memory_limit;
+static unsigned int	top = DEFAULT_TOP;
+static uint64_t		interval = DEFAULT_INTERVAL;
 
 static void parse_args(int argc, char *argv[])
 {
 	int opt;
 
-	while ((opt = getopt_long(argc, argv, "f:v", options, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "f:Sn:rt:i:PClp:ML:", options, NULL)) != -1) {
 		switch (opt) {
 		case 'f':
 			format		= optarg;
 			break;
+		case 'S':
+			by_symbol	= true;
+			break;
+		case 'n':
+			top		= strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			with_rates	= true;
+			break;
+		case 't':
+			timeline_filename = optarg;
+			with_rates	= true;
+			break;
+		case 'i':
+			interval	= parse_output_interval(optarg);
+			if (!interval)
+				error("%s: invalid interval", optarg);
+			break;
+		case 'P':
+			with_profile	= true;
+			break;
+		case 'C':
+			with_profile	= true;
+			with_counters	= true;
+			break;
+		case 'l':
+			with_profile	= true;
+			with_latency	= true;
+			break;
+		case 'p':
+			progress_mode	= parse_progress_mode(optarg);
+			if ((int) progress_mode < 0)
+				error("%s: invalid progress mode", optarg);
+			break;
+		case 'M':
+			with_memory	= true;
+			break;
+		case 'L':
+			memory_limit	= parse_output_size(optarg);
+			if (!memory_limit)
+				error("%s: invalid memory limit", optarg);
+			break;
 		default:
 			usage();
 			break;
@@ -85,8 +169,21 @@ static void release_stream(z_stream *stream)
 	inflateEnd(stream);
 }
 
+static struct output *open_timeline(void)
+{
+	struct output_options opts;
+
+	opts = (struct output_options) {
+		.compression	= OUTPUT_COMPRESSION_NONE,
+	};
+
+	return output_open(timeline_filename, &opts);
+}
+
 int cmd_stat(int argc, char *argv[])
 {
+	struct output *timeline = NULL;
+	struct rates rates;
 	enum format fmt;
 	z_stream stream;
 	int fd;
@@ -95,6 +192,14 @@ int cmd_stat(int argc, char *argv[])
 
 	parse_args(argc - 1, argv + 1);
 
+	if (with_profile)
+		profile_start(with_counters, with_latency);
+
+	progress_start(progress_mode, filename);
+
+	if (with_memory || memory_limit)
+		memory_start(filename, memory_limit);
+
 	if (!format)
 		error("%s: file format not detected. Please specify it with the '-f' option.",
 			filename);
@@ -107,29 +212,61 @@ int cmd_stat(int argc, char *argv[])
 
 	fmt = parse_format(format);
 
+	if (timeline_filename)
+		timeline = open_timeline();
+
+	if (with_rates)
+		rates_init(&rates, filename, timeline, interval);
+
 	switch (fmt) {
 	case FORMAT_NASDAQ_ITCH_41: {
 		struct stats stats;
 
-		stats = (struct stats) {
-			.filename	= filename,
-		};
+		stats_init(&stats, filename, by_symbol);
+
+		if (with_rates)
+			stats.rates = &rates;
 
 		nasdaq_itch_stat(&stats, fd, &stream);
+		progress_stop();
+
 		nasdaq_itch_print_stats(&stats);
 
+		if (by_symbol)
+			nasdaq_itch_print_symbol_stats(&stats, top);
+
+		if (with_rates) {
+			rates_finish(&rates);
+			print_rates(&rates);
+		}
+
+		stats_release(&stats);
+
 		break;
 	}
 	case FORMAT_BATS_PITCH_112: {
 		struct stats stats;
 
-		stats = (struct stats) {
-			.filename	= filename,
-		};
+		stats_init(&stats, filename, by_symbol);
+
+		if (with_rates)
+			stats.rates = &rates;
 
 		bats_pitch_stat(&stats, fd, &stream);
+		progress_stop();
+
 		bats_pitch_print_stats(&stats);
 
+		if (by_symbol)
+			bats_pitch_print_symbol_stats(&stats, top);
+
+		if (with_rates) {
+			rates_finish(&rates);
+			print_rates(&rates);
+		}
+
+		stats_release(&stats);
+
 		break;
 	}
 	case FORMAT_NYSE_TAQ_17:
@@ -141,9 +278,17 @@ int cmd_stat(int argc, char *argv[])
 
 	printf("\n");
 
+	if (timeline)
+		output_close(timeline);
+
 	if (close(fd) < 0)
 		error("%s: %s: %s", filename, strerror(errno));
 
+	print_profile(filename);
+
+	if (with_memory)
+		print_memory();
+
 	release_stream(&stream);
 
 	return 0;
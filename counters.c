@@ -0,0 +1,233 @@
+#include "tick/counters.h"
+
+#include "tick/types.h"
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+const char *counter_names[NR_COUNTERS] = {
+	[COUNTER_CYCLES]		= "Cycles",
+	[COUNTER_INSTRUCTIONS]		= "Instructions",
+	[COUNTER_CACHE_REFERENCES]	= "Cache references",
+	[COUNTER_CACHE_MISSES]		= "Cache misses",
+	[COUNTER_BRANCHES]		= "Branches",
+	[COUNTER_BRANCH_MISSES]		= "Branch misses",
+};
+
+static const uint64_t counter_configs[NR_COUNTERS] = {
+	[COUNTER_CYCLES]		= PERF_COUNT_HW_CPU_CYCLES,
+	[COUNTER_INSTRUCTIONS]		= PERF_COUNT_HW_INSTRUCTIONS,
+	[COUNTER_CACHE_REFERENCES]	= PERF_COUNT_HW_CACHE_REFERENCES,
+	[COUNTER_CACHE_MISSES]		= PERF_COUNT_HW_CACHE_MISSES,
+	[COUNTER_BRANCHES]		= PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
+	[COUNTER_BRANCH_MISSES]		= PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+static int perf_event_open(struct perf_event_attr *attr, int group_fd)
+{
+	return syscall(SYS_perf_event_open, attr, 0, -1, group_fd, 0);
+}
+
+static void counter_mmap(struct counter *counter)
+{
+	void *page;
+
+	page = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, counter->fd, 0);
+	if (page == MAP_FAILED)
+		return;
+
+	counter->page = page;
+}
+
+static bool counter_can_rdpmc(struct counter *counter)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	struct perf_event_mmap_page *pc = counter->page;
+
+	return pc && pc->cap_user_rdpmc;
+#else
+	return false;
+#endif
+}
+
+/*
+ * Open the counters.  Returns zero if at least one of them could be
+ * opened and a negative error code otherwise.
+ */
+int counters_open(struct counters *counters)
+{
+	unsigned int i;
+	int err = 0;
+
+	*counters = (struct counters) {
+		.group_fd	= -1,
+		.rdpmc		= true,
+	};
+
+	for (i = 0; i < NR_COUNTERS; i++) {
+		struct counter *counter = &counters->counters[i];
+		struct perf_event_attr attr;
+
+		attr = (struct perf_event_attr) {
+			.type		= PERF_TYPE_HARDWARE,
+			.size		= sizeof(attr),
+			.config		= counter_configs[i],
+			.read_format	= PERF_FORMAT_GROUP,
+			.disabled	= counters->group_fd < 0,
+			.exclude_kernel	= 1,
+			.exclude_hv	= 1,
+		};
+
+		counter->fd = perf_event_open(&attr, counters->group_fd);
+		if (counter->fd < 0) {
+			err = -errno;
+			continue;
+		}
+
+		if (counters->group_fd < 0)
+			counters->group_fd = counter->fd;
+
+		counters->slots[i] = counters->nr_open++;
+
+		counter_mmap(counter);
+
+		if (!counter_can_rdpmc(counter))
+			counters->rdpmc = false;
+	}
+
+	if (!counters->nr_open)
+		return err;
+
+	ioctl(counters->group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(counters->group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+	return 0;
+}
+
+/*
+ * Explain why the counters could not be opened.  perf_event_open(2)
+ * reports a missing PMU with errors that make little sense as such.
+ */
+const char *counters_strerror(int err)
+{
+	switch (-err) {
+	case EACCES:
+	case EPERM:
+		return "permission denied (see /proc/sys/kernel/perf_event_paranoid)";
+	case ENOENT:
+	case ENODEV:
+	case EOPNOTSUPP:
+		return "not supported by the CPU or the kernel";
+	case ENOSYS:
+		return "perf_event_open(2) is not available";
+	default:
+		return strerror(-err);
+	}
+}
+
+void counters_close(struct counters *counters)
+{
+	unsigned int i;
+
+	for (i = 0; i < NR_COUNTERS; i++) {
+		struct counter *counter = &counters->counters[i];
+
+		if (counter->page)
+			munmap(counter->page, sysconf(_SC_PAGESIZE));
+
+		if (counter->fd >= 0)
+			close(counter->fd);
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*
+ * Read a counter from user space as described in <linux/perf_event.h>.
+ * Fails if the counter is not currently scheduled on the PMU.
+ */
+static bool counter_rdpmc(struct counter *counter, uint64_t *value)
+{
+	volatile struct perf_event_mmap_page *pc = counter->page;
+	uint64_t count;
+	uint32_t seq;
+
+	do {
+		uint32_t idx;
+
+		seq = pc->lock;
+
+		__asm__ __volatile__("" ::: "memory");
+
+		idx = pc->index;
+		if (!pc->cap_user_rdpmc || !idx)
+			return false;
+
+		count = pc->offset;
+
+		count += (int64_t) (__rdpmc(idx - 1) << (64 - pc->pmc_width)) >> (64 - pc->pmc_width);
+
+		__asm__ __volatile__("" ::: "memory");
+	} while (pc->lock != seq);
+
+	*value = count;
+
+	return true;
+}
+#else
+static bool counter_rdpmc(struct counter *counter __maybe_unused, uint64_t *value __maybe_unused)
+{
+	return false;
+}
+#endif
+
+static void counters_read_group(struct counters *counters, uint64_t *values)
+{
+	struct {
+		uint64_t	nr;
+		uint64_t	values[NR_COUNTERS];
+	} buf;
+	unsigned int i;
+
+	if (read(counters->group_fd, &buf, sizeof(buf)) < 0)
+		memset(&buf, 0, sizeof(buf));
+
+	for (i = 0; i < NR_COUNTERS; i++)
+		values[i] = counter_is_open(counters, i) ? buf.values[counters->slots[i]] : 0;
+}
+
+/*
+ * Read the current values of the counters into an array indexed by
+ * enum counter_id.
+ */
+void counters_read(struct counters *counters, uint64_t *values)
+{
+	unsigned int i;
+
+	if (!counters->rdpmc) {
+		counters_read_group(counters, values);
+		return;
+	}
+
+	for (i = 0; i < NR_COUNTERS; i++) {
+		struct counter *counter = &counters->counters[i];
+
+		if (!counter_is_open(counters, i)) {
+			values[i] = 0;
+			continue;
+		}
+
+		if (!counter_rdpmc(counter, &values[i])) {
+			counters_read_group(counters, values);
+			return;
+		}
+	}
+}
@@ -1,9 +1,13 @@
 #include "tick/dsv.h"
 
+#include "tick/output.h"
+#include "tick/error.h"
+
+#include <strings.h>
+#include <string.h>
 #include <stdio.h>
-#include <unistd.h>
 
-void dsv_write_header(int fd, const char *columns[], size_t nr_columns, char delim)
+void dsv_write_header(struct output *out, const char *columns[], size_t nr_columns, char delim)
 {
 	unsigned long idx = 0;
 	unsigned int i;
@@ -17,7 +21,78 @@ void dsv_write_header(int fd, const char *columns[], size_t nr_columns, char del
 	}
 
 	buf[idx++] = '\n';
-	buf[idx++] = '\0';
 
-	write(fd, buf, strlen(buf));
+	output_write_header(out, buf, idx);
+}
+
+/*
+ * Parse a comma-separated list of column names into indices of the
+ * 'columns' table.  Returns the number of selected columns.
+ */
+unsigned int dsv_parse_columns(const char *list, const char *columns[], size_t nr_columns, unsigned int *indices)
+{
+	unsigned int nr = 0;
+	const char *s = list;
+
+	for (;;) {
+		const char *end = strchrnul(s, ',');
+		size_t len = end - s;
+		unsigned int i;
+
+		for (i = 0; i < nr_columns; i++) {
+			if (strlen(columns[i]) == len && !strncasecmp(columns[i], s, len))
+				break;
+		}
+
+		if (i == nr_columns)
+			error("%.*s: unknown column", (int) len, s);
+
+		if (nr == nr_columns)
+			error("%s: too many columns", list);
+
+		indices[nr++] = i;
+
+		if (!*end)
+			break;
+
+		s = end + 1;
+	}
+
+	return nr;
+}
+
+/*
+ * Parse a comma-separated list of event types into a mask for
+ * dsv_event_selected().  'types' is the zero-terminated set of valid event
+ * types, all of which are selected if 'list' is NULL.
+ */
+uint32_t dsv_parse_events(const char *list, const char *types)
+{
+	uint32_t events = 0;
+	const char *s;
+
+	if (!list) {
+		for (s = types; *s; s++)
+			events |= dsv_event_bit(*s);
+
+		return events;
+	}
+
+	s = list;
+
+	for (;;) {
+		const char *end = strchrnul(s, ',');
+
+		if (end - s != 1 || !strchr(types, *s))
+			error("%.*s: unknown event type", (int) (end - s), s);
+
+		events |= dsv_event_bit(*s);
+
+		if (!*end)
+			break;
+
+		s = end + 1;
+	}
+
+	return events;
 }
@@ -22,3 +22,18 @@ void error(const char *fmt, ...)
 
 	exit(EXIT_FAILURE);
 }
+
+void warning(const char *fmt, ...)
+{
+	va_list ap;
+
+	fprintf(stderr, "%s: warning: ", program);
+
+	va_start(ap, fmt);
+
+	vfprintf(stderr, fmt, ap);
+
+	va_end(ap);
+
+	fprintf(stderr, "\n");
+}
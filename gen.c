@@ -0,0 +1,626 @@
+#include "tick/gen.h"
+
+#include "tick/error.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <math.h>
+
+/*
+ * Order flow parameters.  Probabilities are per event, times are in
+ * nanoseconds.
+ */
+#define TRADE_PROB		0.03	/* arrival is a non-displayed trade */
+#define EXECUTE_PROB		0.12	/* order ends in executions */
+#define REPLACE_PROB		0.10	/* order that does not execute is replaced */
+#define PARTIAL_PROB		0.25	/* order change leaves shares behind */
+#define ODD_LOT_PROB		0.05
+
+#define FLEETING_PROB		0.60
+#define SHORT_PROB		0.30
+#define FLEETING_LIFETIME	20e6	/* 20 ms */
+#define SHORT_LIFETIME		2e9	/* 2 s */
+#define LONG_LIFETIME		120e9	/* 2 min */
+
+#define BURST_RATE		10.0	/* arrival rate multiplier in bursts */
+#define BURST_FRACTION		0.03	/* fraction of time in bursts */
+#define BURST_LENGTH		100e6	/* 100 ms */
+
+/*
+ * Messages per order arrival, roughly: the add, the end of the order and
+ * its partial changes.
+ */
+#define EVENTS_PER_ARRIVAL	2.1
+
+uint64_t gen_random(struct gen *gen)
+{
+	uint64_t z = (gen->rng += 0x9e3779b97f4a7c15ULL);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+	return z ^ (z >> 31);
+}
+
+/*
+ * Uniform in [0, 1).
+ */
+double gen_uniform(struct gen *gen)
+{
+	return (gen_random(gen) >> 11) * (1.0 / (1ULL << 53));
+}
+
+/*
+ * Exponentially distributed duration of at least one nanosecond.
+ */
+static uint64_t gen_duration(struct gen *gen, double mean)
+{
+	return 1 + (uint64_t) (-mean * log1p(-gen_uniform(gen)));
+}
+
+static unsigned int gen_geometric(struct gen *gen, double p, unsigned int max)
+{
+	unsigned int n = 1;
+
+	while (n < max && gen_uniform(gen) >= p)
+		n++;
+
+	return n;
+}
+
+static void gen_symbols_init(struct gen *gen)
+{
+	double total = 0.0;
+	unsigned int i;
+
+	gen->symbols = calloc(gen->nr_symbols, sizeof(*gen->symbols));
+	gen->weights = calloc(gen->nr_symbols, sizeof(*gen->weights));
+	if (!gen->symbols || !gen->weights)
+		error("out of memory");
+
+	for (i = 0; i < gen->nr_symbols; i++) {
+		struct gen_symbol *sym = &gen->symbols[i];
+		/* Multiplying by a prime scatters the names over all of them. */
+		uint64_t code = (i * 7919ULL + 17576ULL * 7) % GEN_MAX_SYMBOLS;
+		unsigned int j;
+
+		for (j = 0; j < GEN_SYMBOL_LEN; j++) {
+			sym->name[GEN_SYMBOL_LEN - 1 - j] = 'A' + code % 26;
+
+			code /= 26;
+		}
+
+		/* Prices between $5 and $500, on a log scale. */
+		sym->price = (uint64_t) (5.0 * pow(100.0, gen_uniform(gen)) * 100) * GEN_TICK;
+
+		total += 1.0 / (i + 1);
+
+		gen->weights[i] = total;
+	}
+}
+
+static uint32_t gen_symbol(struct gen *gen)
+{
+	double x = gen_uniform(gen) * gen->weights[gen->nr_symbols - 1];
+	unsigned int lo = 0, hi = gen->nr_symbols - 1;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (gen->weights[mid] <= x)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+ * Relative arrival rate over the session: busy at the open and the close,
+ * quiet around midday, and one on average.
+ */
+static double gen_intraday(uint64_t time)
+{
+	double x;
+
+	if (time < GEN_SESSION_START)
+		return 1.0;
+
+	x = 2.0 * (time - GEN_SESSION_START) / GEN_SESSION_LEN - 1.0;
+	if (x > 1.0)
+		return 1.0;
+
+	return 0.6 + 1.2 * x * x;
+}
+
+static double gen_regime_rate(bool burst)
+{
+	if (burst)
+		return BURST_RATE;
+
+	return (1.0 - BURST_FRACTION * BURST_RATE) / (1.0 - BURST_FRACTION);
+}
+
+/*
+ * Draw the next arrival.  The rate is constant within a regime, so when the
+ * regime ends before the arrival, the draw starts over from there.
+ */
+static void gen_schedule_arrival(struct gen *gen, uint64_t time)
+{
+	for (;;) {
+		double rate = gen->rate * gen_intraday(time) * gen_regime_rate(gen->burst);
+		uint64_t next = time + gen_duration(gen, 1.0 / rate);
+
+		if (next < gen->regime_end) {
+			gen->next_arrival = next;
+			return;
+		}
+
+		time = gen->regime_end;
+
+		gen->burst = !gen->burst;
+
+		if (gen->burst)
+			gen->regime_end = time + gen_duration(gen, BURST_LENGTH);
+		else
+			gen->regime_end = time + gen_duration(gen, BURST_LENGTH * (1.0 - BURST_FRACTION) / BURST_FRACTION);
+	}
+}
+
+static uint64_t gen_lifetime(struct gen *gen)
+{
+	double x = gen_uniform(gen);
+
+	if (x < FLEETING_PROB)
+		return gen_duration(gen, FLEETING_LIFETIME);
+
+	if (x < FLEETING_PROB + SHORT_PROB)
+		return gen_duration(gen, SHORT_LIFETIME);
+
+	return gen_duration(gen, LONG_LIFETIME);
+}
+
+static uint32_t gen_shares(struct gen *gen)
+{
+	if (gen_uniform(gen) < ODD_LOT_PROB)
+		return 1 + gen_random(gen) % 99;
+
+	return 100 * gen_geometric(gen, 0.35, 50);
+}
+
+/*
+ * Returns the index of the first level whose price is not below 'price'.
+ */
+static unsigned int gen_side_search(struct gen_side *side, uint64_t price)
+{
+	unsigned int first = 0, last = side->nr_levels;
+
+	while (first < last) {
+		unsigned int mid = first + (last - first) / 2;
+
+		if (side->levels[mid].price < price)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+
+	return first;
+}
+
+static void gen_side_add(struct gen_side *side, uint64_t price)
+{
+	unsigned int idx = gen_side_search(side, price);
+
+	if (idx < side->nr_levels && side->levels[idx].price == price) {
+		side->levels[idx].nr_orders++;
+		return;
+	}
+
+	if (side->nr_levels == side->capacity) {
+		side->capacity = side->capacity ? 2 * side->capacity : 16;
+
+		side->levels = realloc(side->levels, side->capacity * sizeof(*side->levels));
+		if (!side->levels)
+			error("out of memory");
+	}
+
+	memmove(side->levels + idx + 1, side->levels + idx, (side->nr_levels - idx) * sizeof(*side->levels));
+
+	side->levels[idx] = (struct gen_level) {
+		.price		= price,
+		.nr_orders	= 1,
+	};
+
+	side->nr_levels++;
+}
+
+static void gen_side_remove(struct gen_side *side, uint64_t price)
+{
+	unsigned int idx = gen_side_search(side, price);
+
+	if (idx == side->nr_levels || side->levels[idx].price != price)
+		return;
+
+	if (--side->levels[idx].nr_orders)
+		return;
+
+	side->nr_levels--;
+
+	memmove(side->levels + idx, side->levels + idx + 1, (side->nr_levels - idx) * sizeof(*side->levels));
+}
+
+static inline struct gen_side *gen_side(struct gen_symbol *sym, char side)
+{
+	return side == 'B' ? &sym->bids : &sym->asks;
+}
+
+/*
+ * Orders rest a few ticks away from the mid price, most at the inside.  As
+ * the mid price follows the executions it can move through orders that are
+ * still resting, so an order is also kept a tick away from the best price
+ * of the other side to keep the book from crossing.
+ */
+static uint64_t gen_order_price(struct gen *gen, struct gen_symbol *sym, char side)
+{
+	uint64_t offset = gen_geometric(gen, 0.4, 20) * GEN_TICK;
+	uint64_t price;
+
+	if (side == 'B') {
+		price = sym->price > offset ? sym->price - offset : GEN_TICK;
+
+		if (sym->asks.nr_levels && price >= sym->asks.levels[0].price)
+			price = sym->asks.levels[0].price - GEN_TICK;
+
+		return price;
+	}
+
+	price = sym->price + offset;
+
+	if (sym->bids.nr_levels && price <= sym->bids.levels[sym->bids.nr_levels - 1].price)
+		price = sym->bids.levels[sym->bids.nr_levels - 1].price + GEN_TICK;
+
+	return price;
+}
+
+static void heap_swap(struct gen_order *a, struct gen_order *b)
+{
+	struct gen_order tmp = *a;
+
+	*a = *b;
+	*b = tmp;
+}
+
+static void heap_push(struct gen *gen, struct gen_order *order)
+{
+	size_t i;
+
+	if (gen->nr_orders == gen->orders_capacity) {
+		gen->orders_capacity = gen->orders_capacity ? 2 * gen->orders_capacity : 1024;
+
+		gen->orders = realloc(gen->orders, gen->orders_capacity * sizeof(*gen->orders));
+		if (!gen->orders)
+			error("out of memory");
+	}
+
+	i = gen->nr_orders++;
+
+	gen->orders[i] = *order;
+
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+
+		if (gen->orders[parent].time <= gen->orders[i].time)
+			break;
+
+		heap_swap(&gen->orders[parent], &gen->orders[i]);
+
+		i = parent;
+	}
+}
+
+static void heap_pop(struct gen *gen, struct gen_order *order)
+{
+	size_t i = 0;
+
+	*order = gen->orders[0];
+
+	gen->orders[0] = gen->orders[--gen->nr_orders];
+
+	for (;;) {
+		size_t left = 2 * i + 1, right = left + 1, min = i;
+
+		if (left < gen->nr_orders && gen->orders[left].time < gen->orders[min].time)
+			min = left;
+
+		if (right < gen->nr_orders && gen->orders[right].time < gen->orders[min].time)
+			min = right;
+
+		if (min == i)
+			break;
+
+		heap_swap(&gen->orders[min], &gen->orders[i]);
+
+		i = min;
+	}
+}
+
+void gen_init(struct gen *gen, const struct gen_options *opts)
+{
+	*gen = (struct gen) {
+		.rng		= opts->seed,
+		.time		= GEN_SESSION_START,
+		.nr_symbols	= opts->nr_symbols,
+		.next_order_id	= 1,
+		.next_exec_id	= 1,
+	};
+
+	gen->rate = opts->nr_events / EVENTS_PER_ARRIVAL / GEN_SESSION_LEN;
+	if (gen->rate <= 0.0)
+		gen->rate = 1.0 / GEN_SESSION_LEN;
+
+	gen_symbols_init(gen);
+
+	gen->regime_end = gen->time + gen_duration(gen, BURST_LENGTH * (1.0 - BURST_FRACTION) / BURST_FRACTION);
+
+	gen_schedule_arrival(gen, gen->time);
+}
+
+void gen_release(struct gen *gen)
+{
+	unsigned int i;
+
+	for (i = 0; i < gen->nr_symbols; i++) {
+		free(gen->symbols[i].bids.levels);
+		free(gen->symbols[i].asks.levels);
+	}
+
+	free(gen->orders);
+	free(gen->weights);
+	free(gen->symbols);
+}
+
+static void gen_arrival(struct gen *gen, struct gen_event *event)
+{
+	uint32_t symbol = gen_symbol(gen);
+	struct gen_symbol *sym = &gen->symbols[symbol];
+	char side = gen_random(gen) & 1 ? 'B' : 'S';
+	struct gen_order order;
+
+	gen->time = gen->next_arrival;
+
+	gen_schedule_arrival(gen, gen->time);
+
+	if (gen_uniform(gen) < TRADE_PROB) {
+		*event = (struct gen_event) {
+			.type		= GEN_EVENT_TRADE,
+			.time		= gen->time,
+			.symbol		= symbol,
+			.exec_id	= gen->next_exec_id++,
+			.side		= side,
+			.quantity	= gen_shares(gen),
+			.price		= sym->price,
+		};
+
+		return;
+	}
+
+	order = (struct gen_order) {
+		.time		= gen->time + gen_lifetime(gen),
+		.order_id	= gen->next_order_id++,
+		.price		= gen_order_price(gen, sym, side),
+		.remaining	= gen_shares(gen),
+		.symbol		= symbol,
+		.side		= side,
+	};
+
+	heap_push(gen, &order);
+
+	gen_side_add(gen_side(sym, side), order.price);
+
+	*event = (struct gen_event) {
+		.type		= GEN_EVENT_ADD,
+		.time		= gen->time,
+		.symbol		= symbol,
+		.order_id	= order.order_id,
+		.side		= order.side,
+		.quantity	= order.remaining,
+		.price		= order.price,
+	};
+}
+
+/*
+ * The mid price follows the executions.
+ */
+static void gen_execution(struct gen_symbol *sym, struct gen_order *order)
+{
+	if (order->side == 'B' && order->price < sym->price)
+		sym->price = order->price + GEN_TICK;
+	else if (order->side == 'S' && order->price > sym->price)
+		sym->price = order->price - GEN_TICK;
+
+	if (sym->price < GEN_TICK)
+		sym->price = GEN_TICK;
+}
+
+static void gen_order_change(struct gen *gen, struct gen_event *event)
+{
+	struct gen_order order;
+	struct gen_symbol *sym;
+	uint32_t quantity;
+	bool partial;
+
+	heap_pop(gen, &order);
+
+	gen->time = order.time;
+
+	sym = &gen->symbols[order.symbol];
+
+	partial = order.remaining > 1 && gen_uniform(gen) < PARTIAL_PROB;
+
+	quantity = partial ? 1 + gen_random(gen) % (order.remaining - 1) : order.remaining;
+
+	*event = (struct gen_event) {
+		.time		= gen->time,
+		.symbol		= order.symbol,
+		.order_id	= order.order_id,
+		.side		= order.side,
+		.quantity	= quantity,
+		.price		= order.price,
+	};
+
+	/* Whether an order executes is decided by its identifier. */
+	if ((order.order_id * 0x9e3779b97f4a7c15ULL >> 11) * (1.0 / (1ULL << 53)) < EXECUTE_PROB) {
+		event->type	= GEN_EVENT_EXECUTE;
+		event->exec_id	= gen->next_exec_id++;
+
+		gen_execution(sym, &order);
+	} else if (partial) {
+		event->type	= GEN_EVENT_CANCEL;
+	} else if (gen_uniform(gen) < REPLACE_PROB) {
+		gen_side_remove(gen_side(sym, order.side), order.price);
+
+		order.order_id	= gen->next_order_id++;
+		order.price	= gen_order_price(gen, sym, order.side);
+		order.remaining	= gen_shares(gen);
+		order.time	= gen->time + gen_lifetime(gen);
+
+		event->type		= GEN_EVENT_REPLACE;
+		event->new_order_id	= order.order_id;
+		event->new_quantity	= order.remaining;
+		event->new_price	= order.price;
+
+		heap_push(gen, &order);
+
+		gen_side_add(gen_side(sym, order.side), order.price);
+
+		return;
+	} else {
+		event->type	= GEN_EVENT_DELETE;
+	}
+
+	order.remaining -= quantity;
+
+	if (!order.remaining) {
+		gen_side_remove(gen_side(sym, order.side), order.price);
+		return;
+	}
+
+	order.time = gen->time + gen_lifetime(gen);
+
+	heap_push(gen, &order);
+}
+
+/*
+ * Generate the next event in time order.
+ */
+void gen_next(struct gen *gen, struct gen_event *event)
+{
+	if (gen->nr_orders && gen->orders[0].time <= gen->next_arrival)
+		gen_order_change(gen, event);
+	else
+		gen_arrival(gen, event);
+}
+
+#define GEN_BUFFER_SIZE		(1ULL << 20) /* 1 MB */
+
+void gen_output_open(struct gen_output *out, const char *filename, int level)
+{
+	*out = (struct gen_output) {
+		.filename	= filename,
+	};
+
+	if (!strcmp(filename, "-")) {
+		out->fd = STDOUT_FILENO;
+	} else {
+		out->fd = open(filename, O_WRONLY|O_CREAT|O_EXCL, 0644);
+		if (out->fd < 0)
+			error("%s: %s", filename, strerror(errno));
+	}
+
+	out->buf	= malloc(GEN_BUFFER_SIZE);
+	out->out_buf	= malloc(GEN_BUFFER_SIZE);
+	if (!out->buf || !out->out_buf)
+		error("out of memory");
+
+	/* 15 + 16 selects a gzip wrapper instead of zlib. */
+	if (deflateInit2(&out->zstream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		error("unable to initialize zlib");
+}
+
+static void gen_output_xwrite(struct gen_output *out, const char *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t nr;
+
+		nr = write(out->fd, buf, len);
+		if (nr < 0) {
+			if (errno == EINTR)
+				continue;
+
+			error("%s: %s", out->filename, strerror(errno));
+		}
+
+		buf += nr;
+		len -= nr;
+	}
+}
+
+static void gen_output_deflate(struct gen_output *out, int flush)
+{
+	z_stream *zstream = &out->zstream;
+	int ret;
+
+	zstream->next_in	= (void *) out->buf;
+	zstream->avail_in	= out->len;
+
+	do {
+		zstream->next_out	= (void *) out->out_buf;
+		zstream->avail_out	= GEN_BUFFER_SIZE;
+
+		ret = deflate(zstream, flush);
+		if (ret == Z_STREAM_ERROR)
+			error("%s: compression failed", out->filename);
+
+		gen_output_xwrite(out, out->out_buf, GEN_BUFFER_SIZE - zstream->avail_out);
+
+		out->bytes_out += GEN_BUFFER_SIZE - zstream->avail_out;
+	} while (zstream->avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+
+	out->len = 0;
+}
+
+void gen_output_write(struct gen_output *out, const void *data, size_t len)
+{
+	if (out->len + len > GEN_BUFFER_SIZE)
+		gen_output_deflate(out, Z_NO_FLUSH);
+
+	memcpy(out->buf + out->len, data, len);
+
+	out->len	+= len;
+	out->bytes_in	+= len;
+}
+
+void gen_output_close(struct gen_output *out)
+{
+	gen_output_deflate(out, Z_FINISH);
+
+	deflateEnd(&out->zstream);
+
+	if (out->fd != STDOUT_FILENO && close(out->fd) < 0)
+		error("%s: %s", out->filename, strerror(errno));
+
+	free(out->out_buf);
+	free(out->buf);
+}
+
+void gen_progress(uint64_t done, uint64_t total)
+{
+	fprintf(stderr, "Generating messages: %3u%%\r", (unsigned int) (done * 100 / total));
+
+	fflush(stderr);
+}
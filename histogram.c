@@ -0,0 +1,81 @@
+#include "tick/histogram.h"
+
+#include "tick/error.h"
+
+#include <stdlib.h>
+
+struct histogram *histogram_new(void)
+{
+	struct histogram *hist = calloc(1, sizeof(*hist));
+
+	if (!hist)
+		error("out of memory");
+
+	return hist;
+}
+
+void histogram_free(struct histogram *hist)
+{
+	free(hist);
+}
+
+void histogram_add(struct histogram *dst, const struct histogram *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < HISTOGRAM_NR_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+
+	dst->count += src->count;
+
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+/*
+ * The highest value that falls into a bucket.
+ */
+static uint64_t bucket_max(unsigned int bucket)
+{
+	unsigned int shift;
+
+	if (bucket < 2 * HISTOGRAM_SUB_BUCKETS)
+		return bucket;
+
+	shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+
+	return ((uint64_t) (bucket - (shift << HISTOGRAM_SUB_BITS) + 1) << shift) - 1;
+}
+
+/*
+ * Returns the value below or at which 'percentile' percent of the values
+ * fall, rounded up to the end of its bucket but never above the largest
+ * value recorded.
+ */
+uint64_t histogram_percentile(const struct histogram *hist, double percentile)
+{
+	uint64_t rank, seen = 0;
+	unsigned int i;
+	double exact;
+
+	if (!hist->count)
+		return 0;
+
+	exact = percentile / 100.0 * hist->count;
+
+	rank = (uint64_t) exact;
+	if (rank < exact || rank < 1)
+		rank++;
+
+	for (i = 0; i < HISTOGRAM_NR_BUCKETS; i++) {
+		seen += hist->buckets[i];
+
+		if (seen >= rank) {
+			uint64_t value = bucket_max(i);
+
+			return value < hist->max ? value : hist->max;
+		}
+	}
+
+	return hist->max;
+}
@@ -0,0 +1,60 @@
+#ifndef TICK_BARS_H
+#define TICK_BARS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bars
+ *
+ * Trades are aggregated into open/high/low/close/volume/VWAP bars per
+ * symbol and per time interval as they stream by.  State is kept for one
+ * interval at a time, indexed by symbol identifier, and the bars of an
+ * interval are written out when the first trade of a later interval
+ * arrives or the date changes.  Intervals without trades have no bar.
+ */
+
+#define BARS_DATE_LEN		16
+
+struct ob_event;
+struct taq_event;
+struct output;
+
+struct bar {
+	uint64_t		open;
+	uint64_t		high;
+	uint64_t		low;
+	uint64_t		close;
+	uint64_t		volume;
+	unsigned __int128	notional;	/* sum of price times quantity */
+	uint64_t		nr_trades;
+};
+
+struct bars {
+	struct output		*out;
+	uint64_t		interval;	/* nanoseconds */
+	uint64_t		start;		/* start of the current interval */
+	char			date[BARS_DATE_LEN];
+	size_t			date_len;
+
+	/* Bars of the current interval, indexed by symbol identifier: */
+	struct bar		*bars;
+	unsigned int		nr_bars;
+
+	/* Symbols that have a bar in the current interval, in order of their first trade: */
+	uint32_t		*active;
+	unsigned int		nr_active;
+};
+
+void bars_init(struct bars *bars, struct output *out, uint64_t interval);
+void bars_release(struct bars *bars);
+void bars_write_header(struct bars *bars);
+void bars_flush(struct bars *bars);
+void bars_trade(struct bars *bars, uint32_t symbol, uint64_t time, uint64_t price, uint64_t quantity);
+void bars_date(struct bars *bars, const char *date, size_t len);
+
+void bars_ob_event(void *data, struct ob_event *event);
+void bars_taq_event(void *data, struct taq_event *event);
+
+#endif
@@ -1,11 +1,20 @@
 #ifndef TICK_BASE36_H
 #define TICK_BASE36_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+
+#if defined(__SSSE3__) && defined(__x86_64__)
+#include <tmmintrin.h>
+#endif
 
 #define BASE36_DIGIT(ch) ((ch) - '0')
 
+/* Length of PITCH order and execution IDs: */
+#define BASE36_ID_LEN	12
+
 extern unsigned char base36_table[];
 
 static inline unsigned long base36_pos(unsigned char ch)
@@ -29,4 +38,205 @@ static inline uint64_t base36_decode(const char *s, size_t len)
 	return ret;
 }
 
+/*
+ * Fixed-width decoding of 12-character IDs
+ *
+ * base36_decode() carries a multiply-add from one character to the next.
+ * The decoders below convert all characters at once and combine them
+ * pairwise: pairs of digits into 16-bit lanes, pairs of those into 32-bit
+ * lanes and those into the 64-bit value, so the dependency chain is three
+ * steps long instead of twelve.  With SSSE3 (e.g. when built with
+ * CFLAGS_OPTIMIZE="-O3 -march=native") the characters are mapped to digits
+ * with a shuffle and combined with multiply-adds in SSE registers; other
+ * builds do the same in 64-bit general purpose registers.
+ *
+ * The unchecked variant expects upper case base 36 characters and returns
+ * a meaningless value for anything else.  The checked variant validates
+ * the characters first.
+ */
+
+#define BASE36_ONES		0x0101010101010101ULL
+
+#if defined(__SSSE3__) && defined(__x86_64__)
+
+/*
+ * Loads the 12 characters into the low bytes of a register without
+ * reading past the end of the ID.
+ */
+static inline __m128i base36_load_id(const char *s)
+{
+	uint32_t tail;
+
+	memcpy(&tail, s + 8, sizeof(tail));
+
+	return _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *) s), _mm_cvtsi32_si128(tail));
+}
+
+static inline uint64_t base36_reduce_id(__m128i chars)
+{
+	/* Subtract '0' from digits and 'A' - 10 from letters, by high nibble: */
+	const __m128i offsets = _mm_setr_epi8(0, 0, 0, -'0', -'A' + 10, -'A' + 10, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	__m128i nibbles, digits, pairs, quads;
+	uint64_t lo;
+	uint32_t hi;
+
+	nibbles	= _mm_and_si128(_mm_srli_epi16(chars, 4), _mm_set1_epi8(0x0f));
+	digits	= _mm_add_epi8(chars, _mm_shuffle_epi8(offsets, nibbles));
+
+	pairs	= _mm_maddubs_epi16(digits, _mm_set1_epi16(1 << 8 | 36));
+	quads	= _mm_madd_epi16(pairs, _mm_set1_epi32(1 << 16 | 36 * 36));
+
+	lo	= _mm_cvtsi128_si64(quads);
+	hi	= _mm_cvtsi128_si32(_mm_srli_si128(quads, 8));
+
+	return ((lo & 0xffffffff) * 1679616 + (lo >> 32)) * 1679616 + hi;
+}
+
+static inline bool base36_valid_id(__m128i chars)
+{
+	__m128i digit, letter, valid;
+
+	digit	= _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+	digit	= _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+
+	letter	= _mm_sub_epi8(chars, _mm_set1_epi8('A'));
+	letter	= _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(25)), letter);
+
+	valid	= _mm_or_si128(digit, letter);
+
+	return (_mm_movemask_epi8(valid) & 0xfff) == 0xfff;
+}
+
+static inline uint64_t base36_decode_id(const char *s)
+{
+	return base36_reduce_id(base36_load_id(s));
+}
+
+static inline bool base36_decode_id_checked(const char *s, uint64_t *value)
+{
+	__m128i chars = base36_load_id(s);
+
+	if (!base36_valid_id(chars))
+		return false;
+
+	*value = base36_reduce_id(chars);
+
+	return true;
+}
+
+#elif __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+/*
+ * Decodes eight characters that are loaded into a word, the first one in
+ * the lowest byte.
+ */
+static inline uint64_t base36_reduce_word(uint64_t x)
+{
+	x -= BASE36_ONES * '0';
+
+	/* Letters are now 17 to 42; take them down to 10 to 35: */
+	x -= ((x + BASE36_ONES * (0x80 - 10)) >> 7 & BASE36_ONES) * ('A' - '0' - 10);
+
+	x = (x & 0x00ff00ff00ff00ffULL) * 36 + (x >> 8 & 0x00ff00ff00ff00ffULL);
+	x = (x & 0x0000ffff0000ffffULL) * (36 * 36) + (x >> 16 & 0x0000ffff0000ffffULL);
+
+	return (x & 0xffffffff) * 1679616 + (x >> 32);
+}
+
+/*
+ * True if every byte of the word is a digit or an upper case letter.  A
+ * byte is checked against both ranges without carries into its neighbours
+ * by working on its low seven bits and testing the top bit separately.
+ */
+static inline bool base36_valid_word(uint64_t x)
+{
+	uint64_t low = x & BASE36_ONES * 0x7f, digit, letter;
+
+	digit	= (BASE36_ONES * (0x7f + '9' + 1) - low) & ~x & (low + BASE36_ONES * (0x7f - '0' + 1));
+	letter	= (BASE36_ONES * (0x7f + 'Z' + 1) - low) & ~x & (low + BASE36_ONES * (0x7f - 'A' + 1));
+
+	return ((digit | letter) & BASE36_ONES * 0x80) == BASE36_ONES * 0x80;
+}
+
+/*
+ * Loads the first eight characters into 'head' and the last four, behind
+ * four '0' characters, into 'tail'.
+ */
+static inline void base36_load_id(const char *s, uint64_t *head, uint64_t *tail)
+{
+	uint32_t last;
+
+	memcpy(head, s, sizeof(*head));
+	memcpy(&last, s + 8, sizeof(last));
+
+	*tail = (uint64_t) last << 32 | BASE36_ONES * '0' >> 32;
+}
+
+static inline uint64_t base36_decode_id(const char *s)
+{
+	uint64_t head, tail;
+
+	base36_load_id(s, &head, &tail);
+
+	return base36_reduce_word(head) * 1679616 + base36_reduce_word(tail);
+}
+
+static inline bool base36_decode_id_checked(const char *s, uint64_t *value)
+{
+	uint64_t head, tail;
+
+	base36_load_id(s, &head, &tail);
+
+	if (!base36_valid_word(head) || !base36_valid_word(tail))
+		return false;
+
+	*value = base36_reduce_word(head) * 1679616 + base36_reduce_word(tail);
+
+	return true;
+}
+
+#else
+
+static inline uint64_t base36_decode_id(const char *s)
+{
+	return base36_decode(s, BASE36_ID_LEN);
+}
+
+static inline bool base36_decode_id_checked(const char *s, uint64_t *value)
+{
+	unsigned int i;
+
+	for (i = 0; i < BASE36_ID_LEN; i++) {
+		char ch = s[i];
+
+		if ((ch < '0' || ch > '9') && (ch < 'A' || ch > 'Z'))
+			return false;
+	}
+
+	*value = base36_decode(s, BASE36_ID_LEN);
+
+	return true;
+}
+
+#endif
+
+size_t base36_decode_ids(const char *s, size_t stride, size_t nr, uint64_t *values);
+
+static inline size_t base36_encode(char *buf, uint64_t value)
+{
+	static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	char tmp[13];
+	size_t len = 0;
+
+	do {
+		tmp[sizeof(tmp) - ++len] = digits[value % 36];
+
+		value /= 36;
+	} while (value);
+
+	memcpy(buf, tmp + sizeof(tmp) - len, len);
+
+	return len;
+}
+
 #endif
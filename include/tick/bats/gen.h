@@ -0,0 +1,11 @@
+#ifndef TICK_BATS_GEN_H
+#define TICK_BATS_GEN_H
+
+#include <stdint.h>
+
+struct gen_output;
+struct gen;
+
+void bats_pitch_gen(struct gen *gen, struct gen_output *out, uint64_t nr_messages);
+
+#endif
@@ -1,26 +1,35 @@
 #ifndef TICK_BATS_PITCH112_H
 #define TICK_BATS_PITCH112_H
 
+#include "tick/base10.h"
+#include "tick/symbol.h"
+
 #include <stdbool.h>
 #include <stdint.h>
 #include <glib.h>
 #include <zlib.h>
 
 struct pitch_message;
+struct ob_writer;
+struct taq_writer;
 struct stream;
 
-#define PITCH_PRICE_INT_LEN		6
-#define PITCH_PRICE_FRACTION_LEN	4
+#define PITCH_TIMESTAMP_LEN		8
 
+/*
+ * Without a symbol, the filter selects every symbol.
+ */
 struct pitch_filter {
 	char			symbol[6];
+	bool			all;
 };
 
 struct pitch_session {
 	struct pitch_filter	filter;
 	z_stream		*zstream;
 	int			in_fd;
-	int			out_fd;
+	struct ob_writer	*ob_writer;
+	struct taq_writer	*taq_writer;
 	const char		*input_filename;
 	const char		*date;
 	unsigned long		date_len;
@@ -30,21 +39,45 @@ struct pitch_session {
 	unsigned long		time_zone_len;
 	const char		*symbol;
 	unsigned long		symbol_len;
+	uint32_t		symbol_id;
+	struct symbol_cache	symbol_cache;
 	GHashTable		*order_hash;
 	GHashTable		*exec_hash;
 };
 
 struct pitch_exec_info {
 	uint64_t		exec_id;
-	const char		*symbol;
+	uint32_t		symbol;
 };
 
 struct pitch_order_info {
 	uint64_t		order_id;
+	uint64_t		time;
 	uint32_t		remaining;
-	char			price[10];
+	uint32_t		symbol;
+	uint64_t		price;
+	char			side;
 };
 
+/*
+ * PITCH timestamps are milliseconds since midnight.
+ */
+static inline uint64_t pitch_timestamp(const char *timestamp)
+{
+	return base10_decode(timestamp, PITCH_TIMESTAMP_LEN) * 1000000ULL;
+}
+
+/*
+ * Symbol identifier of a message's StockSymbol field.
+ */
+static inline uint32_t pitch_session_symbol(struct pitch_session *session, const char *symbol, size_t len)
+{
+	if (!session->filter.all)
+		return session->symbol_id;
+
+	return symbol_cache_intern_padded(&session->symbol_cache, symbol, len);
+}
+
 int bats_pitch_read(struct stream *stream, struct pitch_message **msg_p);
 int pitch_file_parse_date(const char *filename, char *buf, size_t buf_len);
 void pitch_filter_init(struct pitch_filter *filter, const char *symbol);
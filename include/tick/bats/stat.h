@@ -6,6 +6,7 @@
 struct stats;
 
 void bats_pitch_print_stats(struct stats *stats);
+void bats_pitch_print_symbol_stats(struct stats *stats, unsigned int top);
 void bats_pitch_stat(struct stats *stats, int fd, z_stream *zstream);
 
 #endif
@@ -1,7 +1,16 @@
 #ifndef TICK_BUILTINS_H
 #define TICK_BUILTINS_H
 
+int cmd_bars(int argc, char *argv[]);
+int cmd_batch(int argc, char *argv[]);
+int cmd_bench(int argc, char *argv[]);
+int cmd_cat(int argc, char *argv[]);
+int cmd_gen(int argc, char *argv[]);
+int cmd_index(int argc, char *argv[]);
+int cmd_merge(int argc, char *argv[]);
+int cmd_metrics(int argc, char *argv[]);
 int cmd_ob(int argc, char *argv[]);
+int cmd_slice(int argc, char *argv[]);
 int cmd_stat(int argc, char *argv[]);
 int cmd_taq(int argc, char *argv[]);
 
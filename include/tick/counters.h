@@ -0,0 +1,59 @@
+#ifndef TICK_COUNTERS_H
+#define TICK_COUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Hardware performance counters
+ *
+ * The counters are opened as one perf_event_open(2) group so that they
+ * are scheduled onto the PMU together, and they count user space only.
+ * Where the kernel allows it, they are read with the rdpmc instruction
+ * through the mmap'd event page, which is cheap enough to do on every
+ * profiling stage change; otherwise the whole group is read with one
+ * read(2).
+ *
+ * Counters that the CPU or the kernel does not support are left out and
+ * read as zero.
+ */
+
+enum counter_id {
+	COUNTER_CYCLES,
+	COUNTER_INSTRUCTIONS,
+	COUNTER_CACHE_REFERENCES,
+	COUNTER_CACHE_MISSES,
+	COUNTER_BRANCHES,
+	COUNTER_BRANCH_MISSES,
+
+	NR_COUNTERS,
+};
+
+extern const char *counter_names[];
+
+struct counter {
+	int			fd;
+	void			*page;		/* struct perf_event_mmap_page */
+};
+
+struct counters {
+	struct counter		counters[NR_COUNTERS];
+	unsigned int		nr_open;
+	int			group_fd;
+	bool			rdpmc;
+
+	/* Position of each open counter in a group read: */
+	unsigned int		slots[NR_COUNTERS];
+};
+
+int counters_open(struct counters *counters);
+void counters_close(struct counters *counters);
+void counters_read(struct counters *counters, uint64_t *values);
+const char *counters_strerror(int err);
+
+static inline bool counter_is_open(struct counters *counters, enum counter_id id)
+{
+	return counters->counters[id].fd >= 0;
+}
+
+#endif
@@ -1,68 +1,87 @@
 #ifndef TICK_DSV_H
 #define TICK_DSV_H
 
-#include "decimal.h"
-#include "error.h"
-
-#include "time.h"
+#include "base10.h"
+#include "base36.h"
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+/*
+ * Fixed-point prices have four decimal digits.
+ */
+#define DSV_PRICE_SCALE		10000
+
+/*
+ * Upper bounds for the output of the formatters, including the delimiter.
+ * Writers add these up to reserve output space for a row.
+ */
+#define DSV_CHAR_MAX_LEN	2
+#define DSV_UINT_MAX_LEN	21
+#define DSV_BASE36_MAX_LEN	14
+#define DSV_PRICE_MAX_LEN	(DSV_UINT_MAX_LEN + 5)
+
+static inline size_t dsv_fmt_null(char *buf, char delim)
+{
+	buf[0] = delim;
+
+	return 1;
+}
+
 static inline size_t dsv_fmt_char(char *buf, unsigned char c, char delim)
 {
 	size_t ret = 0;
 
-	buf[ret++] = c;
+	if (c)
+		buf[ret++] = c;
+
 	buf[ret++] = delim;
 
 	return ret;
 }
 
-static inline size_t dsv_fmt_decimal(char *buf, struct decimal *decimal, char delim)
+static inline size_t dsv_fmt_uint(char *buf, uint64_t value, char delim)
 {
-	size_t ret = 0;
+	char tmp[20];
+	size_t len = 0;
 
-	if (decimal->integer) {
-		memcpy(buf, decimal->integer, decimal->integer_len);
+	do {
+		tmp[sizeof(tmp) - ++len] = '0' + value % 10;
 
-		ret += decimal->integer_len;
+		value /= 10;
+	} while (value);
 
-		buf[ret++] = '.';
+	memcpy(buf, tmp + sizeof(tmp) - len, len);
 
-		memcpy(buf + ret, decimal->fraction, decimal->fraction_len);
+	buf[len++] = delim;
 
-		ret += decimal->fraction_len;
-	}
+	return len;
+}
+
+static inline size_t dsv_fmt_base36(char *buf, uint64_t value, char delim)
+{
+	size_t ret;
+
+	ret = base36_encode(buf, value);
 
 	buf[ret++] = delim;
 
 	return ret;
 }
 
-static inline size_t dsv_fmt_time(char *buf, struct time *time, char delim)
+static inline size_t dsv_fmt_price(char *buf, uint64_t value, char delim)
 {
-	size_t ret = 0;
-
-	if (time->value) {
-		memcpy(buf, time->value, time->value_len);
-
-		ret += time->value_len;
+	unsigned int fraction = value % DSV_PRICE_SCALE;
+	size_t ret;
 
-		switch (time->unit) {
-		case TIME_UNIT_MILLISECONDS:
-			memset(buf + ret, '0', 6);
+	ret = dsv_fmt_uint(buf, value / DSV_PRICE_SCALE, '.');
 
-			ret += 6;
-
-			break;
-		case TIME_UNIT_NANOSECONDS:
-			break;
-		default:
-			error("%s: unknown time unit: %d", time->unit);
-			break;
-		}
-	}
+	buf[ret++] = '0' + fraction / 1000;
+	buf[ret++] = '0' + fraction / 100 % 10;
+	buf[ret++] = '0' + fraction / 10 % 10;
+	buf[ret++] = '0' + fraction % 10;
 
 	buf[ret++] = delim;
 
@@ -84,6 +103,88 @@ static inline size_t dsv_fmt_value(char *buf, const char *value, size_t len, cha
 	return ret;
 }
 
-void dsv_write_header(int fd, const char *columns[], size_t num_columns, char delim);
+/*
+ * Parse up to eight decimal digits at once.  The digits are loaded into a
+ * little-endian word and combined pairwise, then in fours, then in eights.
+ * This reads eight bytes from 's' regardless of 'len', which is fine for
+ * fields of the TSV reader because its buffer is padded.
+ */
+static inline uint64_t dsv_parse_8digits(const char *s, size_t len)
+{
+	uint64_t v;
+
+	memcpy(&v, s, sizeof(v));
+
+	v -= 0x3030303030303030ULL;
+
+	/* Shift out what follows the digits; leading zeros shift in: */
+	v <<= 8 * (8 - len);
+
+	v = (v * 10) + (v >> 8);
+	v = (((v & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32))) +
+	     (((v >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32)))) >> 32;
+
+	return v;
+}
+
+static inline uint64_t dsv_parse_uint(const char *s, size_t len)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	if (len <= 8)
+		return len ? dsv_parse_8digits(s, len) : 0;
+
+	if (len <= 16)
+		return dsv_parse_8digits(s, len - 8) * 100000000ULL + dsv_parse_8digits(s + len - 8, 8);
+#endif
+	return base10_decode(s, len);
+}
+
+static inline uint64_t dsv_parse_base36(const char *s, size_t len)
+{
+	return base36_decode(s, len);
+}
+
+static inline uint64_t dsv_parse_price(const char *s, size_t len)
+{
+	static const unsigned int scales[] = { 10000, 1000, 100, 10, 1 };
+	const char *dot;
+	size_t frac_len;
+	uint64_t ret;
+
+	dot = memchr(s, '.', len);
+	if (!dot)
+		return dsv_parse_uint(s, len) * DSV_PRICE_SCALE;
+
+	ret = dsv_parse_uint(s, dot - s) * DSV_PRICE_SCALE;
+
+	frac_len = len - (dot - s) - 1;
+	if (frac_len > 4)
+		frac_len = 4;
+
+	return ret + dsv_parse_uint(dot + 1, frac_len) * scales[frac_len];
+}
+
+/*
+ * Event types are upper-case letters, so a set of them fits in a 32-bit mask.
+ */
+static inline uint32_t dsv_event_bit(char type)
+{
+	return 1U << (type - 'A');
+}
+
+/*
+ * Rows read back from a file without an Event column have no type and are
+ * always selected.
+ */
+static inline bool dsv_event_selected(uint32_t events, char type)
+{
+	return !type || events & dsv_event_bit(type);
+}
+
+struct output;
+
+void dsv_write_header(struct output *out, const char *columns[], size_t num_columns, char delim);
+unsigned int dsv_parse_columns(const char *list, const char *columns[], size_t nr_columns, unsigned int *indices);
+uint32_t dsv_parse_events(const char *list, const char *types);
 
 #endif
@@ -2,5 +2,6 @@
 #define TICK_ERROR_H
 
 void error(const char *fmt, ...);
+void warning(const char *fmt, ...);
 
 #endif
@@ -0,0 +1,160 @@
+#ifndef TICK_GEN_H
+#define TICK_GEN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+/*
+ * Synthetic order flow
+ *
+ * A deterministic, seeded model of a market's order flow that the feed
+ * generators turn into ITCH, PITCH and TAQ messages:
+ *
+ *   - symbol activity follows a Zipf distribution
+ *   - orders arrive as a Poisson process whose rate follows the U-shaped
+ *     intraday profile and switches between calm and bursty regimes
+ *   - order lifetimes are a mixture of fleeting, short and long-lived
+ *     orders, and an order ends in an execution, a cancel or a replace,
+ *     possibly after partial executions and cancels
+ *   - orders rest around a mid price that follows the executions, but
+ *     never at or through the other side of the book
+ *
+ * Orders are kept in a heap ordered by the time they next change, so that
+ * events come out in time order and memory is bounded by the number of
+ * live orders rather than by the length of the feed.
+ */
+
+#define GEN_SYMBOL_LEN		4
+#define GEN_MAX_SYMBOLS		(26 * 26 * 26 * 26)
+#define GEN_SESSION_START	(34200ULL * 1000000000ULL)	/* 09:30 */
+#define GEN_SESSION_LEN		(23400ULL * 1000000000ULL)	/* 6.5 hours */
+#define GEN_TICK		100				/* $0.01 */
+
+struct gen_options {
+	uint64_t		seed;
+	unsigned int		nr_symbols;
+	uint64_t		nr_events;	/* expected over the session */
+};
+
+struct gen_level {
+	uint64_t		price;
+	uint32_t		nr_orders;
+};
+
+/*
+ * Price levels of the live orders on one side of a book, lowest price
+ * first.
+ */
+struct gen_side {
+	struct gen_level	*levels;
+	unsigned int		nr_levels;
+	unsigned int		capacity;
+};
+
+struct gen_symbol {
+	char			name[GEN_SYMBOL_LEN + 1];
+	uint64_t		price;		/* mid price */
+	struct gen_side		bids;
+	struct gen_side		asks;
+};
+
+struct gen_order {
+	uint64_t		time;		/* time of the next change */
+	uint64_t		order_id;
+	uint64_t		price;
+	uint32_t		remaining;
+	uint32_t		symbol;
+	char			side;
+};
+
+enum gen_event_type {
+	GEN_EVENT_ADD,
+	GEN_EVENT_EXECUTE,
+	GEN_EVENT_CANCEL,		/* partial cancel */
+	GEN_EVENT_DELETE,
+	GEN_EVENT_REPLACE,
+	GEN_EVENT_TRADE,		/* non-displayed order */
+};
+
+struct gen_event {
+	enum gen_event_type	type;
+	uint64_t		time;
+	uint32_t		symbol;
+	uint64_t		order_id;
+	uint64_t		exec_id;	/* GEN_EVENT_EXECUTE, GEN_EVENT_TRADE */
+	char			side;
+	uint32_t		quantity;
+	uint64_t		price;
+
+	/* The order that replaces the original one in GEN_EVENT_REPLACE: */
+	uint64_t		new_order_id;
+	uint32_t		new_quantity;
+	uint64_t		new_price;
+};
+
+struct gen {
+	uint64_t		rng;
+	uint64_t		time;
+
+	struct gen_symbol	*symbols;
+	double			*weights;	/* cumulative Zipf weights */
+	unsigned int		nr_symbols;
+
+	/* Order arrivals: */
+	double			rate;		/* mean arrivals per nanosecond */
+	uint64_t		next_arrival;
+	uint64_t		regime_end;
+	bool			burst;
+
+	/* Live orders, a min-heap by time: */
+	struct gen_order	*orders;
+	size_t			nr_orders;
+	size_t			orders_capacity;
+
+	uint64_t		next_order_id;
+	uint64_t		next_exec_id;
+};
+
+void gen_init(struct gen *gen, const struct gen_options *opts);
+void gen_release(struct gen *gen);
+void gen_next(struct gen *gen, struct gen_event *event);
+uint64_t gen_random(struct gen *gen);
+double gen_uniform(struct gen *gen);
+
+/*
+ * Single-stream gzip output of the generated files.
+ */
+struct gen_output {
+	const char		*filename;
+	int			fd;
+	z_stream		zstream;
+	char			*buf;
+	size_t			len;
+	char			*out_buf;
+	uint64_t		bytes_in;
+	uint64_t		bytes_out;
+};
+
+void gen_output_open(struct gen_output *out, const char *filename, int level);
+void gen_output_write(struct gen_output *out, const void *data, size_t len);
+void gen_output_close(struct gen_output *out);
+
+void gen_progress(uint64_t done, uint64_t total);
+
+#define GEN_PROGRESS_STEP	(1ULL << 16)
+
+/*
+ * Format a zero-padded decimal field.
+ */
+static inline void gen_digits(char *buf, size_t len, uint64_t value)
+{
+	while (len--) {
+		buf[len] = '0' + value % 10;
+
+		value /= 10;
+	}
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef TICK_HISTOGRAM_H
+#define TICK_HISTOGRAM_H
+
+#include <stdint.h>
+
+/*
+ * Log-bucketed histogram
+ *
+ * Values are bucketed like in an HDR histogram: every power of two is split
+ * into HISTOGRAM_SUB_BUCKETS linear buckets, so a bucket is never wider than
+ * 1/32 of the values in it and values below 64 are counted exactly.  Finding
+ * the bucket of a value takes a count of leading zeros and a shift, which
+ * keeps recording cheap enough to do for every message.
+ */
+
+#define HISTOGRAM_SUB_BITS	5
+#define HISTOGRAM_SUB_BUCKETS	(1U << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_NR_BUCKETS	((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+struct histogram {
+	uint64_t		count;
+	uint64_t		max;
+	uint64_t		buckets[HISTOGRAM_NR_BUCKETS];
+};
+
+static inline unsigned int histogram_bucket(uint64_t value)
+{
+	unsigned int shift = 63 - __builtin_clzll(value | HISTOGRAM_SUB_BUCKETS) - HISTOGRAM_SUB_BITS;
+
+	return (shift << HISTOGRAM_SUB_BITS) + (value >> shift);
+}
+
+static inline void histogram_record_count(struct histogram *hist, uint64_t value, uint64_t count)
+{
+	hist->buckets[histogram_bucket(value)] += count;
+	hist->count += count;
+
+	if (value > hist->max)
+		hist->max = value;
+}
+
+static inline void histogram_record(struct histogram *hist, uint64_t value)
+{
+	histogram_record_count(hist, value, 1);
+}
+
+struct histogram *histogram_new(void);
+void histogram_free(struct histogram *hist);
+void histogram_add(struct histogram *dst, const struct histogram *src);
+uint64_t histogram_percentile(const struct histogram *hist, double percentile);
+
+#endif
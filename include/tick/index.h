@@ -0,0 +1,76 @@
+#ifndef TICK_INDEX_H
+#define TICK_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Index sidecar
+ *
+ * An index samples every Nth timed row of an uncompressed OB or TAQ file
+ * and records the row's byte offset and time.  Rows between two samples
+ * are known to lie between the samples' times, so a time window maps to a
+ * byte range of the file without reading the rows before it.
+ *
+ * The rows from one sample up to the next form a block, and each entry
+ * also records the set of symbols of its block.  Blocks without rows of a
+ * symbol can then be skipped when slicing by symbol.  Rows without a
+ * symbol are in the set as INDEX_SYMBOL_NONE.
+ *
+ * The sidecar is "<file>.idx".  It starts with a header, followed by the
+ * symbol names that the sets refer to, the entries and the symbol sets.
+ * The file size is recorded so that an index that is out of date can be
+ * detected.
+ */
+
+#define INDEX_MAGIC		"TICKIDX3"
+#define INDEX_DEFAULT_STRIDE	1024
+#define INDEX_SYMBOL_NONE	UINT32_MAX
+
+struct index_header {
+	char			magic[8];
+	uint32_t		stride;
+	uint32_t		nr_symbols;
+	uint64_t		nr_entries;
+	uint64_t		nr_block_symbols;
+	uint64_t		file_size;
+	uint64_t		data_offset;	/* first timed row */
+};
+
+struct index_entry {
+	uint64_t		offset;
+	uint64_t		time;		/* nanoseconds since midnight */
+	uint64_t		symbols;	/* first symbol of the block's set */
+	uint32_t		nr_symbols;
+	uint32_t		reserved;
+};
+
+struct index {
+	uint32_t		stride;
+	uint64_t		file_size;
+	uint64_t		data_offset;
+	struct index_entry	*entries;
+	uint64_t		nr_entries;
+	uint64_t		capacity;
+
+	/* Symbol sets of the blocks, one after the other: */
+	uint32_t		*block_symbols;
+	uint64_t		nr_block_symbols;
+	uint64_t		block_symbols_capacity;
+
+	/* Number of the last block a symbol was added to, plus one: */
+	uint64_t		*symbol_seen;
+	uint64_t		none_seen;
+	unsigned int		nr_symbol_seen;
+};
+
+char *index_filename(const char *filename);
+void index_init(struct index *index, uint32_t stride);
+void index_release(struct index *index);
+void index_add(struct index *index, uint64_t offset, uint64_t time);
+void index_add_symbol(struct index *index, uint32_t symbol);
+bool index_block_has_symbol(struct index *index, uint64_t entry, uint32_t symbol);
+void index_write(struct index *index, const char *filename);
+void index_read(struct index *index, const char *filename);
+
+#endif
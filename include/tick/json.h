@@ -0,0 +1,45 @@
+#ifndef TICK_JSON_H
+#define TICK_JSON_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * JSON
+ *
+ * Just enough JSON to write result files and to read them back: values are
+ * parsed into a tree that is walked with json_get() and json_number().
+ */
+
+enum json_type {
+	JSON_NULL,
+	JSON_FALSE,
+	JSON_TRUE,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT,
+};
+
+struct json_value {
+	enum json_type		type;
+	double			number;
+	char			*string;
+
+	/* Elements of an array or members of an object: */
+	struct json_value	*elements;
+	char			**keys;
+	unsigned int		nr_elements;
+};
+
+struct json_value *json_parse(const char *text, size_t len);
+struct json_value *json_read(const char *filename);
+void json_free(struct json_value *value);
+
+const struct json_value *json_get(const struct json_value *object, const char *key);
+double json_number(const struct json_value *object, const char *key, double def);
+const char *json_string(const struct json_value *object, const char *key);
+
+void json_print_string(FILE *file, const char *s);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef TICK_MEMORY_H
+#define TICK_MEMORY_H
+
+#include <glib.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Memory accounting
+ *
+ * Accounts for the memory of tick's own data structures: the order and
+ * execution tables and the input and output buffers.  The tables are
+ * sampled whenever the input buffer is refilled, so a peak can miss what
+ * comes and goes within one buffer of input.  The size of a table is an
+ * estimate made up of its entries, the allocator's overhead per entry and
+ * GLib's bucket arrays.
+ *
+ * The mapped input file is reported but not accounted for: its pages
+ * belong to the page cache and can be reclaimed.
+ *
+ * With a budget, the run is aborted as soon as the accounted memory
+ * exceeds it.
+ */
+
+enum memory_table {
+	MEMORY_TABLE_ORDERS,
+	MEMORY_TABLE_EXECS,
+
+	MEMORY_NR_TABLES,
+};
+
+struct memory_table_stats {
+	GHashTable		*table;
+	size_t			entry_size;
+	uint64_t		live;
+	uint64_t		peak;
+	uint64_t		bytes;
+	uint64_t		peak_bytes;
+};
+
+struct output;
+
+struct memory {
+	bool			enabled;
+	const char		*filename;
+	uint64_t		budget;
+
+	struct memory_table_stats tables[MEMORY_NR_TABLES];
+
+	uint64_t		input_mapped;
+	uint64_t		input_buffer;
+	struct output		*output;
+	uint64_t		output_bytes;
+
+	uint64_t		total;
+	uint64_t		peak_total;
+};
+
+extern struct memory memory;
+
+void memory_start(const char *filename, uint64_t budget);
+void memory_track_table(enum memory_table id, GHashTable *table, size_t entry_size);
+void memory_untrack_table(enum memory_table id);
+void memory_sample(uint64_t input_mapped, uint64_t input_buffer);
+void memory_untrack_output(void);
+void print_memory(void);
+
+static inline void memory_track_output(struct output *out)
+{
+	memory.output = out;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef TICK_METRICS_H
+#define TICK_METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Microstructure metrics
+ *
+ * The price levels of the order book are rebuilt per symbol from the OB
+ * events of a converter, which carry the state of the order they apply to
+ * from the converter's order table, and metrics are accumulated per symbol
+ * and per time interval as the events stream by:
+ *
+ *   - time-weighted average quoted spread and top-of-book depth imbalance
+ *   - add, cancel, execution and trade counts and order-to-trade ratio
+ *   - cancel rate: orders canceled over the orders on the book during the
+ *     interval, that is, the orders open at its start and the orders added
+ *   - distribution of the lifetimes of orders that left the book
+ *
+ * A symbol's metrics for an interval are written out when the first event
+ * of a later interval arrives or the date changes.  Only the symbols that
+ * have events in an interval get a row for it.
+ */
+
+#define METRICS_DATE_LEN		16
+#define METRICS_LIFETIME_BUCKETS	64
+
+struct ob_event;
+struct output;
+
+struct metrics_level {
+	uint64_t		price;
+	uint64_t		quantity;
+};
+
+/*
+ * Price levels of one side of the book, best price last so that the busy
+ * end of the book is cheap to insert into and remove from.
+ */
+struct metrics_side {
+	struct metrics_level	*levels;
+	unsigned int		nr_levels;
+	unsigned int		capacity;
+	bool			descending;
+};
+
+struct metrics_symbol {
+	struct metrics_side	bids;
+	struct metrics_side	asks;
+	uint64_t		last_time;
+	uint64_t		nr_open;	/* orders on the book */
+	bool			active;
+
+	/* Accumulated over the current interval: */
+	double			spread_sum;	/* spread times nanoseconds */
+	double			imbalance_sum;	/* imbalance times nanoseconds */
+	uint64_t		quoted_time;	/* nanoseconds with a two-sided book */
+	uint64_t		nr_open_start;	/* orders on the book at the start */
+	uint64_t		nr_adds;
+	uint64_t		nr_cancels;
+	uint64_t		nr_canceled;	/* orders that a cancel removed */
+	uint64_t		nr_executions;
+	uint64_t		nr_trades;
+	uint64_t		nr_lifetimes;
+	uint64_t		lifetimes[METRICS_LIFETIME_BUCKETS];	/* log2 histogram */
+};
+
+struct metrics {
+	struct output		*out;
+	uint64_t		interval;	/* nanoseconds */
+	uint64_t		start;		/* start of the current interval */
+	char			date[METRICS_DATE_LEN];
+	size_t			date_len;
+
+	/* Per-symbol state, indexed by symbol identifier: */
+	struct metrics_symbol	*symbols;
+	unsigned int		nr_symbols;
+
+	/* Symbols that have events in the current interval: */
+	uint32_t		*active;
+	unsigned int		nr_active;
+};
+
+void metrics_init(struct metrics *metrics, struct output *out, uint64_t interval);
+void metrics_release(struct metrics *metrics);
+void metrics_write_header(struct metrics *metrics);
+void metrics_flush(struct metrics *metrics);
+void metrics_ob_event(void *data, struct ob_event *event);
+
+#endif
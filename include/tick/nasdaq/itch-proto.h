@@ -1,23 +1,30 @@
 #ifndef TICK_NASDAQ_ITCH41_H
 #define TICK_NASDAQ_ITCH41_H
 
+#include "tick/symbol.h"
+
 #include <stdbool.h>
 #include <stdint.h>
 #include <glib.h>
 #include <zlib.h>
 
 struct itch41_message;
+struct ob_writer;
 struct stream;
 
+/*
+ * Without a symbol, the filter selects every symbol.
+ */
 struct nasdaq_itch_filter {
 	char			symbol[8];
+	bool			all;
 };
 
 struct nasdaq_itch_session {
 	struct nasdaq_itch_filter	filter;
 	z_stream			*zstream;
 	int				in_fd;
-	int				out_fd;
+	struct ob_writer		*ob_writer;
 	const char			*input_filename;
 	const char			*date;
 	unsigned long			date_len;
@@ -27,6 +34,8 @@ struct nasdaq_itch_session {
 	unsigned long			time_zone_len;
 	const char			*symbol;
 	unsigned long			symbol_len;
+	uint32_t			symbol_id;
+	struct symbol_cache		symbol_cache;
 	unsigned long			second;
 	GHashTable			*order_hash;
 	GHashTable			*exec_hash;
@@ -34,16 +43,29 @@ struct nasdaq_itch_session {
 
 struct nasdaq_itch_exec_info {
 	uint64_t		exec_id;
-	const char		*symbol;
+	uint32_t		symbol;
 };
 
 struct nasdaq_itch_order_info {
 	uint64_t		order_ref_num;
+	uint64_t		time;
 	uint32_t		remaining;
 	uint32_t		price;
+	uint32_t		symbol;
 	char			side;
 };
 
+/*
+ * Symbol identifier of a message's Stock field.
+ */
+static inline uint32_t nasdaq_itch_session_symbol(struct nasdaq_itch_session *session, const char *stock)
+{
+	if (!session->filter.all)
+		return session->symbol_id;
+
+	return symbol_cache_intern_padded(&session->symbol_cache, stock, sizeof(session->filter.symbol));
+}
+
 int nasdaq_itch_read(struct stream *stream, struct itch41_message **msg_p);
 int nasdaq_itch_file_parse_date(const char *filename, char *buf, size_t buf_len);
 void nasdaq_itch_filter_init(struct nasdaq_itch_filter *filter, const char *symbol);
@@ -6,6 +6,7 @@
 struct stats;
 
 void nasdaq_itch_print_stats(struct stats *stats);
+void nasdaq_itch_print_symbol_stats(struct stats *stats, unsigned int top);
 void nasdaq_itch_stat(struct stats *stats, int fd, z_stream *zstream);
 
 #endif
@@ -0,0 +1,17 @@
+#ifndef TICK_NYSE_GEN_H
+#define TICK_NYSE_GEN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct gen_output;
+struct gen;
+
+/*
+ * NYSE TAQ daily files carry either quotes or trades.  The date is in
+ * YYYY-MM-DD format.
+ */
+void nyse_taq_gen(struct gen *gen, struct gen_output *out, uint64_t nr_messages,
+	const char *date, bool trades);
+
+#endif
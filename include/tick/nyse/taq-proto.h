@@ -1,15 +1,24 @@
 #ifndef TICK_NYSE_TAQ_PROTO_H
 #define TICK_NYSE_TAQ_PROTO_H
 
+#include "tick/symbol.h"
+
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <zlib.h>
 
+/*
+ * Without a symbol, the filter selects every symbol.
+ */
 struct nyse_taq_filter {
 	char			symbol[6];
+	bool			all;
 };
 
 void nyse_taq_filter_init(struct nyse_taq_filter *filter, const char *symbol);
 
+struct taq_writer;
 struct stream;
 struct nyse_taq_msg_daily_quote;
 struct nyse_taq_msg_daily_trade;
@@ -24,11 +33,15 @@ struct nyse_taq_session {
 	struct nyse_taq_filter	filter;
 	z_stream		*zstream;
 	int			in_fd;
-	int			out_fd;
+	struct taq_writer	*taq_writer;
 	const char		*input_filename;
 	const char		*date;
 	const char		*time_zone;
 	size_t			time_zone_len;
+	const char		*symbol;
+	size_t			symbol_len;
+	uint32_t		symbol_id;
+	struct symbol_cache	symbol_cache;
 };
 
 void nyse_taq_taq(struct nyse_taq_session *);
@@ -1,7 +1,12 @@
 #ifndef TICK_OB_H
 #define TICK_OB_H
 
-#include "decimal.h"
+#include "tick/symbol.h"
+#include "tick/tsv.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /*
  * OB format
@@ -18,32 +23,94 @@ enum ob_event_type {
 	OB_EVENT_STATUS		= 'S',
 };
 
+/*
+ * Numeric fields that are present in an event.  String fields are absent
+ * when NULL and character fields when zero.
+ */
+enum ob_field {
+	OB_FIELD_TIME		= 1U << 0,
+	OB_FIELD_SYMBOL		= 1U << 1,
+	OB_FIELD_ORDER_ID	= 1U << 2,
+	OB_FIELD_EXEC_ID	= 1U << 3,
+	OB_FIELD_QUANTITY	= 1U << 4,
+	OB_FIELD_PRICE		= 1U << 5,
+	OB_FIELD_ORDER		= 1U << 6,
+};
+
 struct ob_event {
 	enum ob_event_type	type;
+	unsigned int		fields;
 	const char		*date;
 	unsigned long		date_len;
-	const char		*time;
-	unsigned long		time_len;
+	uint64_t		time;		/* nanoseconds since midnight */
 	const char		*time_zone;
 	unsigned long		time_zone_len;
 	const char		*exchange;
 	unsigned long		exchange_len;
-	const char		*symbol;
-	unsigned long		symbol_len;
-	const char		*order_id;
-	unsigned long		order_id_len;
-	const char		*exec_id;
-	unsigned long		exec_id_len;
-	const char		*side;
-	unsigned long		side_len;
-	const char		*quantity;
-	unsigned long		quantity_len;
-	const char		*status;
-	unsigned long		status_len;
-	struct decimal		price;
+	uint32_t		symbol;		/* symbol table identifier */
+	uint64_t		order_id;
+	uint64_t		exec_id;
+	char			side;
+	uint64_t		quantity;
+	uint64_t		price;		/* fixed-point, four decimal digits */
+	char			status;
+	bool			non_printable;	/* execution not counted in volume */
+
+	/*
+	 * The order that a cancel or execution applies to, as the converter
+	 * has it after the event.  Only for event hooks; not written out.
+	 */
+	uint64_t		order_time;	/* when the order was added */
+	uint64_t		order_price;
+	uint64_t		order_remaining;
+	char			order_side;
+};
+
+#define OB_NR_COLUMNS		12
+
+typedef size_t (*ob_column_fmt_t)(char *buf, struct ob_event *event);
+
+/*
+ * An OB writer emits the selected columns of the selected event types.  The
+ * column formatters are looked up once in ob_writer_init() so that writing an
+ * event is a walk over the selected columns only.
+ */
+struct ob_writer {
+	struct output		*out;
+	const char		*column_names[OB_NR_COLUMNS];
+	ob_column_fmt_t		column_fmts[OB_NR_COLUMNS];
+	unsigned int		nr_columns;
+	size_t			row_len;	/* longest row without strings */
+	uint32_t		events;
+
+	/* Selected events go to 'event_fn' instead of 'out' when it is set: */
+	void			(*event_fn)(void *data, struct ob_event *event);
+	void			*event_data;
+};
+
+void ob_writer_init(struct ob_writer *writer, const char *columns, const char *events);
+void ob_write_header(struct ob_writer *writer);
+void ob_write_event(struct ob_writer *writer, struct ob_event *event);
+
+struct ob_reader;
+
+typedef void (*ob_column_parse_t)(struct ob_reader *reader, struct ob_event *event, const struct tsv_field *field);
+
+/*
+ * An OB reader parses the rows of an OB file into events.  The columns of
+ * the file are mapped to parsers once, from the header row.  String fields
+ * point into the reader's buffer until the next event is read.
+ */
+struct ob_reader {
+	struct tsv_reader	*tsv;
+	const char		*column_names[TSV_MAX_FIELDS];
+	ob_column_parse_t	column_parsers[TSV_MAX_FIELDS];
+	unsigned int		nr_columns;
+	struct symbol_cache	symbol_cache;
 };
 
-void ob_write_header(int fd);
-void ob_write_event(int fd, struct ob_event *event);
+bool ob_header_match(struct tsv_reader *tsv);
+void ob_reader_init(struct ob_reader *reader, struct tsv_reader *tsv);
+bool ob_read_event(struct ob_reader *reader, struct ob_event *event);
 
 #endif
@@ -0,0 +1,205 @@
+#ifndef TICK_OUTPUT_H
+#define TICK_OUTPUT_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Buffered output
+ *
+ * Writers format records directly into the current output block with
+ * output_reserve() and output_commit().  When compression is enabled, full
+ * blocks are compressed independently on a pool of worker threads and a
+ * writer thread appends them to the output file in submission order.  Each
+ * block becomes a self-contained gzip member or zstd frame, so the
+ * concatenation is a valid compressed stream.
+ *
+ * Uncompressed output is also written asynchronously, with io_uring where
+ * available and with the writer thread otherwise, so that formatting the
+ * next block overlaps with writing out the previous ones.
+ *
+ * Output can optionally be rolled over to a new chunk file when the chunk
+ * reaches a size limit or when the feed time crosses an interval boundary.
+ * Every chunk starts with the table header and the current date row and
+ * is a complete file of its own.  A manifest lists the time range, number of rows and size of each
+ * chunk.
+ */
+
+enum output_compression {
+	OUTPUT_COMPRESSION_NONE,
+	OUTPUT_COMPRESSION_GZIP,
+	OUTPUT_COMPRESSION_ZSTD,
+};
+
+extern const char *output_compression_names[];
+
+enum output_compression parse_output_compression(const char *name);
+uint64_t parse_output_size(const char *s);
+uint64_t parse_output_interval(const char *s);
+
+struct output_options {
+	enum output_compression	compression;
+	int			level;
+	unsigned int		nr_threads;	/* zero for one per CPU */
+	uint64_t		roll_size;	/* uncompressed bytes */
+	uint64_t		roll_interval;	/* nanoseconds of feed time */
+};
+
+bool output_parse_option(struct output_options *opts, int opt, const char *arg);
+
+#define OUTPUT_TIME_NONE	UINT64_MAX
+
+struct output_chunk {
+	unsigned int		seq;
+	uint64_t		rows;
+	uint64_t		context_rows;	/* repeated from the last chunk */
+	uint64_t		first_time;
+	uint64_t		last_time;
+	uint64_t		start_in;
+	uint64_t		start_out;
+};
+
+enum output_block_state {
+	OUTPUT_BLOCK_FREE,
+	OUTPUT_BLOCK_QUEUED,
+	OUTPUT_BLOCK_DONE,
+};
+
+struct output_block {
+	enum output_block_state	state;
+	char			*data;
+	size_t			len;
+	char			*comp;
+	size_t			comp_len;
+	size_t			comp_capacity;
+};
+
+#define OUTPUT_ASYNC_BUFS	8
+
+struct output_worker {
+	struct output		*output;
+	pthread_t		thread;
+	void			*zstream;
+	void			*zstd_cctx;
+};
+
+struct output {
+	int			fd;
+	const char		*filename;
+	enum output_compression	compression;
+	int			level;
+
+	/* Block that is currently being filled: */
+	char			*buf;
+	size_t			pos;
+	size_t			capacity;
+
+	/* Compression pipeline: */
+	struct output_block	*blocks;
+	unsigned int		nr_blocks;
+	struct output_worker	*workers;
+	unsigned int		nr_workers;
+	pthread_t		writer;
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	unsigned long		seq;
+	unsigned long		cseq;
+	unsigned long		wseq;
+	bool			closing;
+
+	uint64_t		bytes_in;
+	uint64_t		bytes_out;
+	uint64_t		buffer_bytes;	/* memory of the buffers */
+
+	/* Asynchronous output with io_uring: */
+	void			*uring;
+
+	/* Zero-copy output to a pipe: */
+	bool			splice;
+
+	/* Rolling: */
+	uint64_t		roll_size;
+	uint64_t		roll_interval;
+	char			*header;
+	size_t			header_len;
+	char			*context;
+	size_t			context_len;
+	char			*path;
+	struct output_chunk	chunk;
+	FILE			*manifest;
+	char			*manifest_filename;
+};
+
+#define OUTPUT_BLOCK_SIZE	(1ULL << 20) /* 1 MB */
+
+/*
+ * Largest single output_reserve() request.  Writers reserve an upper bound
+ * of the row they are about to format; a larger request is an error.
+ */
+#define OUTPUT_MAX_RESERVE	1024
+
+struct output *output_open(const char *filename, struct output_options *opts);
+void output_flush(struct output *out);
+void output_close(struct output *out);
+void output_write(struct output *out, const void *data, size_t len);
+void output_copy_range(struct output *out, int fd, const char *filename, uint64_t offset, uint64_t len);
+void output_write_header(struct output *out, const void *data, size_t len);
+void output_set_context(struct output *out, const void *data, size_t len);
+void output_roll(struct output *out);
+void output_reserve_slow(struct output *out, size_t len);
+
+static inline bool output_roll_due(struct output *out, uint64_t time)
+{
+	struct output_chunk *chunk = &out->chunk;
+
+	if (chunk->rows == chunk->context_rows)
+		return false;
+
+	if (out->roll_size && out->bytes_in + out->pos - chunk->start_in >= out->roll_size)
+		return true;
+
+	if (out->roll_interval && time != OUTPUT_TIME_NONE && chunk->first_time != OUTPUT_TIME_NONE)
+		return time / out->roll_interval != chunk->first_time / out->roll_interval;
+
+	return false;
+}
+
+/*
+ * Account for a row that is about to be written.  Rows are never split
+ * across chunks, so this is where output is rolled over.
+ */
+static inline void output_begin_row(struct output *out, uint64_t time)
+{
+	struct output_chunk *chunk = &out->chunk;
+
+	if (out->manifest && output_roll_due(out, time))
+		output_roll(out);
+
+	chunk->rows++;
+
+	if (time == OUTPUT_TIME_NONE)
+		return;
+
+	if (chunk->first_time == OUTPUT_TIME_NONE)
+		chunk->first_time = time;
+
+	chunk->last_time = time;
+}
+
+static inline char *output_reserve(struct output *out, size_t len)
+{
+	if (out->capacity - out->pos < len || len > OUTPUT_MAX_RESERVE)
+		output_reserve_slow(out, len);
+
+	return out->buf + out->pos;
+}
+
+static inline void output_commit(struct output *out, size_t len)
+{
+	out->pos += len;
+}
+
+#endif
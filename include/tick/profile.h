@@ -0,0 +1,194 @@
+#ifndef TICK_PROFILE_H
+#define TICK_PROFILE_H
+
+#include "tick/histogram.h"
+#include "tick/counters.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Stage profiling
+ *
+ * The timers are always compiled in but do nothing unless profiling is
+ * enabled with profile_start().  Stages nest: entering a stage stops the
+ * clock of the enclosing one, so every tick is charged to exactly one
+ * stage and the stage times add up to the total.  Time that is not spent
+ * in any stage is charged to PROFILE_STAGE_OTHER.
+ *
+ * The clock is the time stamp counter where available and CLOCK_MONOTONIC
+ * otherwise.  Ticks are converted to nanoseconds when the report is
+ * printed.
+ *
+ * Hardware performance counters can be charged to the stages as well.
+ * Without rdpmc, every stage change reads the counters with a system call,
+ * which slows the run down considerably, but as the counters exclude the
+ * kernel, the counts stay meaningful.
+ *
+ * With latency histograms, the cost of every message is also recorded in
+ * a histogram of its message type so that the report can show percentiles
+ * and not just the mean, which hides the few messages that hit a hash
+ * table resize or walk a whole table.
+ */
+
+enum profile_stage {
+	PROFILE_STAGE_OTHER,
+	PROFILE_STAGE_INFLATE,
+	PROFILE_STAGE_DECODE,
+	PROFILE_STAGE_LOOKUP,
+	PROFILE_STAGE_FILTER,
+	PROFILE_STAGE_PROCESS,
+	PROFILE_STAGE_FORMAT,
+	PROFILE_STAGE_WRITE,
+
+	PROFILE_NR_STAGES,
+};
+
+#define PROFILE_MAX_DEPTH	8
+
+struct profile {
+	bool			enabled;
+
+	/* Stack of the stages that are being timed: */
+	enum profile_stage	stack[PROFILE_MAX_DEPTH];
+	unsigned int		depth;
+	uint64_t		last;
+
+	uint64_t		stage_ticks[PROFILE_NR_STAGES];
+	uint64_t		stage_calls[PROFILE_NR_STAGES];
+
+	/* Cost of processing a message by message type: */
+	uint64_t		message_start;
+	uint64_t		type_ticks[256];
+	uint64_t		type_count[256];
+	bool			with_latency;
+	struct histogram	*type_latency[256];
+
+	/* Hardware performance counters: */
+	struct counters		*counters;
+	int			counters_err;
+	uint64_t		counter_last[NR_COUNTERS];
+	uint64_t		counter_stage[PROFILE_NR_STAGES][NR_COUNTERS];
+
+	uint64_t		bytes_in;	/* compressed input */
+	uint64_t		bytes_decoded;	/* uncompressed input */
+	uint64_t		bytes_formatted;/* output before compression */
+	uint64_t		bytes_out;
+
+	/* Clock calibration: */
+	uint64_t		start_ticks;
+	struct timespec		start_time;
+};
+
+extern struct profile profile;
+
+void profile_charge_counters(enum profile_stage stage);
+
+static inline uint64_t profile_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static inline void profile_charge(uint64_t now)
+{
+	enum profile_stage stage = profile.stack[profile.depth];
+
+	profile.stage_ticks[stage] += now - profile.last;
+
+	profile.last = now;
+
+	if (profile.counters)
+		profile_charge_counters(stage);
+}
+
+static inline void profile_enter(enum profile_stage stage)
+{
+	if (!profile.enabled)
+		return;
+
+	profile_charge(profile_ticks());
+
+	profile.stack[++profile.depth] = stage;
+
+	profile.stage_calls[stage]++;
+}
+
+static inline void profile_leave(void)
+{
+	if (!profile.enabled)
+		return;
+
+	profile_charge(profile_ticks());
+
+	profile.depth--;
+}
+
+/*
+ * Time the processing of one message.  Stages that are entered while the
+ * message is processed count towards its cost.
+ */
+static inline void profile_message_begin(void)
+{
+	if (!profile.enabled)
+		return;
+
+	profile_enter(PROFILE_STAGE_PROCESS);
+
+	profile.message_start = profile.last;
+}
+
+static inline void profile_record_latency(uint8_t msg_type, uint64_t ticks)
+{
+	struct histogram *hist = profile.type_latency[msg_type];
+
+	if (!hist)
+		hist = profile.type_latency[msg_type] = histogram_new();
+
+	histogram_record(hist, ticks);
+}
+
+static inline void profile_message_end(uint8_t msg_type)
+{
+	uint64_t ticks;
+
+	if (!profile.enabled)
+		return;
+
+	profile_leave();
+
+	ticks = profile.last - profile.message_start;
+
+	profile.type_ticks[msg_type] += ticks;
+	profile.type_count[msg_type]++;
+
+	if (profile.with_latency)
+		profile_record_latency(msg_type, ticks);
+}
+
+static inline void profile_input(uint64_t bytes_in, uint64_t bytes_decoded)
+{
+	if (!profile.enabled)
+		return;
+
+	profile.bytes_in	+= bytes_in;
+	profile.bytes_decoded	+= bytes_decoded;
+}
+
+void profile_start(bool with_counters, bool with_latency);
+void profile_output(uint64_t bytes_formatted, uint64_t bytes_out);
+void print_profile(const char *filename);
+
+#endif
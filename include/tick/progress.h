@@ -1,8 +1,102 @@
 #ifndef TICK_PROGRESS_H
 #define TICK_PROGRESS_H
 
-struct buffer;
+#include <glib.h>
 
-void print_progress(struct buffer *buf);
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Progress reporting
+ *
+ * A ticker thread wakes up a few times a second and raises a flag.  The
+ * main loop only counts messages and input; the report is printed from
+ * the main loop when it next refills the input buffer and finds the flag
+ * raised, so reading the state needs no locking and the cost per message
+ * is an increment.
+ *
+ * By default progress is shown only when standard error is a terminal.
+ * The log mode prints one line of key=value pairs per report instead of
+ * updating a status line, which suits log files of batch runs.
+ */
+
+enum progress_mode {
+	PROGRESS_AUTO,
+	PROGRESS_TTY,
+	PROGRESS_LOG,
+	PROGRESS_NONE,
+};
+
+extern const char *progress_mode_names[];
+
+enum progress_mode parse_progress_mode(const char *name);
+
+struct output;
+
+struct progress {
+	enum progress_mode	mode;
+	const char		*filename;
+	bool			due;
+
+	uint64_t		bytes_in;	/* compressed input */
+	uint64_t		bytes_total;	/* size of the compressed input */
+	uint64_t		bytes_decoded;	/* uncompressed input */
+	uint64_t		nr_messages;
+
+	/* Optional sources for the report: */
+	GHashTable		*orders;
+	struct output		*output;
+
+	/* State at the previous report, for the current rates: */
+	struct timespec		start;
+	double			last_secs;
+	uint64_t		last_bytes_decoded;
+	uint64_t		last_bytes_out;
+	uint64_t		last_messages;
+
+	/* Ticker thread: */
+	pthread_t		ticker;
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	bool			stopping;
+};
+
+extern struct progress progress;
+
+void progress_start(enum progress_mode mode, const char *filename);
+void progress_stop(void);
+void progress_disable(void);
+void progress_report(void);
+
+static inline void progress_track_orders(GHashTable *orders)
+{
+	progress.orders = orders;
+}
+
+static inline void progress_track_output(struct output *out)
+{
+	progress.output = out;
+}
+
+static inline void progress_message(void)
+{
+	progress.nr_messages++;
+}
+
+/*
+ * Account for an input buffer refill.  'consumed' and 'total' are the
+ * position in and the size of the compressed input.
+ */
+static inline void progress_input(uint64_t consumed, uint64_t total, uint64_t bytes_decoded)
+{
+	progress.bytes_in	 = consumed;
+	progress.bytes_total	 = total;
+	progress.bytes_decoded	+= bytes_decoded;
+
+	if (__atomic_load_n(&progress.due, __ATOMIC_RELAXED))
+		progress_report();
+}
 
 #endif
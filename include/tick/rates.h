@@ -0,0 +1,94 @@
+#ifndef TICK_RATES_H
+#define TICK_RATES_H
+
+#include "tick/histogram.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Message rates
+ *
+ * Messages are counted in fixed, aligned windows of feed time.  When a
+ * window closes, its count goes into a log-linear histogram and a short
+ * list of the busiest windows, so that peak rates, percentiles and the
+ * busiest intervals are found in one streaming pass with fixed memory.
+ * Empty windows between the first and the last message are counted too.
+ * Percentiles are exact for small counts and otherwise round up by less
+ * than 1/2^HISTOGRAM_SUB_BITS.
+ */
+
+#define RATES_NR_WINDOWS	3
+#define RATES_NR_BUSIEST	10
+
+struct output;
+
+struct rate_interval {
+	uint64_t		start;
+	uint64_t		count;
+};
+
+struct rate_window {
+	uint64_t		length;		/* nanoseconds */
+	uint64_t		start;		/* start of the current window */
+	uint64_t		count;		/* messages in the current window */
+	bool			started;
+
+	/* Message counts of the closed windows: */
+	struct histogram	hist;
+
+	/* The busiest windows, in no particular order: */
+	struct rate_interval	busiest[RATES_NR_BUSIEST];
+	unsigned int		nr_busiest;
+};
+
+struct rates {
+	const char		*filename;
+	uint64_t		time;		/* time of the last message */
+	struct rate_window	windows[RATES_NR_WINDOWS];
+
+	/* Optional timeline of message counts per interval: */
+	struct output		*timeline;
+	uint64_t		timeline_interval;
+	uint64_t		timeline_start;
+	uint64_t		timeline_count;
+};
+
+void rates_init(struct rates *rates, const char *filename, struct output *timeline, uint64_t timeline_interval);
+void rates_finish(struct rates *rates);
+void print_rates(struct rates *rates);
+
+void rate_window_advance(struct rate_window *window, uint64_t time);
+void rates_timeline_advance(struct rates *rates, uint64_t time);
+
+/*
+ * Count a message at 'time' nanoseconds since midnight.  Time that goes
+ * backwards is counted in the current window.
+ */
+static inline void rates_message(struct rates *rates, uint64_t time)
+{
+	unsigned int i;
+
+	if (time < rates->time)
+		time = rates->time;
+
+	rates->time = time;
+
+	for (i = 0; i < RATES_NR_WINDOWS; i++) {
+		struct rate_window *window = &rates->windows[i];
+
+		if (time - window->start >= window->length || !window->started)
+			rate_window_advance(window, time);
+
+		window->count++;
+	}
+
+	if (rates->timeline) {
+		if (time - rates->timeline_start >= rates->timeline_interval || !rates->timeline_count)
+			rates_timeline_advance(rates, time);
+
+		rates->timeline_count++;
+	}
+}
+
+#endif
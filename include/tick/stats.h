@@ -3,15 +3,72 @@
 
 #include <libtrading/types.h>
 
+#include "tick/symbol.h"
+
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <glib.h>
+
+/*
+ * Message statistics
+ *
+ * Messages are always counted by type.  Optionally, messages are also
+ * attributed to symbols, either by the symbol they carry or by the symbol
+ * of the order they refer to, and the live orders of every symbol are
+ * tracked to find the peak size of the order table a conversion of that
+ * symbol needs.
+ */
+
+#define STATS_MAX_TYPES		32
+#define STATS_SHARES_ALL	UINT64_MAX
+
+struct rates;
+
+struct stats_order {
+	uint64_t		order_id;
+	uint64_t		remaining;
+	uint32_t		symbol;
+};
+
+struct stats_symbol {
+	uint64_t		nr_messages;
+	uint64_t		nr_orders;	/* live orders */
+	uint64_t		peak_orders;
+	uint64_t		stats[STATS_MAX_TYPES];	/* by type slot */
+};
 
 struct stats {
-	const char	*filename;
-	uint64_t	stats[256];
+	const char		*filename;
+	uint64_t		stats[256];
+
+	/* Message rates, only collected when set: */
+	struct rates		*rates;
+
+	/* Per-symbol statistics, only collected when 'by_symbol' is set: */
+	bool			by_symbol;
+	struct symbol_cache	symbol_cache;
+	u8			type_slots[256];	/* slot + 1, or 0 */
+	u8			types[STATS_MAX_TYPES];
+	unsigned int		nr_types;
+	struct stats_symbol	*symbols;
+	unsigned int		nr_symbols;
+	GHashTable		*orders;
+	uint64_t		nr_orders;
+	uint64_t		peak_orders;
 };
 
+void stats_init(struct stats *stats, const char *filename, bool by_symbol);
+void stats_release(struct stats *stats);
+
+uint32_t stats_symbol(struct stats *stats, const char *name, size_t len);
+void stats_symbol_message(struct stats *stats, uint32_t symbol, u8 msg_type);
+void stats_add_order(struct stats *stats, uint32_t symbol, uint64_t order_id, uint64_t shares, u8 msg_type);
+void stats_reduce_order(struct stats *stats, uint64_t order_id, uint64_t shares, u8 msg_type);
+void stats_replace_order(struct stats *stats, uint64_t order_id, uint64_t new_order_id, uint64_t shares, u8 msg_type);
+
 void print_stat(struct stats *stats, u8 msg_type, const char *name);
 void print_stats(struct stats *stats, const char **stat_names, size_t stat_len);
+void print_symbol_stats(struct stats *stats, const char **stat_names, size_t stat_len, unsigned int top);
 
 #endif
@@ -1,15 +1,41 @@
 #ifndef TICK_STREAM_H
 #define TICK_STREAM_H
 
-#include <zlib.h>
+#include "libtrading/buffer.h"
+
+#include "tick/progress.h"
+#include "tick/memory.h"
+#include "tick/profile.h"
 
-struct buffer;
+#include <sys/types.h>
+#include <zlib.h>
 
 struct stream {
 	z_stream		*zstream;
 	struct buffer		*uncomp_buf;
 	struct buffer		*comp_buf;
-	void			(*progress)(struct buffer *);
 };
 
+static inline ssize_t stream_inflate(struct stream *stream)
+{
+	unsigned long start = stream->comp_buf->start;
+	ssize_t nr;
+
+	profile_enter(PROFILE_STAGE_INFLATE);
+
+	nr = buffer_inflate(stream->comp_buf, stream->uncomp_buf, stream->zstream);
+
+	profile_leave();
+
+	if (nr > 0) {
+		profile_input(stream->comp_buf->start - start, nr);
+		progress_input(stream->comp_buf->start, stream->comp_buf->capacity, nr);
+	}
+
+	if (memory.enabled)
+		memory_sample(stream->comp_buf->capacity, stream->uncomp_buf->capacity);
+
+	return nr;
+}
+
 #endif
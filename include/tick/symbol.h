@@ -0,0 +1,78 @@
+#ifndef TICK_SYMBOL_H
+#define TICK_SYMBOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Symbol table
+ *
+ * Symbols are interned once and referred to by a dense 32-bit identifier
+ * so that events and per-symbol state do not carry symbol strings around.
+ */
+
+#define SYMBOL_MAX_LEN		16
+
+struct symbol {
+	char			name[SYMBOL_MAX_LEN + 1];
+	unsigned long		len;
+};
+
+extern struct symbol **symbol_table;
+
+uint32_t symbol_intern(const char *name, size_t len);
+unsigned int nr_symbols(void);
+
+static inline const char *symbol_name(uint32_t id)
+{
+	return symbol_table[id]->name;
+}
+
+static inline unsigned long symbol_len(uint32_t id)
+{
+	return symbol_table[id]->len;
+}
+
+/*
+ * Remembers the last symbol looked up, which saves a hash table lookup per
+ * row when reading files that are mostly about one symbol.
+ */
+struct symbol_cache {
+	char			name[SYMBOL_MAX_LEN];
+	size_t			len;
+	uint32_t		id;
+	bool			valid;
+};
+
+static inline uint32_t symbol_cache_intern(struct symbol_cache *cache, const char *name, size_t len)
+{
+	if (cache->valid && cache->len == len && !memcmp(cache->name, name, len))
+		return cache->id;
+
+	if (len > SYMBOL_MAX_LEN)
+		return symbol_intern(name, len);
+
+	memcpy(cache->name, name, len);
+
+	cache->len	= len;
+	cache->id	= symbol_intern(name, len);
+	cache->valid	= true;
+
+	return cache->id;
+}
+
+/*
+ * Intern a fixed-width symbol field of a feed message, which is padded
+ * with spaces on the right.
+ */
+static inline uint32_t symbol_cache_intern_padded(struct symbol_cache *cache, const char *name, size_t len)
+{
+	while (len && name[len - 1] == ' ')
+		len--;
+
+	return symbol_cache_intern(cache, name, len);
+}
+
+#endif
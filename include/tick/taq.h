@@ -1,8 +1,12 @@
 #ifndef TICK_TAQ_H
 #define TICK_TAQ_H
 
-#include "decimal.h"
-#include "time.h"
+#include "tick/symbol.h"
+#include "tick/tsv.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /*
  * TAQ format
@@ -16,43 +20,86 @@ enum taq_event_type {
 	TAQ_EVENT_STATUS	= 'S',
 };
 
-#define TAQ_TRADE_TYPE_REGULAR			"R"
-#define TAQ_TRADE_TYPE_NON_DISPLAYED		"N"
-#define TAQ_TRADE_TYPE_INTERMARKET_SWEEP	"I"
+#define TAQ_TRADE_TYPE_REGULAR			'R'
+#define TAQ_TRADE_TYPE_NON_DISPLAYED		'N'
+#define TAQ_TRADE_TYPE_INTERMARKET_SWEEP	'I'
 
-#define TAQ_TRADE_TYPE_LEN			1
+/*
+ * Numeric fields that are present in an event.  String fields are absent
+ * when NULL and character fields when zero.
+ */
+enum taq_field {
+	TAQ_FIELD_TIME		= 1U << 0,
+	TAQ_FIELD_SYMBOL	= 1U << 1,
+	TAQ_FIELD_EXEC_ID	= 1U << 2,
+	TAQ_FIELD_TRADE		= 1U << 3,
+	TAQ_FIELD_QUOTE		= 1U << 4,
+};
 
 struct taq_event {
 	enum taq_event_type	type;
+	unsigned int		fields;
 	const char		*date;
 	unsigned long		date_len;
-	struct time		time;
+	uint64_t		time;		/* nanoseconds since midnight */
 	const char		*time_zone;
 	unsigned long		time_zone_len;
 	const char		*exchange;
 	unsigned long		exchange_len;
-	const char		*symbol;
-	unsigned long		symbol_len;
-	const char		*exec_id;
-	unsigned long		exec_id_len;
-	const char		*trade_quantity;
-	unsigned long		trade_quantity_len;
-	struct decimal		trade_price;
-	const char		*trade_side;
-	unsigned long		trade_side_len;
-	const char		*trade_type;
-	unsigned long		trade_type_len;
-	const char		*bid_quantity1;
-	unsigned long		bid_quantity1_len;
-	struct decimal		bid_price1;
-	const char		*ask_quantity1;
-	unsigned long		ask_quantity1_len;
-	struct decimal		ask_price1;
-	const char		*status;
-	unsigned long		status_len;
+	uint32_t		symbol;		/* symbol table identifier */
+	uint64_t		exec_id;
+	uint64_t		trade_quantity;
+	uint64_t		trade_price;	/* fixed-point, four decimal digits */
+	char			trade_side;
+	char			trade_type;
+	char			status;
+	uint64_t		bid_quantity1;
+	uint64_t		bid_price1;
+	uint64_t		ask_quantity1;
+	uint64_t		ask_price1;
+};
+
+#define TAQ_NR_COLUMNS		16
+
+typedef size_t (*taq_column_fmt_t)(char *buf, struct taq_event *event);
+
+/*
+ * A TAQ writer emits the selected columns of the selected event types.
+ */
+struct taq_writer {
+	struct output		*out;
+	const char		*column_names[TAQ_NR_COLUMNS];
+	taq_column_fmt_t	column_fmts[TAQ_NR_COLUMNS];
+	unsigned int		nr_columns;
+	size_t			row_len;	/* longest row without strings */
+	uint32_t		events;
+
+	/* Selected events go to 'event_fn' instead of 'out' when it is set: */
+	void			(*event_fn)(void *data, struct taq_event *event);
+	void			*event_data;
+};
+
+void taq_writer_init(struct taq_writer *writer, const char *columns, const char *events);
+void taq_write_header(struct taq_writer *writer);
+void taq_write_event(struct taq_writer *writer, struct taq_event *event);
+
+struct taq_reader;
+
+typedef void (*taq_column_parse_t)(struct taq_reader *reader, struct taq_event *event, const struct tsv_field *field);
+
+/*
+ * A TAQ reader parses the rows of a TAQ file into events.
+ */
+struct taq_reader {
+	struct tsv_reader	*tsv;
+	const char		*column_names[TSV_MAX_FIELDS];
+	taq_column_parse_t	column_parsers[TSV_MAX_FIELDS];
+	unsigned int		nr_columns;
+	struct symbol_cache	symbol_cache;
 };
 
-void taq_write_header(int fd);
-void taq_write_event(int fd, struct taq_event *event);
+bool taq_header_match(struct tsv_reader *tsv);
+void taq_reader_init(struct taq_reader *reader, struct tsv_reader *tsv);
+bool taq_read_event(struct taq_reader *reader, struct taq_event *event);
 
 #endif
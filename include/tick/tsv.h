@@ -0,0 +1,79 @@
+#ifndef TICK_TSV_H
+#define TICK_TSV_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * TSV reader
+ *
+ * Reads tab-separated rows from a plain, gzip or zstd compressed file.
+ * Rows are split into fields in place: a field points into the reader's
+ * buffer and stays valid until the next call to tsv_read_row().  Tabs and
+ * newlines are located 64 bytes at a time with SIMD compares, and the
+ * resulting bit mask is carried over from one row to the next.
+ */
+
+#define TSV_MAX_FIELDS		32
+
+struct tsv_field {
+	const char		*s;
+	size_t			len;
+};
+
+enum tsv_compression {
+	TSV_COMPRESSION_NONE,
+	TSV_COMPRESSION_GZIP,
+	TSV_COMPRESSION_ZSTD,
+};
+
+struct tsv_reader {
+	int			fd;
+	const char		*filename;
+	enum tsv_compression	compression;
+	void			*zstream;
+	void			*zstd_dctx;
+	bool			eof;
+
+	/* Compressed input: */
+	char			*in_buf;
+	size_t			in_start;
+	size_t			in_end;
+	bool			in_eof;
+	bool			in_frame;	/* inside a gzip member or zstd frame */
+
+	/* Uncompressed window: */
+	char			*buf;
+	size_t			pos;
+	size_t			end;
+	uint64_t		base;		/* stream offset of 'buf' */
+
+	/* Delimiter bits of the 64-byte block at 'block' from 'pos' on: */
+	size_t			block;
+	uint64_t		mask;
+
+	struct tsv_field	fields[TSV_MAX_FIELDS];
+	unsigned int		nr_fields;
+	uint64_t		line;
+	uint64_t		offset;		/* stream offset of the row */
+};
+
+void tsv_reader_open(struct tsv_reader *reader, const char *filename);
+void tsv_reader_close(struct tsv_reader *reader);
+bool tsv_read_row(struct tsv_reader *reader);
+char *tsv_join_fields(struct tsv_reader *reader, char delim);
+
+static inline bool tsv_field_equals(const struct tsv_field *field, const char *s)
+{
+	size_t i;
+
+	for (i = 0; i < field->len; i++) {
+		if (field->s[i] != s[i])
+			return false;
+	}
+
+	return s[i] == '\0';
+}
+
+#endif
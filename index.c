@@ -0,0 +1,256 @@
+#include "tick/index.h"
+
+#include "tick/symbol.h"
+#include "tick/error.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+char *index_filename(const char *filename)
+{
+	size_t len = strlen(filename);
+	char *ret;
+
+	ret = malloc(len + strlen(".idx") + 1);
+	if (!ret)
+		error("out of memory");
+
+	memcpy(ret, filename, len);
+	strcpy(ret + len, ".idx");
+
+	return ret;
+}
+
+void index_init(struct index *index, uint32_t stride)
+{
+	*index = (struct index) {
+		.stride		= stride,
+	};
+}
+
+void index_release(struct index *index)
+{
+	free(index->symbol_seen);
+	free(index->block_symbols);
+	free(index->entries);
+}
+
+void index_add(struct index *index, uint64_t offset, uint64_t time)
+{
+	if (index->nr_entries == index->capacity) {
+		index->capacity = index->capacity ? 2 * index->capacity : 1024;
+
+		index->entries = realloc(index->entries, index->capacity * sizeof(*index->entries));
+		if (!index->entries)
+			error("out of memory");
+	}
+
+	index->entries[index->nr_entries++] = (struct index_entry) {
+		.offset		= offset,
+		.time		= time,
+		.symbols	= index->nr_block_symbols,
+	};
+}
+
+static uint64_t *index_symbol_seen(struct index *index, uint32_t symbol)
+{
+	if (symbol == INDEX_SYMBOL_NONE)
+		return &index->none_seen;
+
+	if (symbol >= index->nr_symbol_seen) {
+		unsigned int nr = index->nr_symbol_seen ? index->nr_symbol_seen : 1024;
+
+		while (nr <= symbol)
+			nr *= 2;
+
+		index->symbol_seen = realloc(index->symbol_seen, nr * sizeof(*index->symbol_seen));
+		if (!index->symbol_seen)
+			error("out of memory");
+
+		memset(index->symbol_seen + index->nr_symbol_seen, 0, (nr - index->nr_symbol_seen) * sizeof(*index->symbol_seen));
+
+		index->nr_symbol_seen = nr;
+	}
+
+	return &index->symbol_seen[symbol];
+}
+
+/*
+ * Add the symbol of a row to the set of the last block.
+ */
+void index_add_symbol(struct index *index, uint32_t symbol)
+{
+	struct index_entry *entry = &index->entries[index->nr_entries - 1];
+	uint64_t *seen = index_symbol_seen(index, symbol);
+
+	if (*seen == index->nr_entries)
+		return;
+
+	*seen = index->nr_entries;
+
+	if (index->nr_block_symbols == index->block_symbols_capacity) {
+		index->block_symbols_capacity = index->block_symbols_capacity ? 2 * index->block_symbols_capacity : 1024;
+
+		index->block_symbols = realloc(index->block_symbols, index->block_symbols_capacity * sizeof(*index->block_symbols));
+		if (!index->block_symbols)
+			error("out of memory");
+	}
+
+	index->block_symbols[index->nr_block_symbols++] = symbol;
+
+	entry->nr_symbols++;
+}
+
+bool index_block_has_symbol(struct index *index, uint64_t entry, uint32_t symbol)
+{
+	const uint32_t *symbols = index->block_symbols + index->entries[entry].symbols;
+	uint32_t i;
+
+	for (i = 0; i < index->entries[entry].nr_symbols; i++) {
+		if (symbols[i] == symbol)
+			return true;
+	}
+
+	return false;
+}
+
+static void index_fwrite(FILE *file, const char *filename, const void *data, size_t len)
+{
+	if (fwrite(data, 1, len, file) != len)
+		error("%s: %s", filename, strerror(errno));
+}
+
+static void index_fread(FILE *file, const char *filename, void *data, size_t len)
+{
+	if (fread(data, 1, len, file) != len)
+		error("%s: truncated index", filename);
+}
+
+/*
+ * Symbol sets refer to the process-wide symbol table, which is written out
+ * in full and mapped back to symbol identifiers when the index is read.
+ */
+void index_write(struct index *index, const char *filename)
+{
+	struct index_header header;
+	unsigned int i;
+	FILE *file;
+
+	file = fopen(filename, "w");
+	if (!file)
+		error("%s: %s", filename, strerror(errno));
+
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+
+	header.stride		= index->stride;
+	header.nr_symbols	= nr_symbols();
+	header.nr_entries	= index->nr_entries;
+	header.nr_block_symbols	= index->nr_block_symbols;
+	header.file_size	= index->file_size;
+	header.data_offset	= index->data_offset;
+
+	index_fwrite(file, filename, &header, sizeof(header));
+
+	for (i = 0; i < header.nr_symbols; i++) {
+		unsigned char len = symbol_len(i);
+
+		index_fwrite(file, filename, &len, sizeof(len));
+		index_fwrite(file, filename, symbol_name(i), len);
+	}
+
+	index_fwrite(file, filename, index->entries, index->nr_entries * sizeof(*index->entries));
+	index_fwrite(file, filename, index->block_symbols, index->nr_block_symbols * sizeof(*index->block_symbols));
+
+	if (fclose(file))
+		error("%s: %s", filename, strerror(errno));
+}
+
+static void *index_alloc(uint64_t nr, size_t size)
+{
+	void *ret;
+
+	ret = malloc(nr * size);
+	if (!ret && nr)
+		error("out of memory");
+
+	return ret;
+}
+
+void index_read(struct index *index, const char *filename)
+{
+	struct index_header header;
+	uint32_t *symbols;
+	uint64_t i;
+	FILE *file;
+
+	file = fopen(filename, "r");
+	if (!file)
+		error("%s: %s", filename, strerror(errno));
+
+	index_fread(file, filename, &header, sizeof(header));
+
+	if (memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)))
+		error("%s: not an index file", filename);
+
+	index_init(index, header.stride);
+
+	index->file_size	= header.file_size;
+	index->data_offset	= header.data_offset;
+
+	symbols = index_alloc(header.nr_symbols, sizeof(*symbols));
+
+	/* Map the symbols of the index to this process' symbol table: */
+	for (i = 0; i < header.nr_symbols; i++) {
+		char name[SYMBOL_MAX_LEN];
+		unsigned char len;
+
+		index_fread(file, filename, &len, sizeof(len));
+		if (len > SYMBOL_MAX_LEN)
+			error("%s: corrupt index", filename);
+
+		index_fread(file, filename, name, len);
+
+		symbols[i] = symbol_intern(name, len);
+	}
+
+	index->capacity		= header.nr_entries;
+	index->nr_entries	= header.nr_entries;
+
+	index->entries = index_alloc(header.nr_entries, sizeof(*index->entries));
+
+	index_fread(file, filename, index->entries, header.nr_entries * sizeof(*index->entries));
+
+	index->block_symbols_capacity	= header.nr_block_symbols;
+	index->nr_block_symbols		= header.nr_block_symbols;
+
+	index->block_symbols = index_alloc(header.nr_block_symbols, sizeof(*index->block_symbols));
+
+	index_fread(file, filename, index->block_symbols, header.nr_block_symbols * sizeof(*index->block_symbols));
+
+	for (i = 0; i < index->nr_entries; i++) {
+		struct index_entry *entry = &index->entries[i];
+
+		if (entry->symbols + entry->nr_symbols > index->nr_block_symbols)
+			error("%s: corrupt index", filename);
+	}
+
+	for (i = 0; i < index->nr_block_symbols; i++) {
+		uint32_t *symbol = &index->block_symbols[i];
+
+		if (*symbol == INDEX_SYMBOL_NONE)
+			continue;
+
+		if (*symbol >= header.nr_symbols)
+			error("%s: corrupt index", filename);
+
+		*symbol = symbols[*symbol];
+	}
+
+	free(symbols);
+
+	fclose(file);
+}
@@ -0,0 +1,396 @@
+#include "tick/json.h"
+
+#include "tick/error.h"
+
+#include <sys/stat.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#define JSON_MAX_DEPTH		64
+
+struct json_parser {
+	const char		*p;
+	const char		*end;
+	unsigned int		depth;
+};
+
+static void json_skip_space(struct json_parser *parser)
+{
+	while (parser->p < parser->end) {
+		switch (*parser->p) {
+		case ' ':
+		case '\t':
+		case '\n':
+		case '\r':
+			parser->p++;
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+static bool json_consume(struct json_parser *parser, const char *token)
+{
+	size_t len = strlen(token);
+
+	if ((size_t) (parser->end - parser->p) < len || memcmp(parser->p, token, len))
+		return false;
+
+	parser->p += len;
+
+	return true;
+}
+
+static void json_free_value(struct json_value *value)
+{
+	unsigned int i;
+
+	for (i = 0; i < value->nr_elements; i++) {
+		json_free_value(&value->elements[i]);
+
+		if (value->keys)
+			free(value->keys[i]);
+	}
+
+	free(value->elements);
+	free(value->keys);
+	free(value->string);
+}
+
+/*
+ * Escapes other than the common ones are not needed by the files that are
+ * read back and are rejected.
+ */
+static char *json_parse_string(struct json_parser *parser)
+{
+	const char *start;
+	char *ret, *q;
+
+	if (!json_consume(parser, "\""))
+		return NULL;
+
+	start = parser->p;
+
+	while (parser->p < parser->end && *parser->p != '"') {
+		if (*parser->p == '\\')
+			parser->p++;
+
+		parser->p++;
+	}
+
+	if (parser->p >= parser->end)
+		return NULL;
+
+	ret = malloc(parser->p - start + 1);
+	if (!ret)
+		error("out of memory");
+
+	for (q = ret; start < parser->p; start++) {
+		if (*start != '\\') {
+			*q++ = *start;
+			continue;
+		}
+
+		switch (*++start) {
+		case '"':
+		case '\\':
+		case '/':
+			*q++ = *start;
+			break;
+		case 'n':
+			*q++ = '\n';
+			break;
+		case 't':
+			*q++ = '\t';
+			break;
+		default:
+			free(ret);
+			return NULL;
+		}
+	}
+
+	*q = '\0';
+
+	parser->p++;
+
+	return ret;
+}
+
+static bool json_parse_value(struct json_parser *parser, struct json_value *value);
+
+static struct json_value *json_add_element(struct json_value *value)
+{
+	struct json_value *elements;
+
+	elements = realloc(value->elements, (value->nr_elements + 1) * sizeof(*elements));
+	if (!elements)
+		error("out of memory");
+
+	value->elements = elements;
+
+	if (value->type == JSON_OBJECT) {
+		char **keys = realloc(value->keys, (value->nr_elements + 1) * sizeof(*keys));
+
+		if (!keys)
+			error("out of memory");
+
+		value->keys = keys;
+		value->keys[value->nr_elements] = NULL;
+	}
+
+	elements[value->nr_elements] = (struct json_value) { .type = JSON_NULL };
+
+	return &elements[value->nr_elements++];
+}
+
+static bool json_parse_elements(struct json_parser *parser, struct json_value *value, const char *close)
+{
+	json_skip_space(parser);
+
+	if (json_consume(parser, close))
+		return true;
+
+	for (;;) {
+		struct json_value *element = json_add_element(value);
+
+		if (value->type == JSON_OBJECT) {
+			char *key = json_parse_string(parser);
+
+			if (!key)
+				return false;
+
+			value->keys[value->nr_elements - 1] = key;
+
+			json_skip_space(parser);
+
+			if (!json_consume(parser, ":"))
+				return false;
+		}
+
+		if (!json_parse_value(parser, element))
+			return false;
+
+		json_skip_space(parser);
+
+		if (json_consume(parser, close))
+			return true;
+
+		if (!json_consume(parser, ","))
+			return false;
+
+		json_skip_space(parser);
+	}
+}
+
+static bool json_parse_value(struct json_parser *parser, struct json_value *value)
+{
+	bool ret;
+
+	json_skip_space(parser);
+
+	if (parser->p >= parser->end)
+		return false;
+
+	switch (*parser->p) {
+	case '{':
+	case '[':
+		if (++parser->depth > JSON_MAX_DEPTH)
+			return false;
+
+		value->type = *parser->p == '{' ? JSON_OBJECT : JSON_ARRAY;
+
+		parser->p++;
+
+		ret = json_parse_elements(parser, value, value->type == JSON_OBJECT ? "}" : "]");
+
+		parser->depth--;
+
+		return ret;
+	case '"':
+		value->type	= JSON_STRING;
+		value->string	= json_parse_string(parser);
+
+		return value->string != NULL;
+	case 't':
+		value->type = JSON_TRUE;
+
+		return json_consume(parser, "true");
+	case 'f':
+		value->type = JSON_FALSE;
+
+		return json_consume(parser, "false");
+	case 'n':
+		value->type = JSON_NULL;
+
+		return json_consume(parser, "null");
+	default: {
+		char buf[64], *end;
+		size_t len = parser->end - parser->p;
+
+		if (len >= sizeof(buf))
+			len = sizeof(buf) - 1;
+
+		memcpy(buf, parser->p, len);
+		buf[len] = '\0';
+
+		value->type	= JSON_NUMBER;
+		value->number	= strtod(buf, &end);
+
+		if (end == buf)
+			return false;
+
+		parser->p += end - buf;
+
+		return true;
+	}
+	}
+}
+
+/*
+ * Parse a JSON document.  Returns NULL if it is not valid.
+ */
+struct json_value *json_parse(const char *text, size_t len)
+{
+	struct json_parser parser;
+	struct json_value *value;
+
+	parser = (struct json_parser) {
+		.p		= text,
+		.end		= text + len,
+	};
+
+	value = calloc(1, sizeof(*value));
+	if (!value)
+		error("out of memory");
+
+	if (!json_parse_value(&parser, value))
+		goto invalid;
+
+	json_skip_space(&parser);
+
+	if (parser.p != parser.end)
+		goto invalid;
+
+	return value;
+
+invalid:
+	json_free(value);
+
+	return NULL;
+}
+
+struct json_value *json_read(const char *filename)
+{
+	struct json_value *ret;
+	struct stat st;
+	char *text;
+	ssize_t nr;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		error("%s: %s", filename, strerror(errno));
+
+	if (fstat(fd, &st) < 0)
+		error("%s: %s", filename, strerror(errno));
+
+	text = malloc(st.st_size + 1);
+	if (!text)
+		error("out of memory");
+
+	nr = read(fd, text, st.st_size);
+	if (nr != st.st_size)
+		error("%s: %s", filename, nr < 0 ? strerror(errno) : "short read");
+
+	close(fd);
+
+	ret = json_parse(text, st.st_size);
+	if (!ret)
+		error("%s: not a valid JSON file", filename);
+
+	free(text);
+
+	return ret;
+}
+
+void json_free(struct json_value *value)
+{
+	if (!value)
+		return;
+
+	json_free_value(value);
+
+	free(value);
+}
+
+const struct json_value *json_get(const struct json_value *object, const char *key)
+{
+	unsigned int i;
+
+	if (!object || object->type != JSON_OBJECT)
+		return NULL;
+
+	for (i = 0; i < object->nr_elements; i++) {
+		if (!strcmp(object->keys[i], key))
+			return &object->elements[i];
+	}
+
+	return NULL;
+}
+
+double json_number(const struct json_value *object, const char *key, double def)
+{
+	const struct json_value *value = json_get(object, key);
+
+	if (!value || value->type != JSON_NUMBER)
+		return def;
+
+	return value->number;
+}
+
+const char *json_string(const struct json_value *object, const char *key)
+{
+	const struct json_value *value = json_get(object, key);
+
+	if (!value || value->type != JSON_STRING)
+		return NULL;
+
+	return value->string;
+}
+
+void json_print_string(FILE *file, const char *s)
+{
+	fputc('"', file);
+
+	for (; *s; s++) {
+		unsigned char ch = *s;
+
+		switch (ch) {
+		case '"':
+			fputs("\\\"", file);
+			break;
+		case '\\':
+			fputs("\\\\", file);
+			break;
+		case '\n':
+			fputs("\\n", file);
+			break;
+		case '\t':
+			fputs("\\t", file);
+			break;
+		default:
+			if (ch < 0x20)
+				fputc('?', file);
+			else
+				fputc(ch, file);
+			break;
+		}
+	}
+
+	fputc('"', file);
+}
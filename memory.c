@@ -0,0 +1,181 @@
+#include "tick/memory.h"
+
+#include "tick/output.h"
+#include "tick/error.h"
+
+#include <sys/resource.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/*
+ * Bytes that malloc() adds to every allocation, and bytes per bucket of a
+ * GHashTable: the hash, the key and the value.
+ */
+#define MEMORY_MALLOC_OVERHEAD	16
+#define MEMORY_BUCKET_SIZE	20
+
+struct memory memory;
+
+static const char *table_names[MEMORY_NR_TABLES] = {
+	[MEMORY_TABLE_ORDERS]	= "Orders",
+	[MEMORY_TABLE_EXECS]	= "Executions",
+};
+
+void memory_start(const char *filename, uint64_t budget)
+{
+	memory = (struct memory) {
+		.enabled	= true,
+		.filename	= filename,
+		.budget		= budget,
+	};
+}
+
+/*
+ * GLib keeps the number of buckets a power of two and grows the table
+ * before it is full.
+ */
+static uint64_t table_bytes(uint64_t nr_entries, size_t entry_size)
+{
+	uint64_t nr_buckets = 8;
+
+	while (nr_buckets * 15 / 16 < nr_entries)
+		nr_buckets *= 2;
+
+	return nr_entries * (entry_size + MEMORY_MALLOC_OVERHEAD) + nr_buckets * MEMORY_BUCKET_SIZE;
+}
+
+static void memory_sample_table(struct memory_table_stats *stats)
+{
+	if (!stats->table)
+		return;
+
+	stats->live	= g_hash_table_size(stats->table);
+	stats->bytes	= table_bytes(stats->live, stats->entry_size);
+
+	if (stats->live > stats->peak)
+		stats->peak = stats->live;
+
+	if (stats->bytes > stats->peak_bytes)
+		stats->peak_bytes = stats->bytes;
+}
+
+void memory_sample(uint64_t input_mapped, uint64_t input_buffer)
+{
+	unsigned int i;
+
+	if (!memory.enabled)
+		return;
+
+	memory.input_mapped	= input_mapped;
+	memory.input_buffer	= input_buffer;
+	memory.total		= input_buffer;
+
+	for (i = 0; i < MEMORY_NR_TABLES; i++) {
+		memory_sample_table(&memory.tables[i]);
+
+		memory.total += memory.tables[i].bytes;
+	}
+
+	if (memory.output)
+		memory.output_bytes = memory.output->buffer_bytes;
+
+	memory.total += memory.output_bytes;
+
+	if (memory.total > memory.peak_total)
+		memory.peak_total = memory.total;
+
+	if (memory.budget && memory.total > memory.budget) {
+		print_memory();
+
+		error("%s: memory budget of %.1f MB exceeded (%.1f MB in use)",
+			memory.filename, memory.budget / 1e6, memory.total / 1e6);
+	}
+}
+
+void memory_track_table(enum memory_table id, GHashTable *table, size_t entry_size)
+{
+	struct memory_table_stats *stats = &memory.tables[id];
+
+	stats->table		= table;
+	stats->entry_size	= entry_size;
+}
+
+/*
+ * Stop accounting for a table that is about to be released.  The table is
+ * sampled one last time so that the report shows its final size.
+ */
+void memory_untrack_table(enum memory_table id)
+{
+	struct memory_table_stats *stats = &memory.tables[id];
+
+	if (memory.enabled)
+		memory_sample_table(stats);
+
+	stats->table = NULL;
+}
+
+/*
+ * Stop accounting for the output before it is closed.  Its buffers are
+ * remembered for the report.
+ */
+void memory_untrack_output(void)
+{
+	if (memory.output)
+		memory.output_bytes = memory.output->buffer_bytes;
+
+	memory.output = NULL;
+}
+
+static void print_row(const char *name, uint64_t live, uint64_t peak, uint64_t bytes, uint64_t peak_bytes)
+{
+	fprintf(stderr, "  %-22s %'14" PRIu64 " %'14" PRIu64 " %'12.1f %'12.1f\n",
+		name, live, peak, bytes / 1e6, peak_bytes / 1e6);
+}
+
+static void print_bytes(const char *name, uint64_t bytes)
+{
+	fprintf(stderr, "  %-22s %14s %14s %'12.1f\n", name, "", "", bytes / 1e6);
+}
+
+void print_memory(void)
+{
+	struct rusage usage;
+	unsigned int i;
+
+	if (!memory.enabled)
+		return;
+
+	fprintf(stderr, "\n Memory for '%s':\n\n", memory.filename);
+
+	fprintf(stderr, "  %-22s %14s %14s %12s %12s\n",
+		"Structure", "Entries", "Peak entries", "MB", "Peak MB");
+
+	for (i = 0; i < MEMORY_NR_TABLES; i++) {
+		struct memory_table_stats *stats = &memory.tables[i];
+
+		if (!stats->entry_size)
+			continue;
+
+		print_row(table_names[i], stats->live, stats->peak, stats->bytes, stats->peak_bytes);
+	}
+
+	print_bytes("Input buffer", memory.input_buffer);
+
+	if (memory.output_bytes)
+		print_bytes("Output buffers", memory.output_bytes);
+
+	fprintf(stderr, "  %-22s %14s %14s %'12.1f %'12.1f\n",
+		"Total", "", "", memory.total / 1e6, memory.peak_total / 1e6);
+
+	fprintf(stderr, "\n");
+
+	print_bytes("Input (mapped)", memory.input_mapped);
+
+	if (!getrusage(RUSAGE_SELF, &usage))
+		print_bytes("Peak RSS", usage.ru_maxrss * 1024ULL);
+
+	if (memory.budget)
+		print_bytes("Budget", memory.budget);
+
+	fprintf(stderr, "\n");
+}
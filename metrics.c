@@ -0,0 +1,412 @@
+#include "tick/metrics.h"
+
+#include "tick/output.h"
+#include "tick/symbol.h"
+#include "tick/error.h"
+#include "tick/types.h"
+#include "tick/dsv.h"
+#include "tick/ob.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char header[] =
+	"Date\tSymbol\tTime\tSpread\tImbalance\tAdds\tCancels\tExecutions\tTrades\t"
+	"OrderToTrade\tCancelRate\tLifetimeP50\tLifetimeP90\tLifetimeP99\n";
+
+void metrics_init(struct metrics *metrics, struct output *out, uint64_t interval)
+{
+	*metrics = (struct metrics) {
+		.out		= out,
+		.interval	= interval,
+	};
+}
+
+void metrics_release(struct metrics *metrics)
+{
+	unsigned int i;
+
+	for (i = 0; i < metrics->nr_symbols; i++) {
+		free(metrics->symbols[i].bids.levels);
+		free(metrics->symbols[i].asks.levels);
+	}
+
+	free(metrics->symbols);
+	free(metrics->active);
+}
+
+void metrics_write_header(struct metrics *metrics)
+{
+	output_write_header(metrics->out, header, strlen(header));
+}
+
+/*
+ * Returns the index of the first level that is not better than 'price'.
+ */
+static unsigned int side_search(struct metrics_side *side, uint64_t price)
+{
+	unsigned int first = 0, last = side->nr_levels;
+
+	while (first < last) {
+		unsigned int mid = first + (last - first) / 2;
+		uint64_t level = side->levels[mid].price;
+
+		if (side->descending ? level > price : level < price)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+
+	return first;
+}
+
+static void side_add(struct metrics_side *side, uint64_t price, uint64_t quantity)
+{
+	unsigned int idx = side_search(side, price);
+
+	if (idx < side->nr_levels && side->levels[idx].price == price) {
+		side->levels[idx].quantity += quantity;
+		return;
+	}
+
+	if (side->nr_levels == side->capacity) {
+		side->capacity = side->capacity ? 2 * side->capacity : 64;
+
+		side->levels = realloc(side->levels, side->capacity * sizeof(*side->levels));
+		if (!side->levels)
+			error("out of memory");
+	}
+
+	memmove(side->levels + idx + 1, side->levels + idx, (side->nr_levels - idx) * sizeof(*side->levels));
+
+	side->levels[idx] = (struct metrics_level) {
+		.price		= price,
+		.quantity	= quantity,
+	};
+
+	side->nr_levels++;
+}
+
+static void side_remove(struct metrics_side *side, uint64_t price, uint64_t quantity)
+{
+	unsigned int idx = side_search(side, price);
+	struct metrics_level *level;
+
+	if (idx == side->nr_levels || side->levels[idx].price != price)
+		return;
+
+	level = &side->levels[idx];
+
+	if (level->quantity > quantity) {
+		level->quantity -= quantity;
+		return;
+	}
+
+	side->nr_levels--;
+
+	memmove(level, level + 1, (side->nr_levels - idx) * sizeof(*side->levels));
+}
+
+static inline struct metrics_level *side_best(struct metrics_side *side)
+{
+	return side->nr_levels ? &side->levels[side->nr_levels - 1] : NULL;
+}
+
+static struct metrics_symbol *metrics_symbol(struct metrics *metrics, uint32_t symbol)
+{
+	struct metrics_symbol *sym;
+
+	if (symbol >= metrics->nr_symbols) {
+		unsigned int nr = metrics->nr_symbols ? metrics->nr_symbols : 1024;
+		unsigned int i;
+
+		while (nr <= symbol)
+			nr *= 2;
+
+		metrics->symbols = realloc(metrics->symbols, nr * sizeof(*metrics->symbols));
+		metrics->active = realloc(metrics->active, nr * sizeof(*metrics->active));
+		if (!metrics->symbols || !metrics->active)
+			error("out of memory");
+
+		memset(metrics->symbols + metrics->nr_symbols, 0, (nr - metrics->nr_symbols) * sizeof(*metrics->symbols));
+
+		for (i = metrics->nr_symbols; i < nr; i++)
+			metrics->symbols[i].asks.descending = true;
+
+		metrics->nr_symbols = nr;
+	}
+
+	sym = &metrics->symbols[symbol];
+
+	if (!sym->active) {
+		sym->active = true;
+
+		metrics->active[metrics->nr_active++] = symbol;
+	}
+
+	return sym;
+}
+
+/*
+ * Accumulate the time-weighted book metrics from the last book change, or
+ * from the start of the interval, up to 'time'.
+ */
+static void metrics_accumulate(struct metrics *metrics, struct metrics_symbol *sym, uint64_t time)
+{
+	struct metrics_level *bid = side_best(&sym->bids);
+	struct metrics_level *ask = side_best(&sym->asks);
+	uint64_t from = sym->last_time;
+
+	if (from < metrics->start)
+		from = metrics->start;
+
+	if (time > from && bid && ask) {
+		uint64_t dt = time - from;
+
+		sym->spread_sum		+= (double) dt * ((double) ask->price - (double) bid->price);
+		sym->imbalance_sum	+= (double) dt * ((double) bid->quantity - (double) ask->quantity) /
+					   (double) (bid->quantity + ask->quantity);
+		sym->quoted_time	+= dt;
+	}
+
+	if (time > sym->last_time)
+		sym->last_time = time;
+}
+
+static size_t fmt_decimal(char *buf, double value, bool valid, char delim)
+{
+	size_t ret = 0;
+
+	if (!valid)
+		return dsv_fmt_null(buf, delim);
+
+	if (value < 0) {
+		buf[ret++] = '-';
+		value = -value;
+	}
+
+	return ret + dsv_fmt_price(buf + ret, (uint64_t) (value * DSV_PRICE_SCALE + 0.5), delim);
+}
+
+/*
+ * Lifetimes are kept in power-of-two buckets and a quantile is reported as
+ * the lower bound of its bucket.
+ */
+static size_t fmt_lifetime(char *buf, struct metrics_symbol *sym, unsigned int percentile, char delim)
+{
+	uint64_t rank, count = 0;
+	unsigned int i;
+
+	if (!sym->nr_lifetimes)
+		return dsv_fmt_null(buf, delim);
+
+	rank = (sym->nr_lifetimes * percentile + 99) / 100;
+
+	for (i = 0; i < METRICS_LIFETIME_BUCKETS; i++) {
+		count += sym->lifetimes[i];
+		if (count >= rank)
+			break;
+	}
+
+	return dsv_fmt_uint(buf, i ? 1ULL << i : 0, delim);
+}
+
+/*
+ * Longest row after the Date and Symbol columns:
+ */
+#define METRICS_ROW_LEN		(8 * DSV_UINT_MAX_LEN + 4 * (1 + DSV_PRICE_MAX_LEN))
+
+static void metrics_write(struct metrics *metrics, uint32_t symbol, struct metrics_symbol *sym)
+{
+	uint64_t nr_fills = sym->nr_executions + sym->nr_trades;
+	uint64_t nr_orders = sym->nr_open_start + sym->nr_adds;
+	size_t idx = 0;
+	char *buf;
+
+	output_begin_row(metrics->out, metrics->start);
+
+	buf = output_reserve(metrics->out, metrics->date_len + 1 + SYMBOL_MAX_LEN + 1 + METRICS_ROW_LEN);
+
+	idx += dsv_fmt_value(buf + idx, metrics->date, metrics->date_len, '\t');
+	idx += dsv_fmt_value(buf + idx, symbol_name(symbol), symbol_len(symbol), '\t');
+	idx += dsv_fmt_uint(buf + idx, metrics->start, '\t');
+
+	/* A crossed book has a negative spread: */
+	idx += fmt_decimal(buf + idx, sym->quoted_time ? sym->spread_sum / sym->quoted_time / DSV_PRICE_SCALE : 0, sym->quoted_time, '\t');
+	idx += fmt_decimal(buf + idx, sym->quoted_time ? sym->imbalance_sum / sym->quoted_time : 0, sym->quoted_time, '\t');
+	idx += dsv_fmt_uint(buf + idx, sym->nr_adds, '\t');
+	idx += dsv_fmt_uint(buf + idx, sym->nr_cancels, '\t');
+	idx += dsv_fmt_uint(buf + idx, sym->nr_executions, '\t');
+	idx += dsv_fmt_uint(buf + idx, sym->nr_trades, '\t');
+	idx += fmt_decimal(buf + idx, nr_fills ? (double) sym->nr_adds / nr_fills : 0, nr_fills, '\t');
+	idx += fmt_decimal(buf + idx, nr_orders ? (double) sym->nr_canceled / nr_orders : 0, nr_orders, '\t');
+	idx += fmt_lifetime(buf + idx, sym, 50, '\t');
+	idx += fmt_lifetime(buf + idx, sym, 90, '\t');
+	idx += fmt_lifetime(buf + idx, sym, 99, '\n');
+
+	output_commit(metrics->out, idx);
+}
+
+/*
+ * Write out the metrics of the current interval and start over.
+ */
+void metrics_flush(struct metrics *metrics)
+{
+	uint64_t end = metrics->start + metrics->interval;
+	unsigned int i;
+
+	for (i = 0; i < metrics->nr_active; i++) {
+		uint32_t symbol = metrics->active[i];
+		struct metrics_symbol *sym = &metrics->symbols[symbol];
+
+		metrics_accumulate(metrics, sym, end);
+
+		metrics_write(metrics, symbol, sym);
+
+		sym->active		= false;
+		sym->spread_sum		= 0;
+		sym->imbalance_sum	= 0;
+		sym->quoted_time	= 0;
+		sym->nr_open_start	= sym->nr_open;
+		sym->nr_adds		= 0;
+		sym->nr_cancels		= 0;
+		sym->nr_canceled	= 0;
+		sym->nr_executions	= 0;
+		sym->nr_trades		= 0;
+		sym->nr_lifetimes	= 0;
+
+		memset(sym->lifetimes, 0, sizeof(sym->lifetimes));
+	}
+
+	metrics->nr_active = 0;
+}
+
+static void metrics_advance(struct metrics *metrics, uint64_t time)
+{
+	uint64_t start = time - time % metrics->interval;
+
+	if (start == metrics->start)
+		return;
+
+	metrics_flush(metrics);
+
+	metrics->start = start;
+}
+
+static inline struct metrics_side *metrics_side(struct metrics_symbol *sym, char side)
+{
+	return side == 'B' ? &sym->bids : &sym->asks;
+}
+
+static void metrics_add_order(struct metrics_symbol *sym, struct ob_event *event)
+{
+	side_add(metrics_side(sym, event->side), event->price, event->quantity);
+
+	sym->nr_adds++;
+	sym->nr_open++;
+}
+
+/*
+ * Returns true if the order left the book.
+ */
+static bool metrics_reduce_order(struct metrics_symbol *sym, struct ob_event *event)
+{
+	uint64_t lifetime;
+
+	if (!(event->fields & OB_FIELD_ORDER))
+		return false;
+
+	side_remove(metrics_side(sym, event->order_side), event->order_price, event->quantity);
+
+	if (event->order_remaining)
+		return false;
+
+	lifetime = event->time > event->order_time ? event->time - event->order_time : 0;
+
+	sym->lifetimes[lifetime ? 63 - __builtin_clzll(lifetime) : 0]++;
+	sym->nr_lifetimes++;
+
+	if (sym->nr_open)
+		sym->nr_open--;
+
+	return true;
+}
+
+static void metrics_clear(struct metrics_symbol *sym)
+{
+	sym->bids.nr_levels = 0;
+	sym->asks.nr_levels = 0;
+
+	sym->nr_open = 0;
+}
+
+/*
+ * A change of date starts a new session, so the open intervals are written
+ * out first.  Feeds announce the date once per exchange, which does not
+ * start a new session.
+ */
+static void metrics_date(struct metrics *metrics, const char *date, size_t len)
+{
+	unsigned int i;
+
+	if (len >= METRICS_DATE_LEN)
+		len = METRICS_DATE_LEN - 1;
+
+	if (len == metrics->date_len && !memcmp(metrics->date, date, len))
+		return;
+
+	metrics_flush(metrics);
+
+	for (i = 0; i < metrics->nr_symbols; i++)
+		metrics->symbols[i].last_time = 0;
+
+	memcpy(metrics->date, date, len);
+
+	metrics->date_len = len;
+}
+
+void metrics_ob_event(void *data, struct ob_event *event)
+{
+	struct metrics *metrics = data;
+	struct metrics_symbol *sym;
+
+	if (event->type == OB_EVENT_DATE) {
+		metrics_date(metrics, event->date, event->date_len);
+		return;
+	}
+
+	if (!(event->fields & OB_FIELD_TIME) || !(event->fields & OB_FIELD_SYMBOL))
+		return;
+
+	metrics_advance(metrics, event->time);
+
+	sym = metrics_symbol(metrics, event->symbol);
+
+	metrics_accumulate(metrics, sym, event->time);
+
+	switch (event->type) {
+	case OB_EVENT_ADD_ORDER:
+		metrics_add_order(sym, event);
+		break;
+	case OB_EVENT_CANCEL_ORDER:
+		if (metrics_reduce_order(sym, event))
+			sym->nr_canceled++;
+		sym->nr_cancels++;
+		break;
+	case OB_EVENT_EXECUTE_ORDER:
+		metrics_reduce_order(sym, event);
+		sym->nr_executions++;
+		break;
+	case OB_EVENT_TRADE:
+		sym->nr_trades++;
+		break;
+	case OB_EVENT_CLEAR:
+		metrics_clear(sym);
+		break;
+	case OB_EVENT_DATE:
+	case OB_EVENT_TRADE_BREAK:
+	case OB_EVENT_STATUS:
+	default:
+		break;
+	}
+}
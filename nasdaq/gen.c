@@ -0,0 +1,281 @@
+#include "tick/nasdaq/gen.h"
+
+#include "libtrading/proto/nasdaq_itch41_message.h"
+#include "libtrading/byte-order.h"
+
+#include "tick/gen.h"
+
+#include <string.h>
+
+#define NSEC_PER_SEC		1000000000ULL
+
+#define ADD_ORDER_MPID_PROB	0.05
+#define EXECUTED_PRICE_PROB	0.02
+
+struct nasdaq_itch_gen {
+	struct gen_output	*out;
+	uint64_t		nr_messages;
+	uint64_t		second;
+	uint64_t		time;
+};
+
+static void nasdaq_itch_write(struct nasdaq_itch_gen *itch, const void *msg, size_t len)
+{
+	be16 size = cpu_to_be16(len);
+
+	gen_output_write(itch->out, &size, sizeof(size));
+	gen_output_write(itch->out, msg, len);
+
+	itch->nr_messages++;
+}
+
+/*
+ * Every message carries the nanoseconds of the second that was last
+ * announced with a 'T' message.
+ */
+static be32 nasdaq_itch_timestamp(struct nasdaq_itch_gen *itch, uint64_t time)
+{
+	if (time / NSEC_PER_SEC != itch->second) {
+		struct itch41_msg_timestamp_seconds m;
+
+		itch->second = time / NSEC_PER_SEC;
+
+		m = (struct itch41_msg_timestamp_seconds) {
+			.MessageType	= ITCH41_MSG_TIMESTAMP_SECONDS,
+			.Second		= cpu_to_be32(itch->second),
+		};
+
+		nasdaq_itch_write(itch, &m, sizeof(m));
+	}
+
+	itch->time = time;
+
+	return cpu_to_be32(time % NSEC_PER_SEC);
+}
+
+static void nasdaq_itch_stock(char *stock, struct gen_symbol *sym)
+{
+	memset(stock, ' ', 8);
+	memcpy(stock, sym->name, GEN_SYMBOL_LEN);
+}
+
+static void nasdaq_itch_system_event(struct nasdaq_itch_gen *itch, char event_code)
+{
+	struct itch41_msg_system_event m;
+
+	m = (struct itch41_msg_system_event) {
+		.MessageType		= ITCH41_MSG_SYSTEM_EVENT,
+		.TimestampNanoseconds	= nasdaq_itch_timestamp(itch, itch->time),
+		.EventCode		= event_code,
+	};
+
+	nasdaq_itch_write(itch, &m, sizeof(m));
+}
+
+static void nasdaq_itch_stock_directory(struct nasdaq_itch_gen *itch, struct gen_symbol *sym)
+{
+	struct itch41_msg_stock_directory m;
+
+	m = (struct itch41_msg_stock_directory) {
+		.MessageType			= ITCH41_MSG_STOCK_DIRECTORY,
+		.TimestampNanoseconds		= nasdaq_itch_timestamp(itch, itch->time),
+		.MarketCategory			= 'Q',
+		.FinancialStatusIndicator	= 'N',
+		.RoundLotSize			= cpu_to_be32(100),
+		.RoundLotsOnly			= 'N',
+	};
+
+	nasdaq_itch_stock(m.Stock, sym);
+
+	nasdaq_itch_write(itch, &m, sizeof(m));
+}
+
+static void nasdaq_itch_add_order(struct nasdaq_itch_gen *itch, struct gen *gen, struct gen_event *event)
+{
+	struct gen_symbol *sym = &gen->symbols[event->symbol];
+
+	if (gen_uniform(gen) < ADD_ORDER_MPID_PROB) {
+		struct itch41_msg_add_order_mpid m;
+
+		m = (struct itch41_msg_add_order_mpid) {
+			.MessageType		= ITCH41_MSG_ADD_ORDER_MPID,
+			.TimestampNanoseconds	= nasdaq_itch_timestamp(itch, event->time),
+			.OrderReferenceNumber	= cpu_to_be64(event->order_id),
+			.BuySellIndicator	= event->side,
+			.Shares			= cpu_to_be32(event->quantity),
+			.Price			= cpu_to_be32(event->price),
+			.Attribution		= { 'G', 'E', 'N', 'X' },
+		};
+
+		nasdaq_itch_stock(m.Stock, sym);
+
+		nasdaq_itch_write(itch, &m, sizeof(m));
+	} else {
+		struct itch41_msg_add_order m;
+
+		m = (struct itch41_msg_add_order) {
+			.MessageType		= ITCH41_MSG_ADD_ORDER,
+			.TimestampNanoseconds	= nasdaq_itch_timestamp(itch, event->time),
+			.OrderReferenceNumber	= cpu_to_be64(event->order_id),
+			.BuySellIndicator	= event->side,
+			.Shares			= cpu_to_be32(event->quantity),
+			.Price			= cpu_to_be32(event->price),
+		};
+
+		nasdaq_itch_stock(m.Stock, sym);
+
+		nasdaq_itch_write(itch, &m, sizeof(m));
+	}
+}
+
+static void nasdaq_itch_order_executed(struct nasdaq_itch_gen *itch, struct gen *gen, struct gen_event *event)
+{
+	if (gen_uniform(gen) < EXECUTED_PRICE_PROB) {
+		struct itch41_msg_order_executed_with_price m;
+
+		m = (struct itch41_msg_order_executed_with_price) {
+			.MessageType		= ITCH41_MSG_ORDER_EXECUTED_WITH_PRICE,
+			.TimestampNanoseconds	= nasdaq_itch_timestamp(itch, event->time),
+			.OrderReferenceNumber	= cpu_to_be64(event->order_id),
+			.ExecutedShares		= cpu_to_be32(event->quantity),
+			.MatchNumber		= cpu_to_be64(event->exec_id),
+			.Printable		= 'Y',
+			.ExecutionPrice		= cpu_to_be32(event->price),
+		};
+
+		nasdaq_itch_write(itch, &m, sizeof(m));
+	} else {
+		struct itch41_msg_order_executed m;
+
+		m = (struct itch41_msg_order_executed) {
+			.MessageType		= ITCH41_MSG_ORDER_EXECUTED,
+			.TimestampNanoseconds	= nasdaq_itch_timestamp(itch, event->time),
+			.OrderReferenceNumber	= cpu_to_be64(event->order_id),
+			.ExecutedShares		= cpu_to_be32(event->quantity),
+			.MatchNumber		= cpu_to_be64(event->exec_id),
+		};
+
+		nasdaq_itch_write(itch, &m, sizeof(m));
+	}
+}
+
+static void nasdaq_itch_order_cancel(struct nasdaq_itch_gen *itch, struct gen_event *event)
+{
+	struct itch41_msg_order_cancel m;
+
+	m = (struct itch41_msg_order_cancel) {
+		.MessageType		= ITCH41_MSG_ORDER_CANCEL,
+		.TimestampNanoseconds	= nasdaq_itch_timestamp(itch, event->time),
+		.OrderReferenceNumber	= cpu_to_be64(event->order_id),
+		.CanceledShares		= cpu_to_be32(event->quantity),
+	};
+
+	nasdaq_itch_write(itch, &m, sizeof(m));
+}
+
+static void nasdaq_itch_order_delete(struct nasdaq_itch_gen *itch, struct gen_event *event)
+{
+	struct itch41_msg_order_delete m;
+
+	m = (struct itch41_msg_order_delete) {
+		.MessageType		= ITCH41_MSG_ORDER_DELETE,
+		.TimestampNanoseconds	= nasdaq_itch_timestamp(itch, event->time),
+		.OrderReferenceNumber	= cpu_to_be64(event->order_id),
+	};
+
+	nasdaq_itch_write(itch, &m, sizeof(m));
+}
+
+static void nasdaq_itch_order_replace(struct nasdaq_itch_gen *itch, struct gen_event *event)
+{
+	struct itch41_msg_order_replace m;
+
+	m = (struct itch41_msg_order_replace) {
+		.MessageType			= ITCH41_MSG_ORDER_REPLACE,
+		.TimestampNanoseconds		= nasdaq_itch_timestamp(itch, event->time),
+		.OriginalOrderReferenceNumber	= cpu_to_be64(event->order_id),
+		.NewOrderReferenceNumber	= cpu_to_be64(event->new_order_id),
+		.Shares				= cpu_to_be32(event->new_quantity),
+		.Price				= cpu_to_be32(event->new_price),
+	};
+
+	nasdaq_itch_write(itch, &m, sizeof(m));
+}
+
+static void nasdaq_itch_trade(struct nasdaq_itch_gen *itch, struct gen *gen, struct gen_event *event)
+{
+	struct itch41_msg_trade m;
+
+	m = (struct itch41_msg_trade) {
+		.MessageType		= ITCH41_MSG_TRADE,
+		.TimestampNanoseconds	= nasdaq_itch_timestamp(itch, event->time),
+		.BuySellIndicator	= event->side,
+		.Shares			= cpu_to_be32(event->quantity),
+		.Price			= cpu_to_be32(event->price),
+		.MatchNumber		= cpu_to_be64(event->exec_id),
+	};
+
+	nasdaq_itch_stock(m.Stock, &gen->symbols[event->symbol]);
+
+	nasdaq_itch_write(itch, &m, sizeof(m));
+}
+
+void nasdaq_itch_gen(struct gen *gen, struct gen_output *out, uint64_t nr_messages)
+{
+	uint64_t next_progress = GEN_PROGRESS_STEP;
+	struct nasdaq_itch_gen itch;
+	unsigned int i;
+
+	itch = (struct nasdaq_itch_gen) {
+		.out		= out,
+		.second		= UINT64_MAX,
+		.time		= gen->time,
+	};
+
+	nasdaq_itch_system_event(&itch, 'O');
+
+	for (i = 0; i < gen->nr_symbols; i++)
+		nasdaq_itch_stock_directory(&itch, &gen->symbols[i]);
+
+	nasdaq_itch_system_event(&itch, 'S');
+	nasdaq_itch_system_event(&itch, 'Q');
+
+	while (itch.nr_messages < nr_messages) {
+		struct gen_event event;
+
+		gen_next(gen, &event);
+
+		switch (event.type) {
+		case GEN_EVENT_ADD:
+			nasdaq_itch_add_order(&itch, gen, &event);
+			break;
+		case GEN_EVENT_EXECUTE:
+			nasdaq_itch_order_executed(&itch, gen, &event);
+			break;
+		case GEN_EVENT_CANCEL:
+			nasdaq_itch_order_cancel(&itch, &event);
+			break;
+		case GEN_EVENT_DELETE:
+			nasdaq_itch_order_delete(&itch, &event);
+			break;
+		case GEN_EVENT_REPLACE:
+			nasdaq_itch_order_replace(&itch, &event);
+			break;
+		case GEN_EVENT_TRADE:
+			nasdaq_itch_trade(&itch, gen, &event);
+			break;
+		default:
+			break;
+		}
+
+		if (itch.nr_messages >= next_progress) {
+			gen_progress(itch.nr_messages, nr_messages);
+
+			next_progress += GEN_PROGRESS_STEP;
+		}
+	}
+
+	nasdaq_itch_system_event(&itch, 'M');
+	nasdaq_itch_system_event(&itch, 'E');
+	nasdaq_itch_system_event(&itch, 'C');
+}
@@ -22,16 +22,13 @@ retry_size:
 
 		buffer_compact(stream->uncomp_buf);
 
-		nr = buffer_inflate(stream->comp_buf, stream->uncomp_buf, stream->zstream);
+		nr = stream_inflate(stream);
 		if (nr < 0)
 			return nr;
 
 		if (!nr)
 			return 0;
 
-		if (stream->progress)
-			stream->progress(stream->comp_buf);
-
 		goto retry_size;
 	}
 
@@ -44,16 +41,13 @@ retry_message:
 
 		buffer_compact(stream->uncomp_buf);
 
-		nr = buffer_inflate(stream->comp_buf, stream->uncomp_buf, stream->zstream);
+		nr = stream_inflate(stream);
 		if (nr < 0)
 			return nr;
 
 		if (!nr)
 			return 0;
 
-		if (stream->progress)
-			stream->progress(stream->comp_buf);
-
 		goto retry_message;
 	}
 
@@ -91,7 +85,16 @@ int nasdaq_itch_file_parse_date(const char *filename, char *buf, size_t buf_len)
 void nasdaq_itch_filter_init(struct nasdaq_itch_filter *filter, const char *symbol)
 {
 	memset(filter->symbol, ' ', sizeof(filter->symbol));
-	memcpy(filter->symbol, symbol, strlen(symbol));
+
+	filter->all = !symbol;
+
+	if (symbol)
+		memcpy(filter->symbol, symbol, strlen(symbol));
+}
+
+static inline bool nasdaq_itch_filter_match(struct nasdaq_itch_filter *filter, const char *stock)
+{
+	return filter->all || !memcmp(stock, filter->symbol, sizeof(filter->symbol));
 }
 
 struct nasdaq_itch_order_info *
@@ -156,32 +159,32 @@ bool nasdaq_itch_session_filter_msg(struct nasdaq_itch_session *session, struct
 	case ITCH41_MSG_STOCK_DIRECTORY: {
 		struct itch41_msg_stock_directory *m = (void *) msg;
 
-		return !memcmp(m->Stock, filter->symbol, sizeof(m->Stock));
+		return nasdaq_itch_filter_match(filter, m->Stock);
 	}
 	case ITCH41_MSG_STOCK_TRADING_ACTION: {
 		struct itch41_msg_stock_trading_action *m = (void *) msg;
 
-		return !memcmp(m->Stock, filter->symbol, sizeof(m->Stock));
+		return nasdaq_itch_filter_match(filter, m->Stock);
 	}
 	case ITCH41_MSG_ADD_ORDER: {
 		struct itch41_msg_add_order *m = (void *) msg;
 
-		return !memcmp(m->Stock, filter->symbol, sizeof(m->Stock));
+		return nasdaq_itch_filter_match(filter, m->Stock);
 	}
 	case ITCH41_MSG_ADD_ORDER_MPID: {
 		struct itch41_msg_add_order_mpid *m = (void *) msg;
 
-		return !memcmp(m->Stock, filter->symbol, sizeof(m->Stock));
+		return nasdaq_itch_filter_match(filter, m->Stock);
 	}
 	case ITCH41_MSG_TRADE: {
 		struct itch41_msg_trade *m = (void *) msg;
 
-		return !memcmp(m->Stock, filter->symbol, sizeof(m->Stock));
+		return nasdaq_itch_filter_match(filter, m->Stock);
 	}
 	case ITCH41_MSG_CROSS_TRADE: {
 		struct itch41_msg_cross_trade *m = (void *) msg;
 
-		return !memcmp(m->Stock, filter->symbol, sizeof(m->Stock));
+		return nasdaq_itch_filter_match(filter, m->Stock);
 	}
 	case ITCH41_MSG_BROKEN_TRADE: {
 		struct itch41_msg_broken_trade *m = (void *) msg;
@@ -194,7 +197,7 @@ bool nasdaq_itch_session_filter_msg(struct nasdaq_itch_session *session, struct
 		if (!e_info)
 			return false;
 
-		return !memcmp(e_info->symbol, filter->symbol, 6);
+		return filter->all || e_info->symbol == session->symbol_id;
 	}
 	default:
 		break;
@@ -5,11 +5,11 @@
 #include "libtrading/buffer.h"
 
 #include "tick/progress.h"
-#include "tick/decimal.h"
-#include "tick/base10.h"
-#include "tick/base36.h"
+#include "tick/profile.h"
+#include "tick/memory.h"
 #include "tick/format.h"
 #include "tick/stream.h"
+#include "tick/symbol.h"
 #include "tick/error.h"
 #include "tick/types.h"
 #include "tick/ob.h"
@@ -23,67 +23,83 @@
 #include <stdio.h>
 #include <glib.h>
 
-struct nasdaq_ob_event {
-	char			timestamp[16];
-	unsigned int		timestamp_len;
-	char			order_id[16];
-	unsigned int		order_id_len;
-	char			exec_id[16];
-	unsigned int		exec_id_len;
-	char			quantity[16];
-	unsigned int		quantity_len;
-	char			price[16];
-	unsigned int		price_len;
-};
-
-static void fmt_timestamp(struct nasdaq_ob_event *ev, uint64_t timestamp)
+static gboolean free_entry(gpointer __maybe_unused key, gpointer __maybe_unused  val, gpointer __maybe_unused data)
 {
-	ev->timestamp_len = snprintf(ev->timestamp, sizeof(ev->timestamp), "%lu", timestamp);
-}
+	free(val);
 
-static void fmt_order_id(struct nasdaq_ob_event *ev, uint64_t order_ref_num)
-{
-	ev->order_id_len = snprintf(ev->order_id, sizeof(ev->order_id), "%lu", order_ref_num);
+	return TRUE;
 }
 
-static void fmt_exec_id(struct nasdaq_ob_event *ev, uint64_t match_num)
+static uint64_t nasdaq_itch_timestamp(struct nasdaq_itch_session *session, unsigned long nsec)
 {
-	ev->exec_id_len = snprintf(ev->exec_id, sizeof(ev->exec_id), "%lu", match_num);
+	return session->second * 1000000000UL + nsec;
 }
 
-static void fmt_quantity(struct nasdaq_ob_event *ev, uint32_t shares)
+static inline void nasdaq_itch_order_event(struct ob_event *event, struct nasdaq_itch_order_info *info)
 {
-	ev->quantity_len = snprintf(ev->quantity, sizeof(ev->quantity), "%u", shares);
+	event->fields		|= OB_FIELD_ORDER;
+	event->order_time	= info->time;
+	event->order_price	= info->price;
+	event->order_remaining	= info->remaining;
+	event->order_side	= info->side;
 }
 
-static void fmt_price(struct nasdaq_ob_event *ev, uint32_t price)
+/*
+ * An order reference number that is still on the book replaces the order.
+ * The old order is canceled first so that books built from the events stay
+ * consistent.
+ */
+static void nasdaq_itch_add_order(struct nasdaq_itch_session *session, struct nasdaq_itch_order_info *info)
 {
-	ev->price_len = snprintf(ev->price, sizeof(ev->price), "%.10u", price);
-}
+	struct nasdaq_itch_order_info *old;
+	struct ob_event event;
 
-static gboolean free_entry(gpointer __maybe_unused key, gpointer __maybe_unused  val, gpointer __maybe_unused data)
-{
-	free(val);
+	old = g_hash_table_lookup(session->order_hash, &info->order_ref_num);
+	if (old) {
+		event = (struct ob_event) {
+			.type		= OB_EVENT_CANCEL_ORDER,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_QUANTITY,
+			.time		= info->time,
+			.exchange	= session->exchange,
+			.exchange_len	= session->exchange_len,
+			.symbol		= old->symbol,
+			.order_id	= old->order_ref_num,
+			.quantity	= old->remaining,
+		};
 
-	return TRUE;
-}
+		old->remaining = 0;
 
-static uint64_t nasdaq_itch_timestamp(struct nasdaq_itch_session *session, unsigned long nsec)
-{
-	return session->second * 1000000000UL + nsec;
+		nasdaq_itch_order_event(&event, old);
+
+		ob_write_event(session->ob_writer, &event);
+	}
+
+	g_hash_table_replace(session->order_hash, &info->order_ref_num, info);
 }
 
 static void nasdaq_itch_write(struct nasdaq_itch_session *session, struct itch41_message *msg)
 {
 	struct nasdaq_itch_order_info *info;
-	struct nasdaq_ob_event n_event;
 	struct ob_event event;
+	bool selected;
+
+	profile_enter(PROFILE_STAGE_LOOKUP);
 
 	info = nasdaq_itch_session_lookup_order(session, msg);
+
+	profile_leave();
+
 	if (info)
 		goto found;
 
-	if (!nasdaq_itch_session_filter_msg(session, msg))
+	profile_enter(PROFILE_STAGE_FILTER);
+
+	selected = nasdaq_itch_session_filter_msg(session, msg);
+
+	profile_leave();
+
+	if (!selected)
 		return;
 
 found:
@@ -97,13 +113,8 @@ found:
 	}
 	case ITCH41_MSG_STOCK_TRADING_ACTION: {
 		struct itch41_msg_stock_trading_action *m = (void *) msg;
-		uint64_t timestamp_nsec;
 		char status;
 
-		timestamp_nsec = nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds));
-
-		fmt_timestamp(&n_event, timestamp_nsec);
-
 		switch (m->TradingState) {
 		case 'H': status = 'H'; break;
 		case 'P': status = 'P'; break;
@@ -115,322 +126,218 @@ found:
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_STATUS,
-			.time		= n_event.timestamp,
-			.time_len	= n_event.timestamp_len,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL,
+			.time		= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds)),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.status		= &status,
-			.status_len	= sizeof(status),
+			.symbol		= nasdaq_itch_session_symbol(session, m->Stock),
+			.status		= status,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
 	case ITCH41_MSG_ADD_ORDER: {
 		struct itch41_msg_add_order *m = (void *) msg;
-		uint64_t timestamp_nsec;
-		uint64_t order_ref_num;
-		uint32_t shares;
-		uint32_t price;
-
-		timestamp_nsec	= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds));
-		order_ref_num	= be64_to_cpu(m->OrderReferenceNumber);
-		shares		= be32_to_cpu(m->Shares);
-		price		= be32_to_cpu(m->Price);
-
-		fmt_timestamp(&n_event, timestamp_nsec);
-		fmt_order_id (&n_event, order_ref_num);
-		fmt_quantity (&n_event, shares);
-		fmt_price    (&n_event, price);
 
 		info = malloc(sizeof(*info));
-		info->order_ref_num	= order_ref_num;
-		info->remaining		= shares;
-		info->price		= price;
+		info->order_ref_num	= be64_to_cpu(m->OrderReferenceNumber);
+		info->time		= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds));
+		info->remaining		= be32_to_cpu(m->Shares);
+		info->price		= be32_to_cpu(m->Price);
 		info->side		= m->BuySellIndicator;
+		info->symbol		= nasdaq_itch_session_symbol(session, m->Stock);
 
-		g_hash_table_insert(session->order_hash, &info->order_ref_num, info);
+		nasdaq_itch_add_order(session, info);
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_ADD_ORDER,
-			.time		= n_event.timestamp,
-			.time_len	= n_event.timestamp_len,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_QUANTITY | OB_FIELD_PRICE,
+			.time		= info->time,
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= n_event.order_id,
-			.order_id_len	= n_event.order_id_len,
-			.side		= &info->side,
-			.side_len	= sizeof(info->side),
-			.quantity	= n_event.quantity,
-			.quantity_len	= n_event.quantity_len,
-			.price		= (struct decimal) {
-				.integer	= n_event.price,
-				.integer_len	= 6,
-				.fraction	= n_event.price + 6,
-				.fraction_len	= 4,
-			},
+			.symbol		= info->symbol,
+			.order_id	= info->order_ref_num,
+			.side		= info->side,
+			.quantity	= info->remaining,
+			.price		= info->price,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
 	case ITCH41_MSG_ADD_ORDER_MPID: {
 		struct itch41_msg_add_order_mpid *m = (void *) msg;
-		uint64_t timestamp_nsec;
-		uint64_t order_ref_num;
-		uint32_t shares;
-		uint32_t price;
-
-		timestamp_nsec	= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds));
-		order_ref_num	= be64_to_cpu(m->OrderReferenceNumber);
-		shares		= be32_to_cpu(m->Shares);
-		price		= be32_to_cpu(m->Price);
-
-		fmt_timestamp(&n_event, timestamp_nsec);
-		fmt_order_id (&n_event, order_ref_num);
-		fmt_quantity (&n_event, shares);
-		fmt_price    (&n_event, price);
 
 		info = malloc(sizeof(*info));
-		info->order_ref_num	= order_ref_num;
-		info->remaining		= shares;
-		info->price		= price;
+		info->order_ref_num	= be64_to_cpu(m->OrderReferenceNumber);
+		info->time		= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds));
+		info->remaining		= be32_to_cpu(m->Shares);
+		info->price		= be32_to_cpu(m->Price);
 		info->side		= m->BuySellIndicator;
+		info->symbol		= nasdaq_itch_session_symbol(session, m->Stock);
 
-		g_hash_table_insert(session->order_hash, &info->order_ref_num, info);
+		nasdaq_itch_add_order(session, info);
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_ADD_ORDER,
-			.time		= n_event.timestamp,
-			.time_len	= n_event.timestamp_len,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_QUANTITY | OB_FIELD_PRICE,
+			.time		= info->time,
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= n_event.order_id,
-			.order_id_len	= n_event.order_id_len,
-			.side		= &m->BuySellIndicator,
-			.side_len	= sizeof(m->BuySellIndicator),
-			.quantity	= n_event.quantity,
-			.quantity_len	= n_event.quantity_len,
-			.price		= (struct decimal) {
-				.integer	= n_event.price,
-				.integer_len	= 6,
-				.fraction	= n_event.price + 6,
-				.fraction_len	= 4,
-			},
+			.symbol		= info->symbol,
+			.order_id	= info->order_ref_num,
+			.side		= info->side,
+			.quantity	= info->remaining,
+			.price		= info->price,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
 	case ITCH41_MSG_ORDER_EXECUTED: {
 		struct itch41_msg_order_executed *m = (void *) msg;
-		uint64_t timestamp_nsec;
-		uint64_t order_ref_num;
-		uint64_t match_num;
 		uint32_t shares;
 
-		timestamp_nsec	= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds));
-		order_ref_num	= be64_to_cpu(m->OrderReferenceNumber);
-		shares		= be32_to_cpu(m->ExecutedShares);
-		match_num	= be64_to_cpu(m->MatchNumber);
+		shares = be32_to_cpu(m->ExecutedShares);
+
+		assert(info->remaining >= shares);
 
-		fmt_timestamp(&n_event, timestamp_nsec);
-		fmt_order_id (&n_event, order_ref_num);
-		fmt_quantity (&n_event, shares);
-		fmt_exec_id  (&n_event, match_num);
-		fmt_price    (&n_event, info->price);
+		info->remaining -= shares;
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_EXECUTE_ORDER,
-			.time		= n_event.timestamp,
-			.time_len	= n_event.timestamp_len,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_EXEC_ID | OB_FIELD_QUANTITY | OB_FIELD_PRICE,
+			.time		= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds)),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= n_event.order_id,
-			.order_id_len	= n_event.order_id_len,
-			.exec_id	= n_event.exec_id,
-			.exec_id_len	= n_event.exec_id_len,
-			.quantity	= n_event.quantity,
-			.quantity_len	= n_event.quantity_len,
-			.price		= (struct decimal) {
-				.integer	= n_event.price,
-				.integer_len	= 6,
-				.fraction	= n_event.price + 6,
-				.fraction_len	= 4,
-			},
+			.symbol		= info->symbol,
+			.order_id	= be64_to_cpu(m->OrderReferenceNumber),
+			.exec_id	= be64_to_cpu(m->MatchNumber),
+			.quantity	= shares,
+			.price		= info->price,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		nasdaq_itch_order_event(&event, info);
 
-		assert(info->remaining >= shares);
-
-		info->remaining -= shares;
+		ob_write_event(session->ob_writer, &event);
 
 		if (!info->remaining) {
 			if (!g_hash_table_remove(session->order_hash, &info->order_ref_num))
 				assert(0);
-
-			free(info);
 		}
 
 		break;
 	}
 	case ITCH41_MSG_ORDER_EXECUTED_WITH_PRICE: {
 		struct itch41_msg_order_executed_with_price *m = (void *) msg;
-		uint64_t timestamp_nsec;
-		uint64_t order_ref_num;
-		uint64_t match_num;
 		uint32_t shares;
-		uint32_t price;
 
-		timestamp_nsec	= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds));
-		order_ref_num	= be64_to_cpu(m->OrderReferenceNumber);
-		shares		= be32_to_cpu(m->ExecutedShares);
-		match_num	= be64_to_cpu(m->MatchNumber);
-		price		= be32_to_cpu(m->ExecutionPrice);
+		shares = be32_to_cpu(m->ExecutedShares);
 
-		fmt_timestamp(&n_event, timestamp_nsec);
-		fmt_order_id (&n_event, order_ref_num);
-		fmt_quantity (&n_event, shares);
-		fmt_exec_id  (&n_event, match_num);
-		fmt_price    (&n_event, price);
+		assert(info->remaining >= shares);
+
+		info->remaining -= shares;
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_EXECUTE_ORDER,
-			.time		= n_event.timestamp,
-			.time_len	= n_event.timestamp_len,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_EXEC_ID | OB_FIELD_QUANTITY | OB_FIELD_PRICE,
+			.time		= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds)),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= n_event.order_id,
-			.order_id_len	= n_event.order_id_len,
-			.exec_id	= n_event.exec_id,
-			.exec_id_len	= n_event.exec_id_len,
-			.quantity	= n_event.quantity,
-			.quantity_len	= n_event.quantity_len,
-			.price		= (struct decimal) {
-				.integer	= n_event.price,
-				.integer_len	= 6,
-				.fraction	= n_event.price + 6,
-				.fraction_len	= 4,
-			},
+			.symbol		= info->symbol,
+			.order_id	= be64_to_cpu(m->OrderReferenceNumber),
+			.exec_id	= be64_to_cpu(m->MatchNumber),
+			.quantity	= shares,
+			.price		= be32_to_cpu(m->ExecutionPrice),
+			.non_printable	= m->Printable == 'N',
 		};
 
-		ob_write_event(session->out_fd, &event);
-
-		assert(info->remaining >= shares);
+		nasdaq_itch_order_event(&event, info);
 
-		info->remaining -= shares;
+		ob_write_event(session->ob_writer, &event);
 
 		if (!info->remaining) {
 			if (!g_hash_table_remove(session->order_hash, &info->order_ref_num))
 				assert(0);
-
-			free(info);
 		}
 
 		break;
 	}
 	case ITCH41_MSG_ORDER_CANCEL: {
 		struct itch41_msg_order_cancel *m = (void *) msg;
-		uint64_t timestamp_nsec;
-		uint64_t order_ref_num;
 		uint32_t shares;
 
-		timestamp_nsec	= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds));
-		order_ref_num	= be64_to_cpu(m->OrderReferenceNumber);
-		shares		= be32_to_cpu(m->CanceledShares);
+		shares = be32_to_cpu(m->CanceledShares);
+
+		assert(info->remaining >= shares);
 
-		fmt_timestamp(&n_event, timestamp_nsec);
-		fmt_order_id (&n_event, order_ref_num);
-		fmt_quantity (&n_event, shares);
+		info->remaining -= shares;
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_CANCEL_ORDER,
-			.time		= n_event.timestamp,
-			.time_len	= n_event.timestamp_len,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_QUANTITY,
+			.time		= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds)),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= n_event.order_id,
-			.order_id_len	= n_event.order_id_len,
-			.quantity	= n_event.quantity,
-			.quantity_len	= n_event.quantity_len,
+			.symbol		= info->symbol,
+			.order_id	= be64_to_cpu(m->OrderReferenceNumber),
+			.quantity	= shares,
 		};
 
-		ob_write_event(session->out_fd, &event);
-
-		assert(info->remaining >= shares);
+		nasdaq_itch_order_event(&event, info);
 
-		info->remaining -= shares;
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
 	case ITCH41_MSG_ORDER_DELETE: {
 		struct itch41_msg_order_delete *m = (void *) msg;
-		uint64_t timestamp_nsec;
-		uint64_t order_ref_num;
+		uint32_t shares;
 
 		assert(info->remaining > 0);
 
-		timestamp_nsec	= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds));
-		order_ref_num	= be64_to_cpu(m->OrderReferenceNumber);
-
-		fmt_timestamp(&n_event, timestamp_nsec);
-		fmt_order_id (&n_event, order_ref_num);
-		fmt_quantity (&n_event, info->remaining);
+		shares		= info->remaining;
+		info->remaining	= 0;
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_CANCEL_ORDER,
-			.time		= n_event.timestamp,
-			.time_len	= n_event.timestamp_len,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_QUANTITY,
+			.time		= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds)),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= n_event.order_id,
-			.order_id_len	= n_event.order_id_len,
-			.quantity	= n_event.quantity,
-			.quantity_len	= n_event.quantity_len,
+			.symbol		= info->symbol,
+			.order_id	= be64_to_cpu(m->OrderReferenceNumber),
+			.quantity	= shares,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		nasdaq_itch_order_event(&event, info);
+
+		ob_write_event(session->ob_writer, &event);
 
 		if (!g_hash_table_remove(session->order_hash, &info->order_ref_num))
 			assert(0);
 
-		free(info);
-
 		break;
 	}
 	case ITCH41_MSG_ORDER_REPLACE: {
 		struct itch41_msg_order_replace *m = (void *) msg;
 		uint64_t timestamp_nsec;
-		uint64_t orig_ref_num;
-		uint64_t new_ref_num;
-		uint32_t shares;
-		uint32_t price;
+		uint32_t symbol, shares;
 		char side;
 
 		timestamp_nsec	= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds));
-		orig_ref_num	= be64_to_cpu(m->OriginalOrderReferenceNumber);
-		new_ref_num	= be64_to_cpu(m->NewOrderReferenceNumber);
-		shares		= be32_to_cpu(m->Shares);
-		price		= be32_to_cpu(m->Price);
 		side		= info->side;
+		symbol		= info->symbol;
 
 		/*
 		 * Cancel order:
@@ -438,136 +345,100 @@ found:
 
 		assert(info->remaining > 0);
 
-		fmt_timestamp(&n_event, timestamp_nsec);
-		fmt_order_id (&n_event, orig_ref_num);
-		fmt_quantity (&n_event, info->remaining);
+		shares		= info->remaining;
+		info->remaining	= 0;
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_CANCEL_ORDER,
-			.time		= n_event.timestamp,
-			.time_len	= n_event.timestamp_len,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_QUANTITY,
+			.time		= timestamp_nsec,
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= n_event.order_id,
-			.order_id_len	= n_event.order_id_len,
-			.quantity	= n_event.quantity,
-			.quantity_len	= n_event.quantity_len,
+			.symbol		= info->symbol,
+			.order_id	= be64_to_cpu(m->OriginalOrderReferenceNumber),
+			.quantity	= shares,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		nasdaq_itch_order_event(&event, info);
+
+		ob_write_event(session->ob_writer, &event);
 
 		if (!g_hash_table_remove(session->order_hash, &info->order_ref_num))
 			assert(0);
 
-		free(info);
-
 		/*
 		 * Add order:
 		 */
 
-		fmt_timestamp(&n_event, timestamp_nsec);
-		fmt_order_id (&n_event, new_ref_num);
-		fmt_quantity (&n_event, shares);
-		fmt_price    (&n_event, price);
-
 		info = malloc(sizeof(*info));
-		info->order_ref_num	= new_ref_num;
-		info->remaining		= shares;
-		info->price		= price;
+		info->order_ref_num	= be64_to_cpu(m->NewOrderReferenceNumber);
+		info->time		= timestamp_nsec;
+		info->remaining		= be32_to_cpu(m->Shares);
+		info->price		= be32_to_cpu(m->Price);
 		info->side		= side;
+		info->symbol		= symbol;
 
-		g_hash_table_insert(session->order_hash, &info->order_ref_num, info);
+		nasdaq_itch_add_order(session, info);
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_ADD_ORDER,
-			.time		= n_event.timestamp,
-			.time_len	= n_event.timestamp_len,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_ORDER_ID |
+					  OB_FIELD_QUANTITY | OB_FIELD_PRICE,
+			.time		= timestamp_nsec,
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.order_id	= n_event.order_id,
-			.order_id_len	= n_event.order_id_len,
-			.side		= &info->side,
-			.side_len	= sizeof(info->side),
-			.quantity	= n_event.quantity,
-			.quantity_len	= n_event.quantity_len,
-			.price		= (struct decimal) {
-				.integer	= n_event.price,
-				.integer_len	= 6,
-				.fraction	= n_event.price + 6,
-				.fraction_len	= 4,
-			},
+			.symbol		= info->symbol,
+			.order_id	= info->order_ref_num,
+			.side		= info->side,
+			.quantity	= info->remaining,
+			.price		= info->price,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
 	case ITCH41_MSG_TRADE: {
 		struct itch41_msg_trade *m = (void *) msg;
-		uint64_t timestamp_nsec;
-		uint64_t match_num;
-		uint32_t shares;
-		uint32_t price;
-
-		timestamp_nsec	= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds));
-		shares		= be32_to_cpu(m->Shares);
-		match_num	= be64_to_cpu(m->MatchNumber);
-		price		= be32_to_cpu(m->Price);
-
-		fmt_timestamp(&n_event, timestamp_nsec);
-		fmt_quantity (&n_event, shares);
-		fmt_exec_id  (&n_event, match_num);
-		fmt_price    (&n_event, price);
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_TRADE,
-			.time		= n_event.timestamp,
-			.time_len	= n_event.timestamp_len,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_EXEC_ID |
+					  OB_FIELD_QUANTITY | OB_FIELD_PRICE,
+			.time		= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds)),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.exec_id	= n_event.exec_id,
-			.exec_id_len	= n_event.exec_id_len,
-			.quantity	= n_event.quantity,
-			.quantity_len	= n_event.quantity_len,
-			.price		= (struct decimal) {
-				.integer	= n_event.price,
-				.integer_len	= 6,
-				.fraction	= n_event.price,
-				.fraction_len	= 4,
-			},
+			.symbol		= nasdaq_itch_session_symbol(session, m->Stock),
+			.exec_id	= be64_to_cpu(m->MatchNumber),
+			.quantity	= be32_to_cpu(m->Shares),
+			.price		= be32_to_cpu(m->Price),
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
 	case ITCH41_MSG_BROKEN_TRADE: {
 		struct itch41_msg_broken_trade *m = (void *) msg;
+		struct nasdaq_itch_exec_info *e_info;
 		uint64_t match_num;
 
 		match_num = be64_to_cpu(m->MatchNumber);
 
-		fmt_exec_id(&n_event, match_num);
+		e_info = g_hash_table_lookup(session->exec_hash, &match_num);
 
 		event = (struct ob_event) {
 			.type		= OB_EVENT_TRADE_BREAK,
-			.time		= n_event.timestamp,
-			.time_len	= n_event.timestamp_len,
+			.fields		= OB_FIELD_TIME | OB_FIELD_SYMBOL | OB_FIELD_EXEC_ID,
+			.time		= nasdaq_itch_timestamp(session, be32_to_cpu(m->TimestampNanoseconds)),
 			.exchange	= session->exchange,
 			.exchange_len	= session->exchange_len,
-			.symbol		= session->symbol,
-			.symbol_len	= session->symbol_len,
-			.exec_id	= n_event.exec_id,
-			.exec_id_len	= n_event.exec_id_len,
+			.symbol		= e_info->symbol,
+			.exec_id	= match_num,
 		};
 
-		ob_write_event(session->out_fd, &event);
+		ob_write_event(session->ob_writer, &event);
 
 		break;
 	}
@@ -603,17 +474,25 @@ void nasdaq_itch_ob(struct nasdaq_itch_session *session)
 		.zstream	= session->zstream,
 		.uncomp_buf	= uncomp_buf,
 		.comp_buf	= comp_buf,
-		.progress	= print_progress,
 	};
 
-	session->exec_hash = g_hash_table_new(g_int_hash, g_int_equal);
+	session->exec_hash = g_hash_table_new(g_int64_hash, g_int64_equal);
 	if (!session->exec_hash)
 		error("out of memory");
 
-	session->order_hash = g_hash_table_new(g_int_hash, g_int_equal);
+	memory_track_table(MEMORY_TABLE_EXECS, session->exec_hash, sizeof(struct nasdaq_itch_exec_info));
+
+	session->order_hash = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, free);
 	if (!session->order_hash)
 		error("out of memory");
 
+	progress_track_orders(session->order_hash);
+
+	memory_track_table(MEMORY_TABLE_ORDERS, session->order_hash, sizeof(struct nasdaq_itch_order_info));
+
+	if (session->symbol)
+		session->symbol_id = symbol_intern(session->symbol, session->symbol_len);
+
 	event = (struct ob_event) {
 		.type		= OB_EVENT_DATE,
 		.date		= session->date,
@@ -624,24 +503,41 @@ void nasdaq_itch_ob(struct nasdaq_itch_session *session)
 		.exchange_len	= session->exchange_len,
 	};
 
-	ob_write_event(session->out_fd, &event);
+	ob_write_event(session->ob_writer, &event);
 
 	for (;;) {
 		struct itch41_message *msg;
 		int err;
 
+		profile_enter(PROFILE_STAGE_DECODE);
+
 		err = nasdaq_itch_read(&stream, &msg);
+
+		profile_leave();
+
 		if (err)
 			error("%s: %s", session->input_filename, strerror(err));
 
 		if (!msg)
 			break;
 
+		progress_message();
+
+		profile_message_begin();
+
 		nasdaq_itch_write(session, msg);
+
+		profile_message_end(msg->MessageType);
 	}
 
+	progress_track_orders(NULL);
+
+	memory_untrack_table(MEMORY_TABLE_ORDERS);
+
 	g_hash_table_destroy(session->order_hash);
 
+	memory_untrack_table(MEMORY_TABLE_EXECS);
+
 	g_hash_table_foreach_remove(session->exec_hash, free_entry, NULL);
 
 	g_hash_table_destroy(session->exec_hash);
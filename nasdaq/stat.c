@@ -1,16 +1,19 @@
 #include "tick/nasdaq/stat.h"
 
 #include "libtrading/proto/nasdaq_itch41_message.h"
+#include "libtrading/byte-order.h"
 #include "libtrading/buffer.h"
 
-#include "tick/nasdaq/itch-proto.h"
 #include "tick/progress.h"
+#include "tick/profile.h"
 #include "tick/stream.h"
 #include "tick/error.h"
+#include "tick/rates.h"
 #include "tick/stats.h"
 #include "tick/types.h"
 
 #include <sys/stat.h>
+#include <stddef.h>
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
@@ -41,12 +44,234 @@ void nasdaq_itch_print_stats(struct stats *stats)
 	print_stats(stats, nasdaq_stat_names, ARRAY_SIZE(nasdaq_stat_names));
 }
 
+void nasdaq_itch_print_symbol_stats(struct stats *stats, unsigned int top)
+{
+	print_symbol_stats(stats, nasdaq_stat_names, ARRAY_SIZE(nasdaq_stat_names), top);
+}
+
 #define BUFFER_SIZE	(1ULL << 20) /* 1 MB */
 
+#define NASDAQ_ITCH_NO_SECOND	UINT64_MAX
+
+static void stock_message(struct stats *stats, const char *stock, size_t len, u8 msg_type)
+{
+	stats_symbol_message(stats, stats_symbol(stats, stock, len), msg_type);
+}
+
+/*
+ * Attribute a message to its symbol.  Order messages other than adds do
+ * not carry the symbol, so it is looked up from the order they refer to.
+ */
+static void nasdaq_itch_symbol_stat(struct stats *stats, const void *msg, size_t len)
+{
+	u8 msg_type = *(const u8 *) msg;
+
+	switch (msg_type) {
+	case ITCH41_MSG_STOCK_DIRECTORY: {
+		const struct itch41_msg_stock_directory *m = msg;
+
+		if (len >= sizeof(*m))
+			stock_message(stats, m->Stock, sizeof(m->Stock), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_STOCK_TRADING_ACTION: {
+		const struct itch41_msg_stock_trading_action *m = msg;
+
+		if (len >= sizeof(*m))
+			stock_message(stats, m->Stock, sizeof(m->Stock), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_REG_SHO_RESTRICTION: {
+		const struct itch41_msg_reg_sho_restriction *m = msg;
+
+		if (len >= sizeof(*m))
+			stock_message(stats, m->Stock, sizeof(m->Stock), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_MARKET_PARTICIPANT_POS: {
+		const struct itch41_msg_market_participant_pos *m = msg;
+
+		if (len >= sizeof(*m))
+			stock_message(stats, m->Stock, sizeof(m->Stock), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_ADD_ORDER: {
+		const struct itch41_msg_add_order *m = msg;
+
+		if (len >= sizeof(*m))
+			stats_add_order(stats, stats_symbol(stats, m->Stock, sizeof(m->Stock)),
+					be64_to_cpu(m->OrderReferenceNumber), be32_to_cpu(m->Shares), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_ADD_ORDER_MPID: {
+		const struct itch41_msg_add_order_mpid *m = msg;
+
+		if (len >= sizeof(*m))
+			stats_add_order(stats, stats_symbol(stats, m->Stock, sizeof(m->Stock)),
+					be64_to_cpu(m->OrderReferenceNumber), be32_to_cpu(m->Shares), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_ORDER_EXECUTED: {
+		const struct itch41_msg_order_executed *m = msg;
+
+		if (len >= sizeof(*m))
+			stats_reduce_order(stats, be64_to_cpu(m->OrderReferenceNumber),
+					   be32_to_cpu(m->ExecutedShares), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_ORDER_EXECUTED_WITH_PRICE: {
+		const struct itch41_msg_order_executed_with_price *m = msg;
+
+		if (len >= sizeof(*m))
+			stats_reduce_order(stats, be64_to_cpu(m->OrderReferenceNumber),
+					   be32_to_cpu(m->ExecutedShares), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_ORDER_CANCEL: {
+		const struct itch41_msg_order_cancel *m = msg;
+
+		if (len >= sizeof(*m))
+			stats_reduce_order(stats, be64_to_cpu(m->OrderReferenceNumber),
+					   be32_to_cpu(m->CanceledShares), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_ORDER_DELETE: {
+		const struct itch41_msg_order_delete *m = msg;
+
+		if (len >= sizeof(*m))
+			stats_reduce_order(stats, be64_to_cpu(m->OrderReferenceNumber),
+					   STATS_SHARES_ALL, msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_ORDER_REPLACE: {
+		const struct itch41_msg_order_replace *m = msg;
+
+		if (len >= sizeof(*m))
+			stats_replace_order(stats, be64_to_cpu(m->OriginalOrderReferenceNumber),
+					    be64_to_cpu(m->NewOrderReferenceNumber), be32_to_cpu(m->Shares), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_TRADE: {
+		const struct itch41_msg_trade *m = msg;
+
+		if (len >= sizeof(*m))
+			stock_message(stats, m->Stock, sizeof(m->Stock), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_CROSS_TRADE: {
+		const struct itch41_msg_cross_trade *m = msg;
+
+		if (len >= sizeof(*m))
+			stock_message(stats, m->Stock, sizeof(m->Stock), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_NOII: {
+		const struct itch41_msg_noii *m = msg;
+
+		if (len >= sizeof(*m))
+			stock_message(stats, m->Stock, sizeof(m->Stock), msg_type);
+
+		break;
+	}
+	case ITCH41_MSG_RPII: {
+		const struct itch41_msg_rpii *m = msg;
+
+		if (len >= sizeof(*m))
+			stock_message(stats, m->Stock, sizeof(m->Stock), msg_type);
+
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static void nasdaq_itch_rate_stat(struct stats *stats, const void *msg, size_t len, uint64_t *second)
+{
+	const struct itch41_message *m = msg;
+	uint64_t nsec = 0;
+
+	if (m->MessageType == ITCH41_MSG_TIMESTAMP_SECONDS) {
+		const struct itch41_msg_timestamp_seconds *t = msg;
+
+		if (len >= sizeof(*t))
+			*second = be32_to_cpu(t->Second);
+	} else {
+		const struct itch41_msg_system_event *e = msg;
+
+		/* Every other message starts with a nanosecond timestamp. */
+		if (len >= offsetof(struct itch41_msg_system_event, EventCode))
+			nsec = be32_to_cpu(e->TimestampNanoseconds);
+	}
+
+	/* Messages before the first seconds message have no time. */
+	if (*second == NASDAQ_ITCH_NO_SECOND)
+		return;
+
+	rates_message(stats->rates, *second * 1000000000ULL + nsec);
+}
+
+/*
+ * Count the complete messages in the buffer by their framing only: every
+ * message is prefixed with a big-endian u16 length and starts with its type
+ * byte, so there is no need to decode the message bodies.  A partial
+ * message at the end of the buffer is left in place.
+ */
+static int nasdaq_itch_count(struct stats *stats, struct buffer *buf, uint64_t *second)
+{
+	const u8 *start = (const void *) buffer_start(buf);
+	const u8 *end = start + buffer_size(buf);
+	const u8 *p = start;
+
+	while (end - p > (long) sizeof(u16)) {
+		size_t len = ((size_t) p[0] << 8) | p[1];
+
+		if (!len)
+			return -EINVAL;
+
+		if ((size_t) (end - p) < sizeof(u16) + len)
+			break;
+
+		progress_message();
+
+		profile_message_begin();
+
+		stats->stats[p[2]]++;
+
+		if (stats->rates)
+			nasdaq_itch_rate_stat(stats, p + sizeof(u16), len, second);
+
+		if (stats->by_symbol)
+			nasdaq_itch_symbol_stat(stats, p + sizeof(u16), len);
+
+		profile_message_end(p[2]);
+
+		p += sizeof(u16) + len;
+	}
+
+	buffer_advance(buf, p - start);
+
+	return 0;
+}
+
 void nasdaq_itch_stat(struct stats *stats, int fd, z_stream *zstream)
 {
 	struct buffer *comp_buf, *uncomp_buf;
 	struct stream stream;
+	uint64_t second = NASDAQ_ITCH_NO_SECOND;
 	struct stat st;
 
 	if (fstat(fd, &st) < 0)
@@ -66,22 +291,31 @@ void nasdaq_itch_stat(struct stats *stats, int fd, z_stream *zstream)
 		.zstream	= zstream,
 		.uncomp_buf	= uncomp_buf,
 		.comp_buf	= comp_buf,
-		.progress	= print_progress,
 	};
 
+	progress_track_orders(stats->orders);
 
 	for (;;) {
-		struct itch41_message *msg;
+		ssize_t nr;
 		int err;
 
-		err = nasdaq_itch_read(&stream, &msg);
-		if (err)
-			error("%s: %s", stats->filename, strerror(err));
+		buffer_compact(uncomp_buf);
+
+		nr = stream_inflate(&stream);
+		if (nr < 0)
+			error("%s: %s", stats->filename, strerror(EINVAL));
 
-		if (!msg)
+		if (!nr)
 			break;
 
-		stats->stats[msg->MessageType]++;
+		profile_enter(PROFILE_STAGE_DECODE);
+
+		err = nasdaq_itch_count(stats, uncomp_buf, &second);
+
+		profile_leave();
+
+		if (err < 0)
+			error("%s: %s", stats->filename, strerror(EINVAL));
 	}
 
 	buffer_munmap(comp_buf);
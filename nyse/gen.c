@@ -0,0 +1,197 @@
+#include "tick/nyse/gen.h"
+
+#include "libtrading/proto/nyse_taq_message.h"
+
+#include "tick/error.h"
+#include "tick/gen.h"
+
+#include <string.h>
+
+#define NSEC_PER_MSEC		1000000ULL
+
+#define QUOTE_HEADER_LEN	83
+#define TRADE_HEADER_LEN	61
+
+#define SWEEP_PROB		0.15
+#define NON_REGULAR_PROB	0.02
+
+static const char exchanges[] = "ABCDIJKMNTPSQWXYZ";
+
+struct nyse_taq_gen {
+	struct gen_output	*out;
+	uint64_t		nr_messages;
+	uint64_t		sequence;
+};
+
+/*
+ * The header line starts with the date as "  MMDDYYYY", padded to the
+ * record length that tells quote and trade files apart.
+ */
+static void nyse_taq_header(struct gen_output *out, const char *date, size_t len)
+{
+	char buf[10 + QUOTE_HEADER_LEN + 2];
+
+	if (strlen(date) != 10 || date[4] != '-' || date[7] != '-')
+		error("%s: invalid date, expected YYYY-MM-DD", date);
+
+	memset(buf, ' ', sizeof(buf));
+
+	memcpy(buf + 2, date + 5, 2);
+	memcpy(buf + 4, date + 8, 2);
+	memcpy(buf + 6, date + 0, 4);
+
+	memcpy(buf + 10 + len, "\r\n", 2);
+
+	gen_output_write(out, buf, 10 + len + 2);
+}
+
+/*
+ * Time is HHMMSSXXX, where XXX is milliseconds.
+ */
+static void nyse_taq_time(char *buf, uint64_t time)
+{
+	uint64_t msec = time / NSEC_PER_MSEC;
+
+	gen_digits(buf + 0, 2, msec / 3600000);
+	gen_digits(buf + 2, 2, msec / 60000 % 60);
+	gen_digits(buf + 4, 2, msec / 1000 % 60);
+	gen_digits(buf + 6, 3, msec % 1000);
+}
+
+static void nyse_taq_symbol(char *buf, size_t len, struct gen_symbol *sym)
+{
+	memset(buf, ' ', len);
+	memcpy(buf, sym->name, GEN_SYMBOL_LEN);
+}
+
+static char nyse_taq_exchange(struct gen *gen)
+{
+	return exchanges[gen_random(gen) % (sizeof(exchanges) - 1)];
+}
+
+static uint32_t nyse_taq_lots(uint32_t quantity)
+{
+	return quantity < 100 ? 1 : quantity / 100;
+}
+
+/*
+ * Every order book change is published as a quote of the symbol on one of
+ * the exchanges, with the order's size on its side of the book.
+ */
+static void nyse_taq_quote(struct nyse_taq_gen *taq, struct gen *gen, struct gen_event *event)
+{
+	struct gen_symbol *sym = &gen->symbols[event->symbol];
+	uint64_t bid_price, ask_price, offset;
+	uint32_t bid_size, ask_size;
+	struct nyse_taq_msg_daily_quote m;
+
+	offset = (1 + gen_random(gen) % 3) * GEN_TICK;
+
+	bid_price = sym->price > offset ? sym->price - offset : GEN_TICK;
+	ask_price = sym->price + (1 + gen_random(gen) % 3) * GEN_TICK;
+
+	bid_size = 1 + gen_random(gen) % 10;
+	ask_size = 1 + gen_random(gen) % 10;
+
+	if (event->side == 'B')
+		bid_size = nyse_taq_lots(event->quantity);
+	else
+		ask_size = nyse_taq_lots(event->quantity);
+
+	memset(&m, ' ', sizeof(m));
+
+	nyse_taq_time(m.Time, event->time);
+	m.Exchange = nyse_taq_exchange(gen);
+	nyse_taq_symbol(m.Symbol, sizeof(m.Symbol), sym);
+	gen_digits(m.BidPrice, sizeof(m.BidPrice), bid_price);
+	gen_digits(m.BidSize, sizeof(m.BidSize), bid_size);
+	gen_digits(m.AskPrice, sizeof(m.AskPrice), ask_price);
+	gen_digits(m.AskSize, sizeof(m.AskSize), ask_size);
+	m.QuoteCondition = gen_uniform(gen) < NON_REGULAR_PROB ? 'O' : 'R';
+	m.BidExchange = m.Exchange;
+	m.AskExchange = m.Exchange;
+	gen_digits(m.SequenceNumber, sizeof(m.SequenceNumber), ++taq->sequence);
+	m.NationalBBOInd = '2';
+	m.NASDAQBBOInd = '2';
+	m.SourceOfQuote = 'C';
+	memcpy(m.LineChange, "\r\n", sizeof(m.LineChange));
+
+	gen_output_write(taq->out, &m, sizeof(m));
+
+	taq->nr_messages++;
+}
+
+static void nyse_taq_trade(struct nyse_taq_gen *taq, struct gen *gen, struct gen_event *event)
+{
+	struct gen_symbol *sym = &gen->symbols[event->symbol];
+	struct nyse_taq_msg_daily_trade m;
+	double x = gen_uniform(gen);
+
+	memset(&m, ' ', sizeof(m));
+
+	nyse_taq_time(m.Time, event->time);
+	m.Exchange = nyse_taq_exchange(gen);
+	nyse_taq_symbol(m.Symbol, sizeof(m.Symbol), sym);
+
+	if (x < NON_REGULAR_PROB)
+		memcpy(m.SaleCondition, "@ T ", sizeof(m.SaleCondition));
+	else if (x < NON_REGULAR_PROB + SWEEP_PROB)
+		memcpy(m.SaleCondition, "@F  ", sizeof(m.SaleCondition));
+	else
+		memcpy(m.SaleCondition, "@   ", sizeof(m.SaleCondition));
+
+	gen_digits(m.TradeVolume, sizeof(m.TradeVolume), event->quantity);
+	gen_digits(m.TradePrice, sizeof(m.TradePrice), event->price);
+	memcpy(m.TradeCorrectionIndicator, "00", sizeof(m.TradeCorrectionIndicator));
+	gen_digits(m.TradeSequenceNumber, sizeof(m.TradeSequenceNumber), ++taq->sequence);
+	m.SourceOfTrade = 'C';
+	memcpy(m.LineChange, "\r\n", sizeof(m.LineChange));
+
+	gen_output_write(taq->out, &m, sizeof(m));
+
+	taq->nr_messages++;
+}
+
+void nyse_taq_gen(struct gen *gen, struct gen_output *out, uint64_t nr_messages,
+	const char *date, bool trades)
+{
+	uint64_t next_progress = GEN_PROGRESS_STEP;
+	struct nyse_taq_gen taq;
+
+	taq = (struct nyse_taq_gen) {
+		.out		= out,
+	};
+
+	nyse_taq_header(out, date, trades ? TRADE_HEADER_LEN : QUOTE_HEADER_LEN);
+
+	while (taq.nr_messages < nr_messages) {
+		struct gen_event event;
+
+		gen_next(gen, &event);
+
+		switch (event.type) {
+		case GEN_EVENT_ADD:
+		case GEN_EVENT_CANCEL:
+		case GEN_EVENT_DELETE:
+		case GEN_EVENT_REPLACE:
+			if (!trades)
+				nyse_taq_quote(&taq, gen, &event);
+			break;
+		case GEN_EVENT_EXECUTE:
+		case GEN_EVENT_TRADE:
+			if (trades)
+				nyse_taq_trade(&taq, gen, &event);
+			else
+				nyse_taq_quote(&taq, gen, &event);
+			break;
+		default:
+			break;
+		}
+
+		if (taq.nr_messages >= next_progress) {
+			gen_progress(taq.nr_messages, nr_messages);
+
+			next_progress += GEN_PROGRESS_STEP;
+		}
+	}
+}
@@ -1,7 +1,10 @@
 #include "tick/nyse/taq-proto.h"
 
 #include "tick/progress.h"
+#include "tick/profile.h"
+#include "tick/base10.h"
 #include "tick/stream.h"
+#include "tick/symbol.h"
 #include "tick/error.h"
 #include "tick/taq.h"
 
@@ -63,7 +66,7 @@ static enum file_type parse_header(struct stream *stream, char *dst, size_t dst_
 	if (buffer_size(stream->uncomp_buf) < sizeof(buf)) {
 		buffer_compact(stream->uncomp_buf);
 
-		nr = buffer_inflate(stream->comp_buf, stream->uncomp_buf, stream->zstream);
+		nr = stream_inflate(stream);
 		if (nr <= 0)
 			return FILE_TYPE_UNKNOWN;
 	}
@@ -80,7 +83,7 @@ static enum file_type parse_header(struct stream *stream, char *dst, size_t dst_
 		if (buffer_size(stream->uncomp_buf) == 0) {
 			buffer_compact(stream->uncomp_buf);
 
-			nr = buffer_inflate(stream->comp_buf, stream->uncomp_buf, stream->zstream);
+			nr = stream_inflate(stream);
 			if (nr <= 0)
 				return FILE_TYPE_UNKNOWN;
 		}
@@ -118,13 +121,10 @@ retry_message:
 
 		buffer_compact(stream->uncomp_buf);
 
-		nr = buffer_inflate(stream->comp_buf, stream->uncomp_buf, stream->zstream);
+		nr = stream_inflate(stream);
 		if (nr <= 0)
 			return nr;
 
-		if (stream->progress)
-			stream->progress(stream->comp_buf);
-
 		goto retry_message;
 	}
 
@@ -147,13 +147,10 @@ retry_message:
 
 		buffer_compact(stream->uncomp_buf);
 
-		nr = buffer_inflate(stream->comp_buf, stream->uncomp_buf, stream->zstream);
+		nr = stream_inflate(stream);
 		if (nr <= 0)
 			return nr;
 
-		if (stream->progress)
-			stream->progress(stream->comp_buf);
-
 		goto retry_message;
 	}
 
@@ -165,7 +162,23 @@ retry_message:
 void nyse_taq_filter_init(struct nyse_taq_filter *filter, const char *symbol)
 {
 	memset(filter->symbol, ' ', sizeof(filter->symbol));
-	memcpy(filter->symbol, symbol, strlen(symbol));
+
+	filter->all = !symbol;
+
+	if (symbol)
+		memcpy(filter->symbol, symbol, strlen(symbol));
+}
+
+/*
+ * Symbol identifier of the root of a message's Symbol field, which is what
+ * the filter matches.
+ */
+static uint32_t nyse_taq_session_symbol(struct nyse_taq_session *session, const char *symbol)
+{
+	if (!session->filter.all)
+		return session->symbol_id;
+
+	return symbol_cache_intern_padded(&session->symbol_cache, symbol, sizeof(session->filter.symbol));
 }
 
 static bool nyse_taq_session_filter_msg_daily_quote(struct nyse_taq_session *session,
@@ -173,7 +186,7 @@ static bool nyse_taq_session_filter_msg_daily_quote(struct nyse_taq_session *ses
 {
 	struct nyse_taq_filter *filter = &session->filter;
 
-	return !memcmp(msg->Symbol, filter->symbol, sizeof(filter->symbol));
+	return filter->all || !memcmp(msg->Symbol, filter->symbol, sizeof(filter->symbol));
 }
 
 static bool filter_msg_daily_quote_quote_condition(struct nyse_taq_msg_daily_quote *msg)
@@ -193,7 +206,7 @@ static bool nyse_taq_session_filter_msg_daily_trade(struct nyse_taq_session *ses
 {
 	struct nyse_taq_filter *filter = &session->filter;
 
-	return !memcmp(msg->Symbol, filter->symbol, sizeof(filter->symbol));
+	return filter->all || !memcmp(msg->Symbol, filter->symbol, sizeof(filter->symbol));
 }
 
 static bool filter_msg_daily_trade_sale_condition(struct nyse_taq_msg_daily_trade *msg)
@@ -230,7 +243,7 @@ static bool filter_msg_daily_trade_trade_correction_indicator(struct nyse_taq_ms
 	return false;
 }
 
-static const char *trade_type(struct nyse_taq_msg_daily_trade *msg)
+static char trade_type(struct nyse_taq_msg_daily_trade *msg)
 {
 	unsigned int ndx;
 
@@ -243,8 +256,20 @@ static const char *trade_type(struct nyse_taq_msg_daily_trade *msg)
 	return TAQ_TRADE_TYPE_REGULAR;
 }
 
-#define PRICE_INT_LEN		7
-#define PRICE_FRACTION_LEN	4
+/*
+ * Time is HHMMSSXXX, where XXX is milliseconds.
+ */
+static uint64_t nyse_taq_time(const char *time)
+{
+	uint64_t msec;
+
+	msec = base10_decode(time + 0, 2) * 3600000
+	     + base10_decode(time + 2, 2) * 60000
+	     + base10_decode(time + 4, 2) * 1000
+	     + base10_decode(time + 6, 3);
+
+	return msec * 1000000ULL;
+}
 
 static void nyse_taq_msg_daily_quote_write(struct nyse_taq_session *session,
 	struct nyse_taq_msg_daily_quote *msg)
@@ -259,35 +284,18 @@ static void nyse_taq_msg_daily_quote_write(struct nyse_taq_session *session,
 
 	event = (struct taq_event) {
 		.type			= TAQ_EVENT_QUOTE,
-		.time			= (struct time) {
-			.value		= msg->Time,
-			.value_len	= sizeof(msg->Time),
-			.unit		= TIME_UNIT_MILLISECONDS,
-		},
+		.fields			= TAQ_FIELD_TIME | TAQ_FIELD_SYMBOL | TAQ_FIELD_QUOTE,
+		.time			= nyse_taq_time(msg->Time),
 		.exchange		= mic[MIC_ID(msg->Exchange)],
 		.exchange_len		= MIC_LEN,
-		.symbol			= msg->Symbol,
-		.symbol_len		= sizeof(msg->Symbol),
-		.bid_quantity1		= msg->BidSize,
-		.bid_quantity1_len	= sizeof(msg->BidSize),
-		.bid_price1		= (struct decimal) {
-			.integer	= msg->BidPrice,
-			.integer_len	= PRICE_INT_LEN,
-			.fraction	= msg->BidPrice + PRICE_INT_LEN,
-			.fraction_len	= PRICE_FRACTION_LEN,
-		},
-		.ask_quantity1		= msg->AskSize,
-		.ask_quantity1_len	= sizeof(msg->AskSize),
-		.ask_price1		= (struct decimal) {
-			.integer	= msg->AskPrice,
-			.integer_len	= PRICE_INT_LEN,
-			.fraction	= msg->AskPrice + PRICE_INT_LEN,
-			.fraction_len	= PRICE_FRACTION_LEN,
-		},
-		.status_len		= 0,
+		.symbol			= nyse_taq_session_symbol(session, msg->Symbol),
+		.bid_quantity1		= base10_decode(msg->BidSize, sizeof(msg->BidSize)),
+		.bid_price1		= base10_decode(msg->BidPrice, sizeof(msg->BidPrice)),
+		.ask_quantity1		= base10_decode(msg->AskSize, sizeof(msg->AskSize)),
+		.ask_price1		= base10_decode(msg->AskPrice, sizeof(msg->AskPrice)),
 	};
 
-	taq_write_event(session->out_fd, &event);
+	taq_write_event(session->taq_writer, &event);
 }
 
 static void nyse_taq_msg_daily_trade_write(struct nyse_taq_session *session,
@@ -306,28 +314,17 @@ static void nyse_taq_msg_daily_trade_write(struct nyse_taq_session *session,
 
 	event = (struct taq_event) {
 		.type 			= TAQ_EVENT_TRADE,
-		.time			= (struct time) {
-			.value		= msg->Time,
-			.value_len	= sizeof(msg->Time),
-			.unit		= TIME_UNIT_MILLISECONDS,
-		},
+		.fields			= TAQ_FIELD_TIME | TAQ_FIELD_SYMBOL | TAQ_FIELD_TRADE,
+		.time			= nyse_taq_time(msg->Time),
 		.exchange		= mic[MIC_ID(msg->Exchange)],
 		.exchange_len		= MIC_LEN,
-		.symbol			= msg->Symbol,
-		.symbol_len		= sizeof(msg->Symbol),
-		.trade_quantity		= msg->TradeVolume,
-		.trade_quantity_len	= sizeof(msg->TradeVolume),
-		.trade_price		= (struct decimal) {
-			.integer	= msg->TradePrice,
-			.integer_len	= PRICE_INT_LEN,
-			.fraction	= msg->TradePrice + PRICE_INT_LEN,
-			.fraction_len	= PRICE_FRACTION_LEN,
-		},
+		.symbol			= nyse_taq_session_symbol(session, msg->Symbol),
+		.trade_quantity		= base10_decode(msg->TradeVolume, sizeof(msg->TradeVolume)),
+		.trade_price		= base10_decode(msg->TradePrice, sizeof(msg->TradePrice)),
 		.trade_type		= trade_type(msg),
-		.trade_type_len		= TAQ_TRADE_TYPE_LEN,
 	};
 
-	taq_write_event(session->out_fd, &event);
+	taq_write_event(session->taq_writer, &event);
 }
 
 static void process_daily_quotes(struct nyse_taq_session *session,
@@ -337,14 +334,25 @@ static void process_daily_quotes(struct nyse_taq_session *session,
 		struct nyse_taq_msg_daily_quote *msg;
 		int err;
 
+		profile_enter(PROFILE_STAGE_DECODE);
+
 		err = nyse_taq_msg_daily_quote_read(stream, &msg);
+
+		profile_leave();
+
 		if (err)
 			error("%s: %s", session->input_filename, strerror(err));
 
 		if (!msg)
 			break;
 
+		progress_message();
+
+		profile_message_begin();
+
 		nyse_taq_msg_daily_quote_write(session, msg);
+
+		profile_message_end('Q');
 	}
 }
 
@@ -355,14 +363,25 @@ static void process_daily_trades(struct nyse_taq_session *session,
 		struct nyse_taq_msg_daily_trade *msg;
 		int err;
 
+		profile_enter(PROFILE_STAGE_DECODE);
+
 		err = nyse_taq_msg_daily_trade_read(stream, &msg);
+
+		profile_leave();
+
 		if (err)
 			error("%s: %s", session->input_filename, strerror(err));
 
 		if (!msg)
 			break;
 
+		progress_message();
+
+		profile_message_begin();
+
 		nyse_taq_msg_daily_trade_write(session, msg);
+
+		profile_message_end('T');
 	}
 }
 
@@ -395,7 +414,6 @@ void nyse_taq_taq(struct nyse_taq_session *session)
 		.zstream	= session->zstream,
 		.uncomp_buf	= uncomp_buf,
 		.comp_buf	= comp_buf,
-		.progress	= print_progress,
 	};
 
 	file_type = parse_header(&stream, date_buf, sizeof(date_buf));
@@ -405,6 +423,9 @@ void nyse_taq_taq(struct nyse_taq_session *session)
 	if (!session->date)
 		session->date = date_buf;
 
+	if (session->symbol)
+		session->symbol_id = symbol_intern(session->symbol, session->symbol_len);
+
 	for (ndx = 0; ndx < nr_mic(); ndx++) {
 		event = (struct taq_event) {
 			.type		= TAQ_EVENT_DATE,
@@ -416,7 +437,7 @@ void nyse_taq_taq(struct nyse_taq_session *session)
 			.exchange_len	= strlen(mic_by_index(ndx)),
 		};
 
-		taq_write_event(session->out_fd, &event);
+		taq_write_event(session->taq_writer, &event);
 	}
 
 	switch (file_type) {
@@ -1,9 +1,93 @@
 #include "tick/ob.h"
 
+#include "tick/profile.h"
+#include "tick/output.h"
+#include "tick/symbol.h"
+#include "tick/error.h"
 #include "tick/types.h"
 #include "tick/dsv.h"
+#include "tick/tsv.h"
 
-#include <unistd.h>
+#include <inttypes.h>
+#include <string.h>
+
+static size_t fmt_event(char *buf, struct ob_event *event)
+{
+	return dsv_fmt_char(buf, event->type, '\t');
+}
+
+static size_t fmt_date(char *buf, struct ob_event *event)
+{
+	return dsv_fmt_value(buf, event->date, event->date_len, '\t');
+}
+
+static size_t fmt_time(char *buf, struct ob_event *event)
+{
+	if (event->fields & OB_FIELD_TIME)
+		return dsv_fmt_uint(buf, event->time, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_time_zone(char *buf, struct ob_event *event)
+{
+	return dsv_fmt_value(buf, event->time_zone, event->time_zone_len, '\t');
+}
+
+static size_t fmt_exchange(char *buf, struct ob_event *event)
+{
+	return dsv_fmt_value(buf, event->exchange, event->exchange_len, '\t');
+}
+
+static size_t fmt_symbol(char *buf, struct ob_event *event)
+{
+	if (event->fields & OB_FIELD_SYMBOL)
+		return dsv_fmt_value(buf, symbol_name(event->symbol), symbol_len(event->symbol), '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_order_id(char *buf, struct ob_event *event)
+{
+	if (event->fields & OB_FIELD_ORDER_ID)
+		return dsv_fmt_base36(buf, event->order_id, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_exec_id(char *buf, struct ob_event *event)
+{
+	if (event->fields & OB_FIELD_EXEC_ID)
+		return dsv_fmt_base36(buf, event->exec_id, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_side(char *buf, struct ob_event *event)
+{
+	return dsv_fmt_char(buf, event->side, '\t');
+}
+
+static size_t fmt_quantity(char *buf, struct ob_event *event)
+{
+	if (event->fields & OB_FIELD_QUANTITY)
+		return dsv_fmt_uint(buf, event->quantity, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_price(char *buf, struct ob_event *event)
+{
+	if (event->fields & OB_FIELD_PRICE)
+		return dsv_fmt_price(buf, event->price, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_status(char *buf, struct ob_event *event)
+{
+	return dsv_fmt_char(buf, event->status, '\t');
+}
 
 static const char *column_names[] = {
 	"Event",
@@ -20,28 +104,288 @@ static const char *column_names[] = {
 	"Status",
 };
 
-void ob_write_header(int fd)
+static const ob_column_fmt_t column_fmts[] = {
+	fmt_event,
+	fmt_date,
+	fmt_time,
+	fmt_time_zone,
+	fmt_exchange,
+	fmt_symbol,
+	fmt_order_id,
+	fmt_exec_id,
+	fmt_side,
+	fmt_quantity,
+	fmt_price,
+	fmt_status,
+};
+
+/*
+ * The Date, TimeZone and Exchange columns are copied from the event, so
+ * their widths are only known per row.
+ */
+static const size_t column_widths[] = {
+	DSV_CHAR_MAX_LEN,
+	1,
+	DSV_UINT_MAX_LEN,
+	1,
+	1,
+	SYMBOL_MAX_LEN + 1,
+	DSV_BASE36_MAX_LEN,
+	DSV_BASE36_MAX_LEN,
+	DSV_CHAR_MAX_LEN,
+	DSV_UINT_MAX_LEN,
+	DSV_PRICE_MAX_LEN,
+	DSV_CHAR_MAX_LEN,
+};
+
+static void parse_event(struct ob_reader *reader __maybe_unused, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len)
+		event->type = field->s[0];
+}
+
+static void parse_date(struct ob_reader *reader __maybe_unused, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->date	= field->s;
+		event->date_len	= field->len;
+	}
+}
+
+static void parse_time(struct ob_reader *reader __maybe_unused, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->time	= dsv_parse_uint(field->s, field->len);
+		event->fields	|= OB_FIELD_TIME;
+	}
+}
+
+static void parse_time_zone(struct ob_reader *reader __maybe_unused, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->time_zone	= field->s;
+		event->time_zone_len	= field->len;
+	}
+}
+
+static void parse_exchange(struct ob_reader *reader __maybe_unused, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->exchange		= field->s;
+		event->exchange_len	= field->len;
+	}
+}
+
+static void parse_symbol(struct ob_reader *reader, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->symbol	= symbol_cache_intern(&reader->symbol_cache, field->s, field->len);
+		event->fields	|= OB_FIELD_SYMBOL;
+	}
+}
+
+static void parse_order_id(struct ob_reader *reader __maybe_unused, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->order_id	= dsv_parse_base36(field->s, field->len);
+		event->fields	|= OB_FIELD_ORDER_ID;
+	}
+}
+
+static void parse_exec_id(struct ob_reader *reader __maybe_unused, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->exec_id	= dsv_parse_base36(field->s, field->len);
+		event->fields	|= OB_FIELD_EXEC_ID;
+	}
+}
+
+static void parse_side(struct ob_reader *reader __maybe_unused, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len)
+		event->side = field->s[0];
+}
+
+static void parse_quantity(struct ob_reader *reader __maybe_unused, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->quantity	= dsv_parse_uint(field->s, field->len);
+		event->fields	|= OB_FIELD_QUANTITY;
+	}
+}
+
+static void parse_price(struct ob_reader *reader __maybe_unused, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->price	= dsv_parse_price(field->s, field->len);
+		event->fields	|= OB_FIELD_PRICE;
+	}
+}
+
+static void parse_status(struct ob_reader *reader __maybe_unused, struct ob_event *event, const struct tsv_field *field)
+{
+	if (field->len)
+		event->status = field->s[0];
+}
+
+static const ob_column_parse_t column_parsers[] = {
+	parse_event,
+	parse_date,
+	parse_time,
+	parse_time_zone,
+	parse_exchange,
+	parse_symbol,
+	parse_order_id,
+	parse_exec_id,
+	parse_side,
+	parse_quantity,
+	parse_price,
+	parse_status,
+};
+
+static const char event_types[] = {
+	OB_EVENT_DATE,
+	OB_EVENT_ADD_ORDER,
+	OB_EVENT_CANCEL_ORDER,
+	OB_EVENT_EXECUTE_ORDER,
+	OB_EVENT_CLEAR,
+	OB_EVENT_TRADE,
+	OB_EVENT_TRADE_BREAK,
+	OB_EVENT_STATUS,
+	0,
+};
+
+void ob_writer_init(struct ob_writer *writer, const char *columns, const char *events)
+{
+	unsigned int indices[OB_NR_COLUMNS];
+	unsigned int i;
+
+	memset(writer, 0, sizeof(*writer));
+
+	if (columns) {
+		writer->nr_columns = dsv_parse_columns(columns, column_names, ARRAY_SIZE(column_names), indices);
+	} else {
+		for (i = 0; i < ARRAY_SIZE(column_names); i++)
+			indices[i] = i;
+
+		writer->nr_columns = ARRAY_SIZE(column_names);
+	}
+
+	for (i = 0; i < writer->nr_columns; i++) {
+		writer->column_names[i]	= column_names[indices[i]];
+		writer->column_fmts[i]	= column_fmts[indices[i]];
+		writer->row_len		+= column_widths[indices[i]];
+	}
+
+	if (writer->row_len > OUTPUT_MAX_RESERVE)
+		error("OB rows of up to %zu bytes do not fit in the output buffer", writer->row_len);
+
+	writer->events = dsv_parse_events(events, event_types);
+}
+
+void ob_write_header(struct ob_writer *writer)
 {
-	dsv_write_header(fd, column_names, ARRAY_SIZE(column_names), '\t');
+	dsv_write_header(writer->out, writer->column_names, writer->nr_columns, '\t');
 }
 
-void ob_write_event(int fd, struct ob_event *event)
+void ob_write_event(struct ob_writer *writer, struct ob_event *event)
 {
 	size_t idx = 0;
-	char buf[1024];
-
-	idx += dsv_fmt_char   (buf + idx, event->type, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->date, event->date_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->time, event->time_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->time_zone, event->time_zone_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->exchange, event->exchange_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->symbol, event->symbol_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->order_id, event->order_id_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->exec_id, event->exec_id_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->side, event->side_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->quantity, event->quantity_len, '\t');
-	idx += dsv_fmt_decimal(buf + idx, &event->price, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->status, event->status_len, '\n');
-
-	write(fd, buf, idx);
+	unsigned int i;
+	char *buf;
+
+	if (!dsv_event_selected(writer->events, event->type))
+		return;
+
+	if (writer->event_fn) {
+		writer->event_fn(writer->event_data, event);
+		return;
+	}
+
+	profile_enter(PROFILE_STAGE_FORMAT);
+
+	output_begin_row(writer->out, event->fields & OB_FIELD_TIME ? event->time : OUTPUT_TIME_NONE);
+
+	buf = output_reserve(writer->out, writer->row_len + event->date_len + event->time_zone_len + event->exchange_len);
+
+	for (i = 0; i < writer->nr_columns; i++)
+		idx += writer->column_fmts[i](buf + idx, event);
+
+	buf[idx - 1] = '\n';
+
+	if (event->type == OB_EVENT_DATE)
+		output_set_context(writer->out, buf, idx);
+
+	output_commit(writer->out, idx);
+
+	profile_leave();
+}
+
+static int ob_column_lookup(const struct tsv_field *field)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(column_names); i++) {
+		if (tsv_field_equals(field, column_names[i]))
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Returns true if the header row that was just read is an OB header.
+ */
+bool ob_header_match(struct tsv_reader *tsv)
+{
+	unsigned int i;
+
+	for (i = 0; i < tsv->nr_fields; i++) {
+		if (ob_column_lookup(&tsv->fields[i]) < 0)
+			return false;
+	}
+
+	return tsv->nr_fields > 0;
+}
+
+void ob_reader_init(struct ob_reader *reader, struct tsv_reader *tsv)
+{
+	unsigned int i;
+
+	memset(reader, 0, sizeof(*reader));
+
+	reader->tsv = tsv;
+
+	for (i = 0; i < tsv->nr_fields; i++) {
+		const struct tsv_field *field = &tsv->fields[i];
+		int idx;
+
+		idx = ob_column_lookup(field);
+		if (idx < 0)
+			error("%s: %.*s: unknown column", tsv->filename, (int) field->len, field->s);
+
+		reader->column_names[i]		= column_names[idx];
+		reader->column_parsers[i]	= column_parsers[idx];
+	}
+
+	reader->nr_columns = tsv->nr_fields;
+}
+
+bool ob_read_event(struct ob_reader *reader, struct ob_event *event)
+{
+	struct tsv_reader *tsv = reader->tsv;
+	unsigned int i;
+
+	if (!tsv_read_row(tsv))
+		return false;
+
+	if (tsv->nr_fields != reader->nr_columns)
+		error("%s:%" PRIu64 ": expected %u fields, got %u", tsv->filename, tsv->line, reader->nr_columns, tsv->nr_fields);
+
+	memset(event, 0, sizeof(*event));
+
+	for (i = 0; i < reader->nr_columns; i++)
+		reader->column_parsers[i](reader, event, &tsv->fields[i]);
+
+	return true;
 }
@@ -0,0 +1,1145 @@
+#include "tick/output.h"
+
+#include "tick/profile.h"
+#include "tick/error.h"
+#include "tick/types.h"
+
+#ifdef CONFIG_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef CONFIG_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <zlib.h>
+
+const char *output_compression_names[] = {
+	[OUTPUT_COMPRESSION_NONE]	= "none",
+	[OUTPUT_COMPRESSION_GZIP]	= "gzip",
+	[OUTPUT_COMPRESSION_ZSTD]	= "zstd",
+};
+
+enum output_compression parse_output_compression(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(output_compression_names); i++) {
+		if (!strcmp(name, output_compression_names[i]))
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Parse a size in bytes with an optional K, M or G suffix.  Returns zero if
+ * the size is not valid.
+ */
+uint64_t parse_output_size(const char *s)
+{
+	uint64_t ret;
+	char *end;
+
+	ret = strtoull(s, &end, 10);
+
+	switch (*end) {
+	case 'G': case 'g':
+		ret <<= 10;
+		/* fallthrough */
+	case 'M': case 'm':
+		ret <<= 10;
+		/* fallthrough */
+	case 'K': case 'k':
+		ret <<= 10;
+		end++;
+		break;
+	default:
+		break;
+	}
+
+	if (*end)
+		return 0;
+
+	return ret;
+}
+
+/*
+ * Parse a time interval with an optional ms, s, m or h suffix into
+ * nanoseconds.  Seconds are the default unit.  Returns zero if the interval
+ * is not valid.
+ */
+uint64_t parse_output_interval(const char *s)
+{
+	uint64_t ret;
+	char *end;
+
+	ret = strtoull(s, &end, 10);
+
+	if (!strcmp(end, "ms"))
+		return ret * 1000000ULL;
+
+	switch (*end) {
+	case 'h':
+		ret *= 60;
+		/* fallthrough */
+	case 'm':
+		ret *= 60;
+		/* fallthrough */
+	case 's':
+		end++;
+		break;
+	default:
+		break;
+	}
+
+	if (*end)
+		return 0;
+
+	return ret * 1000000000ULL;
+}
+
+/*
+ * Parse one of the command line options that select how output is written:
+ * -z (compression), -j (compression threads), -R (roll size) and -T (roll
+ * interval).  Returns false if 'opt' is not one of them.
+ */
+bool output_parse_option(struct output_options *opts, int opt, const char *arg)
+{
+	char *end;
+
+	switch (opt) {
+	case 'z':
+		opts->compression	= parse_output_compression(arg);
+		if ((int) opts->compression < 0)
+			error("%s is not a supported compression method", arg);
+		break;
+	case 'j':
+		opts->nr_threads	= strtoul(arg, &end, 10);
+		if (*end)
+			error("%s: invalid number of threads", arg);
+		break;
+	case 'R':
+		opts->roll_size		= parse_output_size(arg);
+		if (!opts->roll_size)
+			error("%s: invalid size", arg);
+		break;
+	case 'T':
+		opts->roll_interval	= parse_output_interval(arg);
+		if (!opts->roll_interval)
+			error("%s: invalid interval", arg);
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+static void output_xwrite(struct output *out, const char *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t nr;
+
+		nr = write(out->fd, buf, len);
+		if (nr < 0) {
+			if (errno == EINTR)
+				continue;
+
+			error("%s: %s", out->path, strerror(errno));
+		}
+
+		buf += nr;
+		len -= nr;
+	}
+}
+
+static bool output_is_pipe(struct output *out)
+{
+	struct stat st;
+
+	if (fstat(out->fd, &st) < 0)
+		error("%s: %s", out->path, strerror(errno));
+
+	return S_ISFIFO(st.st_mode);
+}
+
+/*
+ * Uncompressed output to a pipe is handed to the kernel with vmsplice(),
+ * which maps the pages of the output buffer into the pipe instead of
+ * copying them.  The pipe keeps referring to the pages after the reader
+ * has drained it if the reader splices or tees them on, as pv does, so a
+ * buffer can never be reused for new output.  Every buffer is therefore
+ * mapped fresh, gifted to the kernel with SPLICE_F_GIFT and unmapped right
+ * away; the pipe keeps the pages alive for as long as it needs them.
+ */
+static char *output_splice_buf(struct output *out)
+{
+	void *buf;
+
+	buf = mmap(NULL, out->capacity, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED)
+		error("out of memory");
+
+	return buf;
+}
+
+static void output_splice_init(struct output *out)
+{
+	/* Ask for a larger pipe, but make do with what we get: */
+	fcntl(out->fd, F_SETPIPE_SZ, OUTPUT_BLOCK_SIZE);
+
+	out->buffer_bytes += out->capacity;
+
+	out->buf	= output_splice_buf(out);
+	out->splice	= true;
+}
+
+static void output_vmsplice(struct output *out, char *buf, size_t len)
+{
+	while (len > 0) {
+		struct iovec iov;
+		ssize_t nr;
+
+		iov = (struct iovec) {
+			.iov_base	= buf,
+			.iov_len	= len,
+		};
+
+		nr = vmsplice(out->fd, &iov, 1, SPLICE_F_GIFT);
+		if (nr < 0) {
+			if (errno == EINTR)
+				continue;
+
+			/* Not supported for this pipe, fall back to copying: */
+			if (errno == EINVAL || errno == ENOSYS) {
+				output_xwrite(out, buf, len);
+				return;
+			}
+
+			error("%s: %s", out->path, strerror(errno));
+		}
+
+		buf += nr;
+		len -= nr;
+	}
+}
+
+static void output_splice_flush(struct output *out)
+{
+	output_vmsplice(out, out->buf, out->pos);
+
+	if (munmap(out->buf, out->capacity) < 0)
+		error("%s: %s", out->path, strerror(errno));
+
+	out->buf = output_splice_buf(out);
+}
+
+#ifdef CONFIG_HAVE_LIBURING
+/*
+ * Uncompressed output to a file is written asynchronously with io_uring.
+ * Each flushed buffer is submitted as a write at an explicit file offset
+ * and formatting continues in the next buffer of the ring.  We only wait
+ * when the next buffer still has a write in flight.
+ */
+struct output_uring {
+	struct io_uring		ring;
+	char			*bufs[OUTPUT_ASYNC_BUFS];
+	size_t			lens[OUTPUT_ASYNC_BUFS];
+	uint64_t		offsets[OUTPUT_ASYNC_BUFS];
+	bool			busy[OUTPUT_ASYNC_BUFS];
+	unsigned int		idx;
+	unsigned int		nr_inflight;
+	uint64_t		offset;
+};
+
+static void output_uring_init(struct output *out)
+{
+	struct output_uring *uring;
+	unsigned int i;
+	off_t offset;
+
+	/*
+	 * Writes need explicit offsets, so the file must be seekable and not
+	 * in append mode:
+	 */
+	if (fcntl(out->fd, F_GETFL) & O_APPEND)
+		return;
+
+	offset = lseek(out->fd, 0, SEEK_CUR);
+	if (offset < 0)
+		return;
+
+	uring = calloc(1, sizeof(*uring));
+	if (!uring)
+		error("out of memory");
+
+	if (io_uring_queue_init(OUTPUT_ASYNC_BUFS, &uring->ring, 0) < 0) {
+		/* Not supported by the kernel, use a writer thread instead: */
+		free(uring);
+		return;
+	}
+
+	for (i = 0; i < OUTPUT_ASYNC_BUFS; i++) {
+		uring->bufs[i] = malloc(OUTPUT_BLOCK_SIZE);
+		if (!uring->bufs[i])
+			error("out of memory");
+	}
+
+	out->buffer_bytes += OUTPUT_ASYNC_BUFS * OUTPUT_BLOCK_SIZE;
+
+	uring->offset = offset;
+
+	out->buf	= uring->bufs[0];
+	out->uring	= uring;
+}
+
+static void output_uring_reap(struct output *out)
+{
+	struct output_uring *uring = out->uring;
+	struct io_uring_cqe *cqe = NULL;
+	unsigned int idx;
+	int ret;
+
+	ret = io_uring_wait_cqe(&uring->ring, &cqe);
+	if (ret < 0)
+		error("%s: %s", out->path, strerror(-ret));
+
+	idx = cqe->user_data;
+	ret = cqe->res;
+
+	io_uring_cqe_seen(&uring->ring, cqe);
+
+	if (ret < 0)
+		error("%s: %s", out->path, strerror(-ret));
+
+	/* Short writes are rare, so finish them synchronously: */
+	if ((size_t) ret < uring->lens[idx]) {
+		const char *buf = uring->bufs[idx] + ret;
+		size_t len = uring->lens[idx] - ret;
+		uint64_t offset = uring->offsets[idx] + ret;
+
+		while (len > 0) {
+			ssize_t nr;
+
+			nr = pwrite(out->fd, buf, len, offset);
+			if (nr < 0) {
+				if (errno == EINTR)
+					continue;
+
+				error("%s: %s", out->path, strerror(errno));
+			}
+
+			buf += nr;
+			len -= nr;
+			offset += nr;
+		}
+	}
+
+	out->bytes_out += uring->lens[idx];
+
+	uring->busy[idx] = false;
+
+	uring->nr_inflight--;
+}
+
+static void output_uring_submit(struct output *out)
+{
+	struct output_uring *uring = out->uring;
+	struct io_uring_sqe *sqe;
+	unsigned int idx;
+
+	idx = uring->idx;
+
+	sqe = io_uring_get_sqe(&uring->ring);
+	if (!sqe)
+		error("%s: io_uring submission queue is full", out->path);
+
+	io_uring_prep_write(sqe, out->fd, uring->bufs[idx], out->pos, uring->offset);
+
+	sqe->user_data = idx;
+
+	if (io_uring_submit(&uring->ring) < 0)
+		error("%s: unable to submit write", out->path);
+
+	uring->lens[idx]	= out->pos;
+	uring->offsets[idx]	= uring->offset;
+	uring->busy[idx]	= true;
+	uring->offset		+= out->pos;
+
+	uring->nr_inflight++;
+
+	uring->idx = (idx + 1) % OUTPUT_ASYNC_BUFS;
+
+	while (uring->busy[uring->idx])
+		output_uring_reap(out);
+
+	out->buf = uring->bufs[uring->idx];
+}
+
+static void output_uring_drain(struct output *out)
+{
+	struct output_uring *uring = out->uring;
+
+	while (uring->nr_inflight)
+		output_uring_reap(out);
+}
+
+static void output_uring_reset(struct output *out)
+{
+	struct output_uring *uring = out->uring;
+
+	uring->offset = 0;
+}
+
+static void output_uring_release(struct output *out)
+{
+	struct output_uring *uring = out->uring;
+	unsigned int i;
+
+	output_uring_drain(out);
+
+	/* Leave the file position after our output, as write() would: */
+	if (lseek(out->fd, uring->offset, SEEK_SET) < 0)
+		error("%s: %s", out->path, strerror(errno));
+
+	io_uring_queue_exit(&uring->ring);
+
+	for (i = 0; i < OUTPUT_ASYNC_BUFS; i++)
+		free(uring->bufs[i]);
+
+	free(uring);
+}
+#else
+static void output_uring_init(struct output *out __maybe_unused)
+{
+}
+
+static void output_uring_submit(struct output *out __maybe_unused)
+{
+}
+
+static void output_uring_drain(struct output *out __maybe_unused)
+{
+}
+
+static void output_uring_reset(struct output *out __maybe_unused)
+{
+}
+
+static void output_uring_release(struct output *out __maybe_unused)
+{
+}
+#endif
+
+static void output_worker_init(struct output_worker *worker, struct output *out)
+{
+	worker->output = out;
+
+	switch (out->compression) {
+	case OUTPUT_COMPRESSION_GZIP: {
+		z_stream *zstream;
+
+		zstream = calloc(1, sizeof(*zstream));
+		if (!zstream)
+			error("out of memory");
+
+		/* 15 + 16 selects a gzip wrapper instead of zlib. */
+		if (deflateInit2(zstream, out->level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			error("unable to initialize zlib");
+
+		worker->zstream = zstream;
+
+		break;
+	}
+	case OUTPUT_COMPRESSION_ZSTD: {
+#ifdef CONFIG_HAVE_ZSTD
+		worker->zstd_cctx = ZSTD_createCCtx();
+		if (!worker->zstd_cctx)
+			error("unable to initialize zstd");
+#endif
+		break;
+	}
+	case OUTPUT_COMPRESSION_NONE:
+	default:
+		break;
+	}
+}
+
+static void output_worker_release(struct output_worker *worker)
+{
+	if (worker->zstream) {
+		deflateEnd(worker->zstream);
+
+		free(worker->zstream);
+	}
+
+#ifdef CONFIG_HAVE_ZSTD
+	if (worker->zstd_cctx)
+		ZSTD_freeCCtx(worker->zstd_cctx);
+#endif
+}
+
+static void output_compress(struct output_worker *worker, struct output_block *block)
+{
+	struct output *out = worker->output;
+
+	switch (out->compression) {
+	case OUTPUT_COMPRESSION_GZIP: {
+		z_stream *zstream = worker->zstream;
+
+		if (deflateReset(zstream) != Z_OK)
+			error("%s: unable to compress output", out->filename);
+
+		zstream->next_in	= (void *) block->data;
+		zstream->avail_in	= block->len;
+		zstream->next_out	= (void *) block->comp;
+		zstream->avail_out	= block->comp_capacity;
+
+		if (deflate(zstream, Z_FINISH) != Z_STREAM_END)
+			error("%s: unable to compress output", out->filename);
+
+		block->comp_len = block->comp_capacity - zstream->avail_out;
+
+		break;
+	}
+	case OUTPUT_COMPRESSION_ZSTD: {
+#ifdef CONFIG_HAVE_ZSTD
+		size_t ret;
+
+		ret = ZSTD_compressCCtx(worker->zstd_cctx, block->comp, block->comp_capacity,
+					block->data, block->len, out->level);
+		if (ZSTD_isError(ret))
+			error("%s: %s", out->filename, ZSTD_getErrorName(ret));
+
+		block->comp_len = ret;
+#endif
+		break;
+	}
+	case OUTPUT_COMPRESSION_NONE:
+	default:
+		break;
+	}
+}
+
+static void *output_worker_main(void *arg)
+{
+	struct output_worker *worker = arg;
+	struct output *out = worker->output;
+
+	for (;;) {
+		struct output_block *block;
+
+		pthread_mutex_lock(&out->lock);
+
+		while (out->cseq == out->seq && !out->closing)
+			pthread_cond_wait(&out->cond, &out->lock);
+
+		if (out->cseq == out->seq) {
+			pthread_mutex_unlock(&out->lock);
+			break;
+		}
+
+		block = &out->blocks[out->cseq++ % out->nr_blocks];
+
+		pthread_mutex_unlock(&out->lock);
+
+		output_compress(worker, block);
+
+		pthread_mutex_lock(&out->lock);
+
+		block->state = OUTPUT_BLOCK_DONE;
+
+		pthread_cond_broadcast(&out->cond);
+
+		pthread_mutex_unlock(&out->lock);
+	}
+
+	return NULL;
+}
+
+static bool output_writer_ready(struct output *out)
+{
+	if (out->wseq < out->seq)
+		return out->blocks[out->wseq % out->nr_blocks].state == OUTPUT_BLOCK_DONE;
+
+	return out->closing;
+}
+
+static void *output_writer_main(void *arg)
+{
+	struct output *out = arg;
+
+	for (;;) {
+		struct output_block *block;
+
+		pthread_mutex_lock(&out->lock);
+
+		while (!output_writer_ready(out))
+			pthread_cond_wait(&out->cond, &out->lock);
+
+		if (out->wseq == out->seq) {
+			pthread_mutex_unlock(&out->lock);
+			break;
+		}
+
+		block = &out->blocks[out->wseq % out->nr_blocks];
+
+		pthread_mutex_unlock(&out->lock);
+
+		output_xwrite(out, block->comp ? block->comp : block->data, block->comp_len);
+
+		pthread_mutex_lock(&out->lock);
+
+		out->bytes_out += block->comp_len;
+
+		block->state = OUTPUT_BLOCK_FREE;
+
+		out->wseq++;
+
+		pthread_cond_broadcast(&out->cond);
+
+		pthread_mutex_unlock(&out->lock);
+	}
+
+	return NULL;
+}
+
+static size_t output_comp_bound(struct output *out)
+{
+	switch (out->compression) {
+	case OUTPUT_COMPRESSION_GZIP:
+		/* Worst case deflate expansion plus the gzip header and trailer. */
+		return compressBound(OUTPUT_BLOCK_SIZE) + 64;
+	case OUTPUT_COMPRESSION_ZSTD:
+#ifdef CONFIG_HAVE_ZSTD
+		return ZSTD_compressBound(OUTPUT_BLOCK_SIZE);
+#else
+		break;
+#endif
+	case OUTPUT_COMPRESSION_NONE:
+	default:
+		break;
+	}
+
+	return OUTPUT_BLOCK_SIZE;
+}
+
+static void output_start_pipeline(struct output *out, unsigned int nr_threads)
+{
+	size_t comp_capacity;
+	unsigned int i;
+
+	/* Uncompressed blocks go straight to the writer thread: */
+	if (out->compression == OUTPUT_COMPRESSION_NONE) {
+		out->nr_workers	= 0;
+		out->nr_blocks	= OUTPUT_ASYNC_BUFS;
+	} else {
+		if (!nr_threads)
+			nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+		out->nr_workers	= nr_threads;
+		out->nr_blocks	= 2 * nr_threads + 2;
+	}
+
+	out->blocks = calloc(out->nr_blocks, sizeof(*out->blocks));
+	if (!out->blocks)
+		error("out of memory");
+
+	comp_capacity = output_comp_bound(out);
+
+	for (i = 0; i < out->nr_blocks; i++) {
+		struct output_block *block = &out->blocks[i];
+
+		block->data = malloc(OUTPUT_BLOCK_SIZE);
+		if (!block->data)
+			error("out of memory");
+
+		out->buffer_bytes += OUTPUT_BLOCK_SIZE;
+
+		if (!out->nr_workers)
+			continue;
+
+		block->comp = malloc(comp_capacity);
+		if (!block->comp)
+			error("out of memory");
+
+		block->comp_capacity = comp_capacity;
+
+		out->buffer_bytes += comp_capacity;
+	}
+
+	out->buf = out->blocks[0].data;
+
+	pthread_mutex_init(&out->lock, NULL);
+	pthread_cond_init(&out->cond, NULL);
+
+	out->workers = calloc(out->nr_workers, sizeof(*out->workers));
+	if (!out->workers)
+		error("out of memory");
+
+	for (i = 0; i < out->nr_workers; i++) {
+		struct output_worker *worker = &out->workers[i];
+
+		output_worker_init(worker, out);
+
+		if (pthread_create(&worker->thread, NULL, output_worker_main, worker))
+			error("unable to create compression thread");
+	}
+
+	if (pthread_create(&out->writer, NULL, output_writer_main, out))
+		error("unable to create writer thread");
+}
+
+static int output_open_file(const char *filename)
+{
+	int fd;
+
+	fd = open(filename, O_RDWR|O_CREAT|O_EXCL, 0644);
+	if (fd < 0)
+		error("%s: %s", filename, strerror(errno));
+
+	return fd;
+}
+
+/*
+ * Chunk and manifest file names are derived from the output file name by
+ * inserting a suffix before the file extensions: "AAPL.tsv.gz" is rolled
+ * over to "AAPL-00000.tsv.gz", "AAPL-00001.tsv.gz" and so on, and the
+ * manifest is written to "AAPL-manifest.tsv".
+ */
+static char *output_derive_filename(const char *filename, const char *suffix, const char *ext)
+{
+	const char *base, *dot;
+	size_t len;
+	char *ret;
+
+	base = strrchr(filename, '/');
+	base = base ? base + 1 : filename;
+
+	dot = strchr(base, '.');
+	if (!dot)
+		dot = base + strlen(base);
+
+	if (!ext)
+		ext = dot;
+
+	len = (dot - filename) + strlen(suffix) + strlen(ext) + 1;
+
+	ret = malloc(len);
+	if (!ret)
+		error("out of memory");
+
+	snprintf(ret, len, "%.*s%s%s", (int) (dot - filename), filename, suffix, ext);
+
+	return ret;
+}
+
+static void output_start_chunk(struct output *out)
+{
+	char suffix[16];
+
+	snprintf(suffix, sizeof(suffix), "-%05u", out->chunk.seq);
+
+	free(out->path);
+
+	out->path	= output_derive_filename(out->filename, suffix, NULL);
+	out->fd		= output_open_file(out->path);
+
+	out->chunk = (struct output_chunk) {
+		.seq		= out->chunk.seq,
+		.first_time	= OUTPUT_TIME_NONE,
+		.last_time	= OUTPUT_TIME_NONE,
+		.start_in	= out->bytes_in + out->pos,
+		.start_out	= out->bytes_out,
+	};
+
+	if (out->header)
+		output_write(out, out->header, out->header_len);
+
+	if (out->context) {
+		output_write(out, out->context, out->context_len);
+
+		out->chunk.rows++;
+		out->chunk.context_rows++;
+	}
+}
+
+static void output_fmt_time(FILE *file, uint64_t time, char delim)
+{
+	if (time != OUTPUT_TIME_NONE)
+		fprintf(file, "%" PRIu64, time);
+
+	fputc(delim, file);
+}
+
+static void output_finish_chunk(struct output *out)
+{
+	struct output_chunk *chunk = &out->chunk;
+	const char *base;
+
+	if (close(out->fd) < 0)
+		error("%s: %s", out->path, strerror(errno));
+
+	base = strrchr(out->path, '/');
+	base = base ? base + 1 : out->path;
+
+	fprintf(out->manifest, "%s\t", base);
+	output_fmt_time(out->manifest, chunk->first_time, '\t');
+	output_fmt_time(out->manifest, chunk->last_time, '\t');
+	fprintf(out->manifest, "%" PRIu64 "\t%" PRIu64 "\n", chunk->rows, out->bytes_out - chunk->start_out);
+
+	/* Keep the manifest usable for the chunks that are done if we fail later: */
+	if (fflush(out->manifest))
+		error("%s: %s", out->manifest_filename, strerror(errno));
+}
+
+static void output_drain(struct output *out)
+{
+	if (out->uring)
+		output_uring_drain(out);
+
+	if (!out->blocks)
+		return;
+
+	pthread_mutex_lock(&out->lock);
+
+	while (out->wseq != out->seq)
+		pthread_cond_wait(&out->cond, &out->lock);
+
+	pthread_mutex_unlock(&out->lock);
+}
+
+void output_roll(struct output *out)
+{
+	output_flush(out);
+
+	output_drain(out);
+
+	output_finish_chunk(out);
+
+	out->chunk.seq++;
+
+	output_start_chunk(out);
+
+	if (out->uring)
+		output_uring_reset(out);
+}
+
+static void output_open_manifest(struct output *out)
+{
+	int fd;
+
+	out->manifest_filename = output_derive_filename(out->filename, "-manifest", ".tsv");
+
+	fd = output_open_file(out->manifest_filename);
+
+	out->manifest = fdopen(fd, "w");
+	if (!out->manifest)
+		error("%s: %s", out->manifest_filename, strerror(errno));
+
+	fprintf(out->manifest, "Chunk\tFirstTime\tLastTime\tRows\tBytes\n");
+}
+
+struct output *output_open(const char *filename, struct output_options *opts)
+{
+	struct output *out;
+
+	out = calloc(1, sizeof(*out));
+	if (!out)
+		error("out of memory");
+
+	out->filename		= filename;
+	out->roll_size		= opts->roll_size;
+	out->roll_interval	= opts->roll_interval;
+	out->compression	= opts->compression;
+	out->level		= opts->level;
+	out->capacity		= OUTPUT_BLOCK_SIZE;
+
+	out->chunk = (struct output_chunk) {
+		.first_time	= OUTPUT_TIME_NONE,
+		.last_time	= OUTPUT_TIME_NONE,
+	};
+
+	if (!strcmp(filename, "-")) {
+		if (out->roll_size || out->roll_interval)
+			error("unable to roll over output to stdout");
+
+		out->path	= strdup("stdout");
+		out->fd		= STDOUT_FILENO;
+	} else if (out->roll_size || out->roll_interval) {
+		output_open_manifest(out);
+
+		output_start_chunk(out);
+	} else {
+		out->path	= strdup(filename);
+		out->fd		= output_open_file(filename);
+	}
+
+	switch (out->compression) {
+	case OUTPUT_COMPRESSION_GZIP:
+		if (!out->level)
+			out->level = Z_DEFAULT_COMPRESSION;
+
+		output_start_pipeline(out, opts->nr_threads);
+
+		break;
+	case OUTPUT_COMPRESSION_ZSTD:
+#ifndef CONFIG_HAVE_ZSTD
+		error("%s: zstd compression is not supported by this build", filename);
+#endif
+		output_start_pipeline(out, opts->nr_threads);
+
+		break;
+	case OUTPUT_COMPRESSION_NONE:
+	default:
+		if (output_is_pipe(out))
+			output_splice_init(out);
+		else
+			output_uring_init(out);
+
+		if (out->splice || out->uring)
+			break;
+
+		output_start_pipeline(out, 0);
+
+		break;
+	}
+
+	return out;
+}
+
+static void output_submit(struct output *out)
+{
+	struct output_block *block;
+
+	pthread_mutex_lock(&out->lock);
+
+	block = &out->blocks[out->seq % out->nr_blocks];
+
+	block->len	= out->pos;
+	block->state	= OUTPUT_BLOCK_QUEUED;
+
+	if (!out->nr_workers) {
+		block->comp_len	= block->len;
+		block->state	= OUTPUT_BLOCK_DONE;
+	}
+
+	out->seq++;
+
+	pthread_cond_broadcast(&out->cond);
+
+	/* Wait for the next block in the ring to be written out: */
+	block = &out->blocks[out->seq % out->nr_blocks];
+
+	while (block->state != OUTPUT_BLOCK_FREE)
+		pthread_cond_wait(&out->cond, &out->lock);
+
+	pthread_mutex_unlock(&out->lock);
+
+	out->buf = block->data;
+}
+
+void output_flush(struct output *out)
+{
+	if (!out->pos)
+		return;
+
+	profile_enter(PROFILE_STAGE_WRITE);
+
+	out->bytes_in += out->pos;
+
+	if (out->blocks) {
+		output_submit(out);
+	} else if (out->uring) {
+		output_uring_submit(out);
+	} else {
+		output_splice_flush(out);
+
+		out->bytes_out += out->pos;
+	}
+
+	out->pos = 0;
+
+	profile_leave();
+}
+
+void output_reserve_slow(struct output *out, size_t len)
+{
+	if (len > OUTPUT_MAX_RESERVE)
+		error("%s: row of up to %zu bytes does not fit in the output buffer", out->path, len);
+
+	output_flush(out);
+}
+
+void output_write(struct output *out, const void *data, size_t len)
+{
+	while (len > 0) {
+		size_t nr;
+
+		if (out->pos == out->capacity)
+			output_flush(out);
+
+		nr = out->capacity - out->pos;
+		if (nr > len)
+			nr = len;
+
+		memcpy(out->buf + out->pos, data, nr);
+
+		out->pos += nr;
+
+		data = (const char *) data + nr;
+		len -= nr;
+	}
+}
+
+/*
+ * Copy a byte range of a file to the output.  The range is read with
+ * pread(2) straight into the output buffer.
+ */
+void output_copy_range(struct output *out, int fd, const char *filename, uint64_t offset, uint64_t len)
+{
+	while (len > 0) {
+		size_t count;
+		ssize_t nr;
+
+		if (out->pos == out->capacity)
+			output_flush(out);
+
+		count = out->capacity - out->pos;
+		if (count > len)
+			count = len;
+
+		nr = pread(fd, out->buf + out->pos, count, offset);
+		if (nr < 0) {
+			if (errno == EINTR)
+				continue;
+
+			error("%s: %s", filename, strerror(errno));
+		}
+
+		if (!nr)
+			error("%s: unexpected end of file", filename);
+
+		out->pos += nr;
+
+		offset	+= nr;
+		len	-= nr;
+	}
+}
+
+/*
+ * Write the table header and remember it for the chunks that follow.
+ */
+void output_write_header(struct output *out, const void *data, size_t len)
+{
+	free(out->header);
+
+	out->header = malloc(len);
+	if (!out->header)
+		error("out of memory");
+
+	memcpy(out->header, data, len);
+
+	out->header_len = len;
+
+	output_write(out, data, len);
+}
+
+/*
+ * Remember a row that applies to the rows after it, such as the date row of
+ * OB and TAQ files, and repeat it at the start of the chunks that follow.
+ * The row has already been written to the current chunk.
+ */
+void output_set_context(struct output *out, const void *data, size_t len)
+{
+	if (!out->manifest)
+		return;
+
+	free(out->context);
+
+	out->context = malloc(len);
+	if (!out->context)
+		error("out of memory");
+
+	memcpy(out->context, data, len);
+
+	out->context_len = len;
+}
+
+static void output_stop_pipeline(struct output *out)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&out->lock);
+
+	out->closing = true;
+
+	pthread_cond_broadcast(&out->cond);
+
+	pthread_mutex_unlock(&out->lock);
+
+	for (i = 0; i < out->nr_workers; i++) {
+		struct output_worker *worker = &out->workers[i];
+
+		pthread_join(worker->thread, NULL);
+
+		output_worker_release(worker);
+	}
+
+	pthread_join(out->writer, NULL);
+
+	for (i = 0; i < out->nr_blocks; i++) {
+		struct output_block *block = &out->blocks[i];
+
+		free(block->data);
+		free(block->comp);
+	}
+
+	pthread_cond_destroy(&out->cond);
+	pthread_mutex_destroy(&out->lock);
+
+	free(out->workers);
+	free(out->blocks);
+}
+
+void output_close(struct output *out)
+{
+	output_flush(out);
+
+	if (out->blocks) {
+		output_stop_pipeline(out);
+	} else if (out->uring) {
+		output_uring_release(out);
+	} else {
+		munmap(out->buf, out->capacity);
+	}
+
+	if (out->manifest) {
+		output_finish_chunk(out);
+
+		if (fclose(out->manifest))
+			error("%s: %s", out->manifest_filename, strerror(errno));
+	} else if (out->fd != STDOUT_FILENO) {
+		if (close(out->fd) < 0)
+			error("%s: %s", out->path, strerror(errno));
+	}
+
+	profile_output(out->bytes_in, out->bytes_out);
+
+	free(out->manifest_filename);
+	free(out->context);
+	free(out->header);
+	free(out->path);
+	free(out);
+}
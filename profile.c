@@ -0,0 +1,277 @@
+#include "tick/profile.h"
+
+#include "tick/error.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+struct profile profile;
+
+static struct counters counters;
+
+static const char *stage_names[PROFILE_NR_STAGES] = {
+	[PROFILE_STAGE_OTHER]	= "Other",
+	[PROFILE_STAGE_INFLATE]	= "Inflate",
+	[PROFILE_STAGE_DECODE]	= "Decode",
+	[PROFILE_STAGE_LOOKUP]	= "Order lookup",
+	[PROFILE_STAGE_FILTER]	= "Filter",
+	[PROFILE_STAGE_PROCESS]	= "Process",
+	[PROFILE_STAGE_FORMAT]	= "Format",
+	[PROFILE_STAGE_WRITE]	= "Write",
+};
+
+static uint64_t profile_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void profile_start(bool with_counters, bool with_latency)
+{
+	profile = (struct profile) {
+		.enabled	= true,
+		.stack		= { PROFILE_STAGE_OTHER },
+		.with_latency	= with_latency,
+	};
+
+	if (with_counters) {
+		int err = counters_open(&counters);
+
+		if (err < 0) {
+			warning("hardware counters unavailable: %s", counters_strerror(err));
+
+			profile.counters_err = err;
+		} else {
+			profile.counters = &counters;
+
+			counters_read(&counters, profile.counter_last);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &profile.start_time);
+
+	profile.start_ticks	= profile_ticks();
+	profile.last		= profile.start_ticks;
+}
+
+void profile_charge_counters(enum profile_stage stage)
+{
+	uint64_t values[NR_COUNTERS];
+	unsigned int i;
+
+	counters_read(profile.counters, values);
+
+	for (i = 0; i < NR_COUNTERS; i++) {
+		profile.counter_stage[stage][i] += values[i] - profile.counter_last[i];
+		profile.counter_last[i] = values[i];
+	}
+}
+
+void profile_output(uint64_t bytes_formatted, uint64_t bytes_out)
+{
+	profile.bytes_formatted	+= bytes_formatted;
+	profile.bytes_out	+= bytes_out;
+}
+
+static double ratio(uint64_t n, uint64_t d)
+{
+	return d ? (double) n / d : 0.0;
+}
+
+static void print_counter_row(const char *name, const uint64_t *values)
+{
+	fprintf(stderr, "  %-22s %'16" PRIu64 " %'16" PRIu64 " %6.2f %'14" PRIu64 " %'14" PRIu64 "\n",
+		name,
+		values[COUNTER_CYCLES],
+		values[COUNTER_INSTRUCTIONS],
+		ratio(values[COUNTER_INSTRUCTIONS], values[COUNTER_CYCLES]),
+		values[COUNTER_CACHE_MISSES],
+		values[COUNTER_BRANCH_MISSES]);
+}
+
+static void print_counters(uint64_t nr_messages)
+{
+	uint64_t totals[NR_COUNTERS] = { 0 };
+	unsigned int i, j;
+
+	if (profile.counters_err) {
+		fprintf(stderr, "  Hardware counters unavailable: %s\n\n", counters_strerror(profile.counters_err));
+		return;
+	}
+
+	fprintf(stderr, "  %-22s %16s %16s %6s %14s %14s\n",
+		"Stage", "Cycles", "Instructions", "IPC", "Cache misses", "Branch misses");
+
+	for (i = 0; i < PROFILE_NR_STAGES; i++) {
+		if (!profile.stage_ticks[i])
+			continue;
+
+		print_counter_row(stage_names[i], profile.counter_stage[i]);
+
+		for (j = 0; j < NR_COUNTERS; j++)
+			totals[j] += profile.counter_stage[i][j];
+	}
+
+	print_counter_row("Total", totals);
+
+	fprintf(stderr, "\n  %-22s %18s %12s\n", "Counter", "Total", "Per message");
+
+	for (j = 0; j < NR_COUNTERS; j++) {
+		if (!counter_is_open(profile.counters, j)) {
+			fprintf(stderr, "  %-22s %18s\n", counter_names[j], "not supported");
+			continue;
+		}
+
+		fprintf(stderr, "  %-22s %'18" PRIu64 " %'12.2f\n",
+			counter_names[j], totals[j], ratio(totals[j], nr_messages));
+	}
+
+	fprintf(stderr, "\n  %-22s %17.2f%%\n", "Cache miss rate",
+		100.0 * ratio(totals[COUNTER_CACHE_MISSES], totals[COUNTER_CACHE_REFERENCES]));
+	fprintf(stderr, "  %-22s %17.2f%%\n\n", "Branch miss rate",
+		100.0 * ratio(totals[COUNTER_BRANCH_MISSES], totals[COUNTER_BRANCHES]));
+
+	counters_close(profile.counters);
+}
+
+static void print_latency_row(const char *name, const struct histogram *hist, double ns_per_tick)
+{
+	fprintf(stderr, "  %-22s %'16" PRIu64 " %'10.0f %'10.0f %'10.0f %'12.0f\n",
+		name, hist->count,
+		histogram_percentile(hist, 50.0) * ns_per_tick,
+		histogram_percentile(hist, 99.0) * ns_per_tick,
+		histogram_percentile(hist, 99.9) * ns_per_tick,
+		hist->max * ns_per_tick);
+}
+
+static void print_latency(double ns_per_tick)
+{
+	struct histogram *all = histogram_new();
+	unsigned int i;
+
+	fprintf(stderr, "  %-22s %16s %10s %10s %10s %12s\n",
+		"Latency (ns)", "Messages", "p50", "p99", "p99.9", "max");
+
+	for (i = 0; i < 256; i++) {
+		struct histogram *hist = profile.type_latency[i];
+		char name[8];
+
+		if (!hist)
+			continue;
+
+		snprintf(name, sizeof(name), "'%c'", i);
+
+		print_latency_row(name, hist, ns_per_tick);
+
+		histogram_add(all, hist);
+
+		histogram_free(hist);
+
+		profile.type_latency[i] = NULL;
+	}
+
+	print_latency_row("All", all, ns_per_tick);
+
+	fprintf(stderr, "\n");
+
+	histogram_free(all);
+}
+
+static void print_bytes(const char *name, uint64_t bytes, double secs)
+{
+	fprintf(stderr, "  %-22s %'18" PRIu64 " %'12.1f\n", name, bytes, secs > 0 ? bytes / secs / 1e6 : 0.0);
+}
+
+void print_profile(const char *filename)
+{
+	uint64_t start_ns, end_ns, ticks, total = 0, nr_messages = 0;
+	double ns_per_tick, secs;
+	unsigned int i;
+
+	if (!profile.enabled)
+		return;
+
+	profile_charge(profile_ticks());
+
+	start_ns = profile.start_time.tv_sec * 1000000000ULL + profile.start_time.tv_nsec;
+	end_ns	 = profile_clock_ns();
+
+	ticks = profile.last - profile.start_ticks;
+
+	ns_per_tick = ticks ? (double) (end_ns - start_ns) / ticks : 0.0;
+
+	for (i = 0; i < PROFILE_NR_STAGES; i++)
+		total += profile.stage_ticks[i];
+
+	secs = total * ns_per_tick / 1e9;
+
+	fprintf(stderr, "\n Profile for '%s':\n\n", filename);
+
+	fprintf(stderr, "  %-22s %12s %8s %16s %10s\n",
+		"Stage", "Time (ms)", "Share", "Calls", "ns/call");
+
+	for (i = 0; i < PROFILE_NR_STAGES; i++) {
+		uint64_t calls = profile.stage_calls[i];
+		double ns = profile.stage_ticks[i] * ns_per_tick;
+
+		if (!profile.stage_ticks[i])
+			continue;
+
+		if (i == PROFILE_STAGE_OTHER) {
+			fprintf(stderr, "  %-22s %'12.1f %7.1f%%\n",
+				stage_names[i], ns / 1e6, 100.0 * profile.stage_ticks[i] / total);
+			continue;
+		}
+
+		fprintf(stderr, "  %-22s %'12.1f %7.1f%% %'16" PRIu64 " %'10.1f\n",
+			stage_names[i], ns / 1e6,
+			100.0 * profile.stage_ticks[i] / total,
+			calls, calls ? ns / calls : 0.0);
+	}
+
+	fprintf(stderr, "  %-22s %'12.1f %7.1f%%\n", "Total", total * ns_per_tick / 1e6, 100.0);
+
+	fprintf(stderr, "\n  %-22s %12s %8s %16s %10s\n",
+		"Message type", "Time (ms)", "Share", "Messages", "ns/msg");
+
+	for (i = 0; i < 256; i++) {
+		uint64_t count = profile.type_count[i];
+		double ns = profile.type_ticks[i] * ns_per_tick;
+		char name[8];
+
+		if (!count)
+			continue;
+
+		nr_messages += count;
+
+		snprintf(name, sizeof(name), "'%c'", i);
+
+		fprintf(stderr, "  %-22s %'12.1f %7.1f%% %'16" PRIu64 " %'10.1f\n",
+			name, ns / 1e6,
+			100.0 * profile.type_ticks[i] / total,
+			count, ns / count);
+	}
+
+	fprintf(stderr, "\n");
+
+	if (profile.with_latency)
+		print_latency(ns_per_tick);
+
+	fprintf(stderr, "  %-22s %18s %12s\n", "Bytes", "Total", "MB/s");
+
+	print_bytes("Input (compressed)", profile.bytes_in, secs);
+	print_bytes("Input (uncompressed)", profile.bytes_decoded, secs);
+
+	if (profile.bytes_formatted) {
+		print_bytes("Output (formatted)", profile.bytes_formatted, secs);
+		print_bytes("Output (written)", profile.bytes_out, secs);
+	}
+
+	fprintf(stderr, "\n");
+
+	if (profile.counters || profile.counters_err)
+		print_counters(nr_messages);
+}
@@ -1,12 +1,253 @@
 #include "tick/progress.h"
 
-#include <libtrading/buffer.h>
+#include "tick/output.h"
+#include "tick/error.h"
+#include "tick/types.h"
 
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
 #include <stdio.h>
 
-void print_progress(struct buffer *buf)
+/*
+ * Time between two reports.  Log lines are written less often so that
+ * long runs do not flood the log.
+ */
+#define PROGRESS_TTY_INTERVAL_MS	250
+#define PROGRESS_LOG_INTERVAL_MS	10000
+
+struct progress progress;
+
+static bool progress_disabled;
+
+const char *progress_mode_names[] = {
+	[PROGRESS_AUTO]	= "auto",
+	[PROGRESS_TTY]	= "tty",
+	[PROGRESS_LOG]	= "log",
+	[PROGRESS_NONE]	= "none",
+};
+
+enum progress_mode parse_progress_mode(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(progress_mode_names); i++) {
+		if (!strcmp(name, progress_mode_names[i]))
+			return i;
+	}
+
+	return -1;
+}
+
+static double progress_elapsed(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - progress.start.tv_sec) + (now.tv_nsec - progress.start.tv_nsec) / 1e9;
+}
+
+static void *progress_tick(void *arg __maybe_unused)
+{
+	unsigned int interval_ms;
+	struct timespec deadline;
+
+	interval_ms = progress.mode == PROGRESS_LOG ? PROGRESS_LOG_INTERVAL_MS : PROGRESS_TTY_INTERVAL_MS;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	pthread_mutex_lock(&progress.lock);
+
+	while (!progress.stopping) {
+		deadline.tv_sec  += interval_ms / 1000;
+		deadline.tv_nsec += (interval_ms % 1000) * 1000000L;
+
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+
+		while (!progress.stopping) {
+			if (pthread_cond_timedwait(&progress.cond, &progress.lock, &deadline))
+				break;
+		}
+
+		__atomic_store_n(&progress.due, true, __ATOMIC_RELAXED);
+	}
+
+	pthread_mutex_unlock(&progress.lock);
+
+	return NULL;
+}
+
+/*
+ * Start reporting progress.  In the automatic mode, progress is reported
+ * only if standard error is a terminal.
+ */
+void progress_start(enum progress_mode mode, const char *filename)
+{
+	pthread_condattr_t attr;
+
+	if (progress_disabled)
+		return;
+
+	if (mode == PROGRESS_AUTO)
+		mode = isatty(STDERR_FILENO) ? PROGRESS_TTY : PROGRESS_NONE;
+
+	progress = (struct progress) {
+		.mode		= mode,
+		.filename	= filename,
+	};
+
+	if (mode == PROGRESS_NONE)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &progress.start);
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+	pthread_mutex_init(&progress.lock, NULL);
+	pthread_cond_init(&progress.cond, &attr);
+
+	pthread_condattr_destroy(&attr);
+
+	if (pthread_create(&progress.ticker, NULL, progress_tick, NULL))
+		error("unable to start progress thread");
+}
+
+/*
+ * Print the final report and stop the ticker thread.
+ */
+void progress_stop(void)
+{
+	if (progress.mode != PROGRESS_TTY && progress.mode != PROGRESS_LOG)
+		return;
+
+	pthread_mutex_lock(&progress.lock);
+
+	progress.stopping = true;
+
+	pthread_cond_signal(&progress.cond);
+
+	pthread_mutex_unlock(&progress.lock);
+
+	pthread_join(progress.ticker, NULL);
+
+	pthread_cond_destroy(&progress.cond);
+	pthread_mutex_destroy(&progress.lock);
+
+	progress_report();
+
+	if (progress.mode == PROGRESS_TTY)
+		fprintf(stderr, "\n");
+
+	progress.mode = PROGRESS_NONE;
+}
+
+void progress_disable(void)
 {
-	fprintf(stderr, "Processing messages: %3u%%\r", (unsigned int)(buf->start * 100 / buf->capacity));
+	progress_disabled = true;
+}
+
+static void format_eta(char *buf, size_t len, double secs)
+{
+	unsigned long s = secs + 0.5;
+
+	if (s >= 3600)
+		snprintf(buf, len, "%lu:%02lu:%02lu", s / 3600, s / 60 % 60, s % 60);
+	else
+		snprintf(buf, len, "%lu:%02lu", s / 60, s % 60);
+}
+
+static void progress_print_tty(double percent, double in_rate, double out_rate, double msg_rate, double eta)
+{
+	char line[256], eta_buf[32];
+	size_t len;
+
+	len = snprintf(line, sizeof(line), "Processing messages: %3u%% %'9.1f MB/s in",
+		(unsigned int) percent, in_rate / 1e6);
+
+	if (progress.output)
+		len += snprintf(line + len, sizeof(line) - len, " %'9.1f MB/s out", out_rate / 1e6);
+
+	len += snprintf(line + len, sizeof(line) - len, " %'13.0f msg/s", msg_rate);
+
+	if (progress.orders)
+		len += snprintf(line + len, sizeof(line) - len, " %'11u orders", g_hash_table_size(progress.orders));
+
+	if (eta >= 0) {
+		format_eta(eta_buf, sizeof(eta_buf), eta);
+
+		snprintf(line + len, sizeof(line) - len, "  ETA %8s", eta_buf);
+	}
+
+	fprintf(stderr, "%s\r", line);
 
 	fflush(stderr);
 }
+
+static void progress_print_log(double secs, double percent, double in_rate, double out_rate,
+			       double msg_rate, double eta, uint64_t bytes_out)
+{
+	fprintf(stderr, "progress file=%s elapsed=%.3f percent=%.1f"
+		" bytes_in=%" PRIu64 " bytes_decoded=%" PRIu64 " bytes_out=%" PRIu64
+		" messages=%" PRIu64 " in_mb_per_sec=%.1f out_mb_per_sec=%.1f messages_per_sec=%.0f",
+		progress.filename ? progress.filename : "-", secs, percent,
+		progress.bytes_in, progress.bytes_decoded, bytes_out,
+		progress.nr_messages, in_rate / 1e6, out_rate / 1e6, msg_rate);
+
+	if (progress.orders)
+		fprintf(stderr, " orders=%u", g_hash_table_size(progress.orders));
+
+	if (eta >= 0)
+		fprintf(stderr, " eta=%.1f", eta);
+
+	fprintf(stderr, "\n");
+}
+
+/*
+ * Print a report.  Rates are measured over the time since the previous
+ * report and the ETA from the average rate since the start.
+ */
+void progress_report(void)
+{
+	double secs, interval, percent = 0.0, eta = -1.0;
+	double in_rate = 0.0, out_rate = 0.0, msg_rate = 0.0;
+	uint64_t bytes_out = 0;
+
+	__atomic_store_n(&progress.due, false, __ATOMIC_RELAXED);
+
+	if (progress.mode != PROGRESS_TTY && progress.mode != PROGRESS_LOG)
+		return;
+
+	secs = progress_elapsed();
+
+	if (progress.output)
+		bytes_out = progress.output->bytes_in + progress.output->pos;
+
+	if (progress.bytes_total) {
+		percent = 100.0 * progress.bytes_in / progress.bytes_total;
+
+		if (progress.bytes_in)
+			eta = secs * (progress.bytes_total - progress.bytes_in) / progress.bytes_in;
+	}
+
+	interval = secs - progress.last_secs;
+	if (interval > 0) {
+		in_rate  = (progress.bytes_decoded - progress.last_bytes_decoded) / interval;
+		out_rate = (bytes_out - progress.last_bytes_out) / interval;
+		msg_rate = (progress.nr_messages - progress.last_messages) / interval;
+	}
+
+	if (progress.mode == PROGRESS_TTY)
+		progress_print_tty(percent, in_rate, out_rate, msg_rate, eta);
+	else
+		progress_print_log(secs, percent, in_rate, out_rate, msg_rate, eta, bytes_out);
+
+	progress.last_secs		= secs;
+	progress.last_bytes_decoded	= progress.bytes_decoded;
+	progress.last_bytes_out		= bytes_out;
+	progress.last_messages		= progress.nr_messages;
+}
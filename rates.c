@@ -0,0 +1,204 @@
+#include "tick/rates.h"
+
+#include "tick/output.h"
+#include "tick/dsv.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+static const char header[] = "Time\tMessages\n";
+
+static const uint64_t window_lengths[RATES_NR_WINDOWS] = {
+	1000000ULL,		/* 1 ms */
+	100000000ULL,		/* 100 ms */
+	1000000000ULL,		/* 1 s */
+};
+
+void rates_init(struct rates *rates, const char *filename, struct output *timeline, uint64_t timeline_interval)
+{
+	unsigned int i;
+
+	*rates = (struct rates) {
+		.filename		= filename,
+		.timeline		= timeline,
+		.timeline_interval	= timeline_interval,
+	};
+
+	for (i = 0; i < RATES_NR_WINDOWS; i++)
+		rates->windows[i].length = window_lengths[i];
+
+	if (timeline)
+		output_write_header(timeline, header, strlen(header));
+}
+
+static void rate_window_record(struct rate_window *window, uint64_t count)
+{
+	unsigned int i, min = 0;
+
+	histogram_record(&window->hist, count);
+
+	if (!count)
+		return;
+
+	if (window->nr_busiest < RATES_NR_BUSIEST) {
+		window->busiest[window->nr_busiest++] = (struct rate_interval) {
+			.start		= window->start,
+			.count		= count,
+		};
+
+		return;
+	}
+
+	for (i = 1; i < RATES_NR_BUSIEST; i++) {
+		if (window->busiest[i].count < window->busiest[min].count)
+			min = i;
+	}
+
+	if (count > window->busiest[min].count) {
+		window->busiest[min] = (struct rate_interval) {
+			.start		= window->start,
+			.count		= count,
+		};
+	}
+}
+
+/*
+ * Close the current window and start the window that 'time' falls into.
+ * The windows skipped in between had no messages.
+ */
+void rate_window_advance(struct rate_window *window, uint64_t time)
+{
+	uint64_t start = time - time % window->length;
+
+	if (window->started) {
+		uint64_t nr_empty = (start - window->start) / window->length - 1;
+
+		rate_window_record(window, window->count);
+
+		histogram_record_count(&window->hist, 0, nr_empty);
+	}
+
+	window->start	= start;
+	window->count	= 0;
+	window->started	= true;
+}
+
+void rates_timeline_advance(struct rates *rates, uint64_t time)
+{
+	struct output *out = rates->timeline;
+
+	if (rates->timeline_count) {
+		size_t idx = 0;
+		char *buf;
+
+		output_begin_row(out, rates->timeline_start);
+
+		buf = output_reserve(out, 2 * DSV_UINT_MAX_LEN);
+
+		idx += dsv_fmt_uint(buf + idx, rates->timeline_start, '\t');
+		idx += dsv_fmt_uint(buf + idx, rates->timeline_count, '\n');
+
+		output_commit(out, idx);
+	}
+
+	rates->timeline_start	= time - time % rates->timeline_interval;
+	rates->timeline_count	= 0;
+}
+
+/*
+ * Close the windows that are still open at the end of the feed.
+ */
+void rates_finish(struct rates *rates)
+{
+	unsigned int i;
+
+	for (i = 0; i < RATES_NR_WINDOWS; i++) {
+		struct rate_window *window = &rates->windows[i];
+
+		if (window->started)
+			rate_window_record(window, window->count);
+
+		window->started = false;
+	}
+
+	if (rates->timeline)
+		rates_timeline_advance(rates, rates->time);
+}
+
+static void fmt_length(char *buf, size_t len, uint64_t length)
+{
+	if (length < 1000000000ULL)
+		snprintf(buf, len, "%" PRIu64 " ms", length / 1000000);
+	else
+		snprintf(buf, len, "%" PRIu64 " s", length / 1000000000);
+}
+
+static void fmt_time(char *buf, size_t len, uint64_t time)
+{
+	uint64_t ms = time / 1000000ULL;
+
+	snprintf(buf, len, "%02" PRIu64 ":%02" PRIu64 ":%02" PRIu64 ".%03" PRIu64,
+		ms / 3600000, ms / 60000 % 60, ms / 1000 % 60, ms % 1000);
+}
+
+static int compare_busiest(const void *a, const void *b)
+{
+	const struct rate_interval *x = a, *y = b;
+
+	if (x->count != y->count)
+		return x->count > y->count ? -1 : 1;
+
+	return x->start < y->start ? -1 : x->start > y->start;
+}
+
+void print_rates(struct rates *rates)
+{
+	unsigned int i, j;
+
+	printf(" Message rates for '%s':\n\n", rates->filename);
+
+	printf("  %-8s %14s %16s %10s %10s %10s %10s\n",
+		"Window", "Peak", "Peak msg/s", "P50", "P90", "P99", "P99.9");
+
+	for (i = 0; i < RATES_NR_WINDOWS; i++) {
+		struct rate_window *window = &rates->windows[i];
+		char length[16];
+
+		fmt_length(length, sizeof(length), window->length);
+
+		printf("  %-8s %'14.0f %'16.0f %'10" PRIu64 " %'10" PRIu64 " %'10" PRIu64 " %'10" PRIu64 "\n",
+			length,
+			(double) window->hist.max,
+			(double) window->hist.max * 1000000000ULL / window->length,
+			histogram_percentile(&window->hist, 50.0),
+			histogram_percentile(&window->hist, 90.0),
+			histogram_percentile(&window->hist, 99.0),
+			histogram_percentile(&window->hist, 99.9));
+	}
+
+	printf("\n");
+
+	for (i = 0; i < RATES_NR_WINDOWS; i++) {
+		struct rate_window *window = &rates->windows[i];
+		char length[16];
+
+		fmt_length(length, sizeof(length), window->length);
+
+		printf(" Busiest %s intervals:\n\n", length);
+
+		qsort(window->busiest, window->nr_busiest, sizeof(*window->busiest), compare_busiest);
+
+		for (j = 0; j < window->nr_busiest; j++) {
+			struct rate_interval *interval = &window->busiest[j];
+			char time[32];
+
+			fmt_time(time, sizeof(time), interval->start);
+
+			printf("  %-14s %'14.0f\n", time, (double) interval->count);
+		}
+
+		printf("\n");
+	}
+}
@@ -1,8 +1,198 @@
 #include "tick/stats.h"
 
+#include "tick/memory.h"
+#include "tick/error.h"
+#include "tick/types.h"
+
+#include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 #include <stdio.h>
 
+void stats_init(struct stats *stats, const char *filename, bool by_symbol)
+{
+	*stats = (struct stats) {
+		.filename	= filename,
+		.by_symbol	= by_symbol,
+	};
+
+	if (!by_symbol)
+		return;
+
+	stats->orders = g_hash_table_new(g_int64_hash, g_int64_equal);
+	if (!stats->orders)
+		error("out of memory");
+
+	memory_track_table(MEMORY_TABLE_ORDERS, stats->orders, sizeof(struct stats_order));
+}
+
+static gboolean free_entry(gpointer __maybe_unused key, gpointer val, gpointer __maybe_unused data)
+{
+	free(val);
+
+	return TRUE;
+}
+
+void stats_release(struct stats *stats)
+{
+	if (stats->orders) {
+		memory_untrack_table(MEMORY_TABLE_ORDERS);
+
+		g_hash_table_foreach_remove(stats->orders, free_entry, NULL);
+
+		g_hash_table_destroy(stats->orders);
+	}
+
+	free(stats->symbols);
+}
+
+static void stats_grow(struct stats *stats, uint32_t symbol)
+{
+	unsigned int nr = stats->nr_symbols ? stats->nr_symbols : 1024;
+
+	while (nr <= symbol)
+		nr *= 2;
+
+	stats->symbols = realloc(stats->symbols, nr * sizeof(*stats->symbols));
+	if (!stats->symbols)
+		error("out of memory");
+
+	memset(stats->symbols + stats->nr_symbols, 0, (nr - stats->nr_symbols) * sizeof(*stats->symbols));
+
+	stats->nr_symbols = nr;
+}
+
+uint32_t stats_symbol(struct stats *stats, const char *name, size_t len)
+{
+	uint32_t symbol = symbol_cache_intern(&stats->symbol_cache, name, len);
+
+	if (symbol >= stats->nr_symbols)
+		stats_grow(stats, symbol);
+
+	return symbol;
+}
+
+/*
+ * Per-symbol counters are kept only for the message types that carry or
+ * refer to a symbol, which keeps the per-symbol state small.
+ */
+static unsigned int stats_type_slot(struct stats *stats, u8 msg_type)
+{
+	unsigned int slot = stats->type_slots[msg_type];
+
+	if (slot)
+		return slot - 1;
+
+	if (stats->nr_types == STATS_MAX_TYPES)
+		error("%s: too many message types", stats->filename);
+
+	slot = stats->nr_types++;
+
+	stats->types[slot] = msg_type;
+
+	stats->type_slots[msg_type] = slot + 1;
+
+	return slot;
+}
+
+void stats_symbol_message(struct stats *stats, uint32_t symbol, u8 msg_type)
+{
+	struct stats_symbol *sym = &stats->symbols[symbol];
+
+	sym->stats[stats_type_slot(stats, msg_type)]++;
+
+	sym->nr_messages++;
+}
+
+static void stats_remove_order(struct stats *stats, struct stats_order *order)
+{
+	g_hash_table_remove(stats->orders, &order->order_id);
+
+	stats->symbols[order->symbol].nr_orders--;
+
+	stats->nr_orders--;
+
+	free(order);
+}
+
+void stats_add_order(struct stats *stats, uint32_t symbol, uint64_t order_id, uint64_t shares, u8 msg_type)
+{
+	struct stats_symbol *sym = &stats->symbols[symbol];
+	struct stats_order *order;
+
+	stats_symbol_message(stats, symbol, msg_type);
+
+	/* An order identifier that is reused replaces the old order. */
+	order = g_hash_table_lookup(stats->orders, &order_id);
+	if (order)
+		stats_remove_order(stats, order);
+
+	order = malloc(sizeof(*order));
+	if (!order)
+		error("out of memory");
+
+	*order = (struct stats_order) {
+		.order_id	= order_id,
+		.remaining	= shares,
+		.symbol		= symbol,
+	};
+
+	g_hash_table_insert(stats->orders, &order->order_id, order);
+
+	if (++sym->nr_orders > sym->peak_orders)
+		sym->peak_orders = sym->nr_orders;
+
+	if (++stats->nr_orders > stats->peak_orders)
+		stats->peak_orders = stats->nr_orders;
+}
+
+static struct stats_order *stats_order_message(struct stats *stats, uint64_t order_id, u8 msg_type)
+{
+	struct stats_order *order;
+
+	order = g_hash_table_lookup(stats->orders, &order_id);
+	if (!order)
+		return NULL;
+
+	stats_symbol_message(stats, order->symbol, msg_type);
+
+	return order;
+}
+
+/*
+ * Executions and cancels of an order are attributed to the order's symbol.
+ * The order leaves the book once no shares remain.
+ */
+void stats_reduce_order(struct stats *stats, uint64_t order_id, uint64_t shares, u8 msg_type)
+{
+	struct stats_order *order;
+
+	order = stats_order_message(stats, order_id, msg_type);
+	if (!order)
+		return;
+
+	if (shares >= order->remaining)
+		stats_remove_order(stats, order);
+	else
+		order->remaining -= shares;
+}
+
+void stats_replace_order(struct stats *stats, uint64_t order_id, uint64_t new_order_id, uint64_t shares, u8 msg_type)
+{
+	struct stats_order *order;
+	uint32_t symbol;
+
+	order = g_hash_table_lookup(stats->orders, &order_id);
+	if (!order)
+		return;
+
+	symbol = order->symbol;
+
+	stats_remove_order(stats, order);
+
+	stats_add_order(stats, symbol, new_order_id, shares, msg_type);
+}
+
 void print_stat(struct stats *stats, u8 msg_type, const char *name)
 {
 	if (isprint(msg_type))
@@ -29,3 +219,166 @@ void print_stats(struct stats *stats, const char **stat_names, size_t stat_len)
 
 	printf("\n");
 }
+
+struct sort_key {
+	struct stats		*stats;
+	int			slot;		/* type slot, or -1 for all messages */
+};
+
+static uint64_t sort_value(struct sort_key *key, uint32_t symbol)
+{
+	struct stats_symbol *sym = &key->stats->symbols[symbol];
+
+	if (key->slot < 0)
+		return sym->nr_messages;
+
+	return sym->stats[key->slot];
+}
+
+static int compare_messages(const void *a, const void *b, void *data)
+{
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+	uint64_t m = sort_value(data, x), n = sort_value(data, y);
+
+	if (m != n)
+		return m > n ? -1 : 1;
+
+	return x < y ? -1 : x > y;
+}
+
+static int compare_peak_orders(const void *a, const void *b, void *data)
+{
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+	struct stats *stats = data;
+	uint64_t m = stats->symbols[x].peak_orders, n = stats->symbols[y].peak_orders;
+
+	if (m != n)
+		return m > n ? -1 : 1;
+
+	return x < y ? -1 : x > y;
+}
+
+static void sort_by_messages(struct stats *stats, uint32_t *ids, unsigned int nr, int slot)
+{
+	struct sort_key key = {
+		.stats		= stats,
+		.slot		= slot,
+	};
+
+	qsort_r(ids, nr, sizeof(*ids), compare_messages, &key);
+}
+
+static double percent(uint64_t part, uint64_t total)
+{
+	return total ? 100.0 * part / total : 0.0;
+}
+
+void print_symbol_stats(struct stats *stats, const char **stat_names, size_t stat_len, unsigned int top)
+{
+	unsigned int nr = 0, i, j;
+	uint64_t total = 0;
+	uint32_t *ids;
+
+	ids = malloc((stats->nr_symbols + 1) * sizeof(*ids));
+	if (!ids)
+		error("out of memory");
+
+	for (i = 0; i < stats->nr_symbols; i++) {
+		if (!stats->symbols[i].nr_messages)
+			continue;
+
+		total += stats->symbols[i].nr_messages;
+
+		ids[nr++] = i;
+	}
+
+	if (top > nr)
+		top = nr;
+
+	printf(" Symbol stats for '%s':\n\n", stats->filename);
+
+	printf("%'14.0f  %s\n", (double) nr, "Symbols");
+	printf("%'14.0f  %s\n", (double) total, "Messages with a symbol");
+	printf("%'14.0f  %s\n", (double) stats->peak_orders, "Peak live orders");
+	printf("\n");
+
+	printf(" Top %u symbols by message count:\n\n", top);
+
+	sort_by_messages(stats, ids, nr, -1);
+
+	printf("  %-16s %14s %8s %14s\n", "Symbol", "Messages", "Share", "Peak orders");
+
+	for (i = 0; i < top; i++) {
+		struct stats_symbol *sym = &stats->symbols[ids[i]];
+
+		printf("  %-16s %'14.0f %7.2f%% %'14.0f\n",
+			symbol_name(ids[i]),
+			(double) sym->nr_messages,
+			percent(sym->nr_messages, total),
+			(double) sym->peak_orders);
+	}
+
+	printf("\n");
+
+	/*
+	 * The peak number of live orders of a symbol is the peak size of the
+	 * order table when converting that symbol.
+	 */
+	printf(" Top %u symbols by peak live orders:\n\n", top);
+
+	qsort_r(ids, nr, sizeof(*ids), compare_peak_orders, stats);
+
+	printf("  %-16s %14s %14s\n", "Symbol", "Peak orders", "Messages");
+
+	for (i = 0; i < top; i++) {
+		struct stats_symbol *sym = &stats->symbols[ids[i]];
+
+		printf("  %-16s %'14.0f %'14.0f\n",
+			symbol_name(ids[i]),
+			(double) sym->peak_orders,
+			(double) sym->nr_messages);
+	}
+
+	printf("\n");
+
+	printf(" Top %u symbols by message type:\n", top);
+
+	for (i = 0; i < stat_len; i++) {
+		unsigned int slot = stats->type_slots[i];
+		uint64_t type_total = 0;
+		const char *name;
+
+		if (!slot)
+			continue;
+
+		slot--;
+
+		name = stat_names[i] ? stat_names[i] : "<unknown>";
+
+		if (isprint(i))
+			printf("\n  %s # '%c'\n\n", name, i);
+		else
+			printf("\n  %s # 0x%02x\n\n", name, i);
+
+		sort_by_messages(stats, ids, nr, slot);
+
+		for (j = 0; j < nr; j++)
+			type_total += stats->symbols[ids[j]].stats[slot];
+
+		for (j = 0; j < top; j++) {
+			uint64_t count = stats->symbols[ids[j]].stats[slot];
+
+			if (!count)
+				break;
+
+			printf("  %-16s %'14.0f %7.2f%%\n",
+				symbol_name(ids[j]),
+				(double) count,
+				percent(count, type_total));
+		}
+	}
+
+	printf("\n");
+
+	free(ids);
+}
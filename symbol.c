@@ -0,0 +1,65 @@
+#include "tick/symbol.h"
+
+#include "tick/error.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+struct symbol		**symbol_table;
+
+static unsigned int	symbol_table_size;
+static unsigned int	symbol_table_capacity;
+static GHashTable	*symbol_hash;
+
+uint32_t symbol_intern(const char *name, size_t len)
+{
+	char key[SYMBOL_MAX_LEN + 1];
+	struct symbol *sym;
+	gpointer id;
+
+	/* Exchange symbols are padded with spaces. */
+	while (len > 0 && name[len - 1] == ' ')
+		len--;
+
+	if (len > SYMBOL_MAX_LEN)
+		len = SYMBOL_MAX_LEN;
+
+	memcpy(key, name, len);
+	key[len] = '\0';
+
+	if (!symbol_hash) {
+		symbol_hash = g_hash_table_new(g_str_hash, g_str_equal);
+		if (!symbol_hash)
+			error("out of memory");
+	}
+
+	if (g_hash_table_lookup_extended(symbol_hash, key, NULL, &id))
+		return GPOINTER_TO_UINT(id);
+
+	sym = malloc(sizeof(*sym));
+	if (!sym)
+		error("out of memory");
+
+	memcpy(sym->name, key, len + 1);
+	sym->len = len;
+
+	if (symbol_table_size == symbol_table_capacity) {
+		symbol_table_capacity = symbol_table_capacity ? 2 * symbol_table_capacity : 1024;
+
+		symbol_table = realloc(symbol_table, symbol_table_capacity * sizeof(*symbol_table));
+		if (!symbol_table)
+			error("out of memory");
+	}
+
+	symbol_table[symbol_table_size] = sym;
+
+	g_hash_table_insert(symbol_hash, sym->name, GUINT_TO_POINTER(symbol_table_size));
+
+	return symbol_table_size++;
+}
+
+unsigned int nr_symbols(void)
+{
+	return symbol_table_size;
+}
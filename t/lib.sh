@@ -0,0 +1,27 @@
+# Helpers for the tests in this directory.  Each test runs in a scratch
+# directory of its own and exits with a non-zero status on failure.
+
+TICK="$(cd "$(dirname "$0")"/.. && pwd)/tick"
+
+test_name="$(basename "$0" .sh)"
+
+scratch="$(mktemp -d "${TMPDIR:-/tmp}/$test_name.XXXXXX")" || exit 1
+trap 'rm -rf "$scratch"' EXIT
+
+cd "$scratch" || exit 1
+
+tick()
+{
+	"$TICK" "$@" 2>/dev/null || fail "tick $*"
+}
+
+fail()
+{
+	echo "FAIL $test_name: $*"
+	exit 1
+}
+
+ok()
+{
+	echo "ok   $test_name"
+}
@@ -0,0 +1,28 @@
+#!/bin/sh
+#
+# Every chunk of rolled over output is a file of its own: it starts with the
+# header and the date row, and it loads without the chunks before it.
+
+. "$(dirname "$0")"/lib.sh
+
+tick gen -f nasdaq-itch-4.1 -y 1 -n 200K S010313-v41.txt.gz
+tick ob -f nasdaq-itch-4.1 -s HAAA -R 256K S010313-v41.txt.gz ob.tsv
+
+nr_chunks=$(tail -n +2 ob-manifest.tsv | wc -l)
+test "$nr_chunks" -gt 2 || fail "expected more than two chunks, got $nr_chunks"
+
+header=$(head -1 ob-00000.tsv)
+date_row=$(sed -n 2p ob-00000.tsv)
+
+tail -n +2 ob-manifest.tsv | while IFS='	' read -r chunk first last rows bytes; do
+	test "$(head -1 "$chunk")" = "$header" || fail "$chunk: no header"
+	test "$(sed -n 2p "$chunk")" = "$date_row" || fail "$chunk: no date row"
+	test "$(($(wc -l < "$chunk") - 1))" -eq "$rows" || fail "$chunk: row count"
+	test "$(wc -c < "$chunk")" -eq "$bytes" || fail "$chunk: byte count"
+done || exit 1
+
+# A later chunk loads on its own:
+tick cat ob-00002.tsv chunk.tsv
+cmp -s chunk.tsv ob-00002.tsv || fail "ob-00002.tsv does not load on its own"
+
+ok
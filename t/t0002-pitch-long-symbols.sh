@@ -0,0 +1,24 @@
+#!/bin/sh
+#
+# The PITCH symbol filter matches long messages, whose Symbol field has two
+# more bytes than the filter, so a filtered book has a row for every message
+# that 'tick stat' counts for the symbol.  Trade breaks carry no symbol and
+# are not counted.
+
+. "$(dirname "$0")"/lib.sh
+
+tick gen -f bats-pitch-1.12 -y 3 -n 100K pitch20130103.dat.gz
+
+nr_long=$(tick stat -f bats-pitch-1.12 pitch20130103.dat.gz | awk "/# 'd'/ { print \$1 }")
+test "$nr_long" -gt 0 || fail "no long messages generated"
+
+for symbol in HAAA HLSP HXLE; do
+	tick ob -f bats-pitch-1.12 -s $symbol pitch20130103.dat.gz $symbol.tsv
+
+	expected=$(tick stat -f bats-pitch-1.12 -S pitch20130103.dat.gz | awk -v s=$symbol '$1 == s { print $2; exit }')
+	rows=$(awk -F '\t' 'NR > 1 && $1 != "D" && $1 != "B"' $symbol.tsv | wc -l)
+
+	test "$rows" -eq "$expected" || fail "$symbol: $rows rows, expected $expected"
+done
+
+ok
@@ -1,9 +1,122 @@
 #include "tick/taq.h"
 
+#include "tick/profile.h"
+#include "tick/output.h"
+#include "tick/symbol.h"
+#include "tick/error.h"
 #include "tick/types.h"
 #include "tick/dsv.h"
+#include "tick/tsv.h"
 
-#include <unistd.h>
+#include <inttypes.h>
+#include <string.h>
+
+static size_t fmt_event(char *buf, struct taq_event *event)
+{
+	return dsv_fmt_char(buf, event->type, '\t');
+}
+
+static size_t fmt_date(char *buf, struct taq_event *event)
+{
+	return dsv_fmt_value(buf, event->date, event->date_len, '\t');
+}
+
+static size_t fmt_time(char *buf, struct taq_event *event)
+{
+	if (event->fields & TAQ_FIELD_TIME)
+		return dsv_fmt_uint(buf, event->time, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_time_zone(char *buf, struct taq_event *event)
+{
+	return dsv_fmt_value(buf, event->time_zone, event->time_zone_len, '\t');
+}
+
+static size_t fmt_exchange(char *buf, struct taq_event *event)
+{
+	return dsv_fmt_value(buf, event->exchange, event->exchange_len, '\t');
+}
+
+static size_t fmt_symbol(char *buf, struct taq_event *event)
+{
+	if (event->fields & TAQ_FIELD_SYMBOL)
+		return dsv_fmt_value(buf, symbol_name(event->symbol), symbol_len(event->symbol), '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_exec_id(char *buf, struct taq_event *event)
+{
+	if (event->fields & TAQ_FIELD_EXEC_ID)
+		return dsv_fmt_base36(buf, event->exec_id, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_trade_quantity(char *buf, struct taq_event *event)
+{
+	if (event->fields & TAQ_FIELD_TRADE)
+		return dsv_fmt_uint(buf, event->trade_quantity, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_trade_price(char *buf, struct taq_event *event)
+{
+	if (event->fields & TAQ_FIELD_TRADE)
+		return dsv_fmt_price(buf, event->trade_price, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_trade_side(char *buf, struct taq_event *event)
+{
+	return dsv_fmt_char(buf, event->trade_side, '\t');
+}
+
+static size_t fmt_trade_type(char *buf, struct taq_event *event)
+{
+	return dsv_fmt_char(buf, event->trade_type, '\t');
+}
+
+static size_t fmt_status(char *buf, struct taq_event *event)
+{
+	return dsv_fmt_char(buf, event->status, '\t');
+}
+
+static size_t fmt_bid_quantity1(char *buf, struct taq_event *event)
+{
+	if (event->fields & TAQ_FIELD_QUOTE)
+		return dsv_fmt_uint(buf, event->bid_quantity1, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_bid_price1(char *buf, struct taq_event *event)
+{
+	if (event->fields & TAQ_FIELD_QUOTE)
+		return dsv_fmt_price(buf, event->bid_price1, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_ask_quantity1(char *buf, struct taq_event *event)
+{
+	if (event->fields & TAQ_FIELD_QUOTE)
+		return dsv_fmt_uint(buf, event->ask_quantity1, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
+
+static size_t fmt_ask_price1(char *buf, struct taq_event *event)
+{
+	if (event->fields & TAQ_FIELD_QUOTE)
+		return dsv_fmt_price(buf, event->ask_price1, '\t');
+
+	return dsv_fmt_null(buf, '\t');
+}
 
 static const char *column_names[] = {
 	"Event",
@@ -24,32 +137,327 @@ static const char *column_names[] = {
 	"AskPrice1",
 };
 
-void taq_write_header(int fd)
+static const taq_column_fmt_t column_fmts[] = {
+	fmt_event,
+	fmt_date,
+	fmt_time,
+	fmt_time_zone,
+	fmt_exchange,
+	fmt_symbol,
+	fmt_exec_id,
+	fmt_trade_quantity,
+	fmt_trade_price,
+	fmt_trade_side,
+	fmt_trade_type,
+	fmt_status,
+	fmt_bid_quantity1,
+	fmt_bid_price1,
+	fmt_ask_quantity1,
+	fmt_ask_price1,
+};
+
+/*
+ * The Date, TimeZone and Exchange columns are copied from the event, so
+ * their widths are only known per row.
+ */
+static const size_t column_widths[] = {
+	DSV_CHAR_MAX_LEN,
+	1,
+	DSV_UINT_MAX_LEN,
+	1,
+	1,
+	SYMBOL_MAX_LEN + 1,
+	DSV_BASE36_MAX_LEN,
+	DSV_UINT_MAX_LEN,
+	DSV_PRICE_MAX_LEN,
+	DSV_CHAR_MAX_LEN,
+	DSV_CHAR_MAX_LEN,
+	DSV_CHAR_MAX_LEN,
+	DSV_UINT_MAX_LEN,
+	DSV_PRICE_MAX_LEN,
+	DSV_UINT_MAX_LEN,
+	DSV_PRICE_MAX_LEN,
+};
+
+static void parse_event(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len)
+		event->type = field->s[0];
+}
+
+static void parse_date(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->date	= field->s;
+		event->date_len	= field->len;
+	}
+}
+
+static void parse_time(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->time	= dsv_parse_uint(field->s, field->len);
+		event->fields	|= TAQ_FIELD_TIME;
+	}
+}
+
+static void parse_time_zone(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
 {
-	dsv_write_header(fd, column_names, ARRAY_SIZE(column_names), '\t');
+	if (field->len) {
+		event->time_zone	= field->s;
+		event->time_zone_len	= field->len;
+	}
 }
 
-void taq_write_event(int fd, struct taq_event *event)
+static void parse_exchange(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->exchange		= field->s;
+		event->exchange_len	= field->len;
+	}
+}
+
+static void parse_symbol(struct taq_reader *reader, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->symbol	= symbol_cache_intern(&reader->symbol_cache, field->s, field->len);
+		event->fields	|= TAQ_FIELD_SYMBOL;
+	}
+}
+
+static void parse_exec_id(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->exec_id	= dsv_parse_base36(field->s, field->len);
+		event->fields	|= TAQ_FIELD_EXEC_ID;
+	}
+}
+
+static void parse_trade_quantity(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->trade_quantity	= dsv_parse_uint(field->s, field->len);
+		event->fields		|= TAQ_FIELD_TRADE;
+	}
+}
+
+static void parse_trade_price(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->trade_price	= dsv_parse_price(field->s, field->len);
+		event->fields		|= TAQ_FIELD_TRADE;
+	}
+}
+
+static void parse_trade_side(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len)
+		event->trade_side = field->s[0];
+}
+
+static void parse_trade_type(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len)
+		event->trade_type = field->s[0];
+}
+
+static void parse_status(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len)
+		event->status = field->s[0];
+}
+
+static void parse_bid_quantity1(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->bid_quantity1	= dsv_parse_uint(field->s, field->len);
+		event->fields		|= TAQ_FIELD_QUOTE;
+	}
+}
+
+static void parse_bid_price1(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->bid_price1	= dsv_parse_price(field->s, field->len);
+		event->fields		|= TAQ_FIELD_QUOTE;
+	}
+}
+
+static void parse_ask_quantity1(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->ask_quantity1	= dsv_parse_uint(field->s, field->len);
+		event->fields		|= TAQ_FIELD_QUOTE;
+	}
+}
+
+static void parse_ask_price1(struct taq_reader *reader __maybe_unused, struct taq_event *event, const struct tsv_field *field)
+{
+	if (field->len) {
+		event->ask_price1	= dsv_parse_price(field->s, field->len);
+		event->fields		|= TAQ_FIELD_QUOTE;
+	}
+}
+
+static const taq_column_parse_t column_parsers[] = {
+	parse_event,
+	parse_date,
+	parse_time,
+	parse_time_zone,
+	parse_exchange,
+	parse_symbol,
+	parse_exec_id,
+	parse_trade_quantity,
+	parse_trade_price,
+	parse_trade_side,
+	parse_trade_type,
+	parse_status,
+	parse_bid_quantity1,
+	parse_bid_price1,
+	parse_ask_quantity1,
+	parse_ask_price1,
+};
+
+static const char event_types[] = {
+	TAQ_EVENT_DATE,
+	TAQ_EVENT_TRADE,
+	TAQ_EVENT_TRADE_BREAK,
+	TAQ_EVENT_QUOTE,
+	TAQ_EVENT_STATUS,
+	0,
+};
+
+void taq_writer_init(struct taq_writer *writer, const char *columns, const char *events)
+{
+	unsigned int indices[TAQ_NR_COLUMNS];
+	unsigned int i;
+
+	memset(writer, 0, sizeof(*writer));
+
+	if (columns) {
+		writer->nr_columns = dsv_parse_columns(columns, column_names, ARRAY_SIZE(column_names), indices);
+	} else {
+		for (i = 0; i < ARRAY_SIZE(column_names); i++)
+			indices[i] = i;
+
+		writer->nr_columns = ARRAY_SIZE(column_names);
+	}
+
+	for (i = 0; i < writer->nr_columns; i++) {
+		writer->column_names[i]	= column_names[indices[i]];
+		writer->column_fmts[i]	= column_fmts[indices[i]];
+		writer->row_len		+= column_widths[indices[i]];
+	}
+
+	if (writer->row_len > OUTPUT_MAX_RESERVE)
+		error("TAQ rows of up to %zu bytes do not fit in the output buffer", writer->row_len);
+
+	writer->events = dsv_parse_events(events, event_types);
+}
+
+void taq_write_header(struct taq_writer *writer)
+{
+	dsv_write_header(writer->out, writer->column_names, writer->nr_columns, '\t');
+}
+
+void taq_write_event(struct taq_writer *writer, struct taq_event *event)
 {
 	size_t idx = 0;
-	char buf[1024];
-
-	idx += dsv_fmt_char   (buf + idx, event->type, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->date, event->date_len, '\t');
-	idx += dsv_fmt_time   (buf + idx, &event->time, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->time_zone, event->time_zone_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->exchange, event->exchange_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->symbol, event->symbol_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->exec_id, event->exec_id_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->trade_quantity, event->trade_quantity_len, '\t');
-	idx += dsv_fmt_decimal(buf + idx, &event->trade_price, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->trade_side, event->trade_side_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->trade_type, event->trade_type_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->status, event->status_len, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->bid_quantity1, event->bid_quantity1_len, '\t');
-	idx += dsv_fmt_decimal(buf + idx, &event->bid_price1, '\t');
-	idx += dsv_fmt_value  (buf + idx, event->ask_quantity1, event->ask_quantity1_len, '\t');
-	idx += dsv_fmt_decimal(buf + idx, &event->ask_price1, '\n');
-
-	write(fd, buf, idx);
+	unsigned int i;
+	char *buf;
+
+	if (!dsv_event_selected(writer->events, event->type))
+		return;
+
+	if (writer->event_fn) {
+		writer->event_fn(writer->event_data, event);
+		return;
+	}
+
+	profile_enter(PROFILE_STAGE_FORMAT);
+
+	output_begin_row(writer->out, event->fields & TAQ_FIELD_TIME ? event->time : OUTPUT_TIME_NONE);
+
+	buf = output_reserve(writer->out, writer->row_len + event->date_len + event->time_zone_len + event->exchange_len);
+
+	for (i = 0; i < writer->nr_columns; i++)
+		idx += writer->column_fmts[i](buf + idx, event);
+
+	buf[idx - 1] = '\n';
+
+	if (event->type == TAQ_EVENT_DATE)
+		output_set_context(writer->out, buf, idx);
+
+	output_commit(writer->out, idx);
+
+	profile_leave();
+}
+
+static int taq_column_lookup(const struct tsv_field *field)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(column_names); i++) {
+		if (tsv_field_equals(field, column_names[i]))
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Returns true if the header row that was just read is a TAQ header.
+ */
+bool taq_header_match(struct tsv_reader *tsv)
+{
+	unsigned int i;
+
+	for (i = 0; i < tsv->nr_fields; i++) {
+		if (taq_column_lookup(&tsv->fields[i]) < 0)
+			return false;
+	}
+
+	return tsv->nr_fields > 0;
+}
+
+void taq_reader_init(struct taq_reader *reader, struct tsv_reader *tsv)
+{
+	unsigned int i;
+
+	memset(reader, 0, sizeof(*reader));
+
+	reader->tsv = tsv;
+
+	for (i = 0; i < tsv->nr_fields; i++) {
+		const struct tsv_field *field = &tsv->fields[i];
+		int idx;
+
+		idx = taq_column_lookup(field);
+		if (idx < 0)
+			error("%s: %.*s: unknown column", tsv->filename, (int) field->len, field->s);
+
+		reader->column_names[i]		= column_names[idx];
+		reader->column_parsers[i]	= column_parsers[idx];
+	}
+
+	reader->nr_columns = tsv->nr_fields;
+}
+
+bool taq_read_event(struct taq_reader *reader, struct taq_event *event)
+{
+	struct tsv_reader *tsv = reader->tsv;
+	unsigned int i;
+
+	if (!tsv_read_row(tsv))
+		return false;
+
+	if (tsv->nr_fields != reader->nr_columns)
+		error("%s:%" PRIu64 ": expected %u fields, got %u", tsv->filename, tsv->line, reader->nr_columns, tsv->nr_fields);
+
+	memset(event, 0, sizeof(*event));
+
+	for (i = 0; i < reader->nr_columns; i++)
+		reader->column_parsers[i](reader, event, &tsv->fields[i]);
+
+	return true;
 }
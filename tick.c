@@ -18,7 +18,16 @@ const char *program;
 #define DEFINE_BUILTIN(n, c) { .name = n, .cmd_fn = c }
 
 static struct builtin_cmd builtins[] = {
+	DEFINE_BUILTIN("bars",		cmd_bars),
+	DEFINE_BUILTIN("batch",		cmd_batch),
+	DEFINE_BUILTIN("bench",		cmd_bench),
+	DEFINE_BUILTIN("cat",		cmd_cat),
+	DEFINE_BUILTIN("gen",		cmd_gen),
+	DEFINE_BUILTIN("index",		cmd_index),
+	DEFINE_BUILTIN("merge",		cmd_merge),
+	DEFINE_BUILTIN("metrics",	cmd_metrics),
 	DEFINE_BUILTIN("ob",		cmd_ob),
+	DEFINE_BUILTIN("slice",		cmd_slice),
 	DEFINE_BUILTIN("stat",		cmd_stat),
 	DEFINE_BUILTIN("taq",		cmd_taq),
 };
@@ -42,7 +51,16 @@ static void usage(void)
 #define FMT								\
 "\n usage: %s COMMAND [ARGS]\n"						\
 "\n The commands are:\n"						\
+"   bars      Aggregate trades into OHLCV/VWAP bars\n"		\
+"   batch     Run a command over many input files\n"		\
+"   bench     Benchmark decoding and conversion stages\n"		\
+"   cat       Concatenate and convert OB/TAQ files\n"			\
+"   gen       Generate synthetic feed files\n"			\
+"   index     Index OB/TAQ files for slicing\n"			\
+"   merge     Merge OB/TAQ files by time\n"				\
+"   metrics   Compute order book metrics\n"				\
 "   ob        Convert file to OB format\n"				\
+"   slice     Extract a time window of an indexed OB/TAQ file\n"	\
 "   stat      Print stats\n"						\
 "   taq       Convert file to TAQ format\n"				\
 "\n"
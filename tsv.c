@@ -0,0 +1,451 @@
+#include "tick/tsv.h"
+
+#include "tick/error.h"
+
+#ifdef CONFIG_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <zlib.h>
+
+#define TSV_BUF_SIZE		(4ULL << 20) /* 4 MB */
+#define TSV_IN_BUF_SIZE		(1ULL << 20) /* 1 MB */
+
+/*
+ * The window is followed by padding so that the last 64-byte block can be
+ * loaded without checking for the end of the data, and so that a newline
+ * can be appended to a last row that lacks one.
+ */
+#define TSV_BLOCK_SIZE		64
+
+static inline uint64_t tsv_classify(const char *p)
+{
+#if defined(__AVX2__)
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i nl = _mm256_set1_epi8('\n');
+	__m256i lo, hi;
+	uint32_t m0, m1;
+
+	lo = _mm256_loadu_si256((const __m256i *) p);
+	hi = _mm256_loadu_si256((const __m256i *) (p + 32));
+
+	m0 = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(lo, tab), _mm256_cmpeq_epi8(lo, nl)));
+	m1 = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(hi, tab), _mm256_cmpeq_epi8(hi, nl)));
+
+	return (uint64_t) m1 << 32 | m0;
+#elif defined(__SSE2__)
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i nl = _mm_set1_epi8('\n');
+	uint64_t mask = 0;
+	unsigned int i;
+
+	for (i = 0; i < 4; i++) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (p + 16 * i));
+		uint64_t m;
+
+		m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, nl)));
+
+		mask |= m << (16 * i);
+	}
+
+	return mask;
+#else
+	uint64_t mask = 0;
+	unsigned int i;
+
+	for (i = 0; i < TSV_BLOCK_SIZE; i++) {
+		if (p[i] == '\t' || p[i] == '\n')
+			mask |= 1ULL << i;
+	}
+
+	return mask;
+#endif
+}
+
+static size_t tsv_xread(struct tsv_reader *reader, char *buf, size_t len)
+{
+	ssize_t nr;
+
+	for (;;) {
+		nr = read(reader->fd, buf, len);
+		if (nr >= 0)
+			break;
+
+		if (errno != EINTR)
+			error("%s: %s", reader->filename, strerror(errno));
+	}
+
+	return nr;
+}
+
+static void tsv_fill_input(struct tsv_reader *reader)
+{
+	size_t nr;
+
+	if (reader->in_start == reader->in_end)
+		reader->in_start = reader->in_end = 0;
+
+	nr = tsv_xread(reader, reader->in_buf + reader->in_end, TSV_IN_BUF_SIZE - reader->in_end);
+	if (!nr)
+		reader->in_eof = true;
+
+	reader->in_end += nr;
+}
+
+/*
+ * Compressed input must not end in the middle of a gzip member or zstd
+ * frame, or the tail of a damaged file would be dropped without notice.
+ */
+static void tsv_check_truncated(struct tsv_reader *reader)
+{
+	if (reader->in_frame)
+		error("%s: unexpected end of compressed input", reader->filename);
+}
+
+static size_t tsv_inflate(struct tsv_reader *reader, char *buf, size_t len)
+{
+	z_stream *zstream = reader->zstream;
+	size_t ret = 0;
+
+	while (!ret) {
+		int err;
+
+		if (reader->in_start == reader->in_end) {
+			if (reader->in_eof) {
+				tsv_check_truncated(reader);
+				break;
+			}
+
+			tsv_fill_input(reader);
+			continue;
+		}
+
+		zstream->next_in	= (void *) (reader->in_buf + reader->in_start);
+		zstream->avail_in	= reader->in_end - reader->in_start;
+		zstream->next_out	= (void *) buf;
+		zstream->avail_out	= len;
+
+		err = inflate(zstream, Z_NO_FLUSH);
+
+		reader->in_start	= reader->in_end - zstream->avail_in;
+		reader->in_frame	= true;
+		ret			= len - zstream->avail_out;
+
+		/* Output of 'tick' is a series of gzip members: */
+		if (err == Z_STREAM_END) {
+			if (inflateReset(zstream) != Z_OK)
+				error("%s: unable to decompress input", reader->filename);
+
+			reader->in_frame = false;
+		} else if (err != Z_OK && err != Z_BUF_ERROR) {
+			error("%s: unable to decompress input", reader->filename);
+		}
+	}
+
+	return ret;
+}
+
+#ifdef CONFIG_HAVE_ZSTD
+static size_t tsv_zstd_decompress(struct tsv_reader *reader, char *buf, size_t len)
+{
+	ZSTD_outBuffer output;
+	ZSTD_inBuffer input;
+	size_t ret;
+
+	output = (ZSTD_outBuffer) {
+		.dst		= buf,
+		.size		= len,
+	};
+
+	while (!output.pos) {
+		if (reader->in_start == reader->in_end) {
+			if (reader->in_eof) {
+				tsv_check_truncated(reader);
+				break;
+			}
+
+			tsv_fill_input(reader);
+			continue;
+		}
+
+		input = (ZSTD_inBuffer) {
+			.src		= reader->in_buf,
+			.size		= reader->in_end,
+			.pos		= reader->in_start,
+		};
+
+		ret = ZSTD_decompressStream(reader->zstd_dctx, &output, &input);
+		if (ZSTD_isError(ret))
+			error("%s: %s", reader->filename, ZSTD_getErrorName(ret));
+
+		/* Zero means that a frame was completely decoded: */
+		reader->in_start	= input.pos;
+		reader->in_frame	= ret != 0;
+	}
+
+	return output.pos;
+}
+#endif
+
+static size_t tsv_fill(struct tsv_reader *reader, char *buf, size_t len)
+{
+	switch (reader->compression) {
+	case TSV_COMPRESSION_GZIP:
+		return tsv_inflate(reader, buf, len);
+	case TSV_COMPRESSION_ZSTD:
+#ifdef CONFIG_HAVE_ZSTD
+		return tsv_zstd_decompress(reader, buf, len);
+#else
+		break;
+#endif
+	case TSV_COMPRESSION_NONE:
+	default:
+		break;
+	}
+
+	/* Data that was read for detecting compression goes first: */
+	if (reader->in_start < reader->in_end) {
+		size_t nr = reader->in_end - reader->in_start;
+
+		if (nr > len)
+			nr = len;
+
+		memcpy(buf, reader->in_buf + reader->in_start, nr);
+
+		reader->in_start += nr;
+
+		return nr;
+	}
+
+	return tsv_xread(reader, buf, len);
+}
+
+static void tsv_detect_compression(struct tsv_reader *reader)
+{
+	const unsigned char *magic = (void *) reader->in_buf;
+
+	while (reader->in_end < 4 && !reader->in_eof)
+		tsv_fill_input(reader);
+
+	if (reader->in_end >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+		z_stream *zstream;
+
+		zstream = calloc(1, sizeof(*zstream));
+		if (!zstream)
+			error("out of memory");
+
+		if (inflateInit2(zstream, 15 + 16) != Z_OK)
+			error("unable to initialize zlib");
+
+		reader->zstream		= zstream;
+		reader->compression	= TSV_COMPRESSION_GZIP;
+	} else if (reader->in_end >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+#ifdef CONFIG_HAVE_ZSTD
+		reader->zstd_dctx = ZSTD_createDCtx();
+		if (!reader->zstd_dctx)
+			error("unable to initialize zstd");
+
+		reader->compression	= TSV_COMPRESSION_ZSTD;
+#else
+		error("%s: zstd compression is not supported by this build", reader->filename);
+#endif
+	}
+}
+
+void tsv_reader_open(struct tsv_reader *reader, const char *filename)
+{
+	memset(reader, 0, sizeof(*reader));
+
+	reader->filename = filename;
+
+	if (!strcmp(filename, "-")) {
+		reader->fd = STDIN_FILENO;
+	} else {
+		reader->fd = open(filename, O_RDONLY);
+		if (reader->fd < 0)
+			error("%s: %s", filename, strerror(errno));
+	}
+
+	reader->buf	= malloc(TSV_BUF_SIZE + 1 + TSV_BLOCK_SIZE);
+	reader->in_buf	= malloc(TSV_IN_BUF_SIZE);
+	if (!reader->buf || !reader->in_buf)
+		error("out of memory");
+
+	tsv_detect_compression(reader);
+}
+
+void tsv_reader_close(struct tsv_reader *reader)
+{
+	if (reader->zstream) {
+		inflateEnd(reader->zstream);
+
+		free(reader->zstream);
+	}
+
+#ifdef CONFIG_HAVE_ZSTD
+	if (reader->zstd_dctx)
+		ZSTD_freeDCtx(reader->zstd_dctx);
+#endif
+
+	if (reader->fd != STDIN_FILENO && close(reader->fd) < 0)
+		error("%s: %s", reader->filename, strerror(errno));
+
+	free(reader->in_buf);
+	free(reader->buf);
+}
+
+/*
+ * Move the partial row to the start of the window and read more data after
+ * it.  Returns false if there is no more input.
+ */
+static bool tsv_refill(struct tsv_reader *reader)
+{
+	size_t len = reader->end - reader->pos;
+	size_t nr;
+
+	if (reader->eof)
+		return false;
+
+	if (len == TSV_BUF_SIZE)
+		error("%s:%" PRIu64 ": line too long", reader->filename, reader->line + 1);
+
+	memmove(reader->buf, reader->buf + reader->pos, len);
+
+	reader->base	+= reader->pos;
+	reader->pos	= 0;
+	reader->end	= len;
+
+	nr = tsv_fill(reader, reader->buf + reader->end, TSV_BUF_SIZE - reader->end);
+	if (!nr) {
+		reader->eof = true;
+
+		/* Terminate a last row that lacks a newline: */
+		if (!reader->end || reader->buf[reader->end - 1] == '\n')
+			return false;
+
+		reader->buf[reader->end] = '\n';
+
+		nr = 1;
+	}
+
+	reader->end += nr;
+
+	/* Zero the padding so that it has no delimiter bits: */
+	memset(reader->buf + reader->end, 0, TSV_BLOCK_SIZE);
+
+	reader->block	= 0;
+	reader->mask	= tsv_classify(reader->buf);
+
+	return true;
+}
+
+bool tsv_read_row(struct tsv_reader *reader)
+{
+	struct tsv_field *fields = reader->fields;
+	const char *buf = reader->buf;
+	uint64_t mask = reader->mask;
+	size_t block = reader->block;
+	size_t start = reader->pos;
+	size_t end = reader->end;
+	unsigned int nr = 0;
+
+	/*
+	 * Work on local copies: stores to 'fields' could otherwise alias the
+	 * reader state and force it to be reloaded for every field.
+	 */
+	for (;;) {
+		while (mask) {
+			size_t idx = block + __builtin_ctzll(mask);
+
+			mask &= mask - 1;
+
+			if (nr == TSV_MAX_FIELDS)
+				error("%s:%" PRIu64 ": too many fields", reader->filename, reader->line + 1);
+
+			fields[nr].s	= buf + start;
+			fields[nr].len	= idx - start;
+
+			nr++;
+
+			start = idx + 1;
+
+			if (buf[idx] == '\n') {
+				reader->pos		= start;
+				reader->block		= block;
+				reader->mask		= mask;
+				reader->nr_fields	= nr;
+				reader->offset		= reader->base + (fields[0].s - buf);
+				reader->line++;
+
+				return true;
+			}
+		}
+
+		block += TSV_BLOCK_SIZE;
+
+		if (block < end) {
+			mask = tsv_classify(buf + block);
+			continue;
+		}
+
+		/* The row continues past the window: start over after a refill. */
+		if (!tsv_refill(reader))
+			return false;
+
+		buf	= reader->buf;
+		mask	= reader->mask;
+		block	= reader->block;
+		start	= reader->pos;
+		end	= reader->end;
+		nr	= 0;
+	}
+}
+
+/*
+ * Join the fields of the current row with 'delim' into a newly allocated
+ * string.
+ */
+char *tsv_join_fields(struct tsv_reader *reader, char delim)
+{
+	size_t len = 0;
+	unsigned int i;
+	char *ret;
+
+	for (i = 0; i < reader->nr_fields; i++)
+		len += reader->fields[i].len + 1;
+
+	ret = malloc(len + 1);
+	if (!ret)
+		error("out of memory");
+
+	len = 0;
+
+	for (i = 0; i < reader->nr_fields; i++) {
+		const struct tsv_field *field = &reader->fields[i];
+
+		if (i > 0)
+			ret[len++] = delim;
+
+		memcpy(ret + len, field->s, field->len);
+
+		len += field->len;
+	}
+
+	ret[len] = '\0';
+
+	return ret;
+}